@@ -22,6 +22,7 @@
 #include "config/config.h"
 #include "config/configloader.h"
 #include "config/mainconfigsource.h"
+#include "config/defaultconfigsource.h"
 #include "config/configdefinition.h"
 #include "softwarecontainerfactory.h"
 #include "containerutilityinterface.h"
@@ -84,6 +85,7 @@ public:
 #endif
                                      "shutdown-timeout = 1\n"
                                      "shared-mounts-dir = " + std::string(SHARED_MOUNTS_DIR_TESTING) + "\n"
+                                     "write-buffer-sync-dir = " + std::string(WRITE_BUFFER_SYNC_DIR_TESTING) + "\n"
                                      "deprecated-lxc-config-path = " + std::string(LXC_CONFIG_PATH_TESTING) + "\n"
                                      "service-manifest-dir = " + std::string(SERVICE_MANIFEST_DIR_TESTING) + "\n"
                                      "default-service-manifest-dir = " + std::string(DEFAULT_SERVICE_MANIFEST_DIR_TESTING) + "\n";
@@ -95,9 +97,11 @@ public:
         std::unique_ptr<ConfigLoader> loader(new StringConfigLoader(configString));
         std::unique_ptr<ConfigSource> mainConfig(new MainConfigSource(std::move(loader),
                                                                       ConfigDefinition::typeMap()));
+        std::unique_ptr<ConfigSource> defaultConfig(new DefaultConfigSource());
 
         std::vector<std::unique_ptr<ConfigSource>> configSources;
         configSources.push_back(std::move(mainConfig));
+        configSources.push_back(std::move(defaultConfig));
 
         std::shared_ptr<Config> config = std::make_shared<Config>(std::move(configSources),
                                                                   ConfigDefinition::mandatory(),
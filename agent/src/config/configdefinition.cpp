@@ -60,9 +60,13 @@ const std::string ConfigDefinition::SC_GROUP = "SoftwareContainer";
 const std::string ConfigDefinition::SC_USE_SESSION_BUS_KEY = "use-session-bus";
 const std::string ConfigDefinition::SC_SHUTDOWN_TIMEOUT_KEY = "shutdown-timeout";
 const std::string ConfigDefinition::SC_SHARED_MOUNTS_DIR_KEY = "shared-mounts-dir";
+const std::string ConfigDefinition::SC_WRITE_BUFFER_SYNC_DIR_KEY = "write-buffer-sync-dir";
 const std::string ConfigDefinition::SC_LXC_CONFIG_PATH_KEY = "deprecated-lxc-config-path";
 const std::string ConfigDefinition::SC_SERVICE_MANIFEST_DIR_KEY = "service-manifest-dir";
 const std::string ConfigDefinition::SC_DEFAULT_SERVICE_MANIFEST_DIR_KEY = "default-service-manifest-dir";
+const std::string ConfigDefinition::SC_RESOURCE_SAMPLE_INTERVAL_KEY = "resource-sample-interval";
+const std::string ConfigDefinition::SC_RESOURCE_SIGNAL_INTERVAL_KEY = "resource-signal-interval";
+const std::string ConfigDefinition::SC_PRESSURE_THRESHOLD_KEY = "pressure-threshold";
 
 #ifdef ENABLE_NETWORKGATEWAY
 const std::string ConfigDefinition::SC_CREATE_BRIDGE_KEY = "create-bridge";
@@ -126,6 +130,10 @@ const ConfigItems CONFIGS
                     ConfigDefinition::SC_SHARED_MOUNTS_DIR_KEY,
                     ConfigType::String,
                     Optional),
+    std::make_tuple(ConfigDefinition::SC_GROUP,
+                    ConfigDefinition::SC_WRITE_BUFFER_SYNC_DIR_KEY,
+                    ConfigType::String,
+                    Optional),
     std::make_tuple(ConfigDefinition::SC_GROUP,
                     ConfigDefinition::SC_LXC_CONFIG_PATH_KEY,
                     ConfigType::String,
@@ -137,6 +145,18 @@ const ConfigItems CONFIGS
     std::make_tuple(ConfigDefinition::SC_GROUP,
                     ConfigDefinition::SC_DEFAULT_SERVICE_MANIFEST_DIR_KEY,
                     ConfigType::String,
+                    Optional),
+    std::make_tuple(ConfigDefinition::SC_GROUP,
+                    ConfigDefinition::SC_RESOURCE_SAMPLE_INTERVAL_KEY,
+                    ConfigType::Integer,
+                    Optional),
+    std::make_tuple(ConfigDefinition::SC_GROUP,
+                    ConfigDefinition::SC_RESOURCE_SIGNAL_INTERVAL_KEY,
+                    ConfigType::Integer,
+                    Optional),
+    std::make_tuple(ConfigDefinition::SC_GROUP,
+                    ConfigDefinition::SC_PRESSURE_THRESHOLD_KEY,
+                    ConfigType::Integer,
                     Optional)
 };
 
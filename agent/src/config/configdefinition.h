@@ -77,9 +77,13 @@ public:
     static const std::string SC_USE_SESSION_BUS_KEY;
     static const std::string SC_SHUTDOWN_TIMEOUT_KEY;
     static const std::string SC_SHARED_MOUNTS_DIR_KEY;
+    static const std::string SC_WRITE_BUFFER_SYNC_DIR_KEY;
     static const std::string SC_LXC_CONFIG_PATH_KEY;
     static const std::string SC_SERVICE_MANIFEST_DIR_KEY;
     static const std::string SC_DEFAULT_SERVICE_MANIFEST_DIR_KEY;
+    static const std::string SC_RESOURCE_SAMPLE_INTERVAL_KEY;
+    static const std::string SC_RESOURCE_SIGNAL_INTERVAL_KEY;
+    static const std::string SC_PRESSURE_THRESHOLD_KEY;
 
 #ifdef ENABLE_NETWORKGATEWAY
     static const std::string SC_CREATE_BRIDGE_KEY;
@@ -44,6 +44,12 @@ DefaultConfigSource::DefaultConfigSource():
     stringConfig.setSource(ConfigSourceType::Default);
     m_stringConfigs.push_back(stringConfig);
 
+    stringConfig = StringConfig(ConfigDefinition::SC_GROUP,
+                                ConfigDefinition::SC_WRITE_BUFFER_SYNC_DIR_KEY,
+                                SC_WRITE_BUFFER_SYNC_DIR);
+    stringConfig.setSource(ConfigSourceType::Default);
+    m_stringConfigs.push_back(stringConfig);
+
     stringConfig = StringConfig(ConfigDefinition::SC_GROUP,
                                 ConfigDefinition::SC_LXC_CONFIG_PATH_KEY,
                                 SC_LXC_CONFIG_PATH);
@@ -68,6 +74,24 @@ DefaultConfigSource::DefaultConfigSource():
     intConfig.setSource(ConfigSourceType::Default);
     m_intConfigs.push_back(intConfig);
 
+    intConfig = IntConfig(ConfigDefinition::SC_GROUP,
+                          ConfigDefinition::SC_RESOURCE_SAMPLE_INTERVAL_KEY,
+                          SC_RESOURCE_SAMPLE_INTERVAL);
+    intConfig.setSource(ConfigSourceType::Default);
+    m_intConfigs.push_back(intConfig);
+
+    intConfig = IntConfig(ConfigDefinition::SC_GROUP,
+                          ConfigDefinition::SC_RESOURCE_SIGNAL_INTERVAL_KEY,
+                          SC_RESOURCE_SIGNAL_INTERVAL);
+    intConfig.setSource(ConfigSourceType::Default);
+    m_intConfigs.push_back(intConfig);
+
+    intConfig = IntConfig(ConfigDefinition::SC_GROUP,
+                          ConfigDefinition::SC_PRESSURE_THRESHOLD_KEY,
+                          SC_PRESSURE_THRESHOLD);
+    intConfig.setSource(ConfigSourceType::Default);
+    m_intConfigs.push_back(intConfig);
+
     BoolConfig boolConfig = BoolConfig(ConfigDefinition::SC_GROUP,
                             ConfigDefinition::SC_USE_SESSION_BUS_KEY,
                             SC_USE_SESSION_BUS);
@@ -65,9 +65,58 @@ void ContainerOptionParser::readConfigElement(const json_t *element)
                 log_error() << "Could not parse config due to: 'temporaryFileSystemSize' not found.";
             }
             m_options->setTemporaryFileSystemSize(temporaryFileSystemSize);
+
+            int temporaryFileSystemMaxSize = 0;
+            if (JSONParser::read(element, "temporaryFileSystemMaxSize", temporaryFileSystemMaxSize)) {
+                if (temporaryFileSystemMaxSize < temporaryFileSystemSize) {
+                    std::string errorMessage("'temporaryFileSystemMaxSize' can not be smaller "
+                                             "than 'temporaryFileSystemSize'");
+                    log_error() << errorMessage;
+                    throw ContainerOptionParseError(errorMessage);
+                }
+                m_options->setTemporaryFileSystemMaxSize(temporaryFileSystemMaxSize);
+            }
+        }
+
+        bool asyncWriteBufferSync = false;
+        if (!JSONParser::read(element, "asyncWriteBufferSync", asyncWriteBufferSync)) {
+            log_debug() << "'asyncWriteBufferSync' not found, syncing write buffer on destroy";
+        }
+        m_options->setAsyncWriteBufferSync(asyncWriteBufferSync);
+
+        bool volatileWriteBuffer = false;
+        if (!JSONParser::read(element, "volatileWriteBuffer", volatileWriteBuffer)) {
+            log_debug() << "'volatileWriteBuffer' not found, keeping syncs in the container";
+        }
+        m_options->setVolatileWriteBuffer(volatileWriteBuffer);
+
+        std::string appImage;
+        if (JSONParser::read(element, "appImage", appImage)) {
+            if (appImage.empty() || appImage.front() != '/') {
+                std::string errorMessage("'appImage' must be an absolute path, got '"
+                                         + appImage + "'");
+                log_error() << errorMessage;
+                throw ContainerOptionParseError(errorMessage);
+            }
+            m_options->setAppImage(appImage);
         }
     }
 
+    std::string priorityClass;
+    if (JSONParser::read(element, "priorityClass", priorityClass)) {
+        if (priorityClass == "realtime") {
+            m_options->setPriorityClass(PriorityClass::RealTime);
+        } else if (priorityClass == "foreground") {
+            m_options->setPriorityClass(PriorityClass::Foreground);
+        } else if (priorityClass == "background") {
+            m_options->setPriorityClass(PriorityClass::Background);
+        } else {
+            std::string errorMessage("'priorityClass' must be one of 'realtime', 'foreground' "
+                                     "or 'background', got '" + priorityClass + "'");
+            log_error() << errorMessage;
+            throw ContainerOptionParseError(errorMessage);
+        }
+    }
 }
 
 std::unique_ptr<DynamicContainerOptions> ContainerOptionParser::parse(const std::string &config)
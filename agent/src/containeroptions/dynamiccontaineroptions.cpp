@@ -27,6 +27,12 @@ std::unique_ptr<SoftwareContainerConfig> DynamicContainerOptions::toConfig(const
         std::unique_ptr<SoftwareContainerConfig>(new SoftwareContainerConfig(conf));
 
     dynamicConf->setEnableWriteBuffer(writeBufferEnabled());
+    dynamicConf->setEnableTemporaryFileSystemWriteBuffers(temporaryFileSystemWriteBufferEnabled());
+    dynamicConf->setTemporaryFileSystemSize(temporaryFileSystemSize());
+    dynamicConf->setTemporaryFileSystemMaxSize(temporaryFileSystemMaxSize());
+    dynamicConf->setAsyncWriteBufferSync(asyncWriteBufferSync());
+    dynamicConf->setAppImage(appImage());
+    dynamicConf->setVolatileWriteBuffer(volatileWriteBuffer());
     return dynamicConf;
 }
 
@@ -60,4 +66,54 @@ unsigned int DynamicContainerOptions::temporaryFileSystemSize() const
     return m_temporaryFileSystemSize;
 }
 
+void DynamicContainerOptions::setTemporaryFileSystemMaxSize(unsigned int size)
+{
+    m_temporaryFileSystemMaxSize = size;
+}
+
+unsigned int DynamicContainerOptions::temporaryFileSystemMaxSize() const
+{
+    return m_temporaryFileSystemMaxSize;
+}
+
+void DynamicContainerOptions::setAsyncWriteBufferSync(bool enabled)
+{
+    m_asyncWriteBufferSync = enabled;
+}
+
+bool DynamicContainerOptions::asyncWriteBufferSync() const
+{
+    return m_asyncWriteBufferSync;
+}
+
+void DynamicContainerOptions::setAppImage(const std::string &imagePath)
+{
+    m_appImage = imagePath;
+}
+
+std::string DynamicContainerOptions::appImage() const
+{
+    return m_appImage;
+}
+
+void DynamicContainerOptions::setVolatileWriteBuffer(bool enabled)
+{
+    m_volatileWriteBuffer = enabled;
+}
+
+bool DynamicContainerOptions::volatileWriteBuffer() const
+{
+    return m_volatileWriteBuffer;
+}
+
+void DynamicContainerOptions::setPriorityClass(PriorityClass priorityClass)
+{
+    m_priorityClass = priorityClass;
+}
+
+PriorityClass DynamicContainerOptions::priorityClass() const
+{
+    return m_priorityClass;
+}
+
 } // namespace softwarecontainer
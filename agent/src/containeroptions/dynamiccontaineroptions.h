@@ -25,6 +25,19 @@
 
 namespace softwarecontainer {
 
+/**
+ * @brief How important a container is when the agent places containers on CPUs.
+ *
+ * RealTime containers get a core of their own, Foreground containers share all cores
+ * that are not given away, and Background containers are kept to a part of those.
+ */
+enum class PriorityClass
+{
+    RealTime,
+    Foreground,
+    Background
+};
+
 class DynamicContainerOptions
 {
 public:
@@ -66,10 +79,71 @@ public:
      */
     unsigned int temporaryFileSystemSize() const;
 
+    /**
+     * @brief Setter for the size the tmpfs mounted on the temp directory may be grown to
+     * when it fills up. If it is not larger than temporaryFileSystemSize, the tmpfs keeps
+     * its initial size.
+     * @param size in bytes of the filesystem
+     */
+    void setTemporaryFileSystemMaxSize(unsigned int size);
+    /**
+     * @brief Getter for the temporaryFileSystemMaxSize variable.
+     * @return the max size
+     */
+    unsigned int temporaryFileSystemMaxSize() const;
+
+    /**
+     * @brief Setter for whether the write buffer should be synced in the background after the
+     * container is destroyed, instead of as part of destroying it.
+     */
+    void setAsyncWriteBufferSync(bool enabled);
+
+    /**
+     * @brief Getter for the asyncWriteBufferSync variable
+     */
+    bool asyncWriteBufferSync() const;
+
+    /**
+     * @brief Setter for the path of a read-only EROFS or squashfs image to use as the bottom
+     * layer of the container root filesystem overlay, or empty for none.
+     */
+    void setAppImage(const std::string &imagePath);
+
+    /**
+     * @brief Getter for the appImage variable
+     */
+    std::string appImage() const;
+
+    /**
+     * @brief Setter for whether the write buffer overlays should be mounted volatile, i.e.
+     * with syncs inside the container turned into no-ops.
+     */
+    void setVolatileWriteBuffer(bool enabled);
+
+    /**
+     * @brief Getter for the volatileWriteBuffer variable
+     */
+    bool volatileWriteBuffer() const;
+
+    /**
+     * @brief Setter for the priority class used when placing the container on CPUs.
+     */
+    void setPriorityClass(PriorityClass priorityClass);
+
+    /**
+     * @brief Getter for the priorityClass variable
+     */
+    PriorityClass priorityClass() const;
+
 private:
     bool m_writeBufferEnabled = false;
     bool m_temporaryFileSystemWriteBufferEnabled = false;
-    unsigned int m_temporaryFileSystemSize;
+    unsigned int m_temporaryFileSystemSize = 0;
+    unsigned int m_temporaryFileSystemMaxSize = 0;
+    bool m_asyncWriteBufferSync = false;
+    std::string m_appImage;
+    bool m_volatileWriteBuffer = false;
+    PriorityClass m_priorityClass = PriorityClass::Foreground;
 };
 
 } // namespace softwarecontainer
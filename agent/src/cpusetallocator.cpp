@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+
+#include "cpusetallocator.h"
+
+#include <algorithm>
+#include <set>
+
+namespace softwarecontainer {
+
+CpusetAllocator::CpusetAllocator(const std::vector<unsigned int> &cpus) :
+    m_cpus(cpus),
+    m_allCpus(formatCpuList(cpus))
+{
+    std::sort(m_cpus.begin(), m_cpus.end());
+    m_cpus.erase(std::unique(m_cpus.begin(), m_cpus.end()), m_cpus.end());
+}
+
+std::vector<unsigned int> CpusetAllocator::onlineCpus(const std::string &path)
+{
+    std::string content;
+    std::vector<unsigned int> cpus;
+    if (!readFromFile(path, content) || !parseCpuList(content, cpus)) {
+        log_warning() << "Could not read online CPUs from " << path;
+        return std::vector<unsigned int>();
+    }
+    return cpus;
+}
+
+CpusetAllocator::Placement CpusetAllocator::add(ContainerID containerID,
+                                                PriorityClass priorityClass)
+{
+    if (m_cpus.empty()) {
+        return Placement();
+    }
+
+    m_classes[containerID] = priorityClass;
+    return rebalance();
+}
+
+CpusetAllocator::Placement CpusetAllocator::remove(ContainerID containerID)
+{
+    if (m_classes.erase(containerID) == 0) {
+        return Placement();
+    }
+
+    m_exclusiveCores.erase(containerID);
+    m_placement.erase(containerID);
+    return rebalance();
+}
+
+CpusetAllocator::Placement CpusetAllocator::placement() const
+{
+    return m_placement;
+}
+
+CpusetAllocator::Placement CpusetAllocator::rebalance()
+{
+    std::set<unsigned int> taken;
+    for (auto &it : m_exclusiveCores) {
+        taken.insert(it.second);
+    }
+
+    std::vector<unsigned int> shared;
+    for (unsigned int cpu : m_cpus) {
+        if (taken.count(cpu) == 0) {
+            shared.push_back(cpu);
+        }
+    }
+
+    // Realtime containers keep the core they have, waiting ones get the freed cores in ID order
+    for (auto &it : m_classes) {
+        if (shared.size() <= 1) {
+            break;
+        }
+        if (it.second == PriorityClass::RealTime && m_exclusiveCores.count(it.first) == 0) {
+            m_exclusiveCores[it.first] = shared.back();
+            shared.pop_back();
+        }
+    }
+
+    std::string sharedCpus = formatCpuList(shared);
+    size_t backgroundCount = std::max<size_t>(1, shared.size() / 2);
+    std::string backgroundCpus = formatCpuList(
+        std::vector<unsigned int>(shared.begin(), shared.begin() + backgroundCount));
+
+    Placement changed;
+    for (auto &it : m_classes) {
+        std::string cpus;
+        auto exclusive = m_exclusiveCores.find(it.first);
+        if (exclusive != m_exclusiveCores.end()) {
+            cpus = std::to_string(exclusive->second);
+        } else if (it.second == PriorityClass::Background) {
+            cpus = backgroundCpus;
+        } else {
+            cpus = sharedCpus;
+        }
+
+        // A container that has not been placed yet may run on all CPUs
+        auto previous = m_placement.find(it.first);
+        std::string previousCpus = previous == m_placement.end() ? m_allCpus : previous->second;
+        if (cpus != previousCpus) {
+            log_debug() << "Placing container " << it.first << " on CPUs " << cpus;
+            changed[it.first] = cpus;
+        }
+        m_placement[it.first] = cpus;
+    }
+
+    return changed;
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+#include "containeroptions/dynamiccontaineroptions.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The CpusetAllocator class decides which CPUs each container may run on.
+ *
+ * Every realtime container is given a core of its own, taken from the top of the CPU list
+ * downwards, as long as at least one core is left for the other containers. A realtime
+ * container that finds no free core shares the remaining cores until one is freed. The cores
+ * that are not given away form the shared pool: foreground containers may use all of it and
+ * background containers the lower half of it, so that foreground containers always have some
+ * cores that background work does not compete for.
+ *
+ * The placement is recomputed whenever a container is added or removed, and the containers
+ * whose CPUs changed are returned so the caller can apply them through cpuset.cpus.
+ */
+class CpusetAllocator
+{
+    LOG_DECLARE_CLASS_CONTEXT("CPUA", "Cpuset allocator");
+
+public:
+    /**
+     * @brief Maps container IDs to CPU lists in the format used by cpuset.cpus
+     */
+    typedef std::map<ContainerID, std::string> Placement;
+
+    /**
+     * @param cpus The CPUs to place containers on. If empty, no placement is done.
+     */
+    CpusetAllocator(const std::vector<unsigned int> &cpus);
+
+    /**
+     * @brief The CPUs that are online on the host, or an empty list if they can't be read
+     */
+    static std::vector<unsigned int> onlineCpus(const std::string &path = "/sys/devices/system/cpu/online");
+
+    /**
+     * @brief Place a new container on CPUs according to its priority class
+     *
+     * @return The containers, including the new one, whose CPUs changed. A new container that
+     *         may run on all CPUs is not included.
+     */
+    Placement add(ContainerID containerID, PriorityClass priorityClass);
+
+    /**
+     * @brief Stop placing a container and give its CPUs to the remaining containers
+     *
+     * @return The remaining containers whose CPUs changed
+     */
+    Placement remove(ContainerID containerID);
+
+    /**
+     * @brief The CPUs of all placed containers
+     */
+    Placement placement() const;
+
+private:
+    Placement rebalance();
+
+    std::vector<unsigned int> m_cpus;
+    std::string m_allCpus;
+    std::map<ContainerID, PriorityClass> m_classes;
+    std::map<ContainerID, unsigned int> m_exclusiveCores;
+    Placement m_placement;
+};
+
+} // namespace softwarecontainer
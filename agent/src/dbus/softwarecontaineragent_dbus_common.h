@@ -88,6 +88,17 @@ void returnValue(T0 p0, T1 p1)
     m_message->return_value(Glib::Variant<Glib::VariantBase>::create_tuple(vlist));
 }
 
+template <typename T0,typename T1,typename T2>
+void returnValue(T0 p0, T1 p1, T2 p2)
+{
+    std::vector<Glib::VariantBase> vlist;
+    vlist.push_back(Glib::Variant<T0>::create(p0));
+    vlist.push_back(Glib::Variant<T1>::create(p1));
+    vlist.push_back(Glib::Variant<T2>::create(p2));
+
+    m_message->return_value(Glib::Variant<Glib::VariantBase>::create_tuple(vlist));
+}
+
 void returnError(const std::string &errorMessage)
 {
     Gio::DBus::Error error(Gio::DBus::Error::FAILED, errorMessage);
@@ -9,6 +9,11 @@ Glib::ustring interfaceXml0 = R"XML_DELIMITER(
             <arg direction="out" type="ai" name="containers" />
         </method>
 
+        <method name="ListContainerStatus">
+            <arg direction="in" type="b" name="includeUsage" />
+            <arg direction="out" type="a(isiaiasta{st})" name="statuses" />
+        </method>
+
         <method name="Create">
             <arg direction="in" type="s" name="config" />
             <arg direction="out" type="i" name="containerID" />
@@ -31,10 +36,30 @@ Glib::ustring interfaceXml0 = R"XML_DELIMITER(
             <arg direction="in" type="i" name="containerID" />
         </method>
 
+        <method name="SuspendMany">
+            <arg direction="in" type="ai" name="containerIDs" />
+            <arg direction="out" type="a{ib}" name="results" />
+        </method>
+
+        <method name="ResumeMany">
+            <arg direction="in" type="ai" name="containerIDs" />
+            <arg direction="out" type="a{ib}" name="results" />
+        </method>
+
         <method name="Destroy">
             <arg direction="in" type="i" name="containerID" />
         </method>
 
+        <method name="Checkpoint">
+            <arg direction="in" type="i" name="containerID" />
+            <arg direction="in" type="s" name="directory" />
+        </method>
+
+        <method name="Restore">
+            <arg direction="in" type="s" name="directory" />
+            <arg direction="out" type="i" name="containerID" />
+        </method>
+
         <method name="BindMount">
             <arg direction="in" type="i" name="containerID" />
             <arg direction="in" type="s" name="pathInHost" />
@@ -51,11 +76,79 @@ Glib::ustring interfaceXml0 = R"XML_DELIMITER(
             <arg direction="in" type="as" name="capabilities" />
         </method>
 
+        <method name="SetCgroupLimits">
+            <arg direction="in" type="i" name="containerID" />
+            <arg direction="in" type="a{ss}" name="limits" />
+        </method>
+
+        <method name="GetWriteBufferUsage">
+            <arg direction="in" type="i" name="containerID" />
+            <arg direction="out" type="t" name="usedBytes" />
+            <arg direction="out" type="t" name="freeBytes" />
+            <arg direction="out" type="t" name="sizeBytes" />
+        </method>
+
+        <method name="GetProcessHistory">
+            <arg direction="in" type="i" name="containerID" />
+            <arg direction="out" type="aa{st}" name="processes" />
+        </method>
+
+        <method name="GetCpuPlacement">
+            <arg direction="out" type="a{is}" name="placement" />
+        </method>
+
+        <method name="GetResourceUsage">
+            <arg direction="in" type="i" name="containerID" />
+            <arg direction="out" type="a{st}" name="usage" />
+            <arg direction="out" type="a{st}" name="delta" />
+        </method>
+
+        <method name="TailOutput">
+            <arg direction="in" type="u" name="processID" />
+            <arg direction="in" type="u" name="maxBytes" />
+            <arg direction="out" type="ay" name="output" />
+        </method>
+
         <signal name="ProcessStateChanged">
             <arg direction="out" type="i" name="containerID"/>
             <arg direction="out" type="u" name="processID"/>
             <arg direction="out" type="b" name="isRunning"/>
             <arg direction="out" type="u" name="exitCode"/>
+            <arg direction="out" type="a{st}" name="usage"/>
+        </signal>
+
+        <signal name="WriteBufferSynced">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="b" name="success"/>
+        </signal>
+
+        <signal name="WriteBufferHighWater">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="t" name="usedBytes"/>
+            <arg direction="out" type="t" name="sizeBytes"/>
+        </signal>
+
+        <signal name="ResourceUsageSampled">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="a{st}" name="usage"/>
+            <arg direction="out" type="a{st}" name="delta"/>
+        </signal>
+
+        <signal name="PressureThresholdReached">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="s" name="resource"/>
+            <arg direction="out" type="d" name="avg10"/>
+        </signal>
+
+        <signal name="MemoryEvent">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="s" name="event"/>
+            <arg direction="out" type="t" name="count"/>
+        </signal>
+
+        <signal name="ContainerDestroyed">
+            <arg direction="out" type="i" name="containerID"/>
+            <arg direction="out" type="t" name="durationMs"/>
         </signal>
 
     </interface>
@@ -71,6 +164,24 @@ com::pelagicore::SoftwareContainerAgent::SoftwareContainerAgent() :
     ProcessStateChanged_signal.connect(
         sigc::mem_fun(this, &SoftwareContainerAgent::ProcessStateChanged_emitter)
     );
+    WriteBufferSynced_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::WriteBufferSynced_emitter)
+    );
+    WriteBufferHighWater_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::WriteBufferHighWater_emitter)
+    );
+    ResourceUsageSampled_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::ResourceUsageSampled_emitter)
+    );
+    PressureThresholdReached_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::PressureThresholdReached_emitter)
+    );
+    MemoryEvent_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::MemoryEvent_emitter)
+    );
+    ContainerDestroyed_signal.connect(
+        sigc::mem_fun(this, &SoftwareContainerAgent::ContainerDestroyed_emitter)
+    );
 }
 
 void com::pelagicore::SoftwareContainerAgent::connect(
@@ -106,6 +217,17 @@ void com::pelagicore::SoftwareContainerAgent::on_method_call(const Glib::RefPtr<
                 SoftwareContainerAgentMessageHelper(invocation));
         }
 
+        if (method_name.compare("ListContainerStatus") == 0) {
+            Glib::Variant<bool > base_includeUsage;
+            parameters.get_child(base_includeUsage, 0);
+            bool p_includeUsage;
+            p_includeUsage = base_includeUsage.get();
+
+            ListContainerStatus(
+                (p_includeUsage),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
         if (method_name.compare("Create") == 0) {
             Glib::Variant<Glib::ustring > base_config;
             parameters.get_child(base_config, 0);
@@ -174,6 +296,28 @@ void com::pelagicore::SoftwareContainerAgent::on_method_call(const Glib::RefPtr<
                 SoftwareContainerAgentMessageHelper(invocation));
         }
 
+        if (method_name.compare("SuspendMany") == 0) {
+            Glib::Variant<std::vector<gint32> > base_containerIDs;
+            parameters.get_child(base_containerIDs, 0);
+            std::vector<gint32> p_containerIDs;
+            p_containerIDs = base_containerIDs.get();
+
+            SuspendMany(
+                (p_containerIDs),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("ResumeMany") == 0) {
+            Glib::Variant<std::vector<gint32> > base_containerIDs;
+            parameters.get_child(base_containerIDs, 0);
+            std::vector<gint32> p_containerIDs;
+            p_containerIDs = base_containerIDs.get();
+
+            ResumeMany(
+                (p_containerIDs),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
         if (method_name.compare("Destroy") == 0) {
             Glib::Variant<gint32 > base_containerID;
             parameters.get_child(base_containerID, 0);
@@ -185,6 +329,34 @@ void com::pelagicore::SoftwareContainerAgent::on_method_call(const Glib::RefPtr<
                 SoftwareContainerAgentMessageHelper(invocation));
         }
 
+        if (method_name.compare("Checkpoint") == 0) {
+            Glib::Variant<gint32 > base_containerID;
+            parameters.get_child(base_containerID, 0);
+            gint32 p_containerID;
+            p_containerID = base_containerID.get();
+
+            Glib::Variant<Glib::ustring > base_directory;
+            parameters.get_child(base_directory, 1);
+            Glib::ustring p_directory;
+            p_directory = base_directory.get();
+
+            Checkpoint(
+                (p_containerID),
+                Glib::ustring(p_directory),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("Restore") == 0) {
+            Glib::Variant<Glib::ustring > base_directory;
+            parameters.get_child(base_directory, 0);
+            Glib::ustring p_directory;
+            p_directory = base_directory.get();
+
+            Restore(
+                Glib::ustring(p_directory),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
         if (method_name.compare("BindMount") == 0) {
             Glib::Variant<gint32 > base_containerID;
             parameters.get_child(base_containerID, 0);
@@ -235,6 +407,78 @@ void com::pelagicore::SoftwareContainerAgent::on_method_call(const Glib::RefPtr<
                 SoftwareContainerAgentCommon::glibStringVecToStdStringVec(p_capabilities),
                 SoftwareContainerAgentMessageHelper(invocation));
         }
+
+        if (method_name.compare("SetCgroupLimits") == 0) {
+            Glib::Variant<gint32 > base_containerID;
+            parameters.get_child(base_containerID, 0);
+            gint32 p_containerID;
+            p_containerID = base_containerID.get();
+
+            Glib::Variant<std::map<Glib::ustring, Glib::ustring> > base_limits;
+            parameters.get_child(base_limits, 1);
+            std::map<Glib::ustring, Glib::ustring> p_limits;
+            p_limits = base_limits.get();
+
+            SetCgroupLimits(
+                (p_containerID),
+                SoftwareContainerAgentCommon::glibStringMapToStdStringMap(p_limits),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("GetWriteBufferUsage") == 0) {
+            Glib::Variant<gint32 > base_containerID;
+            parameters.get_child(base_containerID, 0);
+            gint32 p_containerID;
+            p_containerID = base_containerID.get();
+
+            GetWriteBufferUsage(
+                (p_containerID),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("GetProcessHistory") == 0) {
+            Glib::Variant<gint32 > base_containerID;
+            parameters.get_child(base_containerID, 0);
+            gint32 p_containerID;
+            p_containerID = base_containerID.get();
+
+            GetProcessHistory(
+                (p_containerID),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("GetCpuPlacement") == 0) {
+            GetCpuPlacement(
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("GetResourceUsage") == 0) {
+            Glib::Variant<gint32 > base_containerID;
+            parameters.get_child(base_containerID, 0);
+            gint32 p_containerID;
+            p_containerID = base_containerID.get();
+
+            GetResourceUsage(
+                (p_containerID),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
+
+        if (method_name.compare("TailOutput") == 0) {
+            Glib::Variant<guint32 > base_processID;
+            parameters.get_child(base_processID, 0);
+            guint32 p_processID;
+            p_processID = base_processID.get();
+
+            Glib::Variant<guint32 > base_maxBytes;
+            parameters.get_child(base_maxBytes, 1);
+            guint32 p_maxBytes;
+            p_maxBytes = base_maxBytes.get();
+
+            TailOutput(
+                (p_processID),
+                (p_maxBytes),
+                SoftwareContainerAgentMessageHelper(invocation));
+        }
     } catch (softwarecontainer::SoftwareContainerError &err) {
         SoftwareContainerAgentMessageHelper msg(invocation);
         std::string errorMessage(err.what());
@@ -267,13 +511,15 @@ void com::pelagicore::SoftwareContainerAgent::ProcessStateChanged_emitter(
     gint32 containerID,
     guint32 processID,
     bool isRunning,
-    guint32 exitCode)
+    guint32 exitCode,
+    std::map<Glib::ustring, guint64> usage)
 {
     std::vector<Glib::VariantBase> paramsList;
     paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
     paramsList.push_back(Glib::Variant<guint32 >::create((processID)));;
     paramsList.push_back(Glib::Variant<bool >::create((isRunning)));;
     paramsList.push_back(Glib::Variant<guint32 >::create((exitCode)));;
+    paramsList.push_back(Glib::Variant<std::map<Glib::ustring, guint64> >::create((usage)));;
 
     m_connection->emit_signal(
         "/com/pelagicore/SoftwareContainerAgent",
@@ -283,6 +529,135 @@ void com::pelagicore::SoftwareContainerAgent::ProcessStateChanged_emitter(
         Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
 }
 
+void com::pelagicore::SoftwareContainerAgent::WriteBufferSynced_emitter(
+    gint32 containerID,
+    bool success)
+{
+    // Syncs resumed at startup may finish before the bus is acquired
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<bool >::create((success)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "WriteBufferSynced",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
+void com::pelagicore::SoftwareContainerAgent::WriteBufferHighWater_emitter(
+    gint32 containerID,
+    guint64 usedBytes,
+    guint64 sizeBytes)
+{
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<guint64 >::create((usedBytes)));;
+    paramsList.push_back(Glib::Variant<guint64 >::create((sizeBytes)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "WriteBufferHighWater",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
+void com::pelagicore::SoftwareContainerAgent::ResourceUsageSampled_emitter(
+    gint32 containerID,
+    std::map<Glib::ustring, guint64> usage,
+    std::map<Glib::ustring, guint64> delta)
+{
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<std::map<Glib::ustring, guint64> >::create((usage)));;
+    paramsList.push_back(Glib::Variant<std::map<Glib::ustring, guint64> >::create((delta)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "ResourceUsageSampled",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
+void com::pelagicore::SoftwareContainerAgent::PressureThresholdReached_emitter(
+    gint32 containerID,
+    std::string resource,
+    double avg10)
+{
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<Glib::ustring >::create((resource)));;
+    paramsList.push_back(Glib::Variant<double >::create((avg10)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "PressureThresholdReached",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
+void com::pelagicore::SoftwareContainerAgent::MemoryEvent_emitter(
+    gint32 containerID,
+    std::string event,
+    guint64 count)
+{
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<Glib::ustring >::create((event)));;
+    paramsList.push_back(Glib::Variant<guint64 >::create((count)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "MemoryEvent",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
+void com::pelagicore::SoftwareContainerAgent::ContainerDestroyed_emitter(
+    gint32 containerID,
+    guint64 durationMs)
+{
+    if (!m_connection) {
+        return;
+    }
+
+    std::vector<Glib::VariantBase> paramsList;
+    paramsList.push_back(Glib::Variant<gint32 >::create((containerID)));;
+    paramsList.push_back(Glib::Variant<guint64 >::create((durationMs)));;
+
+    m_connection->emit_signal(
+        "/com/pelagicore/SoftwareContainerAgent",
+        "com.pelagicore.SoftwareContainerAgent",
+        "ContainerDestroyed",
+        Glib::ustring(),
+        Glib::Variant<std::vector<Glib::VariantBase> >::create_tuple(paramsList));
+}
+
 void com::pelagicore::SoftwareContainerAgent::on_bus_acquired(
     const Glib::RefPtr<Gio::DBus::Connection>& connection,
     const Glib::ustring& /* name */)
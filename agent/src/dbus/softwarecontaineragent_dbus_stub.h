@@ -18,6 +18,10 @@ protected:
     virtual void List (
         const SoftwareContainerAgentMessageHelper msg) = 0;
 
+    virtual void ListContainerStatus (
+        bool includeUsage,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
     virtual void Create (
         std::string config,
         const SoftwareContainerAgentMessageHelper msg) = 0;
@@ -38,10 +42,27 @@ protected:
         gint32 containerID,
         const SoftwareContainerAgentMessageHelper msg) = 0;
 
+    virtual void SuspendMany (
+        std::vector<gint32>  containerIDs,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void ResumeMany (
+        std::vector<gint32>  containerIDs,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
     virtual void Destroy (
         gint32 containerID,
         const SoftwareContainerAgentMessageHelper msg) = 0;
 
+    virtual void Checkpoint (
+        gint32 containerID,
+        std::string directory,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void Restore (
+        std::string directory,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
     virtual void BindMount (
         gint32 containerID,
         std::string pathInHost,
@@ -57,8 +78,51 @@ protected:
         std::vector<std::string>  capabilities,
         const SoftwareContainerAgentMessageHelper msg) = 0;
 
-    void ProcessStateChanged_emitter(gint32, guint32, bool, guint32);
-    sigc::signal<void, gint32, guint32, bool, guint32 > ProcessStateChanged_signal;
+    virtual void SetCgroupLimits (
+        gint32 containerID,
+        std::map<std::string, std::string>  limits,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void GetWriteBufferUsage (
+        gint32 containerID,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void GetProcessHistory (
+        gint32 containerID,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void GetCpuPlacement (
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void GetResourceUsage (
+        gint32 containerID,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    virtual void TailOutput (
+        guint32 processID,
+        guint32 maxBytes,
+        const SoftwareContainerAgentMessageHelper msg) = 0;
+
+    void ProcessStateChanged_emitter(gint32, guint32, bool, guint32, std::map<Glib::ustring, guint64>);
+    sigc::signal<void, gint32, guint32, bool, guint32, std::map<Glib::ustring, guint64> > ProcessStateChanged_signal;
+
+    void WriteBufferSynced_emitter(gint32, bool);
+    sigc::signal<void, gint32, bool > WriteBufferSynced_signal;
+
+    void WriteBufferHighWater_emitter(gint32, guint64, guint64);
+    sigc::signal<void, gint32, guint64, guint64 > WriteBufferHighWater_signal;
+
+    void ResourceUsageSampled_emitter(gint32, std::map<Glib::ustring, guint64>, std::map<Glib::ustring, guint64>);
+    sigc::signal<void, gint32, std::map<Glib::ustring, guint64>, std::map<Glib::ustring, guint64> > ResourceUsageSampled_signal;
+
+    void PressureThresholdReached_emitter(gint32, std::string, double);
+    sigc::signal<void, gint32, std::string, double > PressureThresholdReached_signal;
+
+    void MemoryEvent_emitter(gint32, std::string, guint64);
+    sigc::signal<void, gint32, std::string, guint64 > MemoryEvent_signal;
+
+    void ContainerDestroyed_emitter(gint32, guint64);
+    sigc::signal<void, gint32, guint64 > ContainerDestroyed_signal;
 
     void on_bus_acquired(const Glib::RefPtr<Gio::DBus::Connection>& connection,
                          const Glib::ustring& /* name */);
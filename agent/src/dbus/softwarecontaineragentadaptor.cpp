@@ -21,6 +21,54 @@
 
 namespace softwarecontainer {
 
+// Type of each container in the result of ListContainerStatus
+static const char *CONTAINER_STATUS_TYPE = "(isiaiasta{st})";
+
+static std::map<Glib::ustring, guint64> usageToMap(const ProcessUsage &usage)
+{
+    std::map<Glib::ustring, guint64> map;
+    map["userTimeUs"] = usage.userTimeUs;
+    map["systemTimeUs"] = usage.systemTimeUs;
+    map["maxRssKb"] = usage.maxRssKb;
+    map["majorFaults"] = usage.majorFaults;
+    map["voluntaryContextSwitches"] = usage.voluntaryContextSwitches;
+    map["involuntaryContextSwitches"] = usage.involuntaryContextSwitches;
+    map["runtimeMs"] = usage.runtimeMs;
+    return map;
+}
+
+static Glib::ustring stateToString(ContainerState state)
+{
+    switch (state) {
+    case ContainerState::READY:
+        return "ready";
+    case ContainerState::SUSPENDED:
+        return "suspended";
+    case ContainerState::TERMINATED:
+        return "terminated";
+    case ContainerState::INVALID:
+        return "invalid";
+    }
+    return "unknown";
+}
+
+static std::map<Glib::ustring, guint64> sampleToMap(const ResourceSample &sample)
+{
+    std::map<Glib::ustring, guint64> map;
+    map["timestampMs"] = sample.timestampMs;
+    map["memoryCurrent"] = sample.memoryCurrent;
+    map["memoryAnon"] = sample.memoryAnon;
+    map["memoryFile"] = sample.memoryFile;
+    map["cpuUsageUs"] = sample.cpuUsageUs;
+    map["cpuUserUs"] = sample.cpuUserUs;
+    map["cpuSystemUs"] = sample.cpuSystemUs;
+    map["ioReadBytes"] = sample.ioReadBytes;
+    map["ioWriteBytes"] = sample.ioWriteBytes;
+    map["ioReadOps"] = sample.ioReadOps;
+    map["ioWriteOps"] = sample.ioWriteOps;
+    return map;
+}
+
 SoftwareContainerAgentAdaptor::~SoftwareContainerAgentAdaptor()
 {
 }
@@ -43,6 +91,40 @@ SoftwareContainerAgentAdaptor::SoftwareContainerAgentAdaptor(
         sigc::mem_fun(this, &SoftwareContainerAgentAdaptor::onDBusError)
     );
     connect(busType, agentBusName);
+
+    m_agent.setWriteBufferSyncedListener([this] (ContainerID containerID, bool success) {
+        WriteBufferSynced_emitter(containerID, success);
+        log_info() << "WriteBufferSynced " << containerID << " success " << success;
+    });
+
+    m_agent.setWriteBufferHighWaterListener(
+        [this] (ContainerID containerID, const WriteBufferUsage &usage) {
+            WriteBufferHighWater_emitter(containerID, usage.usedBytes, usage.sizeBytes);
+            log_info() << "WriteBufferHighWater " << containerID << " used "
+                       << usage.usedBytes << " of " << usage.sizeBytes;
+        });
+
+    m_agent.setResourceUsageListener(
+        [this] (ContainerID containerID, const ResourceSample &usage, const ResourceSample &delta) {
+            ResourceUsageSampled_emitter(containerID, sampleToMap(usage), sampleToMap(delta));
+        });
+
+    m_agent.setPressureListener(
+        [this] (ContainerID containerID, const std::string &resource, double avg10) {
+            PressureThresholdReached_emitter(containerID, resource, avg10);
+        });
+
+    m_agent.setMemoryEventListener(
+        [this] (ContainerID containerID, const std::string &event, uint64_t count) {
+            MemoryEvent_emitter(containerID, event, count);
+            log_info() << "MemoryEvent " << containerID << " " << event << " " << count;
+        });
+
+    m_agent.setContainerDestroyedListener(
+        [this] (ContainerID containerID, uint64_t durationMs) {
+            ContainerDestroyed_emitter(containerID, durationMs);
+            log_info() << "ContainerDestroyed " << containerID << " " << durationMs << " ms";
+        });
 }
 
 void SoftwareContainerAgentAdaptor::onDBusError(std::string message)
@@ -62,6 +144,43 @@ void SoftwareContainerAgentAdaptor::List(SoftwareContainerAgentMessageHelper msg
     msg.returnValue(list);
 }
 
+void SoftwareContainerAgentAdaptor::ListContainerStatus(const bool includeUsage,
+                                                        SoftwareContainerAgentMessageHelper msg)
+{
+    // Arrays of structs have no Glib::Variant type, so the array is built from the structs
+    std::vector<Glib::VariantBase> statuses;
+    for (const ContainerStatus &status : m_agent.listContainerStatus(includeUsage)) {
+        std::vector<gint32> processes(status.processes.begin(), status.processes.end());
+        std::vector<Glib::ustring> gateways(status.gateways.begin(), status.gateways.end());
+        std::map<Glib::ustring, guint64> usage;
+        if (status.hasUsage) {
+            usage = sampleToMap(status.usage);
+        }
+
+        std::vector<Glib::VariantBase> fields;
+        fields.push_back(Glib::Variant<gint32>::create(status.containerID));
+        fields.push_back(Glib::Variant<Glib::ustring>::create(stateToString(status.state)));
+        fields.push_back(Glib::Variant<gint32>::create(status.initPid));
+        fields.push_back(Glib::Variant<std::vector<gint32>>::create(processes));
+        fields.push_back(Glib::Variant<std::vector<Glib::ustring>>::create(gateways));
+        fields.push_back(Glib::Variant<guint64>::create(status.createdAt));
+        fields.push_back(Glib::Variant<std::map<Glib::ustring, guint64>>::create(usage));
+        statuses.push_back(Glib::Variant<Glib::VariantBase>::create_tuple(fields));
+    }
+
+    std::vector<GVariant *> children;
+    for (Glib::VariantBase &status : statuses) {
+        children.push_back(status.gobj());
+    }
+    Glib::VariantBase array = Glib::wrap(g_variant_new_array(G_VARIANT_TYPE(CONTAINER_STATUS_TYPE),
+                                                             children.data(),
+                                                             children.size()));
+
+    std::vector<Glib::VariantBase> result;
+    result.push_back(array);
+    msg.getMessage()->return_value(Glib::Variant<Glib::VariantBase>::create_tuple(result));
+}
+
 void SoftwareContainerAgentAdaptor::ListCapabilities(SoftwareContainerAgentMessageHelper msg)
 {
     std::vector<std::string> stdStrVec = m_agent.listCapabilities();
@@ -83,8 +202,8 @@ void SoftwareContainerAgentAdaptor::Execute(
         workingDirectory,
         outputFile,
         env,
-        [this, containerID](pid_t pid, int exitCode) {
-            ProcessStateChanged_emitter(containerID, pid, false, exitCode);
+        [this, containerID](pid_t pid, int exitCode, const ProcessUsage &usage) {
+            ProcessStateChanged_emitter(containerID, pid, false, exitCode, usageToMap(usage));
             log_info() << "ProcessStateChanged " << pid << " code " << exitCode;
         }
     );
@@ -103,12 +222,49 @@ void SoftwareContainerAgentAdaptor::Resume(const gint32 containerID, SoftwareCon
     msg.returnValue();
 }
 
+void SoftwareContainerAgentAdaptor::SuspendMany(const std::vector<gint32> containerIDs,
+                                                SoftwareContainerAgentMessageHelper msg)
+{
+    std::vector<ContainerID> ids(containerIDs.begin(), containerIDs.end());
+    std::map<gint32, bool> results;
+    for (auto &it : m_agent.suspendContainers(ids)) {
+        results[it.first] = it.second;
+    }
+    msg.returnValue(results);
+}
+
+void SoftwareContainerAgentAdaptor::ResumeMany(const std::vector<gint32> containerIDs,
+                                               SoftwareContainerAgentMessageHelper msg)
+{
+    std::vector<ContainerID> ids(containerIDs.begin(), containerIDs.end());
+    std::map<gint32, bool> results;
+    for (auto &it : m_agent.resumeContainers(ids)) {
+        results[it.first] = it.second;
+    }
+    msg.returnValue(results);
+}
+
 void SoftwareContainerAgentAdaptor::Destroy(const gint32 containerID, SoftwareContainerAgentMessageHelper msg)
 {
     m_agent.shutdownContainer(containerID);
     msg.returnValue();
 }
 
+void SoftwareContainerAgentAdaptor::Checkpoint(const gint32 containerID,
+                                               const std::string directory,
+                                               SoftwareContainerAgentMessageHelper msg)
+{
+    m_agent.checkpointContainer(containerID, directory);
+    msg.returnValue();
+}
+
+void SoftwareContainerAgentAdaptor::Restore(const std::string directory,
+                                            SoftwareContainerAgentMessageHelper msg)
+{
+    gint32 containerID = m_agent.restoreContainer(directory);
+    msg.returnValue(containerID);
+}
+
 void SoftwareContainerAgentAdaptor::BindMount(
     const gint32 containerID,
     const std::string pathInHost,
@@ -136,4 +292,61 @@ void SoftwareContainerAgentAdaptor::Create(const std::string config,
     msg.returnValue(containerID);
 }
 
+void SoftwareContainerAgentAdaptor::SetCgroupLimits(
+    const gint32 containerID,
+    const std::map<std::string, std::string> limits,
+    SoftwareContainerAgentMessageHelper msg)
+{
+    m_agent.setCgroupLimits(containerID, limits);
+    msg.returnValue();
+}
+
+void SoftwareContainerAgentAdaptor::GetWriteBufferUsage(const gint32 containerID,
+                                                        SoftwareContainerAgentMessageHelper msg)
+{
+    WriteBufferUsage usage = m_agent.getWriteBufferUsage(containerID);
+    msg.returnValue(static_cast<guint64>(usage.usedBytes),
+                    static_cast<guint64>(usage.freeBytes),
+                    static_cast<guint64>(usage.sizeBytes));
+}
+
+void SoftwareContainerAgentAdaptor::GetProcessHistory(const gint32 containerID,
+                                                      SoftwareContainerAgentMessageHelper msg)
+{
+    std::vector<std::map<Glib::ustring, guint64>> processes;
+    for (const ProcessRecord &record : m_agent.getProcessHistory(containerID)) {
+        std::map<Glib::ustring, guint64> process = usageToMap(record.usage);
+        process["processID"] = record.pid;
+        process["exitCode"] = static_cast<guint32>(record.exitCode);
+        processes.push_back(process);
+    }
+    msg.returnValue(processes);
+}
+
+void SoftwareContainerAgentAdaptor::GetCpuPlacement(SoftwareContainerAgentMessageHelper msg)
+{
+    std::map<gint32, Glib::ustring> placement;
+    for (auto &it : m_agent.getCpuPlacement()) {
+        placement[it.first] = it.second;
+    }
+    msg.returnValue(placement);
+}
+
+void SoftwareContainerAgentAdaptor::GetResourceUsage(const gint32 containerID,
+                                                     SoftwareContainerAgentMessageHelper msg)
+{
+    ResourceSample usage;
+    ResourceSample delta;
+    m_agent.getResourceUsage(containerID, usage, delta);
+    msg.returnValue(sampleToMap(usage), sampleToMap(delta));
+}
+
+void SoftwareContainerAgentAdaptor::TailOutput(const guint32 processID,
+                                               const guint32 maxBytes,
+                                               SoftwareContainerAgentMessageHelper msg)
+{
+    std::string output = m_agent.tailOutput(processID, maxBytes);
+    msg.returnValue(std::vector<guchar>(output.begin(), output.end()));
+}
+
 } // namespace softwarecontainer
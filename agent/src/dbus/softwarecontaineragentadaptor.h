@@ -38,6 +38,8 @@ public:
         bool useSessionBus);
 
     void List(SoftwareContainerAgentMessageHelper msg) override;
+
+    void ListContainerStatus(const bool includeUsage, SoftwareContainerAgentMessageHelper msg) override;
     void ListCapabilities(SoftwareContainerAgentMessageHelper msg) override;
 
     void Execute(const gint32 containerID,
@@ -59,12 +61,43 @@ public:
 
     void Resume(const gint32 containerID, SoftwareContainerAgentMessageHelper msg) override;
 
+    void SuspendMany(const std::vector<gint32> containerIDs,
+                     SoftwareContainerAgentMessageHelper msg) override;
+
+    void ResumeMany(const std::vector<gint32> containerIDs,
+                    SoftwareContainerAgentMessageHelper msg) override;
+
+    void Checkpoint(const gint32 containerID,
+                    const std::string directory,
+                    SoftwareContainerAgentMessageHelper msg) override;
+
+    void Restore(const std::string directory, SoftwareContainerAgentMessageHelper msg) override;
+
     void SetCapabilities(const gint32 containerID,
                          const std::vector<std::string> capabilities,
                          SoftwareContainerAgentMessageHelper msg) override;
 
     void Create(const std::string config, SoftwareContainerAgentMessageHelper msg) override;
 
+    void SetCgroupLimits(const gint32 containerID,
+                         const std::map<std::string, std::string> limits,
+                         SoftwareContainerAgentMessageHelper msg) override;
+
+    void GetWriteBufferUsage(const gint32 containerID,
+                             SoftwareContainerAgentMessageHelper msg) override;
+
+    void GetProcessHistory(const gint32 containerID,
+                           SoftwareContainerAgentMessageHelper msg) override;
+
+    void GetCpuPlacement(SoftwareContainerAgentMessageHelper msg) override;
+
+    void GetResourceUsage(const gint32 containerID,
+                          SoftwareContainerAgentMessageHelper msg) override;
+
+    void TailOutput(const guint32 processID,
+                    const guint32 maxBytes,
+                    SoftwareContainerAgentMessageHelper msg) override;
+
 private:
     // Slots to be invoked to notify on error or success in dbus setup
     void onDBusError(std::string message);
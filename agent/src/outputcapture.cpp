@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "outputcapture.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace softwarecontainer {
+
+OutputCapture::OutputCapture(Glib::RefPtr<Glib::MainContext> context, int fd, size_t bufferSize) :
+    m_fd(fd),
+    m_buffer(bufferSize)
+{
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    m_connection = context->signal_io().connect(
+        sigc::mem_fun(*this, &OutputCapture::onReadable), m_fd, Glib::IO_IN | Glib::IO_HUP | Glib::IO_ERR);
+}
+
+OutputCapture::~OutputCapture()
+{
+    close();
+    if (m_outputFd != INVALID_FD) {
+        ::close(m_outputFd);
+    }
+}
+
+bool OutputCapture::setOutputFile(const std::string &path, size_t segmentSize, unsigned int segmentCount)
+{
+    mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd == -1) {
+        log_error() << "Could not open output file " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    if (m_outputFd != INVALID_FD) {
+        ::close(m_outputFd);
+    }
+
+    m_outputPath = path;
+    m_outputFd = fd;
+    m_outputSize = 0;
+    m_segmentSize = segmentSize;
+    m_segmentCount = segmentCount;
+    return true;
+}
+
+std::string OutputCapture::tail(size_t maxBytes) const
+{
+    return m_buffer.tail(maxBytes);
+}
+
+bool OutputCapture::isOpen() const
+{
+    return m_fd != INVALID_FD;
+}
+
+bool OutputCapture::onReadable(Glib::IOCondition /*condition*/)
+{
+    char data[16 * 1024];
+
+    while (true) {
+        ssize_t count = ::read(m_fd, data, sizeof(data));
+        if (count > 0) {
+            m_buffer.write(data, count);
+            writeToFile(data, count);
+            continue;
+        }
+
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+
+        // End of output, or an error reading it
+        if (count == -1) {
+            log_warning() << "Could not read output: " << strerror(errno);
+        }
+        close();
+        return false;
+    }
+}
+
+void OutputCapture::writeToFile(const char *data, size_t size)
+{
+    if (m_outputFd == INVALID_FD) {
+        return;
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        ssize_t ret = ::write(m_outputFd, data + written, size - written);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error() << "Could not write to output file " << m_outputPath << ": " << strerror(errno);
+            ::close(m_outputFd);
+            m_outputFd = INVALID_FD;
+            return;
+        }
+        written += ret;
+    }
+
+    m_outputSize += size;
+    if (m_segmentSize > 0 && m_outputSize >= m_segmentSize) {
+        if (!rotate()) {
+            log_warning() << "Could not rotate output file " << m_outputPath;
+        }
+    }
+}
+
+std::string OutputCapture::segmentPath(unsigned int index) const
+{
+    return m_outputPath + "." + std::to_string(index) + ".gz";
+}
+
+bool OutputCapture::rotate()
+{
+    // Make room for the new segment, dropping the oldest one
+    if (m_segmentCount > 0) {
+        unlink(segmentPath(m_segmentCount).c_str());
+        for (unsigned int i = m_segmentCount - 1; i >= 1; i--) {
+            rename(segmentPath(i).c_str(), segmentPath(i + 1).c_str());
+        }
+    }
+
+    bool success = true;
+    if (m_segmentCount > 0) {
+        int input = ::open(m_outputPath.c_str(), O_RDONLY | O_CLOEXEC);
+        gzFile segment = gzopen(segmentPath(1).c_str(), "wb");
+        if (input == -1 || segment == nullptr) {
+            log_error() << "Could not create output segment " << segmentPath(1);
+            success = false;
+        } else {
+            char data[16 * 1024];
+            ssize_t count;
+            while ((count = ::read(input, data, sizeof(data))) > 0) {
+                if (gzwrite(segment, data, count) != count) {
+                    log_error() << "Could not write output segment " << segmentPath(1);
+                    success = false;
+                    break;
+                }
+            }
+        }
+
+        if (segment != nullptr && gzclose(segment) != Z_OK) {
+            success = false;
+        }
+        if (input != -1) {
+            ::close(input);
+        }
+    }
+
+    // Truncate even if compressing failed, to keep the space used on disk bounded
+    if (ftruncate(m_outputFd, 0) == -1 || lseek(m_outputFd, 0, SEEK_SET) == -1) {
+        log_error() << "Could not truncate output file " << m_outputPath << ": " << strerror(errno);
+        return false;
+    }
+    m_outputSize = 0;
+
+    return success;
+}
+
+void OutputCapture::close()
+{
+    m_connection.disconnect();
+    if (m_fd != INVALID_FD) {
+        ::close(m_fd);
+        m_fd = INVALID_FD;
+    }
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include <glibmm.h>
+
+#include "softwarecontainer-common.h"
+#include "ringbuffer.h"
+
+namespace softwarecontainer {
+
+/**
+ * @brief The OutputCapture class reads the output of a process from a pipe on the main loop.
+ *
+ * The most recent output is kept in a fixed size ring buffer which clients can read with
+ * tail(). Optionally the output is also written to a file on disk. Once the file grows
+ * beyond a segment size, it is compressed into a gzip segment next to it and truncated, and
+ * only a fixed number of segments are kept, so the output of long-running processes takes a
+ * bounded amount of space.
+ */
+class OutputCapture
+{
+    LOG_DECLARE_CLASS_CONTEXT("OUTC", "Output capture");
+
+public:
+    /**
+     * @param context The main loop context to read the pipe on
+     * @param fd Read end of the pipe, owned by the capture from now on
+     * @param bufferSize Size of the ring buffer in bytes
+     */
+    OutputCapture(Glib::RefPtr<Glib::MainContext> context, int fd, size_t bufferSize);
+    ~OutputCapture();
+
+    OutputCapture(const OutputCapture &) = delete;
+    OutputCapture &operator=(const OutputCapture &) = delete;
+
+    /**
+     * @brief Also write the output to a file, rotating it into compressed segments
+     *
+     * The segments are named path.1.gz, path.2.gz and so on, where path.1.gz is the most recent.
+     *
+     * @param path The file to write to, it is truncated if it exists
+     * @param segmentSize Size of the file in bytes at which it is rotated, 0 to never rotate
+     * @param segmentCount Max number of compressed segments to keep
+     * @return false if the file could not be opened
+     */
+    bool setOutputFile(const std::string &path, size_t segmentSize, unsigned int segmentCount);
+
+    /**
+     * @brief The most recent output, at most maxBytes
+     */
+    std::string tail(size_t maxBytes) const;
+
+    /**
+     * @brief true until the write end of the pipe has been closed by the process
+     */
+    bool isOpen() const;
+
+private:
+    bool onReadable(Glib::IOCondition condition);
+    void writeToFile(const char *data, size_t size);
+    bool rotate();
+    std::string segmentPath(unsigned int index) const;
+    void close();
+
+    int m_fd;
+    sigc::connection m_connection;
+    RingBuffer m_buffer;
+
+    std::string m_outputPath;
+    int m_outputFd = INVALID_FD;
+    size_t m_outputSize = 0;
+    size_t m_segmentSize = 0;
+    unsigned int m_segmentCount = 0;
+};
+
+} // namespace softwarecontainer
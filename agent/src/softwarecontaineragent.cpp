@@ -17,10 +17,18 @@
  * For further information see LICENSE
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <jansson.h>
 #include "softwarecontaineragent.h"
 
 #include "softwarecontainererror.h"
+#include "overlaysyncer.h"
+#include "workerpool.h"
 
 #include "config/configerror.h"
 #include "config/configdefinition.h"
@@ -29,12 +37,97 @@
 
 namespace softwarecontainer {
 
+// How often the tmpfs write buffers of the containers are checked
+static constexpr unsigned int WRITE_BUFFER_SAMPLE_INTERVAL_MS = 1000;
+// Write buffers fuller than this are grown, or reported if they can not grow
+static constexpr uint64_t WRITE_BUFFER_HIGH_WATER_PERCENT = 90;
+
+// Number of exited processes kept in the history of each container
+static constexpr size_t PROCESS_HISTORY_SIZE = 32;
+
+// Number of resource usage samples kept for each container
+static constexpr size_t RESOURCE_HISTORY_SIZE = 60;
+
+// Window in which the stall time of the pressure-threshold config is measured
+static constexpr unsigned int PRESSURE_WINDOW_US = 1000000;
+
+// Most containers suspended or resumed at the same time by SuspendMany and ResumeMany
+static constexpr size_t MAX_PARALLEL_OPERATIONS = 16;
+
+// Where the ID of a container and the configuration it was created with are saved in a
+// checkpoint directory, and the keys they are saved with
+static const std::string CHECKPOINT_CONFIG_FILE = "config.json";
+static const char *const CHECKPOINT_ID_KEY = "containerID";
+static const char *const CHECKPOINT_CONFIG_KEY = "config";
+
+// Size of the buffer keeping the most recent output of each launched process
+static constexpr size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+// Output files are compressed into a segment when they reach this size
+static constexpr size_t OUTPUT_SEGMENT_SIZE = 1024 * 1024;
+// Number of compressed segments kept for each output file
+static constexpr unsigned int OUTPUT_SEGMENT_COUNT = 4;
+
+static bool aboveHighWater(const WriteBufferUsage &usage)
+{
+    return usage.usedBytes * 100 >= usage.sizeBytes * WRITE_BUFFER_HIGH_WATER_PERCENT;
+}
+
+static bool writeCheckpointConfig(const std::string &path,
+                                  ContainerID containerID,
+                                  const std::string &config)
+{
+    // The configuration was parsed when the container was created, so it is valid JSON
+    json_t *root = json_pack("{s:i, s:o}",
+                             CHECKPOINT_ID_KEY, containerID,
+                             CHECKPOINT_CONFIG_KEY, json_loads(config.c_str(), 0, nullptr));
+    if (root == nullptr) {
+        return false;
+    }
+
+    char *content = json_dumps(root, JSON_INDENT(4));
+    json_decref(root);
+    if (content == nullptr) {
+        return false;
+    }
+
+    bool success = writeToFile(path, content);
+    free(content);
+    return success;
+}
+
+static bool readCheckpointConfig(const std::string &path,
+                                 ContainerID &containerID,
+                                 std::string &config)
+{
+    json_error_t error;
+    json_t *root = json_load_file(path.c_str(), 0, &error);
+    if (root == nullptr) {
+        return false;
+    }
+
+    json_t *id = json_object_get(root, CHECKPOINT_ID_KEY);
+    json_t *createConfig = json_object_get(root, CHECKPOINT_CONFIG_KEY);
+    char *content = createConfig == nullptr ? nullptr : json_dumps(createConfig, JSON_COMPACT);
+    bool success = json_is_integer(id) && content != nullptr;
+    if (success) {
+        containerID = json_integer_value(id);
+        config = content;
+    }
+
+    free(content);
+    json_decref(root);
+    return success;
+}
+
 SoftwareContainerAgent::SoftwareContainerAgent(Glib::RefPtr<Glib::MainContext> mainLoopContext,
                                                std::shared_ptr<Config> config,
                                                std::shared_ptr<SoftwareContainerFactory> factory,
                                                std::shared_ptr<ContainerUtilityInterface> utility):
     m_mainLoopContext(mainLoopContext),
+    m_processMonitor(mainLoopContext),
     m_config(config),
+    m_resourceSampler(RESOURCE_HISTORY_SIZE),
+    m_cpusetAllocator(CpusetAllocator::onlineCpus()),
     m_factory(factory),
     m_containerUtility(utility)
 {
@@ -47,6 +140,9 @@ SoftwareContainerAgent::SoftwareContainerAgent(Glib::RefPtr<Glib::MainContext> m
     std::string sharedMountsDir =
         m_config->getStringValue(ConfigDefinition::SC_GROUP,
                                  ConfigDefinition::SC_SHARED_MOUNTS_DIR_KEY);
+    std::string writeBufferSyncDir =
+        m_config->getStringValue(ConfigDefinition::SC_GROUP,
+                                 ConfigDefinition::SC_WRITE_BUFFER_SYNC_DIR_KEY);
     std::string lxcConfigPath =
         m_config->getStringValue(ConfigDefinition::SC_GROUP,
                                  ConfigDefinition::SC_LXC_CONFIG_PATH_KEY);
@@ -83,6 +179,16 @@ SoftwareContainerAgent::SoftwareContainerAgent(Glib::RefPtr<Glib::MainContext> m
     m_containerUtility->removeOldContainers();
     m_containerUtility->checkWorkspace();
 
+    // This also resumes any syncs that were not finished by a previous agent
+    bool syncerStarted = OverlaySyncer::getInstance().start(
+        writeBufferSyncDir,
+        [this] (const std::string &tag, bool success) {
+            onWriteBufferSynced(tag, success);
+        });
+    if (!syncerStarted) {
+        log_warning() << "Write buffers will be synced when containers are destroyed";
+    }
+
     m_containerConfig = SoftwareContainerConfig(
 #ifdef ENABLE_NETWORKGATEWAY
                                                 createBridge,
@@ -96,10 +202,63 @@ SoftwareContainerAgent::SoftwareContainerAgent(Glib::RefPtr<Glib::MainContext> m
                                                 sharedMountsDir,
                                                 shutdownTimeout);
 
+    std::function<bool ()> sample = [this] () {
+        sampleWriteBuffers();
+        return true;
+    };
+    m_writeBufferSampler = m_mainLoopContext->signal_timeout().connect(
+        sample, WRITE_BUFFER_SAMPLE_INTERVAL_MS);
+
+    int resourceSampleInterval =
+        m_config->getIntValue(ConfigDefinition::SC_GROUP,
+                              ConfigDefinition::SC_RESOURCE_SAMPLE_INTERVAL_KEY);
+    int resourceSignalInterval =
+        m_config->getIntValue(ConfigDefinition::SC_GROUP,
+                              ConfigDefinition::SC_RESOURCE_SIGNAL_INTERVAL_KEY);
+    if (resourceSampleInterval > 0) {
+        m_resourceSampler.start(resourceSampleInterval);
+    }
+    if (resourceSampleInterval > 0 && resourceSignalInterval > 0) {
+        std::function<bool ()> notify = [this] () {
+            notifyResourceUsage();
+            return true;
+        };
+        m_resourceUsageNotifier = m_mainLoopContext->signal_timeout().connect(
+            notify, resourceSignalInterval);
+    }
+
+    int pressureThreshold =
+        m_config->getIntValue(ConfigDefinition::SC_GROUP,
+                              ConfigDefinition::SC_PRESSURE_THRESHOLD_KEY);
+    if (pressureThreshold > 0) {
+        m_pressureMonitor.reset(new PressureMonitor(
+            m_mainLoopContext,
+            pressureThreshold * 1000,
+            PRESSURE_WINDOW_US,
+            [this] (int id, const std::string &resource, double avg10) {
+                if (m_pressureListener) {
+                    m_pressureListener(id, resource, avg10);
+                }
+            },
+            [this] (int id, const std::string &event, uint64_t count) {
+                if (m_memoryEventListener) {
+                    m_memoryEventListener(id, event, count);
+                }
+            }));
+        m_pressureMonitor->watchHost();
+    }
 }
 
 SoftwareContainerAgent::~SoftwareContainerAgent()
 {
+    m_resourceUsageNotifier.disconnect();
+    m_resourceSampler.stop();
+    m_writeBufferSampler.disconnect();
+
+    // No results arrive once the syncer is stopped, so the notifier can be dropped after that
+    OverlaySyncer::getInstance().stop();
+    std::lock_guard<std::mutex> lock(m_writeBufferSyncedLock);
+    m_writeBufferSyncedNotifier.disconnect();
 }
 
 void SoftwareContainerAgent::assertContainerExists(ContainerID containerID)
@@ -138,11 +297,42 @@ std::vector<ContainerID> SoftwareContainerAgent::listContainers()
     return containerIDs;
 }
 
+std::vector<ContainerStatus> SoftwareContainerAgent::listContainerStatus(bool includeUsage)
+{
+    std::vector<ContainerStatus> statuses;
+    for (auto &it : m_statuses) {
+        ContainerStatus status = it.second;
+        status.state = m_containers[it.first]->getContainerState();
+        status.hasUsage = includeUsage && m_resourceSampler.latest(it.first, status.usage);
+        statuses.push_back(status);
+    }
+
+    return statuses;
+}
+
 void SoftwareContainerAgent::deleteContainer(ContainerID containerID)
 {
     assertContainerExists(containerID);
 
     m_containers.erase(containerID);
+    m_priorityClasses.erase(containerID);
+    m_createConfigs.erase(containerID);
+    m_statuses.erase(containerID);
+    m_resourceSampler.remove(containerID);
+    if (m_pressureMonitor) {
+        m_pressureMonitor->unwatch(containerID);
+    }
+    applyCpuPlacement(m_cpusetAllocator.remove(containerID));
+    m_writeBuffersAboveHighWater.erase(containerID);
+    m_processHistory.erase(containerID);
+
+    for (auto it = m_outputCaptures.begin(); it != m_outputCaptures.end();) {
+        if (it->second.containerID == containerID) {
+            it = m_outputCaptures.erase(it);
+        } else {
+            it++;
+        }
+    }
     m_containerIdPool.push_back(containerID);
 }
 
@@ -165,6 +355,29 @@ ContainerID SoftwareContainerAgent::findSuitableId()
     return availableID;
 }
 
+bool SoftwareContainerAgent::claimId(ContainerID containerID)
+{
+    if (containerID < 0 || m_containers.count(containerID) > 0) {
+        return false;
+    }
+
+    // The first ID in the pool is the lowest one never handed out, the rest have been freed
+    ContainerID next = m_containerIdPool[0];
+    if (containerID >= next) {
+        for (ContainerID id = next; id < containerID; id++) {
+            m_containerIdPool.push_back(id);
+        }
+        m_containerIdPool[0] = containerID + 1;
+        return true;
+    }
+
+    auto freed = std::find(m_containerIdPool.begin() + 1, m_containerIdPool.end(), containerID);
+    if (freed != m_containerIdPool.end()) {
+        m_containerIdPool.erase(freed);
+    }
+    return true;
+}
+
 ContainerID SoftwareContainerAgent::createContainer(const std::string &config)
 {
     profilepoint("createContainerStart");
@@ -179,16 +392,83 @@ ContainerID SoftwareContainerAgent::createContainer(const std::string &config)
     auto container = m_factory->createContainer(containerID, std::move(containerConfig));
     log_debug() << "Created container with ID :" << containerID;
 
-    m_containers[containerID] = container;
+    addContainer(containerID, container, *options, config);
     return containerID;
 }
 
+ContainerID SoftwareContainerAgent::restoreContainer(const std::string &directory)
+{
+    profilefunction("restoreContainerFunction");
+
+    ContainerID containerID = INVALID_CONTAINER_ID;
+    std::string config;
+    if (!readCheckpointConfig(buildPath(directory, CHECKPOINT_CONFIG_FILE), containerID, config)) {
+        std::string errorMessage("No checkpoint to restore in " + directory);
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    std::unique_ptr<DynamicContainerOptions> options = m_optionParser.parse(config);
+    std::unique_ptr<SoftwareContainerConfig> containerConfig = options->toConfig(m_containerConfig);
+
+    // The name of the container and its directories are derived from the ID, so it has to
+    // get the same ID again
+    if (!claimId(containerID)) {
+        std::string errorMessage("Can not restore container " + std::to_string(containerID)
+                                 + " from " + directory + ", the ID is in use");
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SoftwareContainerPtr container;
+    try {
+        container = m_factory->restoreContainer(containerID, std::move(containerConfig), directory);
+    } catch (SoftwareContainerError &) {
+        m_containerIdPool.push_back(containerID);
+        throw;
+    }
+
+    uint64_t durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start).count();
+    log_info() << "Restored container " << containerID << " from " << directory
+               << " in " << durationMs << " ms";
+
+    addContainer(containerID, container, *options, config);
+    return containerID;
+}
+
+void SoftwareContainerAgent::addContainer(ContainerID containerID,
+                                          SoftwareContainerPtr container,
+                                          const DynamicContainerOptions &options,
+                                          const std::string &config)
+{
+    m_containers[containerID] = container;
+    m_priorityClasses[containerID] = options.priorityClass();
+    m_createConfigs[containerID] = config;
+
+    ContainerStatus &status = m_statuses[containerID];
+    status.containerID = containerID;
+    status.initPid = container->initPid();
+    status.createdAt = std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::string cgroupPath = container->cgroupPath();
+    if (!cgroupPath.empty()) {
+        m_resourceSampler.add(containerID, cgroupPath);
+        if (m_pressureMonitor) {
+            m_pressureMonitor->watchCgroup(containerID, cgroupPath);
+        }
+        applyCpuPlacement(m_cpusetAllocator.add(containerID, options.priorityClass()));
+    }
+}
+
 pid_t SoftwareContainerAgent::execute(ContainerID containerID,
                                      const std::string &cmdLine,
                                      const std::string &workingDirectory,
                                      const std::string &outputFile,
                                      const EnvironmentVariables &env,
-                                     std::function<void (pid_t, int)> listener)
+                                     std::function<void (pid_t, int, const ProcessUsage &)> listener)
 {
     profilefunction("executeFunction");
     SoftwareContainerPtr container = getContainer(containerID);
@@ -219,21 +499,40 @@ pid_t SoftwareContainerAgent::execute(ContainerID containerID,
         throw SoftwareContainerAgentError(errorMessage);
     }
 
-    job->setOutputFile(outputFile);
+    job->captureOutput();
     job->setEnvironmentVariables(env);
     job->setWorkingDirectory(workingDirectory);
 
     // Start it
     if (!job->start()) {
+        // The output is not captured, close the pipe it would have been read from
+        ::close(job->stdout());
         std::string errorMessage("Could not start job");
         log_error() << errorMessage;
         throw SoftwareContainerError(errorMessage);
     }
 
+    // Capture the output of the process, and write it to the output file if there is one
+    auto capture = std::unique_ptr<OutputCapture>(
+        new OutputCapture(m_mainLoopContext, job->stdout(), OUTPUT_BUFFER_SIZE));
+    if (!outputFile.empty()) {
+        if (!capture->setOutputFile(outputFile, OUTPUT_SEGMENT_SIZE, OUTPUT_SEGMENT_COUNT)) {
+            log_warning() << "Output of " << cmdLine << " will not be written to " << outputFile;
+        }
+    }
+    m_outputCaptures[job->pid()] = CapturedOutput{containerID, std::move(capture), false};
+
     // If things went well, do what we need when it exits
-    addProcessListener(m_connections, job->pid(), [listener](pid_t pid, int exitCode) {
-        listener(pid, exitCode);
-    }, m_mainLoopContext);
+    bool watched = m_processMonitor.watch(job->pid(),
+        [this, containerID, listener](pid_t pid, int exitCode, const ProcessUsage &usage) {
+            recordProcessExit(containerID, ProcessRecord{pid, exitCode, usage});
+            listener(pid, exitCode, usage);
+        });
+    if (watched) {
+        m_statuses[containerID].processes.insert(job->pid());
+    } else {
+        log_error() << "Could not monitor process " << job->pid() << ", its exit will not be reported";
+    }
 
     profilepoint("executeEnd");
 
@@ -247,6 +546,7 @@ void SoftwareContainerAgent::shutdownContainer(ContainerID containerID)
     SoftwareContainerPtr container = getContainer(containerID);
 
     int timeout = m_containerConfig.containerShutdownTimeout();
+    auto start = std::chrono::steady_clock::now();
     container->shutdown(timeout);
 
     try {
@@ -256,6 +556,13 @@ void SoftwareContainerAgent::shutdownContainer(ContainerID containerID)
         log_error() << errorMessage;
         throw SoftwareContainerError(errorMessage);
     }
+
+    uint64_t durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start).count();
+    log_info() << "Destroyed container " << containerID << " in " << durationMs << " ms";
+    if (m_containerDestroyedListener) {
+        m_containerDestroyedListener(containerID, durationMs);
+    }
 }
 
 void SoftwareContainerAgent::suspendContainer(ContainerID containerID)
@@ -270,6 +577,124 @@ void SoftwareContainerAgent::resumeContainer(ContainerID containerID)
     container->resume();
 }
 
+void SoftwareContainerAgent::checkpointContainer(ContainerID containerID,
+                                                 const std::string &directory)
+{
+    profilefunction("checkpointContainerFunction");
+
+    SoftwareContainerPtr container = getContainer(containerID);
+
+    if (!isDirectory(directory) && mkdir(directory.c_str(), S_IRWXU) == -1) {
+        std::string errorMessage("Could not create checkpoint directory " + directory
+                                 + ": " + strerror(errno));
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    // The checkpoint can not be restored without the ID and the configuration of the container
+    if (!writeCheckpointConfig(buildPath(directory, CHECKPOINT_CONFIG_FILE),
+                               containerID,
+                               m_createConfigs[containerID])) {
+        std::string errorMessage("Could not save the configuration of container "
+                                 + std::to_string(containerID) + " to " + directory);
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    container->checkpoint(directory);
+    deleteContainer(containerID);
+
+    uint64_t durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start).count();
+    log_info() << "Checkpointed container " << containerID << " to " << directory
+               << " in " << durationMs << " ms";
+}
+
+std::map<ContainerID, bool> SoftwareContainerAgent::suspendContainers(
+    const std::vector<ContainerID> &containerIDs)
+{
+    profilefunction("suspendContainersFunction");
+
+    std::map<ContainerID, bool> results;
+    forEachInParallel(containerIDs,
+                      [] (SoftwareContainerPtr container) { container->suspend(); },
+                      results);
+    return results;
+}
+
+std::map<ContainerID, bool> SoftwareContainerAgent::resumeContainers(
+    const std::vector<ContainerID> &containerIDs)
+{
+    profilefunction("resumeContainersFunction");
+
+    std::map<PriorityClass, std::vector<ContainerID>> byPriority;
+    for (ContainerID containerID : containerIDs) {
+        auto it = m_priorityClasses.find(containerID);
+        byPriority[it == m_priorityClasses.end() ? PriorityClass::Foreground : it->second]
+            .push_back(containerID);
+    }
+
+    std::map<ContainerID, bool> results;
+    for (PriorityClass priorityClass : { PriorityClass::RealTime,
+                                         PriorityClass::Foreground,
+                                         PriorityClass::Background }) {
+        forEachInParallel(byPriority[priorityClass],
+                          [] (SoftwareContainerPtr container) { container->resume(); },
+                          results);
+    }
+    return results;
+}
+
+void SoftwareContainerAgent::forEachInParallel(
+    const std::vector<ContainerID> &containerIDs,
+    std::function<void (SoftwareContainerPtr)> operation,
+    std::map<ContainerID, bool> &results)
+{
+    std::vector<std::pair<ContainerID, SoftwareContainerPtr>> containers;
+    // Running the operation twice on the same container at once would race
+    std::set<ContainerID> seen;
+    for (ContainerID containerID : containerIDs) {
+        if (!seen.insert(containerID).second) {
+            continue;
+        }
+
+        auto it = m_containers.find(containerID);
+        if (it == m_containers.end()) {
+            log_error() << "Container " << containerID << " does not exist";
+            results[containerID] = false;
+        } else {
+            containers.push_back(*it);
+        }
+    }
+
+    if (containers.empty()) {
+        return;
+    }
+
+    // Results are collected per index, so the workers never touch the same element
+    std::vector<char> succeeded(containers.size(), false);
+    {
+        WorkerPool pool(std::min<size_t>(containers.size(), MAX_PARALLEL_OPERATIONS));
+        for (size_t i = 0; i < containers.size(); i++) {
+            pool.submit([&containers, &succeeded, &operation, i, this] () {
+                try {
+                    operation(containers[i].second);
+                    succeeded[i] = true;
+                } catch (std::exception &err) {
+                    // Nothing may escape into the worker thread
+                    log_error() << "Container " << containers[i].first << ": " << err.what();
+                }
+            });
+        }
+        pool.waitForIdle();
+    }
+
+    for (size_t i = 0; i < containers.size(); i++) {
+        results[containers[i].first] = succeeded[i];
+    }
+}
+
 void SoftwareContainerAgent::bindMount(const ContainerID containerID,
                                        const std::string &pathInHost,
                                        const std::string &pathInContainer,
@@ -294,7 +719,14 @@ bool SoftwareContainerAgent::updateGatewayConfigs(const ContainerID &containerID
     profilefunction("updateGatewayConfigs");
     SoftwareContainerPtr container = getContainer(containerID);
 
-    return container->startGateways(configs);
+    if (!container->startGateways(configs)) {
+        return false;
+    }
+
+    for (auto &gatewayId : configs.ids()) {
+        m_statuses[containerID].gateways.insert(gatewayId);
+    }
+    return true;
 }
 
 std::vector<std::string> SoftwareContainerAgent::listCapabilities()
@@ -337,4 +769,264 @@ void SoftwareContainerAgent::setCapabilities(const ContainerID &containerID,
     }
 }
 
+void SoftwareContainerAgent::setWriteBufferSyncedListener(
+    std::function<void (ContainerID, bool)> listener)
+{
+    m_writeBufferSyncedListener = listener;
+}
+
+void SoftwareContainerAgent::onWriteBufferSynced(const std::string &tag, bool success)
+{
+    // Containers are named SC-<id>, see SoftwareContainer
+    ContainerID containerID = INVALID_CONTAINER_ID;
+    const std::string prefix = "SC-";
+    if (tag.compare(0, prefix.size(), prefix) != 0
+        || !parseInt(tag.c_str() + prefix.size(), &containerID)) {
+        log_warning() << "Write buffer sync done for unknown container " << tag;
+        return;
+    }
+
+    // One idle source passes on all results that arrive before it runs. It is disconnected
+    // by the destructor, so it never runs after the agent is gone.
+    std::lock_guard<std::mutex> lock(m_writeBufferSyncedLock);
+    m_writeBuffersSynced.push_back(std::make_pair(containerID, success));
+    if (m_writeBufferSyncedNotifier.connected()) {
+        return;
+    }
+
+    std::function<bool ()> notify = [this] () {
+        std::vector<std::pair<ContainerID, bool>> results;
+        {
+            std::lock_guard<std::mutex> lock(m_writeBufferSyncedLock);
+            results.swap(m_writeBuffersSynced);
+            m_writeBufferSyncedNotifier.disconnect();
+        }
+
+        for (auto &result : results) {
+            if (m_writeBufferSyncedListener) {
+                m_writeBufferSyncedListener(result.first, result.second);
+            }
+        }
+        return false;
+    };
+    m_writeBufferSyncedNotifier = m_mainLoopContext->signal_idle().connect(notify);
+}
+
+WriteBufferUsage SoftwareContainerAgent::getWriteBufferUsage(ContainerID containerID)
+{
+    SoftwareContainerPtr container = getContainer(containerID);
+
+    WriteBufferUsage usage;
+    if (!container->writeBufferUsage(usage)) {
+        std::string errorMessage("Could not get write buffer usage of container "
+                                 + std::to_string(containerID)
+                                 + ", it might not have a tmpfs write buffer");
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    return usage;
+}
+
+void SoftwareContainerAgent::setCgroupLimits(ContainerID containerID,
+                                             const std::map<std::string, std::string> &limits)
+{
+    SoftwareContainerPtr container = getContainer(containerID);
+
+    if (!container->setCgroupLimits(limits)) {
+        std::string errorMessage("Could not change cgroup limits of container "
+                                 + std::to_string(containerID));
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+}
+
+void SoftwareContainerAgent::getResourceUsage(ContainerID containerID,
+                                              ResourceSample &usage,
+                                              ResourceSample &delta)
+{
+    assertContainerExists(containerID);
+
+    if (!m_resourceSampler.latest(containerID, usage)) {
+        std::string errorMessage("No resource usage sampled for container "
+                                 + std::to_string(containerID));
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    // With a single sample there is no change to report yet
+    if (!m_resourceSampler.latestDelta(containerID, delta)) {
+        delta = ResourceSampler::delta(usage, usage);
+    }
+}
+
+void SoftwareContainerAgent::setResourceUsageListener(
+    std::function<void (ContainerID, const ResourceSample &, const ResourceSample &)> listener)
+{
+    m_resourceUsageListener = listener;
+}
+
+void SoftwareContainerAgent::setPressureListener(
+    std::function<void (ContainerID, const std::string &, double)> listener)
+{
+    m_pressureListener = listener;
+}
+
+void SoftwareContainerAgent::setMemoryEventListener(
+    std::function<void (ContainerID, const std::string &, uint64_t)> listener)
+{
+    m_memoryEventListener = listener;
+}
+
+void SoftwareContainerAgent::setContainerDestroyedListener(
+    std::function<void (ContainerID, uint64_t)> listener)
+{
+    m_containerDestroyedListener = listener;
+}
+
+CpusetAllocator::Placement SoftwareContainerAgent::getCpuPlacement()
+{
+    return m_cpusetAllocator.placement();
+}
+
+void SoftwareContainerAgent::applyCpuPlacement(const CpusetAllocator::Placement &changed)
+{
+    for (auto &it : changed) {
+        auto container = m_containers.find(it.first);
+        if (container == m_containers.end()) {
+            continue;
+        }
+
+        // Limits can only be changed on running containers, the others keep their old CPUs
+        ContainerState state = container->second->getContainerState();
+        if (state != ContainerState::READY && state != ContainerState::SUSPENDED) {
+            log_warning() << "Not placing container " << it.first << " on CPUs " << it.second
+                          << ", it is not running";
+            continue;
+        }
+
+        // A container keeps running on its old CPUs if this fails, which is not fatal
+        if (!container->second->setCgroupLimits({{"cpuset.cpus", it.second}})) {
+            log_warning() << "Could not place container " << it.first
+                          << " on CPUs " << it.second;
+        }
+    }
+}
+
+void SoftwareContainerAgent::notifyResourceUsage()
+{
+    if (!m_resourceUsageListener) {
+        return;
+    }
+
+    for (ContainerID containerID : m_resourceSampler.ids()) {
+        ResourceSample usage;
+        ResourceSample delta;
+        if (m_resourceSampler.latest(containerID, usage)
+            && m_resourceSampler.latestDelta(containerID, delta)) {
+            m_resourceUsageListener(containerID, usage, delta);
+        }
+    }
+}
+
+std::string SoftwareContainerAgent::tailOutput(pid_t pid, size_t maxBytes)
+{
+    auto it = m_outputCaptures.find(pid);
+    if (it == m_outputCaptures.end()) {
+        std::string errorMessage("No captured output for process " + std::to_string(pid));
+        log_error() << errorMessage;
+        throw SoftwareContainerError(errorMessage);
+    }
+
+    return it->second.capture->tail(maxBytes);
+}
+
+std::vector<ProcessRecord> SoftwareContainerAgent::getProcessHistory(ContainerID containerID)
+{
+    assertContainerExists(containerID);
+
+    auto it = m_processHistory.find(containerID);
+    if (it == m_processHistory.end()) {
+        return std::vector<ProcessRecord>();
+    }
+    return std::vector<ProcessRecord>(it->second.begin(), it->second.end());
+}
+
+void SoftwareContainerAgent::recordProcessExit(ContainerID containerID, const ProcessRecord &record)
+{
+    // The container may have been destroyed before the process exited
+    if (m_containers.count(containerID) == 0) {
+        return;
+    }
+
+    m_statuses[containerID].processes.erase(record.pid);
+
+    auto capture = m_outputCaptures.find(record.pid);
+    if (capture != m_outputCaptures.end()) {
+        capture->second.exited = true;
+    }
+
+    // The output of an exited process is kept as long as the process is in the history
+    std::deque<ProcessRecord> &history = m_processHistory[containerID];
+    history.push_back(record);
+    if (history.size() > PROCESS_HISTORY_SIZE) {
+        auto oldest = m_outputCaptures.find(history.front().pid);
+        // The pid may have been reused by a process that is still running
+        if (oldest != m_outputCaptures.end() && oldest->second.exited) {
+            m_outputCaptures.erase(oldest);
+        }
+        history.pop_front();
+    }
+
+    log_debug() << "Process " << record.pid << " in container " << containerID
+                << " exited with " << record.exitCode
+                << ", user " << record.usage.userTimeUs << " us"
+                << ", system " << record.usage.systemTimeUs << " us"
+                << ", max RSS " << record.usage.maxRssKb << " KiB"
+                << ", runtime " << record.usage.runtimeMs << " ms";
+}
+
+void SoftwareContainerAgent::sampleWriteBuffers()
+{
+    for (auto &entry : m_containers) {
+        ContainerID containerID = entry.first;
+        SoftwareContainerPtr container = entry.second;
+
+        WriteBufferUsage usage;
+        if (!container->writeBufferUsage(usage) || usage.sizeBytes == 0) {
+            continue;
+        }
+
+        if (aboveHighWater(usage) && usage.sizeBytes < usage.maxSizeBytes) {
+            uint64_t newSize = std::min(usage.sizeBytes * 2, usage.maxSizeBytes);
+            if (!container->resizeWriteBuffer(newSize)
+                || !container->writeBufferUsage(usage)) {
+                log_warning() << "Could not grow write buffer of container " << containerID;
+            }
+        }
+
+        if (!aboveHighWater(usage)) {
+            m_writeBuffersAboveHighWater.erase(containerID);
+            continue;
+        }
+
+        // Only report when the mark is crossed, not on every sample above it
+        if (!m_writeBuffersAboveHighWater.insert(containerID).second) {
+            continue;
+        }
+
+        log_warning() << "Write buffer of container " << containerID << " is "
+                      << usage.usedBytes << " of " << usage.sizeBytes << " bytes full";
+        if (m_writeBufferHighWaterListener) {
+            m_writeBufferHighWaterListener(containerID, usage);
+        }
+    }
+}
+
+void SoftwareContainerAgent::setWriteBufferHighWaterListener(
+    std::function<void (ContainerID, const WriteBufferUsage &)> listener)
+{
+    m_writeBufferHighWaterListener = listener;
+}
+
 } // namespace softwarecontainer
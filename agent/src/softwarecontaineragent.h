@@ -29,6 +29,10 @@
 #include <ivi-profiling.h>
 
 #include "filetoolkitwithundo.h"
+#include "outputcapture.h"
+#include "pressuremonitor.h"
+#include "processmonitor.h"
+#include "resourcesampler.h"
 #include "softwarecontainer.h"
 #include "softwarecontainer-common.h"
 #include "softwarecontainererror.h"
@@ -40,15 +44,48 @@
 #include "containeroptions/containeroptionparser.h"
 #include "softwarecontainerfactory.h"
 #include "containerutilityinterface.h"
+#include "cpusetallocator.h"
 
 #include <jsonparser.h>
 #include "commandjob.h"
+#include <deque>
+#include <mutex>
 #include <queue>
+#include <set>
 
 namespace softwarecontainer {
 
 static constexpr ContainerID INVALID_CONTAINER_ID = -1;
 
+/**
+ * @brief An exited process launched with SoftwareContainerAgent::execute
+ */
+struct ProcessRecord
+{
+    pid_t pid;
+    int exitCode;
+    ProcessUsage usage;
+};
+
+/**
+ * @brief Status of a container, see SoftwareContainerAgent::listContainerStatus
+ */
+struct ContainerStatus
+{
+    ContainerID containerID = INVALID_CONTAINER_ID;
+    ContainerState state = ContainerState::READY;
+    pid_t initPid = 0;
+    // Processes launched with execute that have not exited yet
+    std::set<pid_t> processes;
+    // Gateways that have been configured through the agent
+    std::set<std::string> gateways;
+    // Seconds since the epoch
+    uint64_t createdAt = 0;
+    // Only set if the resource usage was asked for and has been sampled
+    bool hasUsage = false;
+    ResourceSample usage;
+};
+
 /**
  * @brief An error occured in SoftwareContainerAgent
  *
@@ -114,6 +151,17 @@ public:
      */
     std::vector<ContainerID> listContainers();
 
+    /**
+     * @brief get the status of all containers
+     *
+     * The status is kept by the agent as containers are created and used, so this does
+     * not query the containers themselves.
+     *
+     * @param includeUsage whether to include the latest sampled resource usage
+     * @return the status of each container, in order of container ID
+     */
+    std::vector<ContainerStatus> listContainerStatus(bool includeUsage);
+
     /**
      * @brief List all capabilities that the user can set.
      *
@@ -157,9 +205,11 @@ public:
      * @param containerID the id for the container
      * @param cmdLine the command to run
      * @param workingDirectory the working directory to use when running
-     * @param outputFile where to log any output
+     * @param outputFile where to log any output, empty to only keep the most recent output
+     *        in memory. The file is rotated into compressed segments as it grows.
      * @param env any environment variables to pass to the command
-     * @param listener a function that runs when the process exits
+     * @param listener a function that runs when the process exits, with its exit code and
+     *        the resources it used
      * @return process id of the given command
      */
     pid_t execute(ContainerID containerID,
@@ -167,7 +217,7 @@ public:
                  const std::string &workingDirectory,
                  const std::string &outputFile,
                  const EnvironmentVariables &env,
-                 std::function<void (pid_t, int)> listener);
+                 std::function<void (pid_t, int, const ProcessUsage &)> listener);
 
     /**
      * @brief shuts down a container
@@ -193,6 +243,53 @@ public:
      */
     void resumeContainer(ContainerID containerID);
 
+    /**
+     * @brief suspends execution of several containers in parallel
+     *
+     * @param containerIDs the containers to suspend
+     * @return whether each container was suspended, containers that don't exist or could
+     *         not be suspended are false
+     */
+    std::map<ContainerID, bool> suspendContainers(const std::vector<ContainerID> &containerIDs);
+
+    /**
+     * @brief resumes execution of several containers, in order of their priority class
+     *
+     * Realtime containers are resumed first, then foreground and last background containers.
+     * The containers of a priority class are resumed in parallel, and the next class is only
+     * resumed after that.
+     *
+     * @param containerIDs the containers to resume
+     * @return whether each container was resumed, containers that don't exist or could
+     *         not be resumed are false
+     */
+    std::map<ContainerID, bool> resumeContainers(const std::vector<ContainerID> &containerIDs);
+
+    /**
+     * @brief Checkpoints a container to a directory, and removes it
+     *
+     * The processes of the container are dumped with CRIU, together with its gateway
+     * configurations, bind mounts and the configuration it was created with, so it can be
+     * restored with restoreContainer.
+     *
+     * @param containerID the container to checkpoint
+     * @param directory where to write the checkpoint
+     * @throws SoftwareContainerError on failure, in which case the container is left running
+     */
+    void checkpointContainer(ContainerID containerID, const std::string &directory);
+
+    /**
+     * @brief Restores a container from a checkpoint written by checkpointContainer
+     *
+     * The container gets the ID it had when it was checkpointed, and is set up with the
+     * configuration, gateway configurations and bind mounts it had then.
+     *
+     * @param directory where the checkpoint was written
+     * @return ContainerID for the restored container
+     * @throws SoftwareContainerError if not possible to restore, e.g. if the ID is in use.
+     */
+    ContainerID restoreContainer(const std::string &directory);
+
     /**
      * @brief Bind mount a folder into the container
      *
@@ -223,7 +320,177 @@ public:
     */
     void setCapabilities(const ContainerID &containerID,
                          const std::vector<std::string> &capabilities);
+
+    /**
+     * @brief Set a function to be called when a background write buffer sync is done
+     *
+     * Containers created with the asyncWriteBufferSync option have their write buffer synced
+     * in the background after they are destroyed. The listener is called from the main loop
+     * with the ID the container had, and whether the sync succeeded.
+     *
+     * @param listener the function to call
+     */
+    void setWriteBufferSyncedListener(std::function<void (ContainerID, bool)> listener);
+
+    /**
+     * @brief Get the usage of the tmpfs write buffer of a container
+     *
+     * @param containerID the container to query
+     * @return the used, free and total size of the write buffer
+     * @throws SoftwareContainerError if the container does not exist or has no tmpfs
+     *         write buffer
+     */
+    WriteBufferUsage getWriteBufferUsage(ContainerID containerID);
+
+    /**
+     * @brief Change the CPU, memory and IO limits of a running container
+     *
+     * All limits are changed as one update, either all of them are changed or none.
+     *
+     * @param containerID the container to change limits of
+     * @param limits the cgroup settings to change and their new values, e.g. memory.high
+     * @throws SoftwareContainerError if the container does not exist or the limits could not
+     *         be changed
+     */
+    void setCgroupLimits(ContainerID containerID, const std::map<std::string, std::string> &limits);
+
+    /**
+     * @brief Get the most recent output of a process launched with execute
+     *
+     * The output is kept after the process has exited, as long as the process is in the
+     * history of the container, see getProcessHistory, and at most until the container is
+     * destroyed.
+     *
+     * @param pid the process to get the output of
+     * @param maxBytes max number of bytes to return
+     * @return stdout and stderr of the process, oldest first
+     * @throws SoftwareContainerError if there is no output captured for the process
+     */
+    std::string tailOutput(pid_t pid, size_t maxBytes);
+
+    /**
+     * @brief Get the exit code and resource usage of the most recently exited processes of a
+     * container, oldest first
+     *
+     * @param containerID the container to query
+     * @throws SoftwareContainerError if the container does not exist
+     */
+    std::vector<ProcessRecord> getProcessHistory(ContainerID containerID);
+
+    /**
+     * @brief Check the write buffer usage of all containers
+     *
+     * This is done periodically from the main loop. A tmpfs write buffer that is above the
+     * high-water mark is doubled in size, up to the max size the container allows. If it is
+     * still above the mark, the high-water listener is called. The listener is called again
+     * only after the usage has dropped below the mark.
+     */
+    void sampleWriteBuffers();
+
+    /**
+     * @brief Set a function to be called when the write buffer of a container reaches the
+     * high-water mark and can not be grown any further
+     *
+     * @param listener the function to call
+     */
+    void setWriteBufferHighWaterListener(
+        std::function<void (ContainerID, const WriteBufferUsage &)> listener);
+
+    /**
+     * @brief Get the most recent resource usage sample of a container
+     *
+     * Samples are taken by a background thread, at the interval set by the
+     * resource-sample-interval config.
+     *
+     * @param containerID the container to query
+     * @param usage is set to the most recent sample
+     * @param delta is set to the change since the sample before, see ResourceSampler::delta
+     *
+     * @throws SoftwareContainerError if the container does not exist or has not been sampled
+     */
+    void getResourceUsage(ContainerID containerID, ResourceSample &usage, ResourceSample &delta);
+
+    /**
+     * @brief Set a function to be called from the main loop with the resource usage of each
+     * sampled container, every resource-signal-interval milliseconds
+     *
+     * @param listener the function to call, with the most recent sample and the delta
+     */
+    void setResourceUsageListener(
+        std::function<void (ContainerID, const ResourceSample &, const ResourceSample &)> listener);
+
+    /**
+     * @brief Set a function to be called when a container, or the host, has been stalled on
+     * memory, CPU or IO for longer than the pressure-threshold config allows
+     *
+     * @param listener the function to call, with the container ID or PressureMonitor::HOST_ID,
+     *        the resource, and the share of the last 10 seconds it was stalled, in percent
+     */
+    void setPressureListener(
+        std::function<void (ContainerID, const std::string &, double)> listener);
+
+    /**
+     * @brief Set a function to be called when the high, max, oom or oom_kill counter in
+     * memory.events of a container increases
+     *
+     * @param listener the function to call, with the container ID, the counter and its value
+     */
+    void setMemoryEventListener(
+        std::function<void (ContainerID, const std::string &, uint64_t)> listener);
+
+    /**
+     * @brief Set a function to be called when a container has been destroyed with
+     * shutdownContainer
+     *
+     * @param listener the function to call, with the time it took to stop the processes of
+     *        the container and tear it down, in milliseconds
+     */
+    void setContainerDestroyedListener(std::function<void (ContainerID, uint64_t)> listener);
+
+    /**
+     * @brief Get the CPUs each container has been placed on according to its priority class
+     *
+     * Containers that have no cgroup, or that were created when the online CPUs of the host
+     * could not be read, are not placed and not part of the result.
+     *
+     * @return the CPUs of each placed container, in the format used by cpuset.cpus
+     */
+    CpusetAllocator::Placement getCpuPlacement();
 private:
+    /**
+     * @brief Called by the OverlaySyncer thread when a sync is done, passes the result on to
+     * the write buffer synced listener in the main loop
+     */
+    void onWriteBufferSynced(const std::string &tag, bool success);
+
+    // Passes the most recent resource usage of all sampled containers to the listener
+    void notifyResourceUsage();
+
+    // Adds an exited process to the history of its container
+    void recordProcessExit(ContainerID containerID, const ProcessRecord &record);
+
+    /**
+     * @brief Starts tracking a container that was just created or restored
+     */
+    void addContainer(ContainerID containerID,
+                      SoftwareContainerPtr container,
+                      const DynamicContainerOptions &options,
+                      const std::string &config);
+
+    /**
+     * @brief Runs an operation on several containers in parallel
+     *
+     * @param containerIDs the containers to run the operation on, duplicates are ignored
+     * @param operation called once for each container that exists, may throw
+     * @param results set to whether the operation succeeded for each container
+     */
+    void forEachInParallel(const std::vector<ContainerID> &containerIDs,
+                           std::function<void (SoftwareContainerPtr)> operation,
+                           std::map<ContainerID, bool> &results);
+
+    // Writes the new CPUs of containers whose placement changed to their cpuset.cpus
+    void applyCpuPlacement(const CpusetAllocator::Placement &changed);
+
     /**
      * @brief Update gateway configurations for the container
      *
@@ -241,12 +508,14 @@ private:
     void assertContainerExists(ContainerID containerID);
     // Return a suitable container id
     ContainerID findSuitableId();
+    // Take a specific container id, returns false if it is in use
+    bool claimId(ContainerID containerID);
 
     // List of containers in use
     std::map<ContainerID, SoftwareContainerPtr> m_containers;
 
     Glib::RefPtr<Glib::MainContext> m_mainLoopContext;
-    SignalConnectionsHandler m_connections;
+    ProcessMonitor m_processMonitor;
     std::vector<ContainerID> m_containerIdPool;
 
     std::shared_ptr<FilteredConfigStore> m_filteredConfigStore;
@@ -254,6 +523,53 @@ private:
 
     std::shared_ptr<Config> m_config;
 
+    std::function<void (ContainerID, bool)> m_writeBufferSyncedListener;
+    // Sync results waiting to be passed on in the main loop, and the idle source doing that
+    std::mutex m_writeBufferSyncedLock;
+    std::vector<std::pair<ContainerID, bool>> m_writeBuffersSynced;
+    sigc::connection m_writeBufferSyncedNotifier;
+
+    std::function<void (ContainerID, const WriteBufferUsage &)> m_writeBufferHighWaterListener;
+    // Containers whose write buffer has been reported to be above the high-water mark
+    std::set<ContainerID> m_writeBuffersAboveHighWater;
+    sigc::connection m_writeBufferSampler;
+
+    // Samples the cgroups of the containers on a thread of its own
+    ResourceSampler m_resourceSampler;
+    std::function<void (ContainerID, const ResourceSample &, const ResourceSample &)> m_resourceUsageListener;
+    sigc::connection m_resourceUsageNotifier;
+
+    // Watches pressure and memory events of the host and the containers, if enabled
+    std::unique_ptr<PressureMonitor> m_pressureMonitor;
+    std::function<void (ContainerID, const std::string &, double)> m_pressureListener;
+    std::function<void (ContainerID, const std::string &, uint64_t)> m_memoryEventListener;
+
+    std::function<void (ContainerID, uint64_t)> m_containerDestroyedListener;
+
+    // Priority class of each container, given when it was created
+    std::map<ContainerID, PriorityClass> m_priorityClasses;
+
+    // The configuration each container was created with, kept for checkpoints
+    std::map<ContainerID, std::string> m_createConfigs;
+
+    // Status of each container, without the parts read when listed
+    std::map<ContainerID, ContainerStatus> m_statuses;
+
+    // Places containers on the online CPUs by priority class
+    CpusetAllocator m_cpusetAllocator;
+
+    // Exited processes of each container, at most PROCESS_HISTORY_SIZE per container
+    std::map<ContainerID, std::deque<ProcessRecord>> m_processHistory;
+
+    // Output of processes launched with execute, by pid. The output of exited processes is
+    // dropped when they are dropped from m_processHistory.
+    struct CapturedOutput {
+        ContainerID containerID;
+        std::unique_ptr<OutputCapture> capture;
+        bool exited;
+    };
+    std::map<pid_t, CapturedOutput> m_outputCaptures;
+
     /*
      * Holds all configs to use for each SoftwareContainer instance,
      * both the static configs from Config, as well as dynamic values
@@ -29,4 +29,14 @@ SoftwareContainerFactory::createContainer(const ContainerID id,
     return container;
 }
 
+std::shared_ptr<SoftwareContainerAbstractInterface>
+SoftwareContainerFactory::restoreContainer(const ContainerID id,
+                                           std::unique_ptr<const SoftwareContainerConfig> config,
+                                           const std::string &checkpointDirectory)
+{
+    auto container = std::shared_ptr<SoftwareContainerAbstractInterface>(
+                     new SoftwareContainer(id, std::move(config), checkpointDirectory));
+    return container;
+}
+
 } //namespace
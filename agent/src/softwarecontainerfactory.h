@@ -40,6 +40,14 @@ public:
     virtual std::shared_ptr<SoftwareContainerAbstractInterface>
             createContainer(const ContainerID id,
                             std::unique_ptr<const SoftwareContainerConfig> config);
+
+    /*
+     * Creates a container that is restored from a checkpoint instead of started
+     */
+    virtual std::shared_ptr<SoftwareContainerAbstractInterface>
+            restoreContainer(const ContainerID id,
+                             std::unique_ptr<const SoftwareContainerConfig> config,
+                             const std::string &checkpointDirectory);
 };
 
 } //namespace
@@ -108,6 +108,28 @@ TEST_F(ContainerOptionParserTest, parseConfigNiceTmpfsEnabledSmall) {
     ASSERT_EQ(m_options->temporaryFileSystemSize(), 100);
 }
 
+/*
+ * Parse a configuration where the tmpfs may grow, the max size must not be below the size
+ */
+TEST_F(ContainerOptionParserTest, parseConfigTmpfsMaxSize) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"temporaryFileSystemWriteBufferEnabled\": true, \
+                    \"temporaryFileSystemSize\": 10485760, \
+                    \"temporaryFileSystemMaxSize\": 41943040}]"));
+    ASSERT_EQ(m_options->temporaryFileSystemSize(), 10485760u);
+    ASSERT_EQ(m_options->temporaryFileSystemMaxSize(), 41943040u);
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"temporaryFileSystemWriteBufferEnabled\": true, \
+                    \"temporaryFileSystemSize\": 10485760}]"));
+    ASSERT_EQ(m_options->temporaryFileSystemMaxSize(), 0u);
+
+    ASSERT_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"temporaryFileSystemWriteBufferEnabled\": true, \
+                    \"temporaryFileSystemSize\": 10485760, \
+                    \"temporaryFileSystemMaxSize\": 1048576}]"), ContainerOptionParseError);
+}
+
 /*
  * Parse a "good" configuration where everything is disabled.
  */
@@ -170,3 +192,77 @@ TEST_F(ContainerOptionParserTest, parseConfigEvilConfig) {
     ASSERT_FALSE(m_options->writeBufferEnabled());
 }
 
+
+/*
+ * Asynchronous write buffer sync is off unless asked for
+ */
+TEST_F(ContainerOptionParserTest, parseConfigAsyncWriteBufferSync) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true}]"));
+    ASSERT_FALSE(m_options->asyncWriteBufferSync());
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"asyncWriteBufferSync\": true}]"));
+    ASSERT_TRUE(m_options->asyncWriteBufferSync());
+}
+
+/*
+ * Asynchronous write buffer sync is ignored without a write buffer
+ */
+TEST_F(ContainerOptionParserTest, parseConfigAsyncWriteBufferSyncDisabled) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": false, \
+                    \"asyncWriteBufferSync\": true}]"));
+    ASSERT_FALSE(m_options->asyncWriteBufferSync());
+}
+
+/*
+ * An app image must be given as an absolute path and needs a write buffer
+ */
+TEST_F(ContainerOptionParserTest, parseConfigAppImage) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"appImage\": \"/opt/apps/example.erofs\"}]"));
+    ASSERT_EQ("/opt/apps/example.erofs", m_options->appImage());
+
+    ASSERT_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"appImage\": \"example.erofs\"}]"),
+                 ContainerOptionParseError);
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": false, \
+                    \"appImage\": \"/opt/apps/example.erofs\"}]"));
+    ASSERT_EQ("", m_options->appImage());
+}
+
+/*
+ * Volatile write buffers are off unless asked for, and need a write buffer
+ */
+TEST_F(ContainerOptionParserTest, parseConfigVolatileWriteBuffer) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true}]"));
+    ASSERT_FALSE(m_options->volatileWriteBuffer());
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"volatileWriteBuffer\": true}]"));
+    ASSERT_TRUE(m_options->volatileWriteBuffer());
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": false, \
+                    \"volatileWriteBuffer\": true}]"));
+    ASSERT_FALSE(m_options->volatileWriteBuffer());
+}
+
+/*
+ * The priority class defaults to foreground and must be one of the known classes
+ */
+TEST_F(ContainerOptionParserTest, parseConfigPriorityClass) {
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": false}]"));
+    ASSERT_EQ(PriorityClass::Foreground, m_options->priorityClass());
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": false, \
+                    \"priorityClass\": \"realtime\"}]"));
+    ASSERT_EQ(PriorityClass::RealTime, m_options->priorityClass());
+
+    ASSERT_NO_THROW(parse("[{\"writeBufferEnabled\": true, \
+                    \"priorityClass\": \"background\"}]"));
+    ASSERT_EQ(PriorityClass::Background, m_options->priorityClass());
+
+    ASSERT_THROW(parse("[{\"writeBufferEnabled\": false, \
+                    \"priorityClass\": \"urgent\"}]"),
+                 ContainerOptionParseError);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+
+#include "softwarecontainer-common.h"
+#include "cpusetallocator.h"
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+class CpusetAllocatorTest: public ::testing::Test
+{
+public:
+    CpusetAllocatorTest() : m_allocator({0, 1, 2, 3, 4, 5, 6, 7}) {}
+
+    CpusetAllocator m_allocator;
+};
+
+/*
+ * Foreground containers may use all CPUs, so placing them changes nothing
+ */
+TEST_F(CpusetAllocatorTest, ForegroundRunsEverywhere) {
+    ASSERT_TRUE(m_allocator.add(1, PriorityClass::Foreground).empty());
+    ASSERT_TRUE(m_allocator.add(2, PriorityClass::Foreground).empty());
+    ASSERT_EQ("0-7", m_allocator.placement()[1]);
+    ASSERT_EQ("0-7", m_allocator.placement()[2]);
+}
+
+/*
+ * Background containers are kept to the lower half of the shared CPUs
+ */
+TEST_F(CpusetAllocatorTest, BackgroundGetsLowerHalf) {
+    CpusetAllocator::Placement changed = m_allocator.add(1, PriorityClass::Background);
+    ASSERT_EQ(1u, changed.size());
+    ASSERT_EQ("0-3", changed[1]);
+}
+
+/*
+ * Realtime containers get a core of their own which is taken away from the shared pool,
+ * and the shared containers get it back when the realtime container goes away
+ */
+TEST_F(CpusetAllocatorTest, RealTimeGetsExclusiveCore) {
+    m_allocator.add(1, PriorityClass::Foreground);
+    m_allocator.add(2, PriorityClass::Background);
+
+    CpusetAllocator::Placement changed = m_allocator.add(3, PriorityClass::RealTime);
+    ASSERT_EQ("7", changed[3]);
+    ASSERT_EQ("0-6", changed[1]);
+    ASSERT_EQ("0-2", changed[2]);
+
+    changed = m_allocator.remove(3);
+    ASSERT_EQ(2u, changed.size());
+    ASSERT_EQ("0-7", changed[1]);
+    ASSERT_EQ("0-3", changed[2]);
+    ASSERT_EQ(0u, m_allocator.placement().count(3));
+}
+
+/*
+ * At least one core is always left shared, and a realtime container without a core of its
+ * own gets the first one that is freed
+ */
+TEST_F(CpusetAllocatorTest, RealTimeWaitsForFreeCore) {
+    CpusetAllocator allocator({0, 1, 2});
+
+    ASSERT_EQ("2", allocator.add(1, PriorityClass::RealTime)[1]);
+    ASSERT_EQ("1", allocator.add(2, PriorityClass::RealTime)[2]);
+
+    // No core left to give away, so container 3 shares core 0
+    ASSERT_EQ("0", allocator.add(3, PriorityClass::RealTime)[3]);
+
+    CpusetAllocator::Placement changed = allocator.remove(1);
+    ASSERT_EQ(1u, changed.size());
+    ASSERT_EQ("2", changed[3]);
+    ASSERT_EQ("1", allocator.placement()[2]);
+}
+
+/*
+ * Without any CPUs to place on, containers are left alone
+ */
+TEST_F(CpusetAllocatorTest, NoCpusDisablesPlacement) {
+    CpusetAllocator allocator(CpusetAllocator::onlineCpus("/nonexistent/online"));
+
+    ASSERT_TRUE(allocator.add(1, PriorityClass::RealTime).empty());
+    ASSERT_TRUE(allocator.placement().empty());
+    ASSERT_TRUE(allocator.remove(1).empty());
+}
+
+/*
+ * The online CPUs of the host can be read
+ */
+TEST_F(CpusetAllocatorTest, ReadsOnlineCpus) {
+    std::vector<unsigned int> cpus = CpusetAllocator::onlineCpus();
+    ASSERT_FALSE(cpus.empty());
+    ASSERT_EQ(sysconf(_SC_NPROCESSORS_ONLN), (long) cpus.size());
+}
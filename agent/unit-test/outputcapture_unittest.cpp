@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "softwarecontainer-common.h"
+#include "outputcapture.h"
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+class OutputCaptureTest: public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        char dirTemplate[] = "/tmp/outputcapture-XXXXXX";
+        m_dir = mkdtemp(dirTemplate);
+        ASSERT_EQ(pipe(m_pipe), 0);
+    }
+
+    void TearDown() override
+    {
+        if (m_pipe[1] != -1) {
+            close(m_pipe[1]);
+        }
+        system(("rm -rf " + m_dir).c_str());
+    }
+
+    void writeOutput(OutputCapture &capture, const std::string &data)
+    {
+        ASSERT_EQ(write(m_pipe[1], data.c_str(), data.size()), (ssize_t)data.size());
+        m_context->iteration(true);
+        ASSERT_TRUE(capture.isOpen());
+    }
+
+    Glib::RefPtr<Glib::MainContext> m_context = Glib::MainContext::get_default();
+    std::string m_dir;
+    int m_pipe[2] = {-1, -1};
+};
+
+/*
+ * The most recent output is kept in the buffer, and the capture ends when the pipe is closed
+ */
+TEST_F(OutputCaptureTest, tail)
+{
+    OutputCapture capture(m_context, m_pipe[0], 8);
+
+    writeOutput(capture, "hello ");
+    writeOutput(capture, "world");
+    ASSERT_EQ(capture.tail(100), "lo world");
+    ASSERT_EQ(capture.tail(5), "world");
+
+    close(m_pipe[1]);
+    m_pipe[1] = -1;
+    while (capture.isOpen()) {
+        m_context->iteration(true);
+    }
+    ASSERT_EQ(capture.tail(5), "world");
+}
+
+/*
+ * The output file is rotated into compressed segments, and only the configured number of
+ * segments is kept
+ */
+TEST_F(OutputCaptureTest, rotation)
+{
+    OutputCapture capture(m_context, m_pipe[0], 1024);
+    std::string path = buildPath(m_dir, "output");
+    ASSERT_TRUE(capture.setOutputFile(path, 10, 2));
+
+    for (int i = 0; i < 4; i++) {
+        writeOutput(capture, "0123456789");
+    }
+    writeOutput(capture, "abc");
+
+    ASSERT_TRUE(isFile(path + ".1.gz"));
+    ASSERT_TRUE(isFile(path + ".2.gz"));
+    ASSERT_FALSE(isFile(path + ".3.gz"));
+
+    std::string content;
+    ASSERT_TRUE(readFromFile(path, content));
+    ASSERT_EQ(content, "abc");
+}
@@ -22,10 +22,12 @@
 #include "config/config.h"
 #include "config/configloader.h"
 #include "config/mainconfigsource.h"
+#include "config/defaultconfigsource.h"
 #include "config/configdefinition.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <stdexcept>
 
 using namespace softwarecontainer;
 
@@ -79,6 +81,25 @@ public:
 
     MOCK_METHOD3(bindMount, bool(const std::string &, const std::string &, bool readonly));
 
+    MOCK_METHOD1(writeBufferUsage, bool(WriteBufferUsage &));
+
+    MOCK_METHOD1(resizeWriteBuffer, bool(uint64_t));
+
+    MOCK_METHOD1(setCgroupLimits, bool(const std::map<std::string, std::string> &));
+
+    MOCK_METHOD0(cgroupPath, std::string());
+
+    MOCK_METHOD1(checkpoint, void(const std::string &));
+
+    MOCK_METHOD0(initPid, pid_t());
+
+    ObservableProperty<ContainerState> &getContainerState()
+    {
+        return m_state;
+    }
+
+    ObservableWritableProperty<ContainerState> m_state{ContainerState::READY};
+
     bool previouslyConfigured()
     {
         return false;
@@ -99,6 +120,13 @@ public:
         return m_container;
      }
 
+    std::shared_ptr<SoftwareContainerAbstractInterface> restoreContainer(const ContainerID id __attribute__((unused)),
+                                                                         std::unique_ptr<const SoftwareContainerConfig> config __attribute__((unused)),
+                                                                         const std::string &checkpointDirectory __attribute__((unused)))
+     {
+        return m_container;
+     }
+
     std::shared_ptr<SoftwareContainerAbstractInterface> m_container;
 };
 
@@ -132,6 +160,7 @@ public:
 #endif
                                      "shutdown-timeout = 1\n"
                                      "shared-mounts-dir = " + std::string(SHARED_MOUNTS_DIR_TESTING) + "\n"
+                                     "write-buffer-sync-dir = " + std::string(WRITE_BUFFER_SYNC_DIR_TESTING) + "\n"
                                      "deprecated-lxc-config-path = " + std::string(LXC_CONFIG_PATH_TESTING) + "\n"
                                      "service-manifest-dir = " + std::string(SERVICE_MANIFEST_DIR_TESTING) + "\n"
                                      "default-service-manifest-dir = " + std::string(DEFAULT_SERVICE_MANIFEST_DIR_TESTING) + "\n";
@@ -140,12 +169,26 @@ public:
 
     void SetUp() override
     {
-        std::unique_ptr<ConfigLoader> loader(new StringConfigLoader(configString));
+        createAgent("");
+    }
+
+    /*
+     * Creates the agent with the fixture config plus 'extraConfig'. Values
+     * not set in either are taken from the build defaults.
+     */
+    void createAgent(const std::string &extraConfig)
+    {
+        // The old agent stops the write buffer syncer when it is destroyed
+        sca.reset();
+
+        std::unique_ptr<ConfigLoader> loader(new StringConfigLoader(configString + extraConfig));
         std::unique_ptr<ConfigSource> mainConfig(new MainConfigSource(std::move(loader),
                                                                       ConfigDefinition::typeMap()));
+        std::unique_ptr<ConfigSource> defaultConfig(new DefaultConfigSource());
 
         std::vector<std::unique_ptr<ConfigSource>> configSources;
         configSources.push_back(std::move(mainConfig));
+        configSources.push_back(std::move(defaultConfig));
 
         std::shared_ptr<Config> config = std::make_shared<Config>(std::move(configSources),
                                                                   ConfigDefinition::mandatory(),
@@ -197,7 +240,7 @@ TEST_F(SoftwareContainerAgentTest, ExecuteTest) {
     using ::testing::_;
     EXPECT_CALL(*testContainerInterface, startGateways(_));
     EXPECT_CALL(*testContainerInterface, createCommandJob(_));
-    ASSERT_THROW((sca->execute(id, "run somecommands", "/root", "stdout", var, [&](pid_t, int){})),
+    ASSERT_THROW((sca->execute(id, "run somecommands", "/root", "stdout", var, [&](pid_t, int, const ProcessUsage &){})),
                   SoftwareContainerAgentError);
 
 }
@@ -205,3 +248,314 @@ TEST_F(SoftwareContainerAgentTest, ExecuteTest) {
 
 
 
+
+/*
+ * Test that a full write buffer is grown up to its max size, and reported once if still full
+ */
+TEST_F(SoftwareContainerAgentTest, WriteBufferGrowsAndReportsHighWater) {
+    using ::testing::_;
+    using ::testing::DoAll;
+    using ::testing::Return;
+    using ::testing::SetArgReferee;
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    WriteBufferUsage full;
+    full.usedBytes = 95;
+    full.freeBytes = 5;
+    full.sizeBytes = 100;
+    full.maxSizeBytes = 200;
+    WriteBufferUsage grown = full;
+    grown.usedBytes = 190;
+    grown.freeBytes = 10;
+    grown.sizeBytes = 200;
+
+    EXPECT_CALL(*testContainerInterface, writeBufferUsage(_))
+        .WillOnce(DoAll(SetArgReferee<0>(full), Return(true)))
+        .WillRepeatedly(DoAll(SetArgReferee<0>(grown), Return(true)));
+    EXPECT_CALL(*testContainerInterface, resizeWriteBuffer(200u)).WillOnce(Return(true));
+
+    int reported = 0;
+    sca->setWriteBufferHighWaterListener([&](ContainerID containerID,
+                                             const WriteBufferUsage &usage) {
+        EXPECT_EQ(id, containerID);
+        EXPECT_EQ(200u, usage.sizeBytes);
+        reported++;
+    });
+
+    sca->sampleWriteBuffers();
+    sca->sampleWriteBuffers();
+    ASSERT_EQ(1, reported);
+}
+
+/*
+ * Test that growing a write buffer below the high-water mark is not reported
+ */
+TEST_F(SoftwareContainerAgentTest, WriteBufferGrowsBelowHighWater) {
+    using ::testing::_;
+    using ::testing::DoAll;
+    using ::testing::Return;
+    using ::testing::SetArgReferee;
+
+    ASSERT_NO_THROW(sca->createContainer(valid_config));
+
+    WriteBufferUsage full;
+    full.usedBytes = 95;
+    full.freeBytes = 5;
+    full.sizeBytes = 100;
+    full.maxSizeBytes = 400;
+    WriteBufferUsage grown = full;
+    grown.freeBytes = 105;
+    grown.sizeBytes = 200;
+
+    EXPECT_CALL(*testContainerInterface, writeBufferUsage(_))
+        .WillOnce(DoAll(SetArgReferee<0>(full), Return(true)))
+        .WillOnce(DoAll(SetArgReferee<0>(grown), Return(true)));
+    EXPECT_CALL(*testContainerInterface, resizeWriteBuffer(200u)).WillOnce(Return(true));
+
+    bool reported = false;
+    sca->setWriteBufferHighWaterListener([&](ContainerID, const WriteBufferUsage &) {
+        reported = true;
+    });
+
+    sca->sampleWriteBuffers();
+    ASSERT_FALSE(reported);
+}
+
+/*
+ * Test that asking for the write buffer usage of a container without a tmpfs fails
+ */
+TEST_F(SoftwareContainerAgentTest, WriteBufferUsageWithoutTmpfs) {
+    using ::testing::_;
+    using ::testing::Return;
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    EXPECT_CALL(*testContainerInterface, writeBufferUsage(_)).WillOnce(Return(false));
+    ASSERT_THROW(sca->getWriteBufferUsage(id), SoftwareContainerError);
+}
+
+/*
+ * Test that changing cgroup limits fails if the container could not apply them
+ */
+TEST_F(SoftwareContainerAgentTest, SetCgroupLimits) {
+    using ::testing::_;
+    using ::testing::Return;
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    std::map<std::string, std::string> limits = { { "cpu.weight", "50" } };
+    EXPECT_CALL(*testContainerInterface, setCgroupLimits(limits))
+        .WillOnce(Return(true))
+        .WillOnce(Return(false));
+
+    ASSERT_NO_THROW(sca->setCgroupLimits(id, limits));
+    ASSERT_THROW(sca->setCgroupLimits(id, limits), SoftwareContainerError);
+    ASSERT_THROW(sca->setCgroupLimits(id + 1, limits), SoftwareContainerError);
+}
+
+/*
+ * Containers that are not running keep their CPUs when others are placed, and creating and
+ * destroying other containers still works
+ */
+TEST_F(SoftwareContainerAgentTest, PlacementSkipsContainersNotRunning) {
+    using ::testing::_;
+    using ::testing::Return;
+
+    const std::string backgroundConfig =
+        "[{\"writeBufferEnabled\": false, \"priorityClass\": \"background\"}]";
+    EXPECT_CALL(*testContainerInterface, cgroupPath())
+        .WillRepeatedly(Return("/sys/fs/cgroup/softwarecontainer-test"));
+
+    ContainerID first = 0;
+    ASSERT_NO_THROW((first = sca->createContainer(backgroundConfig)));
+
+    // All containers are the same mock, so none of them is running after this
+    testContainerInterface->m_state.setValueNotify(ContainerState::INVALID);
+    EXPECT_CALL(*testContainerInterface, setCgroupLimits(_)).Times(0);
+
+    ContainerID second = 0;
+    ASSERT_NO_THROW((second = sca->createContainer(backgroundConfig)));
+    ASSERT_NE(first, second);
+    ASSERT_NO_THROW(sca->shutdownContainer(second));
+    ASSERT_NO_THROW(sca->shutdownContainer(first));
+}
+
+/*
+ * Containers that are not in a cgroup v2 hierarchy are not sampled
+ */
+TEST_F(SoftwareContainerAgentTest, ResourceUsageWithoutCgroup) {
+    using ::testing::Return;
+
+    createAgent("resource-sample-interval = 1000\n");
+    EXPECT_CALL(*testContainerInterface, cgroupPath()).WillOnce(Return(""));
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    ResourceSample usage;
+    ResourceSample delta;
+    ASSERT_THROW(sca->getResourceUsage(id, usage, delta), SoftwareContainerError);
+    ASSERT_THROW(sca->getResourceUsage(id + 1, usage, delta), SoftwareContainerError);
+}
+
+/*
+ * Destroying a container reports how long it took
+ */
+TEST_F(SoftwareContainerAgentTest, ContainerDestroyedIsReported) {
+    using ::testing::_;
+
+    std::vector<ContainerID> destroyed;
+    sca->setContainerDestroyedListener([&destroyed] (ContainerID id, uint64_t) {
+        destroyed.push_back(id);
+    });
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    EXPECT_CALL(*testContainerInterface, shutdown(_));
+    ASSERT_NO_THROW(sca->shutdownContainer(id));
+    ASSERT_EQ(std::vector<ContainerID>{id}, destroyed);
+}
+
+/*
+ * Suspending and resuming many containers reports the result of each container
+ */
+TEST_F(SoftwareContainerAgentTest, SuspendAndResumeMany) {
+    using ::testing::Return;
+    using ::testing::Throw;
+
+    ContainerID first = 0;
+    ContainerID second = 0;
+    ASSERT_NO_THROW((first = sca->createContainer(valid_config)));
+    ASSERT_NO_THROW((second = sca->createContainer(valid_config)));
+    ContainerID unknown = second + 1;
+
+    // Both containers are the same mock, so one of them fails
+    EXPECT_CALL(*testContainerInterface, suspend())
+        .WillOnce(Return())
+        .WillOnce(Throw(InvalidOperationError("Already suspended")));
+
+    std::map<ContainerID, bool> results = sca->suspendContainers({ first, second, unknown });
+    ASSERT_EQ(3u, results.size());
+    ASSERT_NE(results[first], results[second]);
+    ASSERT_FALSE(results[unknown]);
+
+    EXPECT_CALL(*testContainerInterface, resume()).Times(2);
+
+    results = sca->resumeContainers({ first, second, unknown });
+    ASSERT_EQ(3u, results.size());
+    ASSERT_TRUE(results[first]);
+    ASSERT_TRUE(results[second]);
+    ASSERT_FALSE(results[unknown]);
+}
+
+/*
+ * A container listed twice is only suspended once, and any error is reported as a failure of
+ * that container
+ */
+TEST_F(SoftwareContainerAgentTest, SuspendManyIgnoresDuplicates) {
+    using ::testing::Throw;
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    EXPECT_CALL(*testContainerInterface, suspend())
+        .WillOnce(Throw(std::runtime_error("Unexpected error")));
+
+    std::map<ContainerID, bool> results = sca->suspendContainers({ id, id });
+    ASSERT_EQ(1u, results.size());
+    ASSERT_FALSE(results[id]);
+}
+
+/*
+ * A checkpointed container is removed, and can be restored with the ID and the configuration
+ * it was created with
+ */
+TEST_F(SoftwareContainerAgentTest, CheckpointAndRestore) {
+    char directoryTemplate[] = "/tmp/sc-checkpoint-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(directoryTemplate));
+    std::string directory(directoryTemplate);
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    EXPECT_CALL(*testContainerInterface, checkpoint(directory));
+    ASSERT_NO_THROW(sca->checkpointContainer(id, directory));
+    ASSERT_THROW(sca->getContainer(id), SoftwareContainerError);
+
+    ContainerID restored = INVALID_CONTAINER_ID;
+    ASSERT_NO_THROW((restored = sca->restoreContainer(directory)));
+    ASSERT_EQ(id, restored);
+    ASSERT_EQ(testContainerInterface, sca->getContainer(restored));
+
+    unlink((directory + "/config.json").c_str());
+    ASSERT_THROW(sca->restoreContainer(directory), SoftwareContainerError);
+    rmdir(directory.c_str());
+}
+
+/*
+ * A container can not be restored while another container has its ID, and IDs handed out
+ * after a restore don't collide with the restored one
+ */
+TEST_F(SoftwareContainerAgentTest, RestoreKeepsId) {
+    char directoryTemplate[] = "/tmp/sc-checkpoint-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(directoryTemplate));
+    std::string directory(directoryTemplate);
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+    EXPECT_CALL(*testContainerInterface, checkpoint(directory));
+    ASSERT_NO_THROW(sca->checkpointContainer(id, directory));
+
+    // The freed ID is handed out again
+    ContainerID other = INVALID_CONTAINER_ID;
+    ASSERT_NO_THROW((other = sca->createContainer(valid_config)));
+    ASSERT_EQ(id, other);
+    ASSERT_THROW(sca->restoreContainer(directory), SoftwareContainerError);
+
+    sca->deleteContainer(other);
+    ContainerID restored = INVALID_CONTAINER_ID;
+    ASSERT_NO_THROW((restored = sca->restoreContainer(directory)));
+    ASSERT_EQ(id, restored);
+
+    ASSERT_NO_THROW((other = sca->createContainer(valid_config)));
+    ASSERT_NE(id, other);
+
+    unlink((directory + "/config.json").c_str());
+    rmdir(directory.c_str());
+}
+
+/*
+ * The status of containers is listed from what the agent keeps track of
+ */
+TEST_F(SoftwareContainerAgentTest, ListContainerStatus) {
+    using ::testing::_;
+    using ::testing::Return;
+
+    EXPECT_CALL(*testContainerInterface, initPid()).WillOnce(Return(1234));
+
+    ContainerID id = 0;
+    ASSERT_NO_THROW((id = sca->createContainer(valid_config)));
+
+    std::vector<ContainerStatus> statuses = sca->listContainerStatus(true);
+    ASSERT_EQ(1u, statuses.size());
+    ASSERT_EQ(id, statuses[0].containerID);
+    ASSERT_EQ(ContainerState::READY, statuses[0].state);
+    ASSERT_EQ(1234, statuses[0].initPid);
+    ASSERT_TRUE(statuses[0].processes.empty());
+    ASSERT_LT(0u, statuses[0].createdAt);
+    // Containers without a cgroup v2 cgroup are not sampled
+    ASSERT_FALSE(statuses[0].hasUsage);
+
+    testContainerInterface->m_state.setValueNotify(ContainerState::SUSPENDED);
+    statuses = sca->listContainerStatus(false);
+    ASSERT_EQ(ContainerState::SUSPENDED, statuses[0].state);
+
+    EXPECT_CALL(*testContainerInterface, shutdown(_));
+    ASSERT_NO_THROW(sca->shutdownContainer(id));
+    ASSERT_TRUE(sca->listContainerStatus(false).empty());
+}
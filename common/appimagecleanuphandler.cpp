@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "appimagecleanuphandler.h"
+#include "appimageregistry.h"
+
+namespace softwarecontainer {
+
+AppImageCleanUpHandler::AppImageCleanUpHandler(const std::string &canonicalPath)
+{
+    m_canonicalPath = canonicalPath;
+}
+
+bool AppImageCleanUpHandler::clean()
+{
+    return AppImageRegistry::getInstance().release(m_canonicalPath);
+}
+
+const std::string AppImageCleanUpHandler::queryName()
+{
+    return "";
+}
+
+} // namespace softwarecontainer
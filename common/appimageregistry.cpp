@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "appimageregistry.h"
+#include "filedescriptor.h"
+
+#include <climits>
+#include <fcntl.h>
+#include <linux/loop.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace softwarecontainer {
+
+namespace {
+
+const std::string EROFS_TYPE = "erofs";
+const std::string SQUASHFS_TYPE = "squashfs";
+
+// Both magic numbers are stored little endian
+constexpr off_t EROFS_SUPERBLOCK_OFFSET = 1024;
+const unsigned char EROFS_MAGIC[] = { 0xe2, 0xe1, 0xf5, 0xe0 };
+const unsigned char SQUASHFS_MAGIC[] = { 'h', 's', 'q', 's' };
+
+// Tries to get a free loop device this many times, since another process may take it first
+constexpr int LOOP_DEVICE_ATTEMPTS = 5;
+
+bool hasMagic(int fd, off_t offset, const unsigned char *magic)
+{
+    unsigned char buffer[4];
+    return ::pread(fd, buffer, sizeof(buffer), offset) == sizeof(buffer)
+           && memcmp(buffer, magic, sizeof(buffer)) == 0;
+}
+
+/*
+ * Names the mount point after the image file, made unique by the inode of the file
+ */
+std::string mountPointName(const std::string &imagePath, const struct stat &st)
+{
+    return logging::StringBuilder() << baseName(imagePath) << "-" << st.st_dev << "-"
+                                    << st.st_ino;
+}
+
+} // namespace
+
+AppImageRegistry &AppImageRegistry::getInstance()
+{
+    static AppImageRegistry instance;
+    return instance;
+}
+
+std::string AppImageRegistry::fileSystemType(const std::string &imagePath)
+{
+    FileDescriptor fd(::open(imagePath.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.isValid()) {
+        return "";
+    }
+
+    if (hasMagic(fd.get(), EROFS_SUPERBLOCK_OFFSET, EROFS_MAGIC)) {
+        return EROFS_TYPE;
+    }
+    if (hasMagic(fd.get(), 0, SQUASHFS_MAGIC)) {
+        return SQUASHFS_TYPE;
+    }
+    return "";
+}
+
+bool AppImageRegistry::acquire(const std::string &imagePath,
+                               const std::string &mountDir,
+                               std::string &mountPoint,
+                               std::string &canonicalPath)
+{
+    char resolved[PATH_MAX];
+    if (nullptr == ::realpath(imagePath.c_str(), resolved)) {
+        log_error() << "Could not find image " << imagePath << ": " << strerror(errno);
+        return false;
+    }
+    std::string resolvedPath(resolved);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_images.find(resolvedPath);
+    if (it != m_images.end()) {
+        it->second.users++;
+        mountPoint = it->second.mountPoint;
+        canonicalPath = resolvedPath;
+        log_debug() << "Image " << resolvedPath << " already mounted at " << mountPoint
+                    << ", users: " << it->second.users;
+        return true;
+    }
+
+    struct stat st;
+    if (::stat(resolvedPath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        log_error() << "Image " << resolvedPath << " is not a regular file";
+        return false;
+    }
+
+    std::string type = fileSystemType(resolvedPath);
+    if (type.empty()) {
+        log_error() << "Image " << resolvedPath << " is neither an EROFS nor a squashfs image";
+        return false;
+    }
+
+    std::string path = buildPath(mountDir, mountPointName(resolvedPath, st));
+    if (::mkdir(mountDir.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+        log_error() << "Could not create " << mountDir << ": " << strerror(errno);
+        return false;
+    }
+    if (::mkdir(path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0
+        && errno != EEXIST) {
+        log_error() << "Could not create " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    if (!mount(resolvedPath, type, path)) {
+        ::rmdir(path.c_str());
+        return false;
+    }
+
+    m_images[resolvedPath] = MountedImage{path, 1};
+    mountPoint = path;
+    canonicalPath = resolvedPath;
+    log_info() << "Mounted " << type << " image " << resolvedPath << " at " << path;
+    return true;
+}
+
+bool AppImageRegistry::release(const std::string &canonicalPath)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_images.find(canonicalPath);
+    if (it == m_images.end()) {
+        log_error() << "Image " << canonicalPath << " is not acquired";
+        return false;
+    }
+
+    if (--it->second.users > 0) {
+        return true;
+    }
+
+    std::string mountPoint = it->second.mountPoint;
+    m_images.erase(it);
+
+    // The loop device is detached automatically when the last reference to it goes away
+    if (::umount2(mountPoint.c_str(), MNT_DETACH) != 0) {
+        log_error() << "Could not unmount image at " << mountPoint << ": " << strerror(errno);
+        return false;
+    }
+    ::rmdir(mountPoint.c_str());
+
+    log_info() << "Unmounted image " << canonicalPath;
+    return true;
+}
+
+bool AppImageRegistry::mount(const std::string &imagePath,
+                             const std::string &fileSystemType,
+                             const std::string &mountPoint)
+{
+    FileDescriptor imageFd(::open(imagePath.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!imageFd.isValid()) {
+        log_error() << "Could not open " << imagePath << ": " << strerror(errno);
+        return false;
+    }
+
+    std::string loopDevice;
+    FileDescriptor loopFd(attachLoopDevice(imageFd.get(), imagePath, loopDevice));
+    if (!loopFd.isValid()) {
+        return false;
+    }
+
+    if (::mount(loopDevice.c_str(), mountPoint.c_str(), fileSystemType.c_str(),
+                MS_RDONLY | MS_NODEV | MS_NOSUID, nullptr) != 0) {
+        log_error() << "Could not mount " << loopDevice << " at " << mountPoint << ": "
+                    << strerror(errno);
+        ::ioctl(loopFd.get(), LOOP_CLR_FD, 0);
+        return false;
+    }
+
+    return true;
+}
+
+int AppImageRegistry::attachLoopDevice(int imageFd,
+                                       const std::string &imagePath,
+                                       std::string &loopDevice)
+{
+    FileDescriptor controlFd(::open("/dev/loop-control", O_RDWR | O_CLOEXEC));
+    if (!controlFd.isValid()) {
+        log_error() << "Could not open /dev/loop-control: " << strerror(errno);
+        return INVALID_FD;
+    }
+
+    struct loop_info64 info;
+    memset(&info, 0, sizeof(info));
+    info.lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR;
+    strncpy(reinterpret_cast<char *>(info.lo_file_name), imagePath.c_str(),
+            LO_NAME_SIZE - 1);
+
+    for (int attempt = 0; attempt < LOOP_DEVICE_ATTEMPTS; attempt++) {
+        int number = ::ioctl(controlFd.get(), LOOP_CTL_GET_FREE);
+        if (number < 0) {
+            log_error() << "Could not get a free loop device: " << strerror(errno);
+            return INVALID_FD;
+        }
+
+        loopDevice = "/dev/loop" + std::to_string(number);
+        int loopFd = ::open(loopDevice.c_str(), O_RDONLY | O_CLOEXEC);
+        if (loopFd < 0) {
+            log_error() << "Could not open " << loopDevice << ": " << strerror(errno);
+            return INVALID_FD;
+        }
+
+#ifdef LOOP_CONFIGURE
+        struct loop_config config;
+        memset(&config, 0, sizeof(config));
+        config.fd = imageFd;
+        config.info = info;
+        if (::ioctl(loopFd, LOOP_CONFIGURE, &config) == 0) {
+            return loopFd;
+        }
+        // Older kernels do not know about LOOP_CONFIGURE
+        if (errno != EINVAL && errno != ENOTTY) {
+            int error = errno;
+            ::close(loopFd);
+            if (error == EBUSY) {
+                continue;
+            }
+            log_error() << "Could not configure " << loopDevice << ": " << strerror(error);
+            return INVALID_FD;
+        }
+#endif
+
+        if (::ioctl(loopFd, LOOP_SET_FD, imageFd) != 0) {
+            int error = errno;
+            ::close(loopFd);
+            if (error == EBUSY) {
+                continue;
+            }
+            log_error() << "Could not attach " << imagePath << " to " << loopDevice << ": "
+                        << strerror(error);
+            return INVALID_FD;
+        }
+
+        if (::ioctl(loopFd, LOOP_SET_STATUS64, &info) != 0) {
+            log_error() << "Could not configure " << loopDevice << ": " << strerror(errno);
+            ::ioctl(loopFd, LOOP_CLR_FD, 0);
+            ::close(loopFd);
+            return INVALID_FD;
+        }
+
+        return loopFd;
+    }
+
+    log_error() << "Could not get a free loop device, all attempts were taken by others";
+    return INVALID_FD;
+}
+
+} // namespace softwarecontainer
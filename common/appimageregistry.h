@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <map>
+#include <mutex>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The AppImageRegistry class is a singleton class that mounts read-only application
+ * images and shares the mounts between all containers using the same image.
+ *
+ * An image is a file holding an EROFS or squashfs filesystem. It is attached to a read-only
+ * loop device and mounted the first time it is acquired, and unmounted when the last user
+ * releases it. The loop device is set to be detached automatically once it is unmounted.
+ * Since all containers using an image share one mount, they also share its page cache.
+ */
+class AppImageRegistry
+{
+    LOG_DECLARE_CLASS_CONTEXT("APIM", "App image registry");
+
+public:
+    /**
+     * @brief getInstance Gets the AppImageRegistry instance.
+     * @return The AppImageRegistry instance.
+     */
+    static AppImageRegistry &getInstance();
+
+    AppImageRegistry(const AppImageRegistry &) = delete;
+    AppImageRegistry &operator=(const AppImageRegistry &) = delete;
+
+    /**
+     * @brief acquire Gets the mount point of an image, mounting it if it is not already
+     *  mounted
+     *
+     * @param imagePath The image file to mount
+     * @param mountDir Directory to create the mount point in, if the image needs to be mounted
+     * @param mountPoint Set to where the image is mounted
+     * @param canonicalPath Set to the canonical path of the image, to pass to release()
+     * @return true on success, false on failure
+     */
+    bool acquire(const std::string &imagePath,
+                 const std::string &mountDir,
+                 std::string &mountPoint,
+                 std::string &canonicalPath);
+
+    /**
+     * @brief release Releases an image acquired with acquire(), and unmounts it if this was
+     *  the last user of it
+     *
+     * The image is looked up by the canonical path given by acquire(), since the path it was
+     * acquired with may have been changed or removed since.
+     *
+     * @param canonicalPath The canonical path of the image, as set by acquire()
+     * @return true on success, false if the image was not acquired or could not be unmounted
+     */
+    bool release(const std::string &canonicalPath);
+
+    /**
+     * @brief fileSystemType Finds the type of the filesystem in an image from its superblock
+     * @return "erofs" or "squashfs", or an empty string if the image is neither
+     */
+    static std::string fileSystemType(const std::string &imagePath);
+
+private:
+    AppImageRegistry() {}
+    ~AppImageRegistry() {}
+
+    struct MountedImage
+    {
+        std::string mountPoint;
+        unsigned int users;
+    };
+
+    bool mount(const std::string &imagePath,
+               const std::string &fileSystemType,
+               const std::string &mountPoint);
+    int attachLoopDevice(int imageFd, const std::string &imagePath, std::string &loopDevice);
+
+    std::mutex m_lock;
+    // Mounted images by the canonical path of the image file
+    std::map<std::string, MountedImage> m_images;
+};
+
+} // namespace softwarecontainer
@@ -22,6 +22,8 @@
 #include "softwarecontainer-common.h"
 #include "softwarecontainer-log.h"
 
+#include <vector>
+
 namespace softwarecontainer {
 
 class CleanUpHandler
@@ -34,6 +36,21 @@ public:
     }
     virtual bool clean() = 0;
     virtual const std::string queryName() = 0;
+
+    /**
+     * @brief requiredPaths Paths that must still be reachable when clean() runs.
+     *
+     * Mounts covering any of these paths are not detached ahead of this handler during
+     * teardown, see CleanupRegistry. By default this is the path returned by queryName().
+     */
+    virtual std::vector<std::string> requiredPaths()
+    {
+        std::string path = queryName();
+        if (path.empty()) {
+            return std::vector<std::string>();
+        }
+        return std::vector<std::string>{path};
+    }
 };
 
 } // namespace softwarecontainer
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "cleanupregistry.h"
+#include "mountcleanuphandler.h"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace softwarecontainer {
+
+namespace {
+
+/*
+ * True if path is below, or the same as, the directory dir
+ */
+bool isBelow(const std::string &path, const std::string &dir)
+{
+    if (dir == "/") {
+        return true;
+    }
+    return path.compare(0, dir.size(), dir) == 0
+           && (path.size() == dir.size() || path[dir.size()] == '/');
+}
+
+std::string withoutTrailingSlash(const std::string &path)
+{
+    size_t end = path.find_last_not_of('/');
+    return (end == std::string::npos) ? "/" : path.substr(0, end + 1);
+}
+
+long long millisecondsSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+void CleanupRegistry::add(CleanUpHandler *handler)
+{
+    m_handlers.emplace_back(handler);
+
+    std::string name = handler->queryName();
+    if (!name.empty()) {
+        m_names.insert(name);
+    }
+}
+
+bool CleanupRegistry::contains(const std::string &name) const
+{
+    return m_names.count(name) > 0;
+}
+
+size_t CleanupRegistry::size() const
+{
+    return m_handlers.size();
+}
+
+bool CleanupRegistry::empty() const
+{
+    return m_handlers.empty();
+}
+
+bool CleanupRegistry::clean()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<bool> done(m_handlers.size(), false);
+
+    bool success = detachMounts(done);
+    long long detachTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    unsigned int remaining = 0;
+    for (size_t i = m_handlers.size(); i-- > 0;) {
+        if (done[i]) {
+            continue;
+        }
+        remaining++;
+        if (!m_handlers[i]->clean()) {
+            success = false;
+        }
+    }
+
+    log_debug() << "Detached mounts in " << detachTime << " ms, ran " << remaining
+                << " remaining cleanup handlers in " << millisecondsSince(start) << " ms";
+
+    m_handlers.clear();
+    m_names.clear();
+    return success;
+}
+
+bool CleanupRegistry::detachMounts(std::vector<bool> &done)
+{
+    // Find the mounts that no earlier running handler depends on, newest first
+    std::vector<std::string> requiredPaths;
+    std::vector<size_t> detachable;
+    std::vector<std::string> mountPaths(m_handlers.size());
+    for (size_t i = m_handlers.size(); i-- > 0;) {
+        MountCleanUpHandler *mount = dynamic_cast<MountCleanUpHandler *>(m_handlers[i].get());
+        if (nullptr == mount) {
+            for (const std::string &path : m_handlers[i]->requiredPaths()) {
+                requiredPaths.push_back(path);
+            }
+            continue;
+        }
+
+        mountPaths[i] = withoutTrailingSlash(mount->m_path);
+        bool required = false;
+        for (const std::string &path : requiredPaths) {
+            if (isBelow(path, mountPaths[i])) {
+                required = true;
+                break;
+            }
+        }
+
+        if (!required) {
+            detachable.push_back(i);
+        }
+    }
+
+    std::unordered_map<std::string, std::vector<size_t>> detachableByPath;
+    for (size_t i : detachable) {
+        detachableByPath[mountPaths[i]].push_back(i);
+    }
+
+    // Each mount is collapsed into the newest detachable mount created before it on one of
+    // its parent directories, if any. Oldest first, so the parent is always resolved first.
+    std::vector<size_t> root(m_handlers.size());
+    for (auto it = detachable.rbegin(); it != detachable.rend(); ++it) {
+        size_t i = *it;
+        root[i] = i;
+
+        std::string dir = mountPaths[i];
+        while (dir != "/") {
+            size_t slash = dir.find_last_of('/');
+            dir = (slash == 0 || slash == std::string::npos) ? "/" : dir.substr(0, slash);
+
+            auto candidates = detachableByPath.find(dir);
+            if (candidates == detachableByPath.end()) {
+                continue;
+            }
+
+            // Newest first, so the first one created before this mount is the one it is on
+            bool found = false;
+            for (size_t candidate : candidates->second) {
+                if (candidate < i) {
+                    root[i] = root[candidate];
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                break;
+            }
+        }
+    }
+
+    bool success = true;
+    unsigned int detached = 0;
+    std::vector<bool> cleaned(m_handlers.size(), false);
+    for (size_t i : detachable) {
+        if (root[i] != i) {
+            continue;
+        }
+
+        done[i] = true;
+        detached++;
+        cleaned[i] = m_handlers[i]->clean();
+        if (!cleaned[i]) {
+            success = false;
+        }
+    }
+
+    // Collapsed mounts are gone if the mount they were on was detached, otherwise they are
+    // left to be unmounted on their own
+    unsigned int collapsed = 0;
+    for (size_t i : detachable) {
+        if (root[i] != i && cleaned[root[i]]) {
+            done[i] = true;
+            collapsed++;
+        }
+    }
+
+    log_debug() << "Detached " << detached << " mounts, " << collapsed
+                << " mounts below them were detached along with them";
+    return success;
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "cleanuphandler.h"
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The CleanupRegistry class owns the cleanup handlers of a FileToolkitWithUndo and runs
+ * them on teardown.
+ *
+ * Handlers are run in the reverse order of registration, so anything is cleaned up before
+ * whatever it was created on top of. The names of the registered handlers are kept in a hash
+ * set, so checking whether a path already has a handler does not depend on the number of
+ * handlers.
+ *
+ * Teardown is done in two phases. First all mounts that are safe to remove early are lazily
+ * detached in one pass. A mount is safe to remove early unless a handler that runs before it
+ * needs a path below it, e.g. an overlay upper directory that is synced on cleanup. A mount
+ * below another such mount that was created after it is not unmounted on its own, since
+ * detaching the mount it lives on takes it along. Then all remaining handlers are run in
+ * order.
+ */
+class CleanupRegistry
+{
+    LOG_DECLARE_CLASS_CONTEXT("CLRE", "Cleanup registry");
+
+public:
+    CleanupRegistry() {}
+    ~CleanupRegistry() {}
+
+    CleanupRegistry(const CleanupRegistry &) = delete;
+    CleanupRegistry &operator=(const CleanupRegistry &) = delete;
+
+    /**
+     * @brief add Registers a handler to be run on teardown, taking ownership of it.
+     */
+    void add(CleanUpHandler *handler);
+
+    /**
+     * @brief contains Checks if a handler with the given name, i.e. a file or directory
+     *  path, has been registered.
+     */
+    bool contains(const std::string &name) const;
+
+    /**
+     * @brief The number of registered handlers.
+     */
+    size_t size() const;
+    bool empty() const;
+
+    /**
+     * @brief clean Runs and removes all registered handlers.
+     *
+     * All handlers are run even if some of them fail.
+     *
+     * @return true if all handlers succeeded, false otherwise
+     */
+    bool clean();
+
+private:
+    bool detachMounts(std::vector<bool> &done);
+
+    std::vector<std::unique_ptr<CleanUpHandler>> m_handlers;
+    std::unordered_set<std::string> m_names;
+};
+
+} // namespace softwarecontainer
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <cleanupregistry.h>
+#include <createdir.h>
+#include <mountcleanuphandler.h>
+
+#include <gtest/gtest.h>
+#include <functional>
+
+#include <sys/mount.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * Runs a function on clean and reports the given paths as required
+ */
+class TestCleanUpHandler : public CleanUpHandler
+{
+public:
+    TestCleanUpHandler(std::function<bool ()> onClean, std::vector<std::string> paths) :
+        m_onClean(onClean),
+        m_paths(paths)
+    {
+    }
+
+    bool clean() override
+    {
+        return m_onClean();
+    }
+
+    const std::string queryName() override
+    {
+        return "";
+    }
+
+    std::vector<std::string> requiredPaths() override
+    {
+        return m_paths;
+    }
+
+private:
+    std::function<bool ()> m_onClean;
+    std::vector<std::string> m_paths;
+};
+
+class CleanupRegistryTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-CleanupRegistryTest-XXXXXX");
+    }
+
+    void mountTmpfs(const std::string &path)
+    {
+        createDir(path);
+        ASSERT_EQ(0, mount("tmpfs", path.c_str(), "tmpfs", 0, "size=1m"));
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+/*
+ * A mount created on top of another registered mount is detached along with it
+ */
+TEST_F(CleanupRegistryTest, nestedMountsAreDetached)
+{
+    std::string outer = buildPath(workdir, "outer");
+    std::string inner = buildPath(outer, "inner");
+    std::string other = buildPath(workdir, "other");
+    mountTmpfs(outer);
+    mountTmpfs(inner);
+    mountTmpfs(other);
+
+    CleanupRegistry registry;
+    registry.add(new MountCleanUpHandler(outer));
+    registry.add(new MountCleanUpHandler(inner));
+    registry.add(new MountCleanUpHandler(other));
+
+    ASSERT_TRUE(registry.clean());
+    ASSERT_FALSE(isMountPoint(outer));
+    ASSERT_FALSE(isMountPoint(inner));
+    ASSERT_FALSE(isMountPoint(other));
+}
+
+/*
+ * Mounts are detached before the other handlers run, unless a handler that runs before the
+ * mount needs a path below it
+ */
+TEST_F(CleanupRegistryTest, mountsNeededByHandlersAreKept)
+{
+    std::string needed = buildPath(workdir, "needed");
+    std::string unneeded = buildPath(workdir, "unneeded");
+    mountTmpfs(needed);
+    mountTmpfs(unneeded);
+
+    bool neededWasMounted = false;
+    bool unneededWasMounted = true;
+
+    CleanupRegistry registry;
+    registry.add(new MountCleanUpHandler(needed));
+    registry.add(new MountCleanUpHandler(unneeded));
+    registry.add(new TestCleanUpHandler([&] () {
+        neededWasMounted = isMountPoint(needed);
+        unneededWasMounted = isMountPoint(unneeded);
+        return true;
+    }, {buildPath(needed, "upper")}));
+
+    ASSERT_TRUE(registry.clean());
+    ASSERT_TRUE(neededWasMounted);
+    ASSERT_FALSE(unneededWasMounted);
+    ASSERT_FALSE(isMountPoint(needed));
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <detachedmount.h>
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+
+#include <stddef.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * The tests attach in the mount namespace of the test itself, which needs root and a kernel
+ * with the new mount API
+ */
+class DetachedMountTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-DetachedMountTest-XXXXXX");
+        source = buildPath(workdir, "source");
+        createDir(source);
+        createFile(buildPath(source, "file.txt"), "content");
+    }
+
+    void TearDown() override
+    {
+        for (const std::string &path : mounted) {
+            umount2(path.c_str(), MNT_DETACH);
+        }
+    }
+
+    CreateDir cd;
+    std::string workdir;
+    std::string source;
+    std::vector<std::string> mounted;
+};
+
+/*
+ * Missing parent directories of the target are created before attaching
+ */
+TEST_F(DetachedMountTest, attachDirectory)
+{
+    std::string target = buildPath(workdir, "a/b/target");
+    DetachedMount mount;
+    ASSERT_TRUE(mount.clone(source));
+    ASSERT_TRUE(mount.attach(getpid(), target, true));
+    mounted.push_back(target);
+
+    ASSERT_TRUE(isMountPoint(target));
+    ASSERT_TRUE(isFile(buildPath(target, "file.txt")));
+}
+
+TEST_F(DetachedMountTest, attachReadOnlyFile)
+{
+    std::string target = buildPath(workdir, "target.txt");
+    DetachedMount mount;
+    ASSERT_TRUE(mount.clone(buildPath(source, "file.txt")));
+    ASSERT_TRUE(mount.setReadOnly());
+    ASSERT_TRUE(mount.attach(getpid(), target, false));
+    mounted.push_back(target);
+
+    std::ifstream in(target);
+    std::string content;
+    in >> content;
+    ASSERT_EQ("content", content);
+
+    std::ofstream out(target);
+    ASSERT_FALSE(out.good());
+}
+
+/*
+ * Without mount_setattr, a read-only tree is remounted read-only once attached, and the rest of
+ * the mount API is still used. The kernel is made to lack mount_setattr with a seccomp filter
+ * in a child process.
+ */
+TEST_F(DetachedMountTest, attachReadOnlyWithoutMountSetattr)
+{
+    std::string target = buildPath(workdir, "target");
+    mounted.push_back(target);
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        struct sock_filter filter[] = {
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_mount_setattr, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        };
+        struct sock_fprog program = { sizeof(filter) / sizeof(filter[0]), filter };
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0
+            || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) != 0) {
+            _exit(1);
+        }
+
+        DetachedMount mount;
+        if (!mount.clone(source) || !mount.setReadOnly()) {
+            _exit(2);
+        }
+        if (!mount.attach(getpid(), target, true) || !DetachedMount::isSupported()) {
+            _exit(3);
+        }
+        _exit(0);
+    }
+
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    ASSERT_TRUE(isMountPoint(target));
+    std::ofstream out(buildPath(target, "file.txt"));
+    ASSERT_FALSE(out.good());
+}
+
+/*
+ * Trees can be attached inside trees attached earlier in the same batch
+ */
+TEST_F(DetachedMountTest, attachAllNested)
+{
+    std::string outer = buildPath(workdir, "outer");
+    std::string inner = buildPath(outer, "inner.txt");
+    DetachedMount outerMount;
+    DetachedMount innerMount;
+    ASSERT_TRUE(outerMount.clone(source));
+    ASSERT_TRUE(innerMount.clone(buildPath(source, "file.txt")));
+
+    ASSERT_TRUE(DetachedMount::attachAll(getpid(), {
+        { &outerMount, outer, true },
+        { &innerMount, inner, false }
+    }));
+    mounted.push_back(inner);
+    mounted.push_back(outer);
+
+    ASSERT_TRUE(isMountPoint(outer));
+    ASSERT_TRUE(isMountPoint(inner));
+}
+
+/*
+ * The trees attached before a failing one stay attached
+ */
+TEST_F(DetachedMountTest, attachAllStopsAtFailure)
+{
+    std::string first = buildPath(workdir, "first");
+    // Can not be created, since the parent is a file
+    std::string second = buildPath(source, "file.txt/second");
+    DetachedMount firstMount;
+    DetachedMount secondMount;
+    ASSERT_TRUE(firstMount.clone(source));
+    ASSERT_TRUE(secondMount.clone(source));
+
+    ASSERT_FALSE(DetachedMount::attachAll(getpid(), {
+        { &firstMount, first, true },
+        { &secondMount, second, true }
+    }));
+    ASSERT_EQ(ENOTDIR, errno);
+    mounted.push_back(first);
+
+    ASSERT_TRUE(isMountPoint(first));
+    ASSERT_TRUE(secondMount.attach(getpid(), buildPath(workdir, "second"), true));
+    mounted.push_back(buildPath(workdir, "second"));
+}
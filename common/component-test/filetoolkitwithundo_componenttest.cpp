@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <filetoolkitwithundo.h>
+#include <mounttable.h>
+#include <overlaysyncer.h>
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/statfs.h>
+
+#include <fcntl.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * Exposes the protected parts of the toolkit
+ */
+class TestFileToolkit : public FileToolkitWithUndo
+{
+public:
+    using FileToolkitWithUndo::overlayMount;
+    using FileToolkitWithUndo::setVolatileOverlays;
+    using FileToolkitWithUndo::m_cleanupHandlers;
+};
+
+/*
+ * Records when it is run, like the handler that releases an app image below an overlay
+ */
+class RecordingCleanUpHandler : public CleanUpHandler
+{
+public:
+    RecordingCleanUpHandler(bool &cleaned) : m_cleaned(cleaned) {}
+
+    bool clean() override
+    {
+        m_cleaned = true;
+        return true;
+    }
+
+    const std::string queryName() override
+    {
+        return "";
+    }
+
+private:
+    bool &m_cleaned;
+};
+
+/*
+ * Checks if a comma separated list of mount options has an option
+ */
+static bool hasOption(const std::string &options, const std::string &option)
+{
+    std::stringstream stream(options);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item == option) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Checks if the options of an overlay mount make it volatile, newer kernels show the volatile
+ * option as fsync=volatile
+ */
+static bool isVolatile(const std::string &superOptions)
+{
+    return hasOption(superOptions, "volatile") || hasOption(superOptions, "fsync=volatile");
+}
+
+/*
+ * Rejects the volatile overlay option like kernels before 5.10 do
+ */
+class OldKernelFileToolkit : public TestFileToolkit
+{
+protected:
+    int mountOverlayFileSystem(const std::string &dst, const std::string &options) override
+    {
+        if (hasOption(options, "volatile")) {
+            errno = EINVAL;
+            return -1;
+        }
+        return TestFileToolkit::mountOverlayFileSystem(dst, options);
+    }
+};
+
+/*
+ * Fails every overlay mount, like a kernel that rejects one of the layers
+ */
+class FailingOverlayFileToolkit : public TestFileToolkit
+{
+protected:
+    int mountOverlayFileSystem(const std::string &, const std::string &) override
+    {
+        errno = EINVAL;
+        return -1;
+    }
+};
+
+class FileToolkitWithUndoTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        // Not in /tmp, which may be a tmpfs where syncs are free anyway
+        workdir = cd.createTempDirectoryFromTemplate("/var/tmp/sc-FileToolkitTest-XXXXXX");
+        lower = buildPath(workdir, "lower");
+        upper = buildPath(workdir, "upper");
+        work = buildPath(workdir, "work");
+        merged = buildPath(workdir, "merged");
+        // Directories created by the toolkit are removed on cleanup, the lower one is kept
+        createDir(lower);
+    }
+
+    void TearDown() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_syncerBlocked = false;
+        }
+        m_changed.notify_all();
+        OverlaySyncer::getInstance().stop();
+    }
+
+    /*
+     * Starts the syncer and keeps it busy with a job of its own, until unblockSyncer() is
+     * called. Jobs queued meanwhile are not run.
+     */
+    bool startBlockedSyncer()
+    {
+        bool started = OverlaySyncer::getInstance().start(buildPath(workdir, "journal"),
+            [this] (const std::string &tag, bool success) {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_syncResults.push_back(std::make_pair(tag, success));
+                m_changed.notify_all();
+                m_changed.wait(lock, [this] () { return !m_syncerBlocked; });
+            });
+
+        std::string blockerUpper = buildPath(workdir, "blocker-upper");
+        std::string blockerLower = buildPath(workdir, "blocker-lower");
+        createDir(blockerUpper);
+        createDir(blockerLower);
+        return started
+               && OverlaySyncer::getInstance().enqueue("blocker", blockerUpper, blockerLower)
+               && waitForSyncResults(1);
+    }
+
+    void unblockSyncer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_syncerBlocked = false;
+        }
+        m_changed.notify_all();
+    }
+
+    bool waitForSyncResults(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        return m_changed.wait_for(lock, std::chrono::seconds(10), [this, count] () {
+            return m_syncResults.size() >= count;
+        });
+    }
+
+    /*
+     * Checks if the kernel supports volatile overlays, by mounting one directly
+     */
+    bool volatileOverlaysSupported()
+    {
+        std::string dir = buildPath(workdir, "probe");
+        createDir(dir);
+        for (const char *name : { "lower", "upper", "work", "merged" }) {
+            createDir(buildPath(dir, name));
+        }
+
+        std::string merged = buildPath(dir, "merged");
+        std::string options = "lowerdir=" + buildPath(dir, "lower")
+                              + ",upperdir=" + buildPath(dir, "upper")
+                              + ",workdir=" + buildPath(dir, "work") + ",volatile";
+        if (mount("overlay", merged.c_str(), "overlay", 0, options.c_str()) != 0) {
+            EXPECT_EQ(EINVAL, errno);
+            return false;
+        }
+        EXPECT_EQ(0, umount2(merged.c_str(), MNT_DETACH));
+        return true;
+    }
+
+    std::string superOptions(const std::string &mountPoint)
+    {
+        MountTable table;
+        table.refresh();
+        for (const MountTable::Entry &entry : table.entries()) {
+            if (entry.mountPoint == mountPoint) {
+                return entry.superOptions;
+            }
+        }
+        return "";
+    }
+
+    /*
+     * Writes files and syncs each of them, returns the time it took in ms
+     */
+    long long writeAndSync(const std::string &dir, int fileCount)
+    {
+        const std::string content(4096, 'x');
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < fileCount; i++) {
+            std::string path = buildPath(dir, std::to_string(i));
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            EXPECT_EQ(static_cast<ssize_t>(content.size()),
+                      write(fd, content.data(), content.size()));
+            fsync(fd);
+            close(fd);
+        }
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+    }
+
+    CreateDir cd;
+    std::string workdir;
+    std::string lower;
+    std::string upper;
+    std::string work;
+    std::string merged;
+
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    bool m_syncerBlocked = true;
+    std::vector<std::pair<std::string, bool>> m_syncResults;
+};
+
+/*
+ * Files written in the overlay end up in the lower layer on cleanup
+ */
+TEST_F(FileToolkitWithUndoTest, overlayMountSyncsOnCleanup)
+{
+    {
+        TestFileToolkit toolkit;
+        ASSERT_TRUE(toolkit.overlayMount(lower, upper, work, merged));
+        createFile(buildPath(merged, "file.txt"));
+        ASSERT_FALSE(isFile(buildPath(lower, "file.txt")));
+    }
+
+    ASSERT_FALSE(isMountPoint(merged));
+    ASSERT_TRUE(isFile(buildPath(lower, "file.txt")));
+}
+
+/*
+ * With a sync tag the sync is handed over to the OverlaySyncer when the toolkit is destroyed,
+ * and the upper directory created by the toolkit is kept until the sync is done
+ */
+TEST_F(FileToolkitWithUndoTest, overlayMountSyncsInBackground)
+{
+    ASSERT_TRUE(startBlockedSyncer());
+
+    {
+        TestFileToolkit toolkit;
+        ASSERT_TRUE(toolkit.overlayMount(lower, upper, work, merged, "SC-1"));
+        createFile(buildPath(merged, "file.txt"));
+    }
+
+    ASSERT_FALSE(isMountPoint(merged));
+    ASSERT_FALSE(existsInFileSystem(work));
+    ASSERT_TRUE(isFile(buildPath(upper, "file.txt")));
+    ASSERT_FALSE(isFile(buildPath(lower, "file.txt")));
+
+    unblockSyncer();
+    ASSERT_TRUE(waitForSyncResults(2));
+
+    ASSERT_EQ("SC-1", m_syncResults[1].first);
+    ASSERT_TRUE(m_syncResults[1].second);
+    ASSERT_TRUE(isFile(buildPath(lower, "file.txt")));
+    ASSERT_FALSE(existsInFileSystem(upper));
+}
+
+/*
+ * Volatile overlays get the volatile option if the kernel supports it, and are synced to the
+ * lower layer on cleanup like other overlays
+ */
+TEST_F(FileToolkitWithUndoTest, overlayMountVolatile)
+{
+    bool supported = volatileOverlaysSupported();
+
+    {
+        TestFileToolkit toolkit;
+        toolkit.setVolatileOverlays(true);
+        ASSERT_TRUE(toolkit.overlayMount(lower, upper, work, merged));
+        ASSERT_EQ(supported, isVolatile(superOptions(merged)));
+        createFile(buildPath(merged, "file.txt"));
+    }
+
+    ASSERT_FALSE(isMountPoint(merged));
+    ASSERT_TRUE(isFile(buildPath(lower, "file.txt")));
+}
+
+/*
+ * If the kernel rejects the volatile option, the overlay is mounted without it
+ */
+TEST_F(FileToolkitWithUndoTest, overlayMountVolatileFallback)
+{
+    {
+        OldKernelFileToolkit toolkit;
+        toolkit.setVolatileOverlays(true);
+        ASSERT_TRUE(toolkit.overlayMount(lower, upper, work, merged));
+        ASSERT_TRUE(isMountPoint(merged));
+        ASSERT_FALSE(isVolatile(superOptions(merged)));
+        createFile(buildPath(merged, "file.txt"));
+    }
+
+    ASSERT_FALSE(isMountPoint(merged));
+    ASSERT_TRUE(isFile(buildPath(lower, "file.txt")));
+}
+
+/*
+ * A failed overlay mount registers no cleanup for itself, so rolling back, as Container::create
+ * does, only runs the handlers registered before it
+ */
+TEST_F(FileToolkitWithUndoTest, overlayMountFails)
+{
+    bool released = false;
+    FailingOverlayFileToolkit toolkit;
+    toolkit.m_cleanupHandlers.add(new RecordingCleanUpHandler(released));
+
+    ASSERT_FALSE(toolkit.overlayMount(lower, upper, work, merged));
+    ASSERT_FALSE(isMountPoint(merged));
+    ASSERT_EQ(1u, toolkit.m_cleanupHandlers.size());
+
+    ASSERT_TRUE(toolkit.m_cleanupHandlers.clean());
+    ASSERT_TRUE(released);
+    ASSERT_TRUE(toolkit.m_cleanupHandlers.empty());
+}
+
+/*
+ * A tmpfs can be grown while in use without losing its contents
+ */
+TEST_F(FileToolkitWithUndoTest, tmpfsResize)
+{
+    const uint64_t size = 1024 * 1024;
+    std::string dir = buildPath(workdir, "tmpfs");
+
+    TestFileToolkit toolkit;
+    ASSERT_TRUE(toolkit.tmpfsMount(dir, size));
+    createFile(buildPath(dir, "file.txt"));
+
+    ASSERT_TRUE(toolkit.tmpfsResize(dir, 4 * size));
+
+    struct statfs stats;
+    ASSERT_EQ(0, statfs(dir.c_str(), &stats));
+    ASSERT_EQ(4 * size, static_cast<uint64_t>(stats.f_blocks) * stats.f_bsize);
+    ASSERT_TRUE(isFile(buildPath(dir, "file.txt")));
+}
+
+/*
+ * Benchmark, run with --gtest_also_run_disabled_tests --gtest_output=xml to get the timings
+ */
+TEST_F(FileToolkitWithUndoTest, DISABLED_fsyncHeavyWriteThroughput)
+{
+    const int fileCount = 2000;
+
+    for (bool volatileOverlay : { false, true }) {
+        std::string dir = buildPath(workdir, volatileOverlay ? "volatile" : "regular");
+        createDir(dir);
+        createDir(buildPath(dir, "lower"));
+
+        TestFileToolkit toolkit;
+        toolkit.setVolatileOverlays(volatileOverlay);
+        ASSERT_TRUE(toolkit.overlayMount(buildPath(dir, "lower"), buildPath(dir, "upper"),
+                                         buildPath(dir, "work"), buildPath(dir, "merged")));
+
+        long long elapsed = writeAndSync(buildPath(dir, "merged"), fileCount);
+        RecordProperty(volatileOverlay ? "volatileElapsedMs" : "regularElapsedMs",
+                       static_cast<int>(elapsed));
+    }
+}
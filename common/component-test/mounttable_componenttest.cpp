@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <mounttable.h>
+
+#include <gtest/gtest.h>
+
+#include <sys/mount.h>
+
+using namespace softwarecontainer;
+
+class MountTableTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-MountTableTest-XXXXXX");
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+/*
+ * The snapshot follows mounts done after it was first read
+ */
+TEST_F(MountTableTest, refreshSeesNewMounts)
+{
+    MountTable table;
+    ASSERT_TRUE(table.refresh());
+    ASSERT_FALSE(table.isMountPoint(workdir));
+
+    ASSERT_EQ(0, mount("tmpfs", workdir.c_str(), "tmpfs", 0, "size=1m"));
+    ASSERT_TRUE(table.refresh());
+    ASSERT_TRUE(table.isMountPoint(workdir));
+
+    ASSERT_EQ(0, umount(workdir.c_str()));
+    ASSERT_TRUE(table.refresh());
+    ASSERT_FALSE(table.isMountPoint(workdir));
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <overlaysyncer.h>
+#include <recursivedelete.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <sys/mount.h>
+#include <unistd.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class OverlaySyncerTest: public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        journalDir = buildPath(cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX"),
+                               "journal");
+        upper = cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX");
+        lower = cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX");
+    }
+
+    void TearDown() override
+    {
+        OverlaySyncer::getInstance().stop();
+        rmdir(journalDir.c_str());
+    }
+
+    bool start()
+    {
+        return OverlaySyncer::getInstance().start(journalDir,
+            [this] (const std::string &tag, bool success) {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_results.push_back(std::make_pair(tag, success));
+                m_done.notify_all();
+            });
+    }
+
+    // Waits for count syncs to be reported
+    bool waitForResults(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        return m_done.wait_for(lock, std::chrono::seconds(10), [this, count] () {
+            return m_results.size() >= count;
+        });
+    }
+
+    /*
+     * Sets up a staging directory the way a stopped syncer leaves it behind
+     */
+    std::string createStagingDir(const std::string &tag, const std::string &removeAfterSync = "",
+                                 bool mounted = true)
+    {
+        std::string stagingDir = buildPath(journalDir, tag + "-resume");
+        mkdir(journalDir.c_str(), S_IRWXU);
+        createDir(stagingDir);
+        createDir(buildPath(stagingDir, "upper"));
+        createDir(buildPath(stagingDir, "lower"));
+        if (mounted) {
+            mount(upper.c_str(), buildPath(stagingDir, "upper").c_str(), "", MS_BIND, nullptr);
+            mount(lower.c_str(), buildPath(stagingDir, "lower").c_str(), "", MS_BIND, nullptr);
+        }
+        std::string journal = "tag=" + tag + "\nupper=" + upper + "\nlower=" + lower + "\n";
+        if (!removeAfterSync.empty()) {
+            journal += "remove=" + removeAfterSync + "\n";
+        }
+        createFile(buildPath(stagingDir, "journal"), journal);
+        return stagingDir;
+    }
+
+    CreateDir cd;
+    std::string journalDir;
+    std::string upper;
+    std::string lower;
+
+    std::mutex m_lock;
+    std::condition_variable m_done;
+    std::vector<std::pair<std::string, bool>> m_results;
+};
+
+/*
+ * A queued job is synced in the background and its staging directory removed afterwards
+ */
+TEST_F(OverlaySyncerTest, syncInBackground)
+{
+    createFile(buildPath(upper, "lala.txt"), "synced");
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(OverlaySyncer::getInstance().enqueue("SC-1", upper, lower));
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_EQ(m_results[0].first, "SC-1");
+    ASSERT_TRUE(m_results[0].second);
+    ASSERT_TRUE(checkContent(buildPath(lower, "lala.txt"), "synced"));
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+}
+
+/*
+ * A journaled job left by a previous run is resumed on start
+ */
+TEST_F(OverlaySyncerTest, resumeJournaledSync)
+{
+    createFile(buildPath(upper, "lala.txt"), "resumed");
+    createStagingDir("SC-2");
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_EQ(m_results[0].first, "SC-2");
+    ASSERT_TRUE(m_results[0].second);
+    ASSERT_TRUE(checkContent(buildPath(lower, "lala.txt"), "resumed"));
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+}
+
+/*
+ * A journaled job whose staging mounts are gone, like after a reboot, is staged again from
+ * the paths in the journal and resumed
+ */
+TEST_F(OverlaySyncerTest, resumeAfterReboot)
+{
+    createFile(buildPath(upper, "lala.txt"), "rebooted");
+    std::string stagingDir = createStagingDir("SC-7", upper, false);
+    ASSERT_FALSE(isMountPoint(buildPath(stagingDir, "upper")));
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_EQ(m_results[0].first, "SC-7");
+    ASSERT_TRUE(m_results[0].second);
+    ASSERT_TRUE(checkContent(buildPath(lower, "lala.txt"), "rebooted"));
+    ASSERT_FALSE(existsInFileSystem(upper));
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+}
+
+/*
+ * Directories handed over with a job are removed once they have been synced
+ */
+TEST_F(OverlaySyncerTest, removeAfterSync)
+{
+    createFile(buildPath(upper, "lala.txt"), "synced");
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(OverlaySyncer::getInstance().enqueue("SC-5", upper, lower, { upper }));
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_TRUE(m_results[0].second);
+    ASSERT_TRUE(checkContent(buildPath(lower, "lala.txt"), "synced"));
+    ASSERT_FALSE(existsInFileSystem(upper));
+    ASSERT_TRUE(isDirectory(lower));
+}
+
+/*
+ * A path that no longer refers to the staged directory, e.g. since a new container with the
+ * same name was created before a resumed job is done, is left alone
+ */
+TEST_F(OverlaySyncerTest, removeAfterSyncSkipsReusedPath)
+{
+    createFile(buildPath(upper, "lala.txt"), "resumed");
+    createStagingDir("SC-6", upper);
+
+    std::string reused = upper + "-old";
+    ASSERT_EQ(0, rename(upper.c_str(), reused.c_str()));
+    createDir(upper);
+    createFile(buildPath(upper, "new.txt"));
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_TRUE(m_results[0].second);
+    ASSERT_TRUE(checkContent(buildPath(lower, "lala.txt"), "resumed"));
+    ASSERT_TRUE(isFile(buildPath(upper, "new.txt")));
+    ASSERT_TRUE(isFile(buildPath(reused, "lala.txt")));
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(reused));
+}
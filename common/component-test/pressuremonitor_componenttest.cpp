@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <pressuremonitor.h>
+
+#include <gtest/gtest.h>
+
+using namespace softwarecontainer;
+
+class PressureMonitorTest : public ::testing::Test
+{
+public:
+    PressureMonitor::PressureCallback ignorePressure = [] (int, const std::string &, double) {};
+    PressureMonitor::MemoryEventCallback ignoreEvents = [] (int, const std::string &, uint64_t) {};
+};
+
+/*
+ * Triggers can be registered on the pressure files of the host, this needs a kernel with
+ * PSI enabled
+ */
+TEST_F(PressureMonitorTest, watchHost)
+{
+    PressureMonitor monitor(Glib::MainContext::get_default(), 100000, 1000000,
+                            ignorePressure, ignoreEvents);
+
+    ASSERT_TRUE(monitor.watchHost());
+    ASSERT_GT(monitor.watchedCount(), 0u);
+    monitor.unwatch(PressureMonitor::HOST_ID);
+    ASSERT_EQ(0u, monitor.watchedCount());
+}
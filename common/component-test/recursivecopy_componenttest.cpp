@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <recursivecopy.h>
+
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * Overlay upper dirs contain whiteouts and trusted xattrs, creating them needs CAP_MKNOD and
+ * CAP_SYS_ADMIN
+ */
+class RecursiveCopyTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        srcdir = cd.createTempDirectoryFromTemplate("/tmp/sc-recursivecopyTest-XXXXXX");
+        dstdir = cd.createTempDirectoryFromTemplate("/tmp/sc-recursivecopyTest-XXXXXX");
+    }
+
+    CreateDir cd;
+    std::string srcdir;
+    std::string dstdir;
+};
+
+/*
+ * A whiteout in an overlay upper dir means the entry was deleted in the container
+ */
+TEST_F(RecursiveCopyTest, copyWhiteoutRemovesDestination)
+{
+    std::string srcWhiteout = buildPath(srcdir, "deleted");
+    ASSERT_EQ(0, mknod(srcWhiteout.c_str(), S_IFCHR | 0000, makedev(0, 0)));
+
+    std::string dstSub = buildPath(dstdir, "deleted");
+    createDir(dstSub);
+    createFile(buildPath(dstSub, "lala.txt"));
+
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+
+    ASSERT_FALSE(existsInFileSystem(dstSub));
+    ASSERT_TRUE(isDirectoryEmpty(dstdir));
+}
+
+/*
+ * An opaque dir in an overlay upper dir hides everything in the corresponding lower dir
+ */
+TEST_F(RecursiveCopyTest, copyOpaqueDirectoryReplacesContent)
+{
+    std::string srcSub = buildPath(srcdir, "opaque");
+    createDir(srcSub);
+    createFile(buildPath(srcSub, "new.txt"));
+    ASSERT_EQ(0, setxattr(srcSub.c_str(), "trusted.overlay.opaque", "y", 1, 0));
+
+    std::string dstSub = buildPath(dstdir, "opaque");
+    createDir(dstSub);
+    createFile(buildPath(dstSub, "old.txt"));
+
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+
+    ASSERT_TRUE(isFile(buildPath(dstSub, "new.txt")));
+    ASSERT_FALSE(isFile(buildPath(dstSub, "old.txt")));
+
+    // The overlay private attribute must not leak to the destination
+    char value;
+    ASSERT_LT(getxattr(dstSub.c_str(), "trusted.overlay.opaque", &value, sizeof(value)), 0);
+}
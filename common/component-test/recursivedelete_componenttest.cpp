@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <recursivedelete.h>
+
+#include <gtest/gtest.h>
+
+#include <sys/mount.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class RecursiveDeleteTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-RecursiveDeleteTest-XXXXXX");
+        testdir = buildPath(workdir, "testdir");
+        createDir(testdir);
+    }
+
+    CreateDir cd;
+    std::string testdir;
+    std::string workdir;
+};
+
+/*
+ * A mount point below the deleted directory, and whatever is mounted there, is left alone
+ */
+TEST_F(RecursiveDeleteTest, deleteDoesNotCrossMountPoints)
+{
+    std::string mounted = buildPath(workdir, "mounted");
+    createDir(mounted);
+    createFile(buildPath(mounted, "keep.txt"));
+    std::string mountPoint = buildPath(testdir, "subdir", "mountpoint");
+    createDir(buildPath(testdir, "subdir"));
+    createDir(mountPoint);
+    createFile(buildPath(testdir, "subfile"));
+    ASSERT_EQ(0, mount(mounted.c_str(), mountPoint.c_str(), "", MS_BIND, nullptr));
+
+    ASSERT_FALSE(RecursiveDelete::getInstance().del(testdir));
+    ASSERT_TRUE(isFile(buildPath(mountPoint, "keep.txt")));
+    ASSERT_FALSE(existsInFileSystem(buildPath(testdir, "subfile")));
+
+    ASSERT_EQ(0, umount(mountPoint.c_str()));
+    ASSERT_TRUE(isFile(buildPath(mounted, "keep.txt")));
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(testdir));
+}
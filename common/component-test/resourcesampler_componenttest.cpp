@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <resourcesampler.h>
+#include <unifiedcgroup.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+/*
+ * The tests sample real cgroups, which needs root and a cgroup v2 hierarchy mounted on
+ * UnifiedCgroup::CGROUP_ROOT
+ */
+class ResourceSamplerTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        ASSERT_TRUE(UnifiedCgroup::isAvailable());
+        parent = buildPath(UnifiedCgroup::CGROUP_ROOT,
+                           "sc-ResourceSamplerTest-" + std::to_string(getpid()));
+        ASSERT_EQ(0, mkdir(parent.c_str(), 0755));
+
+        // Enable what the sampler reads where the host allows it, cpu.stat is always there
+        for (const std::string controller : { "+memory", "+io", "+cpu" }) {
+            std::ofstream control(buildPath(parent, "cgroup.subtree_control"));
+            control << controller;
+        }
+    }
+
+    void TearDown() override
+    {
+        for (auto it = cgroups.rbegin(); it != cgroups.rend(); ++it) {
+            rmdir(it->c_str());
+        }
+        rmdir(parent.c_str());
+    }
+
+    std::string createCgroup(const std::string &name)
+    {
+        std::string path = buildPath(parent, name);
+        if (mkdir(path.c_str(), 0755) == 0) {
+            cgroups.push_back(path);
+        }
+        return path;
+    }
+
+    std::string parent;
+    std::vector<std::string> cgroups;
+};
+
+/*
+ * Sampling 50 cgroups must cost less than ResourceSampler::MAX_LOAD of one CPU at the default
+ * interval of one second
+ */
+TEST_F(ResourceSamplerTest, overhead)
+{
+    ResourceSampler sampler(60);
+    for (int i = 0; i < 50; i++) {
+        ASSERT_TRUE(sampler.add(i, createCgroup(std::to_string(i))));
+    }
+
+    const int rounds = 20;
+    struct timespec before, after;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &before);
+    for (int i = 0; i < rounds; i++) {
+        sampler.sample();
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &after);
+
+    ResourceSample sample;
+    ASSERT_TRUE(sampler.latest(49, sample));
+
+    double seconds = (after.tv_sec - before.tv_sec) + (after.tv_nsec - before.tv_nsec) / 1e9;
+    RecordProperty("sampleRoundUs", static_cast<int>(seconds / rounds * 1e6));
+    ASSERT_LT(seconds / rounds, ResourceSampler::MAX_LOAD * 1.0);
+}
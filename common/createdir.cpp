@@ -102,4 +102,15 @@ bool CreateDir::pathInList(const std::string path)
     return false;
 }
 
+bool CreateDir::release(const std::string path)
+{
+    for (auto it = m_rollbackCleaners.begin(); it != m_rollbackCleaners.end(); ++it) {
+        if (it->queryName() == path) {
+            m_rollbackCleaners.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
 }
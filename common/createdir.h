@@ -59,6 +59,23 @@ public:
      */
     std::string createTempDirectoryFromTemplate(std::string templatePath);
 
+    /**
+     * @brief checks whether path is already added to m_rollbackCleaners or not
+     *
+     * @param a string path name to check
+     * @return true if the path is already exist, false otherwise
+     */
+    bool pathInList(const std::string path);
+
+    /**
+     * @brief release hands over the responsibility of removing a directory created by this
+     * object, it is no longer removed when the object is destroyed.
+     *
+     * @param path Path of a directory created by this object
+     * @return true if the directory was created by this object, false otherwise
+     */
+    bool release(const std::string path);
+
 private :
     /**
      * @brief createParentDirectory Recursively tries to create the directory pointed to by path.
@@ -73,14 +90,6 @@ private :
      * The main purpose of this is to rollback in any errors or when the object is
      */
     std::vector<DirectoryCleanUpHandler> m_rollbackCleaners;
-
-    /**
-     * @brief checks whether path is already added to m_rollbackCleaners or not
-     *
-     * @param a string path name to check
-     * @return true if the path is already exist, false otherwise
-     */
-    bool pathInList(const std::string path);
 };
 
 }
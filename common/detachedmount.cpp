@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "detachedmount.h"
+
+#include <atomic>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Not all C libraries define these yet, the values are from linux/mount.h and linux/fcntl.h
+#ifndef OPEN_TREE_CLONE
+#define OPEN_TREE_CLONE 1
+#endif
+#ifndef OPEN_TREE_CLOEXEC
+#define OPEN_TREE_CLOEXEC O_CLOEXEC
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+#define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef MOUNT_ATTR_RDONLY
+#define MOUNT_ATTR_RDONLY 0x00000001
+#endif
+#ifndef AT_RECURSIVE
+#define AT_RECURSIVE 0x8000
+#endif
+
+#if defined(__NR_open_tree) && defined(__NR_move_mount) && defined(__NR_mount_setattr)
+#define HAVE_MOUNT_API 1
+#endif
+
+namespace softwarecontainer {
+
+namespace {
+
+// Support is tracked per feature, since the kernel may have open_tree and move_mount but not
+// mount_setattr, which came in Linux 5.12
+std::atomic<bool> s_attachUnsupported(false);
+std::atomic<bool> s_setAttributesUnsupported(false);
+
+// Same layout as struct mount_attr from linux/mount.h
+struct MountAttributes
+{
+    uint64_t attrSet;
+    uint64_t attrClear;
+    uint64_t propagation;
+    uint64_t userNamespaceFd;
+};
+
+} // namespace
+
+DetachedMount::DetachedMount()
+{
+}
+
+DetachedMount::~DetachedMount()
+{
+    if (m_fd != INVALID_FD) {
+        ::close(m_fd);
+    }
+}
+
+bool DetachedMount::isSupported()
+{
+#ifdef HAVE_MOUNT_API
+    return !s_attachUnsupported;
+#else
+    return false;
+#endif
+}
+
+bool DetachedMount::checkSupport(const char *call, std::atomic<bool> &unsupported)
+{
+    if (errno == ENOSYS) {
+        log_info() << call << " is not supported by the kernel";
+        unsupported = true;
+    }
+    return false;
+}
+
+bool DetachedMount::clone(const std::string &path)
+{
+#ifdef HAVE_MOUNT_API
+    int fd = ::syscall(__NR_open_tree, AT_FDCWD, path.c_str(),
+                       OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC);
+    if (fd < 0) {
+        int error = errno;
+        log_error() << "Could not clone the mount tree at " << path << ": " << strerror(error);
+        errno = error;
+        return checkSupport("open_tree", s_attachUnsupported);
+    }
+
+    if (m_fd != INVALID_FD) {
+        ::close(m_fd);
+    }
+    m_fd = fd;
+    return true;
+#else
+    (void)path;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+bool DetachedMount::setReadOnly()
+{
+#ifdef HAVE_MOUNT_API
+    if (!s_setAttributesUnsupported) {
+        MountAttributes attributes = { MOUNT_ATTR_RDONLY, 0, 0, 0 };
+        if (::syscall(__NR_mount_setattr, m_fd, "", AT_EMPTY_PATH | AT_RECURSIVE,
+                      &attributes, sizeof(attributes)) == 0) {
+            return true;
+        }
+
+        int error = errno;
+        if (error != ENOSYS) {
+            log_error() << "Could not make the cloned mount tree read-only: " << strerror(error);
+            errno = error;
+            return false;
+        }
+        checkSupport("mount_setattr", s_setAttributesUnsupported);
+    }
+
+    // A detached tree can not be remounted, so it is remounted read-only once attached
+    m_remountReadOnly = true;
+    return true;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+bool DetachedMount::attach(pid_t pid, const std::string &target, bool targetIsDirectory)
+{
+    return attachAll(pid, { { this, target, targetIsDirectory } });
+}
+
+bool DetachedMount::attachAll(pid_t pid, const std::vector<Attachment> &attachments)
+{
+#ifdef HAVE_MOUNT_API
+    if (attachments.empty()) {
+        return true;
+    }
+
+    for (const Attachment &attachment : attachments) {
+        if (attachment.mount->m_fd == INVALID_FD || attachment.target.empty()
+            || attachment.target.front() != '/') {
+            errno = EINVAL;
+            return false;
+        }
+    }
+
+    std::string namespacePath = logging::StringBuilder() << "/proc/" << pid << "/ns/mnt";
+    int namespaceFd = ::open(namespacePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (namespaceFd < 0) {
+        int error = errno;
+        log_error() << "Could not open " << namespacePath << ": " << strerror(error);
+        errno = error;
+        return false;
+    }
+
+    // The child reports how many trees it attached through this pipe
+    int progress[2];
+    if (::pipe2(progress, O_CLOEXEC) != 0) {
+        int error = errno;
+        log_error() << "Could not create a pipe: " << strerror(error);
+        ::close(namespaceFd);
+        errno = error;
+        return false;
+    }
+
+    // Everything the child needs is prepared here, since a child of a multithreaded process
+    // may not allocate memory
+    std::vector<std::vector<std::string>> parents(attachments.size());
+    for (size_t i = 0; i < attachments.size(); i++) {
+        const std::string &target = attachments[i].target;
+        for (size_t slash = target.find('/', 1); slash != std::string::npos;
+             slash = target.find('/', slash + 1)) {
+            parents[i].push_back(target.substr(0, slash));
+        }
+    }
+    const mode_t directoryMode = S_IRWXU | S_IRWXG | S_IRWXO;
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        size_t attached = 0;
+        auto finish = [&progress, &attached] (int error) {
+            ssize_t written = ::write(progress[1], &attached, sizeof(attached));
+            (void)written;
+            ::_exit(error);
+        };
+
+        // Joining the namespace also moves the root and working directory to its root
+        if (::setns(namespaceFd, CLONE_NEWNS) != 0) {
+            finish(errno);
+        }
+
+        for (const Attachment &attachment : attachments) {
+            for (const std::string &parent : parents[attached]) {
+                if (::mkdir(parent.c_str(), directoryMode) != 0 && errno != EEXIST) {
+                    finish(errno);
+                }
+            }
+
+            const char *targetPath = attachment.target.c_str();
+            if (attachment.targetIsDirectory) {
+                if (::mkdir(targetPath, directoryMode) != 0 && errno != EEXIST) {
+                    finish(errno);
+                }
+            } else {
+                int fd = ::open(targetPath, O_WRONLY | O_CREAT | O_CLOEXEC | O_NOCTTY, 0644);
+                if (fd < 0) {
+                    finish(errno);
+                }
+                ::close(fd);
+            }
+
+            if (::syscall(__NR_move_mount, attachment.mount->m_fd, "", AT_FDCWD, targetPath,
+                          MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+                finish(errno);
+            }
+
+            if (attachment.mount->m_remountReadOnly
+                && ::mount(nullptr, targetPath, nullptr, MS_REMOUNT | MS_BIND | MS_RDONLY,
+                           nullptr) != 0) {
+                // Never leave a tree that should be read-only attached as writable
+                int error = errno;
+                ::umount2(targetPath, MNT_DETACH);
+                finish(error);
+            }
+            attached++;
+        }
+        finish(0);
+    }
+
+    int error = (child < 0) ? errno : 0;
+    ::close(namespaceFd);
+    ::close(progress[1]);
+    if (child < 0) {
+        ::close(progress[0]);
+        log_error() << "Could not fork to attach the mounts: " << strerror(error);
+        errno = error;
+        return false;
+    }
+
+    size_t attached = 0;
+    if (::read(progress[0], &attached, sizeof(attached)) != sizeof(attached)) {
+        attached = 0;
+    }
+    ::close(progress[0]);
+
+    int status = 0;
+    while (::waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) {
+            error = errno;
+            log_error() << "Could not wait for the attaching process: " << strerror(error);
+            errno = error;
+            return false;
+        }
+    }
+
+    // The attached trees are now owned by the namespace they are attached to
+    for (size_t i = 0; i < attached && i < attachments.size(); i++) {
+        ::close(attachments[i].mount->m_fd);
+        attachments[i].mount->m_fd = INVALID_FD;
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        error = WIFEXITED(status) ? WEXITSTATUS(status) : ECHILD;
+        std::string target = attached < attachments.size() ? attachments[attached].target : "";
+        log_error() << "Could not attach the mount at " << target << " in the namespace of "
+                    << pid << ": " << strerror(error);
+        errno = error;
+        return checkSupport("move_mount", s_attachUnsupported);
+    }
+
+    return true;
+#else
+    (void)pid;
+    (void)attachments;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+} // namespace softwarecontainer
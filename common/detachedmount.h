@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <atomic>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The DetachedMount class injects bind mounts into another mount namespace using the
+ * mount API of Linux 5.2 and later.
+ *
+ * A copy of a directory tree is taken on the host with open_tree(2), without attaching it
+ * anywhere. It can then be made read-only with mount_setattr(2), and finally attached with
+ * move_mount(2) from a short lived child process that has joined the mount namespace of the
+ * target process. This avoids staging the mount in a directory shared with the target.
+ *
+ * When the kernel does not support open_tree(2) or move_mount(2), the methods fail with errno
+ * set to ENOSYS, and isSupported() returns false from then on, so users can fall back to other
+ * ways of mounting. Without mount_setattr(2), read-only trees are instead remounted read-only
+ * with mount(2) right after being attached.
+ */
+class DetachedMount
+{
+    LOG_DECLARE_CLASS_CONTEXT("DEMO", "Detached mount");
+
+public:
+    /**
+     * @brief A cloned tree and where to attach it, see attachAll()
+     */
+    struct Attachment
+    {
+        DetachedMount *mount;
+        std::string target;
+        bool targetIsDirectory;
+    };
+
+    DetachedMount();
+    ~DetachedMount();
+
+    DetachedMount(const DetachedMount &) = delete;
+    DetachedMount &operator=(const DetachedMount &) = delete;
+
+    /**
+     * @brief isSupported Checks if the kernel has been found to lack support for the mount API
+     *
+     * @return false if open_tree or move_mount has failed with ENOSYS, true otherwise
+     */
+    static bool isSupported();
+
+    /**
+     * @brief clone Takes a detached copy of the mount at path, like a bind mount of it. Mounts
+     *  below path are not included.
+     * @return true on success, false on failure
+     */
+    bool clone(const std::string &path);
+
+    /**
+     * @brief setReadOnly Makes the cloned tree read-only
+     *
+     * If the kernel lacks mount_setattr, the tree is remounted read-only when it is attached
+     * instead.
+     *
+     * @return true on success, false on failure
+     */
+    bool setReadOnly();
+
+    /**
+     * @brief attach Attaches the cloned tree in the mount namespace of another process
+     *
+     * The target and any missing parent directories are created inside the namespace, with
+     * paths resolved relative to the root of the namespace.
+     *
+     * @param pid A process in the mount namespace to attach to
+     * @param target Where to attach the tree, as seen from within the namespace
+     * @param targetIsDirectory Whether to create the target as a directory or a file
+     * @return true on success, false on failure with errno set
+     */
+    bool attach(pid_t pid, const std::string &target, bool targetIsDirectory);
+
+    /**
+     * @brief attachAll Attaches several cloned trees in the mount namespace of another process,
+     *  in order, from a single child process
+     *
+     * Works like calling attach() for each of them, so a tree can be attached inside one
+     * attached earlier in the list. Stops at the first failure, the trees attached before it
+     * stay attached.
+     *
+     * @param pid A process in the mount namespace to attach to
+     * @param attachments The trees to attach
+     * @return true on success, false on failure with errno set
+     */
+    static bool attachAll(pid_t pid, const std::vector<Attachment> &attachments);
+
+private:
+    static bool checkSupport(const char *call, std::atomic<bool> &unsupported);
+
+    int m_fd = INVALID_FD;
+    bool m_remountReadOnly = false;
+};
+
+} // namespace softwarecontainer
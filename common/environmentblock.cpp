@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "environmentblock.h"
+
+namespace softwarecontainer {
+
+EnvironmentBlock::EnvironmentBlock()
+{
+    m_envp.push_back(nullptr);
+}
+
+bool EnvironmentBlock::set(const std::string &name, const std::string &value)
+{
+    auto it = m_variables.find(name);
+    if (it != m_variables.end() && it->second == value) {
+        return false;
+    }
+
+    m_variables[name] = value;
+    m_version++;
+    return true;
+}
+
+const EnvironmentVariables &EnvironmentBlock::variables() const
+{
+    return m_variables;
+}
+
+uint64_t EnvironmentBlock::version() const
+{
+    return m_version;
+}
+
+void EnvironmentBlock::rebuild()
+{
+    m_strings.clear();
+    m_strings.reserve(m_variables.size());
+    for (auto &var : m_variables) {
+        m_strings.push_back(var.first + "=" + var.second);
+    }
+
+    // Only take pointers once all strings are in place, m_strings never reallocates after this
+    m_envp.clear();
+    m_envp.reserve(m_strings.size() + 1);
+    for (auto &string : m_strings) {
+        m_envp.push_back(&string[0]);
+    }
+    m_envp.push_back(nullptr);
+
+    m_builtVersion = m_version;
+    log_debug() << "Rebuilt environment block version " << m_version
+                << " with " << m_strings.size() << " variables";
+}
+
+char **EnvironmentBlock::envp()
+{
+    if (m_builtVersion != m_version) {
+        rebuild();
+    }
+    return m_envp.data();
+}
+
+char **EnvironmentBlock::envp(const EnvironmentVariables &overrides,
+                              std::vector<std::string> &storage,
+                              std::vector<char *> &envp)
+{
+    if (overrides.empty()) {
+        return this->envp();
+    }
+
+    if (m_builtVersion != m_version) {
+        rebuild();
+    }
+
+    envp.clear();
+    envp.reserve(m_strings.size() + overrides.size() + 1);
+
+    // Both maps are sorted on name, so walk them side by side to find overridden variables
+    auto override = overrides.begin();
+    size_t i = 0;
+    for (auto &var : m_variables) {
+        while (override != overrides.end() && override->first < var.first) {
+            override++;
+        }
+
+        if (override != overrides.end() && override->first == var.first) {
+            if (override->second != var.second) {
+                // Inform user that the value in the block is overridden, it might be unintentional
+                log_info() << "Variable \"" << var.first
+                           << "\" set by gateway will be overwritten with the value: \""
+                           << override->second << "\"";
+            }
+        } else {
+            envp.push_back(m_envp[i]);
+        }
+        i++;
+    }
+
+    // Reserve up front so the pointers into storage stay valid
+    storage.clear();
+    storage.reserve(overrides.size());
+    for (auto &var : overrides) {
+        storage.push_back(var.first + "=" + var.second);
+        envp.push_back(&storage.back()[0]);
+    }
+    envp.push_back(nullptr);
+
+    return envp.data();
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The EnvironmentBlock class keeps a set of environment variables together with a
+ * prebuilt, null terminated "NAME=value" array that can be passed as envp when launching
+ * processes.
+ *
+ * The array is only rebuilt when a variable has changed since it was last built. Each change
+ * bumps the version of the block, which can be used to tell whether a previously built array
+ * is still current.
+ */
+class EnvironmentBlock
+{
+    LOG_DECLARE_CLASS_CONTEXT("ENVB", "Environment block");
+
+public:
+    EnvironmentBlock();
+
+    EnvironmentBlock(const EnvironmentBlock &) = delete;
+    EnvironmentBlock &operator=(const EnvironmentBlock &) = delete;
+
+    /**
+     * @brief Sets a variable, the array is rebuilt the next time it is requested
+     *
+     * @return true if the value of the variable changed, false if it was already set to value
+     */
+    bool set(const std::string &name, const std::string &value);
+
+    /**
+     * @brief All variables in the block
+     */
+    const EnvironmentVariables &variables() const;
+
+    /**
+     * @brief The version of the block, incremented every time a variable changes
+     */
+    uint64_t version() const;
+
+    /**
+     * @brief Returns the null terminated envp array for the variables in the block
+     *
+     * The array is owned by the block and valid until the next call to set().
+     */
+    char **envp();
+
+    /**
+     * @brief Returns an envp array with overrides layered on top of the block
+     *
+     * Entries for variables that are not overridden point into the prebuilt array of the block,
+     * so the base variables are not copied. When overrides is empty the prebuilt array itself
+     * is returned.
+     *
+     * @param overrides Variables that take precedence over the ones in the block
+     * @param storage Receives the "NAME=value" strings for the overrides
+     * @param envp Receives the entries of the resulting array
+     *
+     * @return The null terminated array, valid as long as storage and envp are left untouched
+     *         and set() is not called.
+     */
+    char **envp(const EnvironmentVariables &overrides,
+                std::vector<std::string> &storage,
+                std::vector<char *> &envp);
+
+private:
+    void rebuild();
+
+    EnvironmentVariables m_variables;
+
+    // "NAME=value" strings in the same order as m_variables, and pointers to them
+    std::vector<std::string> m_strings;
+    std::vector<char *> m_envp;
+
+    uint64_t m_version = 0;
+    uint64_t m_builtVersion = 0;
+};
+
+} // namespace softwarecontainer
@@ -33,19 +33,8 @@ namespace softwarecontainer {
 
 FileToolkitWithUndo::~FileToolkitWithUndo()
 {
-    bool success = true;
     // Clean up all created directories, files, and mount points
-
-    while (!m_cleanupHandlers.empty()) {
-        std::unique_ptr<CleanUpHandler> c = std::move(m_cleanupHandlers.back());
-        m_cleanupHandlers.pop_back();
-
-        if (!c->clean()) {
-            success = false;
-        }
-    }
-
-    if(!success) {
+    if (!m_cleanupHandlers.clean()) {
         log_warning() << "One or more cleanup handlers returned error status, please check the log";
     }
 }
@@ -92,7 +81,7 @@ bool FileToolkitWithUndo::bindMount(const std::string &src,
 
         log_debug() << "writeBufferEnabled, config: " << os.str();
 
-        mountRes = mount("overlay", dst.c_str(), fstype.c_str(), flags, os.str().c_str());
+        mountRes = mountOverlay(dst, os.str());
         log_debug() << "mountRes: " << mountRes;
     } else {
         const void *data = nullptr;
@@ -130,10 +119,10 @@ bool FileToolkitWithUndo::bindMount(const std::string &src,
 bool FileToolkitWithUndo::overlayMount(const std::string &lower,
                                        const std::string &upper,
                                        const std::string &work,
-                                       const std::string &dst)
+                                       const std::string &dst,
+                                       const std::string &asyncSyncTag,
+                                       const std::vector<std::string> &readOnlyLayers)
 {
-    std::string fstype = "overlay";
-    unsigned long flags = 0;
     std::unique_ptr<CreateDir> createDirInstance = std::unique_ptr<CreateDir>(new CreateDir());
 
     if (!createDirInstance->createDirectory(lower)
@@ -146,16 +135,23 @@ bool FileToolkitWithUndo::overlayMount(const std::string &lower,
         return false;
     }
 
-    std::string mountoptions = logging::StringBuilder() << "lowerdir=" << lower
+    std::string lowerLayers = lower;
+    for (const std::string &layer : readOnlyLayers) {
+        lowerLayers += ":" + layer;
+    }
+
+    std::string mountoptions = logging::StringBuilder() << "lowerdir=" << lowerLayers
                                                         << ",upperdir=" << upper
                                                         << ",workdir=" << work;
 
-    int mountRes = mount("overlay", dst.c_str(), fstype.c_str(), flags, mountoptions.c_str());
+    int mountRes = mountOverlay(dst, mountoptions);
 
     if (mountRes == 0) {
         log_verbose() << "overlayMounted folder " << lower << " in " << dst;
-        m_cleanupHandlers.emplace_back(new MountCleanUpHandler(dst));
-        m_cleanupHandlers.emplace_back(new OverlaySyncCleanupHandler(upper, lower));
+        m_cleanupHandlers.add(new MountCleanUpHandler(dst));
+        m_cleanupHandlers.add(new OverlaySyncCleanupHandler(upper, lower, asyncSyncTag,
+                                                            m_volatileOverlays,
+                                                            createDirInstance.get()));
     } else {
         log_error() << "Could not mount into container: upper=" << upper
                     << ",lower=" << lower
@@ -168,6 +164,34 @@ bool FileToolkitWithUndo::overlayMount(const std::string &lower,
     return true;
 }
 
+int FileToolkitWithUndo::mountOverlay(const std::string &dst, const std::string &options)
+{
+    if (m_volatileOverlays) {
+        if (mountOverlayFileSystem(dst, options + ",volatile") == 0) {
+            return 0;
+        }
+
+        // Kernels before 5.10 do not know the option and reject it
+        if (errno != EINVAL) {
+            return -1;
+        }
+        log_warning() << "Overlayfs does not support the volatile option, mounting " << dst
+                      << " without it";
+    }
+
+    return mountOverlayFileSystem(dst, options);
+}
+
+int FileToolkitWithUndo::mountOverlayFileSystem(const std::string &dst, const std::string &options)
+{
+    return mount("overlay", dst.c_str(), "overlay", 0, options.c_str());
+}
+
+void FileToolkitWithUndo::setVolatileOverlays(bool enabled)
+{
+    m_volatileOverlays = enabled;
+}
+
 bool FileToolkitWithUndo::syncOverlayMount(const std::string &lower,
                                            const std::string &upper)
 {
@@ -193,7 +217,7 @@ bool FileToolkitWithUndo::tmpfsMount(const std::string dst, const int maxSize)
 
     if (0 == mountRes) {
         log_verbose() << "tmpfs mounted in " << dst;
-        m_cleanupHandlers.emplace_back(new MountCleanUpHandler(dst));
+        m_cleanupHandlers.add(new MountCleanUpHandler(dst));
     } else {
         log_error() << "Could not mount tmpfs into directory: " << dst << " size=" << maxSize;
         return false;
@@ -203,6 +227,20 @@ bool FileToolkitWithUndo::tmpfsMount(const std::string dst, const int maxSize)
     return true;
 }
 
+bool FileToolkitWithUndo::tmpfsResize(const std::string &dst, const uint64_t maxSize)
+{
+    std::string mountoptions = logging::StringBuilder() << "size=" << maxSize;
+
+    if (mount("tmpfs", dst.c_str(), "tmpfs", MS_REMOUNT, mountoptions.c_str()) != 0) {
+        log_error() << "Could not resize tmpfs in " << dst << " to " << maxSize
+                    << ": " << strerror(errno);
+        return false;
+    }
+
+    log_debug() << "tmpfs in " << dst << " resized to " << maxSize;
+    return true;
+}
+
 bool FileToolkitWithUndo::createSharedMountPoint(const std::string &path)
 {
     auto mountRes = mount(path.c_str(), path.c_str(), "", MS_BIND, nullptr);
@@ -223,7 +261,7 @@ bool FileToolkitWithUndo::createSharedMountPoint(const std::string &path)
         return false;
     }
 
-    m_cleanupHandlers.emplace_back(new MountCleanUpHandler(path));
+    m_cleanupHandlers.add(new MountCleanUpHandler(path));
     log_debug() << "Created shared mount point at " << path;
 
     return true;
@@ -231,13 +269,7 @@ bool FileToolkitWithUndo::createSharedMountPoint(const std::string &path)
 
 bool FileToolkitWithUndo::pathInList(const std::string path)
 {
-
-    for (auto &element : m_cleanupHandlers) {
-        if (element->queryName() == path) {
-            return true;
-        }
-    }
-    return false;
+    return m_cleanupHandlers.contains(path);
 }
 
 bool FileToolkitWithUndo::writeToFile(const std::string &path, const std::string &content)
@@ -247,7 +279,7 @@ bool FileToolkitWithUndo::writeToFile(const std::string &path, const std::string
     }
 
     if (!pathInList(path)) {
-        m_cleanupHandlers.emplace_back(new FileCleanUpHandler(path));
+        m_cleanupHandlers.add(new FileCleanUpHandler(path));
     }
     log_debug() << "Successfully wrote to " << path;
     return true;
@@ -256,7 +288,7 @@ bool FileToolkitWithUndo::writeToFile(const std::string &path, const std::string
 void FileToolkitWithUndo::markFileForDeletion(const std::string &path)
 {
     if (!pathInList(path)) {
-        m_cleanupHandlers.emplace_back(new FileCleanUpHandler(path));
+        m_cleanupHandlers.add(new FileCleanUpHandler(path));
     }
 }
 
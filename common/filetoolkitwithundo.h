@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include "cleanupregistry.h"
 #include "mountcleanuphandler.h"
 #include "createdir.h"
 #include "softwarecontainer-common.h"
@@ -30,7 +31,7 @@ class FileToolkitWithUndo
     LOG_DECLARE_CLASS_CONTEXT("CLEA", "File toolkit");
 
 public:
-    ~FileToolkitWithUndo();
+    virtual ~FileToolkitWithUndo();
 
     /**
      * @brief bindMount Bind mount a src directory to another position dst.
@@ -55,6 +56,15 @@ public:
      */
     bool tmpfsMount(const std::string dst, const int maxSize);
 
+    /**
+     * @brief tmpfsResize Change the size limit of a mounted tmpfs by remounting it. The
+     *  contents of the tmpfs are kept, and shrinking below the used size fails.
+     * @param dst The mount point of the tmpfs
+     * @param maxSize The new max size of the tmpfs
+     * @return true on success, false on failure
+     */
+    bool tmpfsResize(const std::string &dst, const uint64_t maxSize);
+
 protected:
     /*
      * @brief Writes to a file (and optionally create it)
@@ -78,12 +88,20 @@ protected:
      * @param work This is a work directory, preferably a tmpfs/ramfs of some kind. This is where
      *  writes wind up temporarily.
      * @param dst Where the overlay filesystem will be mounted.
+     * @param asyncSyncTag If set, the upper layer is synced to the lower layer in the
+     *  background by the OverlaySyncer on cleanup, using this tag. Otherwise the sync is done
+     *  before cleanup returns. Upper and lower are then removed by the OverlaySyncer when the
+     *  sync is done, if they were created here.
+     * @param readOnlyLayers Additional read only layers below lower, topmost first. These are
+     *  never written to, the upper layer is only synced to lower.
      * @return true on success, false on failure
      */
     bool overlayMount(const std::string &lower,
                       const std::string &upper,
                       const std::string &work,
-                      const std::string &dst);
+                      const std::string &dst,
+                      const std::string &asyncSyncTag = "",
+                      const std::vector<std::string> &readOnlyLayers = {});
 
     /**
      * @brief syncOverlayMount Copy the directory structure from upper layer to the lower layer
@@ -102,6 +120,16 @@ protected:
      */
     bool createSharedMountPoint(const std::string &path);
 
+    /**
+     * @brief setVolatileOverlays Mount overlays with the overlayfs "volatile" option, which
+     *  turns all syncs of the overlay into no-ops.
+     *
+     * Kernels that do not support the option mount the overlays without it. Since nothing
+     * written to a volatile overlay can be relied on to reach the disk, the upper layer is
+     * flushed to disk once when it is synced to the lower layer on cleanup instead.
+     */
+    void setVolatileOverlays(bool enabled);
+
     /**
      * @brief checks whether given path is already added to clean up handlers or not
      *
@@ -115,16 +143,32 @@ protected:
     bool pathInList(const std::string path);
 
     /**
-     * @brief m_cleanupHandlers A vector of cleanupHandlers added during the lifetime of the
+     * @brief m_cleanupHandlers The cleanupHandlers added during the lifetime of the
      *  FileToolKitWithUndo that will be run from the destructor.
      */
-    std::vector<std::unique_ptr<CleanUpHandler>> m_cleanupHandlers;
+    CleanupRegistry m_cleanupHandlers;
 
     /**
      * @brief m_createDirList A vector of CreateDir classes. This class handles directory cleaning
      * operations when either interfered errors or when its destructor runs.
      */
     std::vector<std::unique_ptr<CreateDir>> m_createDirList;
+
+    /**
+     * @brief Mounts an overlay filesystem on dst with mount(2), overridden by tests to act
+     *  like other kernels
+     * @return The result of mount(2)
+     */
+    virtual int mountOverlayFileSystem(const std::string &dst, const std::string &options);
+
+private:
+    /**
+     * @brief Mounts an overlay on dst, adding the volatile option if enabled
+     * @return The result of mount(2)
+     */
+    int mountOverlay(const std::string &dst, const std::string &options);
+
+    bool m_volatileOverlays = false;
 };
 
 } // namespace softwarecontainer
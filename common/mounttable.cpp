@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "mounttable.h"
+
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace softwarecontainer {
+
+namespace {
+
+/*
+ * Paths in mountinfo have space, tab, newline and backslash escaped as octal, e.g. "\040"
+ */
+std::string unescape(const std::string &field)
+{
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); i++) {
+        if (field[i] == '\\' && i + 3 < field.size()
+            && field[i + 1] >= '0' && field[i + 1] <= '3'
+            && field[i + 2] >= '0' && field[i + 2] <= '7'
+            && field[i + 3] >= '0' && field[i + 3] <= '7') {
+            result += static_cast<char>(((field[i + 1] - '0') << 6)
+                                        | ((field[i + 2] - '0') << 3)
+                                        | (field[i + 3] - '0'));
+            i += 3;
+        } else {
+            result += field[i];
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+MountTable::MountTable(const std::string &mountInfoPath) :
+    m_path(mountInfoPath)
+{
+}
+
+MountTable::~MountTable()
+{
+    if (m_fd != INVALID_FD) {
+        ::close(m_fd);
+    }
+}
+
+bool MountTable::refresh()
+{
+    if (m_fd == INVALID_FD) {
+        m_fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd == INVALID_FD) {
+            log_error() << "Could not open " << m_path << ": " << strerror(errno);
+            return false;
+        }
+        m_loaded = false;
+    }
+
+    // Always poll, so that the change is acknowledged before the file is read
+    if (!hasChanged() && m_loaded) {
+        return true;
+    }
+
+    std::string content;
+    std::vector<Entry> entries;
+    if (!read(content) || !parse(content, entries)) {
+        log_error() << "Could not read the mount table from " << m_path;
+        m_loaded = false;
+        return false;
+    }
+
+    m_entries.swap(entries);
+    m_mountPoints.clear();
+    for (const Entry &entry : m_entries) {
+        m_mountPoints.insert(entry.mountPoint);
+    }
+    m_loaded = true;
+    return true;
+}
+
+bool MountTable::isMountPoint(const std::string &path) const
+{
+    return m_mountPoints.count(path) > 0;
+}
+
+const std::vector<MountTable::Entry> &MountTable::entries() const
+{
+    return m_entries;
+}
+
+bool MountTable::hasChanged()
+{
+    struct pollfd pfd = { m_fd, POLLPRI, 0 };
+    int ret = ::poll(&pfd, 1, 0);
+    if (ret < 0) {
+        log_warning() << "Could not poll " << m_path << ": " << strerror(errno);
+        return true;
+    }
+    return ret > 0 && (pfd.revents & (POLLERR | POLLPRI)) != 0;
+}
+
+bool MountTable::read(std::string &content)
+{
+    if (::lseek(m_fd, 0, SEEK_SET) != 0) {
+        return false;
+    }
+
+    char buffer[4096];
+    while (true) {
+        ssize_t bytesRead = ::read(m_fd, buffer, sizeof(buffer));
+        if (bytesRead == 0) {
+            return true;
+        }
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        content.append(buffer, bytesRead);
+    }
+}
+
+bool MountTable::parse(const std::string &content, std::vector<Entry> &entries)
+{
+    std::vector<Entry> result;
+    std::istringstream lines(content);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Entry entry;
+        std::string majorMinor;
+        if (!(fields >> entry.mountId >> entry.parentId >> majorMinor >> entry.root
+                     >> entry.mountPoint >> entry.mountOptions)) {
+            return false;
+        }
+
+        // Any number of optional fields, terminated by a single hyphen
+        std::string field;
+        while ((fields >> field) && field != "-") {
+        }
+
+        if (field != "-" || !(fields >> entry.fsType >> entry.source >> entry.superOptions)) {
+            return false;
+        }
+
+        entry.root = unescape(entry.root);
+        entry.mountPoint = unescape(entry.mountPoint);
+        entry.source = unescape(entry.source);
+        result.push_back(entry);
+    }
+
+    entries.swap(result);
+    return true;
+}
+
+} // namespace softwarecontainer
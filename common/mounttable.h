@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <unordered_set>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The MountTable class is a snapshot of a mountinfo file, e.g. /proc/<pid>/mountinfo.
+ *
+ * The file is kept open between refreshes, and it is only read again when the kernel reports,
+ * through poll(2), that the mount table of the mount namespace has changed since the last
+ * read. Since the paths in /proc/<pid>/mountinfo are relative to the root of that process, the
+ * mount table of a container can be inspected from the host without attaching to it.
+ *
+ * The class is not thread safe, users must serialize access to it.
+ */
+class MountTable
+{
+    LOG_DECLARE_CLASS_CONTEXT("MOTA", "Mount table");
+
+public:
+    /**
+     * @brief One line of a mountinfo file, see proc(5)
+     */
+    struct Entry
+    {
+        int mountId;
+        int parentId;
+        std::string root;
+        std::string mountPoint;
+        std::string mountOptions;
+        std::string fsType;
+        std::string source;
+        std::string superOptions;
+    };
+
+    /**
+     * @param mountInfoPath The mountinfo file to read, the file is not opened until the first
+     *  call to refresh()
+     */
+    MountTable(const std::string &mountInfoPath = "/proc/self/mountinfo");
+    ~MountTable();
+
+    MountTable(const MountTable &) = delete;
+    MountTable &operator=(const MountTable &) = delete;
+
+    /**
+     * @brief refresh Reads the mountinfo file if it has not been read yet, or if the mount
+     *  table has changed since it was last read
+     *
+     * @return true if the snapshot is up to date, false if the file could not be read
+     */
+    bool refresh();
+
+    /**
+     * @brief isMountPoint Checks if something is mounted on the path in the current snapshot
+     */
+    bool isMountPoint(const std::string &path) const;
+
+    /**
+     * @brief entries The mounts in the current snapshot, in the order of the file
+     */
+    const std::vector<Entry> &entries() const;
+
+    /**
+     * @brief parse Parses the contents of a mountinfo file
+     *
+     * @return false if any line is malformed, in which case entries is left untouched
+     */
+    static bool parse(const std::string &content, std::vector<Entry> &entries);
+
+private:
+    bool read(std::string &content);
+    bool hasChanged();
+
+    std::string m_path;
+    int m_fd = INVALID_FD;
+    bool m_loaded = false;
+    std::vector<Entry> m_entries;
+    std::unordered_set<std::string> m_mountPoints;
+};
+
+} // namespace softwarecontainer
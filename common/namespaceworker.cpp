@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "namespaceworker.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+namespace softwarecontainer {
+
+namespace {
+
+// Max size of a request, i.e. an operation name and its arguments
+constexpr size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+struct Reply
+{
+    int32_t result;
+    int32_t error;
+};
+
+// Namespaces entered by the helper, the user namespace has to be entered first and the mount
+// namespace last, since entering it changes the root directory
+const char *const NAMESPACES[] = { "user", "cgroup", "ipc", "uts", "net", "mnt" };
+
+// Everything the helper needs, set up before forking so that the helper doesn't allocate
+struct HelperContext
+{
+    int socket;
+    long maxFd;
+    std::vector<int> namespaceFds;
+    std::vector<std::pair<const char *, NamespaceWorker::Operation>> operations;
+    // Room for a request and a terminating null character
+    std::vector<char> buffer;
+    // The operation name and its arguments in the current request
+    std::vector<const char *> fields;
+};
+
+bool sameFile(int fd1, int fd2)
+{
+    struct stat st1;
+    struct stat st2;
+    if (fstat(fd1, &st1) == -1 || fstat(fd2, &st2) == -1) {
+        return false;
+    }
+    return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+
+void closeAll(std::vector<int> &fds)
+{
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    fds.clear();
+}
+
+// Closes all file descriptors except stdin, stdout, stderr and fd
+void closeOtherFileDescriptors(int fd, long max)
+{
+    if ((fd == 3 || syscall(SYS_close_range, 3, fd - 1, 0) == 0)
+        && syscall(SYS_close_range, fd + 1, ~0U, 0) == 0) {
+        return;
+    }
+
+    for (int i = 3; i < max; i++) {
+        if (i != fd) {
+            ::close(i);
+        }
+    }
+}
+
+bool enterNamespaces(const std::vector<int> &fds)
+{
+    for (int fd : fds) {
+        if (setns(fd, 0) == -1) {
+            return false;
+        }
+    }
+    return chdir("/") == 0;
+}
+
+void serve(HelperContext &context)
+{
+    char *buffer = context.buffer.data();
+
+    while (true) {
+        ssize_t count = recv(context.socket, buffer, MAX_REQUEST_SIZE, 0);
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return;
+        }
+        buffer[count] = '\0';
+
+        // Split the request into the operation name and its arguments
+        size_t fieldCount = 0;
+        bool tooManyFields = false;
+        const char *field = buffer;
+        const char *end = buffer + count;
+        while (field < end) {
+            if (fieldCount == context.fields.size()) {
+                tooManyFields = true;
+                break;
+            }
+            context.fields[fieldCount++] = field;
+            field += strlen(field) + 1;
+        }
+
+        NamespaceWorker::Operation operation = nullptr;
+        if (fieldCount > 0 && !tooManyFields) {
+            for (const auto &entry : context.operations) {
+                if (strcmp(entry.first, context.fields[0]) == 0) {
+                    operation = entry.second;
+                    break;
+                }
+            }
+        }
+
+        Reply reply = {-1, EINVAL};
+        if (operation != nullptr) {
+            errno = 0;
+            reply.result = operation(context.fields.data() + 1, fieldCount - 1);
+            reply.error = reply.result == 0 ? 0 : errno;
+        }
+
+        if (send(context.socket, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply)) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+constexpr size_t NamespaceWorker::MAX_ARGUMENTS;
+
+NamespaceWorker::NamespaceWorker()
+{
+}
+
+NamespaceWorker::~NamespaceWorker()
+{
+    stop();
+}
+
+void NamespaceWorker::registerOperation(const std::string &name, Operation operation)
+{
+    if (isRunning()) {
+        log_error() << "Operation " << name << " registered after the worker was started, ignoring it";
+        return;
+    }
+    m_operations[name] = operation;
+}
+
+bool NamespaceWorker::isRunning() const
+{
+    return m_pid != INVALID_PID;
+}
+
+bool NamespaceWorker::openNamespaces(pid_t pid, std::vector<int> &fds)
+{
+    std::string directory = "/proc/" + std::to_string(pid) + "/ns";
+    if (access(directory.c_str(), F_OK) == -1) {
+        return false;
+    }
+
+    // Open all namespaces before entering any of them, /proc of the host is not reachable
+    // after entering the mount namespace
+    for (const char *name : NAMESPACES) {
+        std::string path = directory + "/" + name;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            if (errno == ENOENT) {
+                // Not supported by the kernel
+                continue;
+            }
+            int error = errno;
+            closeAll(fds);
+            errno = error;
+            return false;
+        }
+
+        std::string ownPath = std::string("/proc/self/ns/") + name;
+        int ownFd = ::open(ownPath.c_str(), O_RDONLY | O_CLOEXEC);
+        bool shared = ownFd != -1 && sameFile(fd, ownFd);
+        if (ownFd != -1) {
+            ::close(ownFd);
+        }
+
+        if (shared) {
+            ::close(fd);
+        } else {
+            fds.push_back(fd);
+        }
+    }
+
+    return true;
+}
+
+bool NamespaceWorker::start(pid_t pid)
+{
+    if (isRunning()) {
+        log_error() << "Worker is already running";
+        return false;
+    }
+
+    HelperContext context;
+    if (!openNamespaces(pid, context.namespaceFds)) {
+        log_error() << "Could not open the namespaces of process " << pid << ": " << strerror(errno);
+        return false;
+    }
+
+    context.maxFd = sysconf(_SC_OPEN_MAX);
+    if (context.maxFd < 0 || context.maxFd > 65536) {
+        context.maxFd = 65536;
+    }
+    for (const auto &operation : m_operations) {
+        context.operations.push_back(std::make_pair(operation.first.c_str(), operation.second));
+    }
+    context.buffer.resize(MAX_REQUEST_SIZE + 1);
+    context.fields.resize(MAX_ARGUMENTS + 1);
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1) {
+        log_error() << "Could not create socket pair: " << strerror(errno);
+        closeAll(context.namespaceFds);
+        return false;
+    }
+    context.socket = sockets[1];
+
+    pid_t parent = getpid();
+    pid_t child = fork();
+    if (child == -1) {
+        log_error() << "Could not fork worker: " << strerror(errno);
+        ::close(sockets[0]);
+        ::close(sockets[1]);
+        closeAll(context.namespaceFds);
+        return false;
+    }
+
+    if (child == 0) {
+        // Don't outlive the parent, and don't log or allocate from here since the parent may
+        // have been holding locks in other threads when forking
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != parent) {
+            _exit(1);
+        }
+
+        Reply reply = {0, 0};
+        if (!enterNamespaces(context.namespaceFds)) {
+            reply.result = -1;
+            reply.error = errno;
+        }
+        closeOtherFileDescriptors(context.socket, context.maxFd);
+        send(context.socket, &reply, sizeof(reply), MSG_NOSIGNAL);
+
+        if (reply.result == 0) {
+            serve(context);
+        }
+        _exit(reply.result == 0 ? 0 : 1);
+    }
+
+    closeAll(context.namespaceFds);
+    ::close(sockets[1]);
+    m_pid = child;
+    m_socket = sockets[0];
+
+    Reply reply;
+    ssize_t count;
+    do {
+        count = recv(m_socket, &reply, sizeof(reply), 0);
+    } while (count == -1 && errno == EINTR);
+
+    if (count != sizeof(reply) || reply.result != 0) {
+        log_error() << "Worker could not enter the namespaces of process " << pid << ": "
+                    << (count == sizeof(reply) ? strerror(reply.error) : "no reply");
+        stop();
+        return false;
+    }
+
+    log_debug() << "Worker " << m_pid << " running in the namespaces of process " << pid;
+    return true;
+}
+
+void NamespaceWorker::stop()
+{
+    if (m_socket != INVALID_FD) {
+        // The helper exits when it sees the socket closed
+        ::close(m_socket);
+        m_socket = INVALID_FD;
+    }
+
+    if (m_pid != INVALID_PID) {
+        int status;
+        while (waitpid(m_pid, &status, 0) == -1 && errno == EINTR) {}
+        m_pid = INVALID_PID;
+    }
+}
+
+NamespaceWorker::CallResult NamespaceWorker::call(const std::string &name,
+                                                  const std::vector<std::string> &arguments,
+                                                  int &result)
+{
+    if (!isRunning()) {
+        return CallResult::NotSent;
+    }
+
+    if (arguments.size() > MAX_ARGUMENTS) {
+        log_error() << "Too many arguments to operation " << name;
+        return CallResult::NotSent;
+    }
+
+    // The request is the name followed by the arguments, each terminated by a null character
+    std::string request = name;
+    request.push_back('\0');
+    for (const std::string &argument : arguments) {
+        request.append(argument);
+        request.push_back('\0');
+    }
+
+    if (request.size() > MAX_REQUEST_SIZE) {
+        log_error() << "Request for operation " << name << " is too large";
+        return CallResult::NotSent;
+    }
+
+    ssize_t count;
+    do {
+        count = send(m_socket, request.data(), request.size(), MSG_NOSIGNAL);
+    } while (count == -1 && errno == EINTR);
+
+    // Sending is atomic on a SOCK_SEQPACKET socket, so a failed send never reached the helper
+    if (count != static_cast<ssize_t>(request.size())) {
+        log_error() << "Could not send request to worker " << m_pid << ", stopping it";
+        stop();
+        return CallResult::NotSent;
+    }
+
+    Reply reply;
+    do {
+        count = recv(m_socket, &reply, sizeof(reply), 0);
+    } while (count == -1 && errno == EINTR);
+
+    if (count != sizeof(reply)) {
+        log_error() << "Lost contact with worker " << m_pid << " during operation " << name
+                    << ", stopping it";
+        stop();
+        return CallResult::Lost;
+    }
+
+    result = reply.result;
+    if (reply.error != 0) {
+        errno = reply.error;
+    }
+    return CallResult::Done;
+}
+
+} // namespace softwarecontainer
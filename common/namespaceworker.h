@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <map>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The NamespaceWorker class runs operations inside the namespaces of another process,
+ * typically the init process of a container, without forking for every operation.
+ *
+ * start() forks a helper process once, which enters the namespaces of the target process and
+ * then waits for requests on a socket. Each call() sends the name of an operation and its
+ * arguments to the helper, which runs the operation and sends back its result. An operation
+ * can therefore only be a function registered before the worker is started, since the helper
+ * only has a copy of the memory of this process as it was when it was forked.
+ *
+ * This process may have other threads, which could hold locks e.g. in the allocator when the
+ * helper is forked. Everything the helper needs is therefore set up before forking, and the
+ * helper, including the operations it runs, only calls async-signal-safe functions.
+ *
+ * The helper does not enter the pid namespace of the target, so it is not killed together with
+ * the target. stop() must be called before the namespaces are torn down. The helper exits by
+ * itself if this process dies.
+ */
+class NamespaceWorker
+{
+    LOG_DECLARE_CLASS_CONTEXT("NSWO", "Namespace worker");
+
+public:
+    /**
+     * @brief An operation run by the helper, returns 0 on success
+     *
+     * The operation gets the arguments of the call as null terminated strings. It must only
+     * call async-signal-safe functions, and so it must not allocate memory or throw.
+     */
+    typedef int (*Operation)(const char *const arguments[], size_t count);
+
+    /**
+     * @brief The max number of arguments to an operation
+     */
+    static constexpr size_t MAX_ARGUMENTS = 16;
+
+    NamespaceWorker();
+    ~NamespaceWorker();
+
+    NamespaceWorker(const NamespaceWorker &) = delete;
+    NamespaceWorker &operator=(const NamespaceWorker &) = delete;
+
+    /**
+     * @brief Registers an operation, this must be done before the worker is started
+     */
+    void registerOperation(const std::string &name, Operation operation);
+
+    /**
+     * @brief Forks the helper and lets it enter the namespaces of a process
+     *
+     * Namespaces that the process shares with this process are not entered.
+     *
+     * @param pid The process whose namespaces to enter
+     * @return false if the helper could not be started or could not enter the namespaces
+     */
+    bool start(pid_t pid);
+
+    /**
+     * @brief Stops the helper and waits for it to exit
+     */
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * @brief The outcome of call()
+     */
+    enum class CallResult {
+        // The helper ran the operation
+        Done,
+        // The request was never sent to the helper, e.g. since it is not running
+        NotSent,
+        // The helper died after getting the request, the operation may have been run in part
+        Lost
+    };
+
+    /**
+     * @brief Runs a registered operation in the helper and waits for it to finish
+     *
+     * If the helper has died, it is stopped and any later calls return NotSent.
+     *
+     * @param name The name of the operation
+     * @param arguments Passed to the operation, at most MAX_ARGUMENTS of them
+     * @param result Set to the value returned by the operation if it was run
+     * @return Done if the operation was run, otherwise whether it could have been started
+     */
+    CallResult call(const std::string &name, const std::vector<std::string> &arguments,
+                    int &result);
+
+private:
+    static bool openNamespaces(pid_t pid, std::vector<int> &fds);
+
+    std::map<std::string, Operation> m_operations;
+    pid_t m_pid = INVALID_PID;
+    int m_socket = INVALID_FD;
+};
+
+} // namespace softwarecontainer
@@ -19,19 +19,64 @@
 
 #include "overlaysynccleanuphandler.h"
 
+#include "overlaysyncer.h"
 #include "recursivecopy.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace softwarecontainer {
 
-OverlaySyncCleanupHandler::OverlaySyncCleanupHandler(std::string src, std::string dst)
+OverlaySyncCleanupHandler::OverlaySyncCleanupHandler(std::string src,
+                                                     std::string dst,
+                                                     std::string asyncSyncTag,
+                                                     bool flushToDisk,
+                                                     CreateDir *createdDirs)
 {
     m_src = src;
     m_dst = dst;
+    m_asyncSyncTag = asyncSyncTag;
+    m_flushToDisk = flushToDisk;
+    m_createdDirs = createdDirs;
 }
 
 bool OverlaySyncCleanupHandler::clean()
 {
-    return RecursiveCopy::getInstance().copy(m_src, m_dst);
+    if (!m_asyncSyncTag.empty()) {
+        // The directories must not be removed while the background sync still reads them
+        std::vector<std::string> ownedDirs;
+        for (const std::string &path : { m_src, m_dst }) {
+            if (m_createdDirs != nullptr && m_createdDirs->pathInList(path)) {
+                ownedDirs.push_back(path);
+            }
+        }
+
+        if (OverlaySyncer::getInstance().enqueue(m_asyncSyncTag, m_src, m_dst, ownedDirs)) {
+            for (const std::string &path : ownedDirs) {
+                m_createdDirs->release(path);
+            }
+            return true;
+        }
+        log_warning() << "Could not sync " << m_src << " in the background, syncing now";
+    }
+
+    if (!RecursiveCopy::getInstance().copy(m_src, m_dst)) {
+        return false;
+    }
+
+    if (m_flushToDisk) {
+        int fd = open(m_dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == INVALID_FD || syncfs(fd) != 0) {
+            log_error() << "Could not flush " << m_dst << " to disk: " << strerror(errno);
+            if (fd != INVALID_FD) {
+                close(fd);
+            }
+            return false;
+        }
+        close(fd);
+    }
+
+    return true;
 }
 
 const std::string OverlaySyncCleanupHandler::queryName()
@@ -39,4 +84,9 @@ const std::string OverlaySyncCleanupHandler::queryName()
     return "";
 }
 
+std::vector<std::string> OverlaySyncCleanupHandler::requiredPaths()
+{
+    return std::vector<std::string>{m_src, m_dst};
+}
+
 } // namespace softwarecontainer
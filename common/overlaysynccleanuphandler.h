@@ -20,6 +20,7 @@
 #pragma once
 
 #include <cleanuphandler.h>
+#include <createdir.h>
 
 namespace softwarecontainer {
 
@@ -27,6 +28,11 @@ namespace softwarecontainer {
  * @brief The OverlaySyncCleanupHandler class is used to copy files on cleanup and can be added to the
  * CleanupHandler stack in the FileToolkitWithUndo class. On destruction onf the
  * FileToolKitWithUndo, the src will be copied to dst recursively.
+ *
+ * If an async sync tag is given and the OverlaySyncer is running, the copy is instead handed
+ * over to the OverlaySyncer and clean() returns without waiting for it. Any of src and dst that
+ * were created by the given CreateDir are then handed over too, and removed by the
+ * OverlaySyncer once it is done with them.
  */
 class OverlaySyncCleanupHandler : public CleanUpHandler
 {
@@ -35,8 +41,17 @@ public:
      * @brief OverlaySyncCleanupHandler Constructor of the class.
      * @param src Source to copy the files from
      * @param dst Destination of the files.
+     * @param asyncSyncTag Tag to sync in the background with, or empty to sync on cleanup.
+     * @param flushToDisk Flush dst to disk after copying, for overlays mounted volatile. Syncs
+     *  done in the background are always flushed.
+     * @param createdDirs The CreateDir that created src and dst, if any. It must outlive the
+     *  call to clean().
      */
-    OverlaySyncCleanupHandler(std::string src, std::string dst);
+    OverlaySyncCleanupHandler(std::string src,
+                              std::string dst,
+                              std::string asyncSyncTag = "",
+                              bool flushToDisk = false,
+                              CreateDir *createdDirs = nullptr);
 
     /**
      * @brief clean Performs the cleanup handling.
@@ -56,10 +71,17 @@ public:
      * @return an empty string
      */
     const std::string queryName() override;
+
+    /**
+     * @brief requiredPaths Both src and dst are needed to sync.
+     */
+    std::vector<std::string> requiredPaths() override;
 private:
     std::string m_src;
     std::string m_dst;
-
+    std::string m_asyncSyncTag;
+    bool m_flushToDisk;
+    CreateDir *m_createdDirs;
 };
 
 } // namespace softwarecontainer
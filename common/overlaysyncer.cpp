@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "overlaysyncer.h"
+#include "recursivecopy.h"
+#include "recursivedelete.h"
+
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace softwarecontainer {
+
+namespace {
+
+const std::string STAGING_UPPER_DIR = "upper";
+const std::string STAGING_LOWER_DIR = "lower";
+const std::string JOURNAL_FILE = "journal";
+const std::string JOURNAL_TMP_FILE = "journal.tmp";
+const std::string JOURNAL_TAG_KEY = "tag=";
+const std::string JOURNAL_UPPER_KEY = "upper=";
+const std::string JOURNAL_LOWER_KEY = "lower=";
+const std::string JOURNAL_REMOVE_KEY = "remove=";
+
+// ioprio_set(2) has no glibc wrapper
+const int IOPRIO_WHO_PROCESS = 1;
+const int IOPRIO_CLASS_BE = 2;
+const int IOPRIO_CLASS_SHIFT = 13;
+const int IOPRIO_LOWEST_LEVEL = 7;
+
+} // namespace
+
+OverlaySyncer &OverlaySyncer::getInstance()
+{
+    static OverlaySyncer instance;
+    return instance;
+}
+
+OverlaySyncer::OverlaySyncer() {}
+
+OverlaySyncer::~OverlaySyncer()
+{
+    stop();
+}
+
+bool OverlaySyncer::start(const std::string &journalDir, CompletionCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_running) {
+        log_error() << "Overlay syncer is already running";
+        return false;
+    }
+
+    // The journal directory is kept across reboots, so it is not cleaned up like the
+    // directories created by CreateDir
+    std::vector<std::string> missingDirs;
+    for (std::string path = journalDir; !isDirectory(path); path = parentPath(path)) {
+        missingDirs.push_back(path);
+    }
+    for (auto it = missingDirs.rbegin(); it != missingDirs.rend(); ++it) {
+        if (mkdir(it->c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+            log_error() << "Could not create sync journal directory " << *it
+                        << ": " << strerror(errno);
+            return false;
+        }
+    }
+
+    m_journalDir = journalDir;
+    m_callback = callback;
+    m_stopping = false;
+
+    resumeJournals();
+
+    m_thread = std::thread(&OverlaySyncer::run, this);
+    m_running = true;
+    log_debug() << "Overlay syncer started, journal directory " << m_journalDir;
+    return true;
+}
+
+void OverlaySyncer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_running) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    m_thread.join();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_jobs.empty()) {
+        log_info() << m_jobs.size() << " write buffer sync(s) left for the next start";
+    }
+    m_jobs.clear();
+    m_callback = nullptr;
+    m_running = false;
+}
+
+bool OverlaySyncer::isRunning()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_running;
+}
+
+bool OverlaySyncer::enqueue(const std::string &tag,
+                            const std::string &upper,
+                            const std::string &lower,
+                            const std::vector<std::string> &removeAfterSync)
+{
+    for (const std::string &path : removeAfterSync) {
+        if (path != upper && path != lower) {
+            log_error() << "Only the synced directories can be removed after a sync, not " << path;
+            return false;
+        }
+    }
+
+    std::string journalDir;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_running) {
+            return false;
+        }
+        journalDir = m_journalDir;
+    }
+
+    std::string stagingTemplate = buildPath(journalDir, tag + "-XXXXXX");
+    std::vector<char> stagingBuffer(stagingTemplate.begin(), stagingTemplate.end());
+    stagingBuffer.push_back('\0');
+    if (nullptr == mkdtemp(stagingBuffer.data())) {
+        log_error() << "Could not create sync staging directory for " << tag
+                    << ": " << strerror(errno);
+        return false;
+    }
+    std::string stagingDir(stagingBuffer.data());
+
+    // Bind mounts keep the layers reachable after the container has unmounted them, and
+    // unlike open file descriptors they also survive a restart of the agent.
+    Job job{tag, stagingDir, upper, lower, removeAfterSync};
+    if (!stage(job) || !writeJournal(job)) {
+        removeStagingDir(stagingDir);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        // If the syncer was stopped meanwhile, the journal makes sure the job is run later
+        if (m_running && !m_stopping) {
+            m_jobs.push_back(job);
+        }
+    }
+    m_jobAvailable.notify_one();
+
+    log_debug() << "Queued write buffer sync of " << tag << " from " << upper << " to " << lower;
+    return true;
+}
+
+bool OverlaySyncer::stage(const Job &job)
+{
+    const std::vector<std::pair<std::string, std::string>> mounts = {
+        { job.upper, buildPath(job.stagingDir, STAGING_UPPER_DIR) },
+        { job.lower, buildPath(job.stagingDir, STAGING_LOWER_DIR) }
+    };
+
+    for (auto &m : mounts) {
+        if (isMountPoint(m.second)) {
+            continue;
+        }
+
+        if ((mkdir(m.second.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+            || mount(m.first.c_str(), m.second.c_str(), "", MS_BIND, nullptr) != 0
+            || mount("", m.second.c_str(), "", MS_PRIVATE, nullptr) != 0) {
+            log_error() << "Could not stage " << m.first << " for sync: " << strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+void OverlaySyncer::run()
+{
+    // Syncs are background work, so their reads yield to the IO of running applications on
+    // schedulers that honor priorities. The buffered writes are written back by the kernel at
+    // its own priority. The copy threads of RecursiveCopy inherit the priority of this thread.
+    if (::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                  (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | IOPRIO_LOWEST_LEVEL) != 0) {
+        log_warning() << "Could not lower the IO priority of write buffer syncs: "
+                      << strerror(errno);
+    }
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_jobAvailable.wait(lock, [this] () {
+                return m_stopping || !m_jobs.empty();
+            });
+
+            if (m_stopping) {
+                return;
+            }
+
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool success = sync(job);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start).count();
+        log_info() << "Write buffer sync of " << job.tag << (success ? " done" : " failed")
+                   << " after " << elapsed << " ms";
+
+        finish(job, success);
+    }
+}
+
+bool OverlaySyncer::sync(const Job &job)
+{
+    std::string upper = buildPath(job.stagingDir, STAGING_UPPER_DIR);
+    std::string lower = buildPath(job.stagingDir, STAGING_LOWER_DIR);
+
+    if (!isMountPoint(upper) || !isMountPoint(lower)) {
+        log_error() << "The write buffer of " << job.tag << " is gone, can not sync it";
+        return false;
+    }
+
+    bool success = RecursiveCopy::getInstance().copy(upper, lower);
+
+    // The data has to be on disk before the journal is removed
+    int fd = open(lower.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == INVALID_FD || syncfs(fd) != 0) {
+        log_error() << "Could not flush " << lower << ": " << strerror(errno);
+        success = false;
+    }
+    if (fd != INVALID_FD) {
+        close(fd);
+    }
+
+    return success;
+}
+
+void OverlaySyncer::finish(const Job &job, bool success)
+{
+    std::vector<std::string> removable = removableDirs(job);
+    removeStagingDir(job.stagingDir);
+
+    for (const std::string &path : removable) {
+        if (!RecursiveDelete::getInstance().del(path)) {
+            log_warning() << "Could not remove " << path << " after syncing " << job.tag;
+        }
+    }
+
+    if (m_callback) {
+        m_callback(job.tag, success);
+    }
+}
+
+void OverlaySyncer::resumeJournals()
+{
+    DIR *dir = opendir(m_journalDir.c_str());
+    if (nullptr == dir) {
+        log_error() << "Could not read sync journal directory " << m_journalDir
+                    << ": " << strerror(errno);
+        return;
+    }
+
+    std::vector<std::string> stagingDirs;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        if (name != "." && name != "..") {
+            stagingDirs.push_back(buildPath(m_journalDir, name));
+        }
+    }
+    closedir(dir);
+
+    for (const std::string &stagingDir : stagingDirs) {
+        Job job;
+        if (!readJournal(stagingDir, job)) {
+            // The agent stopped before the job was fully set up, nothing was synced
+            log_warning() << "Removing incomplete sync staging directory " << stagingDir;
+            removeStagingDir(stagingDir);
+            continue;
+        }
+
+        // The staging mounts are gone after a reboot, the layers themselves may still be there
+        // if they are on persistent storage. Otherwise the job fails when it is run.
+        if (isDirectory(job.upper) && isDirectory(job.lower) && !stage(job)) {
+            log_warning() << "Could not stage the write buffer of " << job.tag << " again";
+        }
+
+        log_info() << "Resuming write buffer sync of " << job.tag;
+        m_jobs.push_back(job);
+    }
+}
+
+bool OverlaySyncer::writeJournal(const Job &job)
+{
+    std::stringstream content;
+    content << JOURNAL_TAG_KEY << job.tag << "\n"
+            << JOURNAL_UPPER_KEY << job.upper << "\n"
+            << JOURNAL_LOWER_KEY << job.lower << "\n";
+    for (const std::string &path : job.removeAfterSync) {
+        content << JOURNAL_REMOVE_KEY << path << "\n";
+    }
+
+    // Write and rename, so that the journal is either complete or missing
+    std::string tmpPath = buildPath(job.stagingDir, JOURNAL_TMP_FILE);
+    std::string path = buildPath(job.stagingDir, JOURNAL_FILE);
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == INVALID_FD) {
+        log_error() << "Could not create sync journal " << tmpPath << ": " << strerror(errno);
+        return false;
+    }
+
+    std::string data = content.str();
+    bool success = write(fd, data.c_str(), data.size()) == static_cast<ssize_t>(data.size())
+                   && fsync(fd) == 0;
+    close(fd);
+
+    if (!success || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        log_error() << "Could not write sync journal " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    fd = open(job.stagingDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != INVALID_FD) {
+        fsync(fd);
+        close(fd);
+    }
+
+    return true;
+}
+
+bool OverlaySyncer::readJournal(const std::string &stagingDir, Job &job)
+{
+    std::string content;
+    if (!readFromFile(buildPath(stagingDir, JOURNAL_FILE), content)) {
+        return false;
+    }
+
+    job = Job();
+    job.stagingDir = stagingDir;
+
+    auto startsWith = [] (const std::string &line, const std::string &key) {
+        return line.compare(0, key.size(), key) == 0;
+    };
+
+    std::istringstream lines(content);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (startsWith(line, JOURNAL_TAG_KEY)) {
+            job.tag = line.substr(JOURNAL_TAG_KEY.size());
+        } else if (startsWith(line, JOURNAL_UPPER_KEY)) {
+            job.upper = line.substr(JOURNAL_UPPER_KEY.size());
+        } else if (startsWith(line, JOURNAL_LOWER_KEY)) {
+            job.lower = line.substr(JOURNAL_LOWER_KEY.size());
+        } else if (startsWith(line, JOURNAL_REMOVE_KEY)) {
+            job.removeAfterSync.push_back(line.substr(JOURNAL_REMOVE_KEY.size()));
+        }
+    }
+
+    return !job.tag.empty();
+}
+
+std::vector<std::string> OverlaySyncer::removableDirs(const Job &job)
+{
+    std::vector<std::string> removable;
+    for (const std::string &path : job.removeAfterSync) {
+        std::string staged = buildPath(job.stagingDir,
+                                       path == job.upper ? STAGING_UPPER_DIR : STAGING_LOWER_DIR);
+
+        // The path may have been reused by a new container since, e.g. after a restart of the
+        // agent, or it may be gone along with the tmpfs it was on
+        struct stat pathStat;
+        struct stat stagedStat;
+        if (isMountPoint(staged)
+            && stat(path.c_str(), &pathStat) == 0
+            && stat(staged.c_str(), &stagedStat) == 0
+            && pathStat.st_dev == stagedStat.st_dev
+            && pathStat.st_ino == stagedStat.st_ino) {
+            removable.push_back(path);
+        }
+    }
+    return removable;
+}
+
+bool OverlaySyncer::removeStagingDir(const std::string &stagingDir)
+{
+    bool success = true;
+
+    // Remove the journal first, a staging directory without journal is never synced
+    for (const std::string &file : { JOURNAL_FILE, JOURNAL_TMP_FILE }) {
+        std::string path = buildPath(stagingDir, file);
+        if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+            log_error() << "Could not remove " << path << ": " << strerror(errno);
+            success = false;
+        }
+    }
+
+    for (const std::string &dir : { STAGING_UPPER_DIR, STAGING_LOWER_DIR }) {
+        std::string path = buildPath(stagingDir, dir);
+        if (isMountPoint(path) && umount2(path.c_str(), MNT_DETACH) != 0) {
+            log_error() << "Could not unmount " << path << ": " << strerror(errno);
+            success = false;
+            continue;
+        }
+        if (rmdir(path.c_str()) != 0 && errno != ENOENT) {
+            log_error() << "Could not remove " << path << ": " << strerror(errno);
+            success = false;
+        }
+    }
+
+    if (success && rmdir(stagingDir.c_str()) != 0) {
+        log_error() << "Could not remove " << stagingDir << ": " << strerror(errno);
+        success = false;
+    }
+
+    return success;
+}
+
+} // namespace softwarecontainer
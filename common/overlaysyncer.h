@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The OverlaySyncer class syncs overlay upper directories to their lower directories
+ * on a background thread.
+ *
+ * A sync is handed over with enqueue(), which bind mounts both the upper and the lower
+ * directory into a staging directory of its own under the journal directory and records the
+ * job in a journal file there. From then on the job does not depend on the mounts of the
+ * container it came from, so the container can be torn down right away.
+ *
+ * The staging mounts and the journal outlive the agent process, so if the agent exits or
+ * crashes before a sync is done, the job is picked up again by start() the next time. Since
+ * RecursiveCopy replaces files atomically, re-running a partially done sync is safe. If the
+ * staging mounts are gone, e.g. after a reboot, they are created again from the paths in the
+ * journal. If the upper directory is gone as well, e.g. since it was on a tmpfs, the job can
+ * not be resumed and is reported as failed. The journal directory should be on persistent
+ * storage for jobs to survive a reboot at all.
+ *
+ * Directories that would otherwise have been removed along with the container can be handed
+ * over with the job, they are then removed once the job is done.
+ *
+ * The background thread, and the threads it copies files with, run at the lowest best-effort
+ * IO priority. Only schedulers that support priorities, like BFQ, honor it, and not for the
+ * buffered writes that make up most of a sync, since those are written back by the kernel
+ * flusher threads. Syncs are not throttled with io.max or io.weight, which would take a
+ * process in a cgroup of its own.
+ *
+ * This is a singleton like RecursiveCopy. Until start() has been called, enqueue() refuses
+ * new jobs and callers are expected to sync synchronously instead.
+ */
+class OverlaySyncer
+{
+    LOG_DECLARE_CLASS_CONTEXT("OVSY", "Overlay syncer");
+
+public:
+    /**
+     * @brief Called on the syncer thread when a job is done
+     *
+     * @param tag The tag passed to enqueue()
+     * @param success true if everything was synced
+     */
+    typedef std::function<void (const std::string &tag, bool success)> CompletionCallback;
+
+    static OverlaySyncer &getInstance();
+
+    OverlaySyncer(const OverlaySyncer &) = delete;
+    OverlaySyncer &operator=(const OverlaySyncer &) = delete;
+
+    /**
+     * @brief Starts the background thread and resumes any jobs found in the journal directory
+     *
+     * @param journalDir Directory to keep staging directories and journals in, created if
+     *  it does not exist
+     * @param callback Called for each finished job, may be empty
+     * @return false if the journal directory could not be created or the syncer is running
+     */
+    bool start(const std::string &journalDir, CompletionCallback callback);
+
+    /**
+     * @brief Stops the background thread after the currently running job is done.
+     *
+     * Jobs that are still queued are left in the journal directory to be resumed by the next
+     * call to start().
+     */
+    void stop();
+
+    bool isRunning();
+
+    /**
+     * @brief Hands over the sync of upper to lower to the background thread
+     *
+     * Both directories must stay mounted until this returns, after that they may be unmounted.
+     *
+     * @param tag Identifies the job in the completion callback and in the journal directory,
+     *  the container name is used for this
+     * @param upper The upper directory of an overlay that is no longer mounted
+     * @param lower The lower directory to sync to
+     * @param removeAfterSync Any of upper and lower that should be removed when the job is done.
+     *  They are only removed if the paths still refer to the staged directories by then.
+     * @return false if the job could not be set up, nothing is synced and nothing is removed
+     *  in that case
+     */
+    bool enqueue(const std::string &tag,
+                 const std::string &upper,
+                 const std::string &lower,
+                 const std::vector<std::string> &removeAfterSync = {});
+
+private:
+    OverlaySyncer();
+    ~OverlaySyncer();
+
+    struct Job
+    {
+        std::string tag;
+        std::string stagingDir;
+        std::string upper;
+        std::string lower;
+        std::vector<std::string> removeAfterSync;
+    };
+
+    // Bind mounts the layers of a job into its staging directory, unless they already are
+    bool stage(const Job &job);
+
+    void run();
+    bool sync(const Job &job);
+    void finish(const Job &job, bool success);
+
+    void resumeJournals();
+    bool writeJournal(const Job &job);
+    bool readJournal(const std::string &stagingDir, Job &job);
+    bool removeStagingDir(const std::string &stagingDir);
+    std::vector<std::string> removableDirs(const Job &job);
+
+    std::mutex m_lock;
+    std::condition_variable m_jobAvailable;
+    std::deque<Job> m_jobs;
+    std::thread m_thread;
+    bool m_running = false;
+    bool m_stopping = false;
+
+    std::string m_journalDir;
+    CompletionCallback m_callback;
+};
+
+} // namespace softwarecontainer
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "pressuremonitor.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <vector>
+
+namespace softwarecontainer {
+
+namespace {
+
+const char *RESOURCES[] = { "memory", "cpu", "io" };
+
+// The memory.events counters that are reported
+const char *MEMORY_EVENTS[] = { "high", "max", "oom", "oom_kill" };
+
+bool readFromStart(int fd, std::string &content)
+{
+    char buffer[1024];
+    ssize_t bytes = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes < 0) {
+        return false;
+    }
+
+    content.assign(buffer, bytes);
+    return true;
+}
+
+} // namespace
+
+PressureMonitor::PressureMonitor(Glib::RefPtr<Glib::MainContext> context,
+                                 unsigned int stallUs,
+                                 unsigned int windowUs,
+                                 PressureCallback pressureCallback,
+                                 MemoryEventCallback memoryEventCallback) :
+    m_context(context),
+    m_stallUs(stallUs),
+    m_windowUs(windowUs),
+    m_pressureCallback(pressureCallback),
+    m_memoryEventCallback(memoryEventCallback)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd == -1) {
+        log_error() << "Could not create epoll instance, pressure will not be monitored: "
+                    << strerror(errno);
+        return;
+    }
+
+    m_epollConnection = m_context->signal_io().connect(
+        sigc::mem_fun(*this, &PressureMonitor::onEpollReadable), m_epollFd, Glib::IO_IN);
+}
+
+PressureMonitor::~PressureMonitor()
+{
+    m_epollConnection.disconnect();
+
+    for (auto &watch : m_watches) {
+        ::close(watch.first);
+    }
+
+    if (m_epollFd != -1) {
+        ::close(m_epollFd);
+    }
+}
+
+bool PressureMonitor::watchCgroup(int id, const std::string &cgroupPath)
+{
+    bool watched = false;
+    for (const char *resource : RESOURCES) {
+        std::string path = buildPath(cgroupPath, std::string(resource) + ".pressure");
+        if (isFile(path)) {
+            watched |= addPressureWatch(id, resource, path);
+        }
+    }
+
+    std::string eventsPath = buildPath(cgroupPath, "memory.events");
+    if (isFile(eventsPath)) {
+        watched |= addMemoryEventsWatch(id, eventsPath);
+    }
+
+    if (!watched) {
+        log_warning() << "Could not watch pressure or memory events of " << cgroupPath;
+    }
+    return watched;
+}
+
+bool PressureMonitor::watchHost(const std::string &pressureDir)
+{
+    bool watched = false;
+    for (const char *resource : RESOURCES) {
+        std::string path = buildPath(pressureDir, resource);
+        if (isFile(path)) {
+            watched |= addPressureWatch(HOST_ID, resource, path);
+        }
+    }
+
+    if (!watched) {
+        log_warning() << "Could not watch pressure of the host, is PSI enabled in the kernel?";
+    }
+    return watched;
+}
+
+void PressureMonitor::unwatch(int id)
+{
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        if (it->second.id == id) {
+            // Closing the fd removes it from the epoll set
+            ::close(it->first);
+            it = m_watches.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+size_t PressureMonitor::watchedCount() const
+{
+    return m_watches.size();
+}
+
+bool PressureMonitor::addPressureWatch(int id, const std::string &resource, const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        log_warning() << "Could not open " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    // The trigger is kept for as long as the fd is open, the kernel wants the terminating null
+    std::string trigger = "some " + std::to_string(m_stallUs) + " " + std::to_string(m_windowUs);
+    if (write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+        log_warning() << "Could not register pressure trigger \"" << trigger << "\" on "
+                      << path << ": " << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    return addToEpoll(fd, Watch{id, WatchType::Pressure, resource, fd, {}});
+}
+
+bool PressureMonitor::addMemoryEventsWatch(int id, const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        log_warning() << "Could not open " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    // Only increases after this are reported. Reading the file also arms the notification.
+    std::string content;
+    readFromStart(fd, content);
+
+    return addToEpoll(fd, Watch{id, WatchType::MemoryEvents, "memory", fd,
+                                parseMemoryEvents(content)});
+}
+
+bool PressureMonitor::addToEpoll(int fd, Watch watch)
+{
+    // Both PSI triggers and changes of cgroup files are signalled with EPOLLPRI
+    struct epoll_event event = {};
+    event.events = EPOLLPRI;
+    event.data.fd = fd;
+    if (m_epollFd == -1 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        log_warning() << "Could not add " << watch.resource << " watch to epoll set: "
+                      << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    m_watches[fd] = watch;
+    return true;
+}
+
+bool PressureMonitor::onEpollReadable(Glib::IOCondition /*condition*/)
+{
+    static constexpr int MAX_EVENTS = 64;
+    struct epoll_event events[MAX_EVENTS];
+
+    int count;
+    do {
+        count = epoll_wait(m_epollFd, events, MAX_EVENTS, 0);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error() << "Could not wait for pressure events: " << strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            auto it = m_watches.find(events[i].data.fd);
+            if (it == m_watches.end()) {
+                // Unwatched by an earlier callback in the same batch of events
+                continue;
+            }
+
+            if (it->second.type == WatchType::Pressure) {
+                onPressure(it->second);
+            } else {
+                onMemoryEvents(it->second);
+            }
+        }
+    } while (count == MAX_EVENTS || (count == -1 && errno == EINTR));
+
+    return true;
+}
+
+void PressureMonitor::onPressure(Watch &watch)
+{
+    std::string content;
+    double avg10 = 0;
+    if (!readFromStart(watch.fd, content) || !parseSomeAvg10(content, avg10)) {
+        log_warning() << "Could not read " << watch.resource << " pressure of " << watch.id;
+    }
+
+    // The callback may unwatch, which invalidates watch
+    int id = watch.id;
+    std::string resource = watch.resource;
+    log_info() << "Pressure threshold reached for " << resource << " of " << id
+               << ", avg10 " << avg10;
+    if (m_pressureCallback) {
+        m_pressureCallback(id, resource, avg10);
+    }
+}
+
+void PressureMonitor::onMemoryEvents(Watch &watch)
+{
+    std::string content;
+    if (!readFromStart(watch.fd, content)) {
+        log_warning() << "Could not read memory events of " << watch.id;
+        return;
+    }
+
+    std::map<std::string, uint64_t> events = parseMemoryEvents(content);
+    std::vector<std::pair<std::string, uint64_t>> increased;
+    for (const char *name : MEMORY_EVENTS) {
+        auto current = events.find(name);
+        if (current != events.end() && current->second > watch.events[name]) {
+            increased.push_back(*current);
+        }
+    }
+    watch.events = events;
+
+    // The callback may unwatch, which invalidates watch
+    int id = watch.id;
+    for (auto &event : increased) {
+        log_info() << "Memory event " << event.first << " in " << id << ", count " << event.second;
+        if (m_memoryEventCallback) {
+            m_memoryEventCallback(id, event.first, event.second);
+        }
+    }
+}
+
+std::map<std::string, uint64_t> PressureMonitor::parseMemoryEvents(const std::string &content)
+{
+    std::map<std::string, uint64_t> events;
+    std::istringstream lines(content);
+    std::string name;
+    uint64_t value;
+    while (lines >> name >> value) {
+        events[name] = value;
+    }
+    return events;
+}
+
+bool PressureMonitor::parseSomeAvg10(const std::string &content, double &avg10)
+{
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    const std::string prefix = "some avg10=";
+    size_t position = content.find(prefix);
+    if (position == std::string::npos) {
+        return false;
+    }
+
+    const char *start = content.c_str() + position + prefix.size();
+    char *end;
+    avg10 = strtod(start, &end);
+    return end != start;
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <glibmm.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The PressureMonitor class reports pressure stalls and memory events of cgroups and of
+ * the host.
+ *
+ * A PSI trigger is registered on the memory.pressure, cpu.pressure and io.pressure files of every
+ * watched cgroup, and on the files in /proc/pressure for the host. The kernel then wakes the
+ * monitor when tasks have been stalled on the resource for longer than the threshold within the
+ * window. The memory.events file of every cgroup is watched too, and any increase of its high,
+ * max, oom and oom_kill counters is reported.
+ *
+ * All files are kept in a single epoll set, and only the epoll fd is attached to the glib main
+ * loop, the same way as in ProcessMonitor.
+ *
+ * @warning This is not thread safe, it is meant to be used from the thread running the main loop
+ */
+class PressureMonitor
+{
+    LOG_DECLARE_CLASS_CONTEXT("PSMO", "Pressure monitor");
+
+public:
+    /**
+     * @brief The id the host is reported with
+     */
+    static constexpr int HOST_ID = -1;
+
+    static constexpr const char *PROC_PRESSURE_DIR = "/proc/pressure";
+
+    /**
+     * @brief Called with the id of the cgroup, the resource ("memory", "cpu" or "io"), and the
+     * share of the last 10 seconds in which some tasks were stalled on it, in percent
+     */
+    typedef std::function<void (int, const std::string &, double)> PressureCallback;
+
+    /**
+     * @brief Called with the id of the cgroup, the memory.events counter that increased
+     * ("high", "max", "oom" or "oom_kill"), and its new value
+     */
+    typedef std::function<void (int, const std::string &, uint64_t)> MemoryEventCallback;
+
+    /**
+     * @param stallUs Time tasks must have been stalled within a window for a trigger to fire
+     * @param windowUs Length of the window, between 500 ms and 10 s
+     */
+    PressureMonitor(Glib::RefPtr<Glib::MainContext> context,
+                    unsigned int stallUs,
+                    unsigned int windowUs,
+                    PressureCallback pressureCallback,
+                    MemoryEventCallback memoryEventCallback);
+    ~PressureMonitor();
+
+    PressureMonitor(const PressureMonitor &) = delete;
+    PressureMonitor &operator=(const PressureMonitor &) = delete;
+
+    /**
+     * @brief Starts watching the pressure files and memory.events of a cgroup v2 directory
+     *
+     * Files that are missing, e.g. when a controller is not enabled, are not watched.
+     *
+     * @return false if none of the files could be watched
+     */
+    bool watchCgroup(int id, const std::string &cgroupPath);
+
+    /**
+     * @brief Starts watching the pressure of the whole host, which is reported with HOST_ID
+     *
+     * @return false if the kernel does not support PSI or no trigger could be registered
+     */
+    bool watchHost(const std::string &pressureDir = PROC_PRESSURE_DIR);
+
+    /**
+     * @brief Stops watching a cgroup, or the host if id is HOST_ID
+     */
+    void unwatch(int id);
+
+    /**
+     * @brief The number of files currently being watched
+     */
+    size_t watchedCount() const;
+
+    /**
+     * @brief Parses the "key value" lines of memory.events
+     */
+    static std::map<std::string, uint64_t> parseMemoryEvents(const std::string &content);
+
+    /**
+     * @brief Parses the avg10 value of the "some" line of a pressure file
+     *
+     * @return false if the content has no such value
+     */
+    static bool parseSomeAvg10(const std::string &content, double &avg10);
+
+private:
+    enum class WatchType { Pressure, MemoryEvents };
+
+    struct Watch {
+        int id;
+        WatchType type;
+        // The resource of a pressure file
+        std::string resource;
+        int fd;
+        // Counters of a memory.events file, as they were when last read
+        std::map<std::string, uint64_t> events;
+    };
+
+    bool addPressureWatch(int id, const std::string &resource, const std::string &path);
+    bool addMemoryEventsWatch(int id, const std::string &path);
+    bool addToEpoll(int fd, Watch watch);
+
+    bool onEpollReadable(Glib::IOCondition condition);
+    void onPressure(Watch &watch);
+    void onMemoryEvents(Watch &watch);
+
+    Glib::RefPtr<Glib::MainContext> m_context;
+    unsigned int m_stallUs;
+    unsigned int m_windowUs;
+    PressureCallback m_pressureCallback;
+    MemoryEventCallback m_memoryEventCallback;
+
+    int m_epollFd = INVALID_FD;
+    sigc::connection m_epollConnection;
+    // Watches by fd
+    std::unordered_map<int, Watch> m_watches;
+};
+
+} // namespace softwarecontainer
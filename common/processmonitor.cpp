@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "processmonitor.h"
+
+#include <chrono>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+namespace softwarecontainer {
+
+namespace {
+
+int pidfdOpen(pid_t pid)
+{
+    return syscall(SYS_pidfd_open, pid, 0);
+}
+
+uint64_t elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    auto elapsed = std::chrono::steady_clock::now() - since;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+uint64_t toMicroseconds(const struct timeval &time)
+{
+    return static_cast<uint64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+// Reaps the process of a pidfd if it has exited, so it is not left as a zombie when the pidfd
+// is closed without a callback
+void reapIfExited(int pidfd)
+{
+    siginfo_t info = {};
+    waitid(static_cast<idtype_t>(P_PIDFD), pidfd, &info, WEXITED | WNOHANG);
+}
+
+} // namespace
+
+ProcessMonitor::ProcessMonitor(Glib::RefPtr<Glib::MainContext> context) :
+    m_context(context)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd == -1) {
+        log_error() << "Could not create epoll instance, falling back to child watches: "
+                    << strerror(errno);
+        return;
+    }
+
+    m_epollConnection = m_context->signal_io().connect(
+        sigc::mem_fun(*this, &ProcessMonitor::onEpollReadable), m_epollFd, Glib::IO_IN);
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+    m_epollConnection.disconnect();
+
+    for (auto &watch : m_watches) {
+        reapIfExited(watch.second.pidfd);
+        ::close(watch.second.pidfd);
+    }
+
+    for (auto &watch : m_fallbackWatches) {
+        watch.second.disconnect();
+    }
+
+    if (m_epollFd != -1) {
+        ::close(m_epollFd);
+    }
+}
+
+bool ProcessMonitor::watch(pid_t pid, ExitCallback callback)
+{
+    if (m_watches.count(pid) != 0 || m_fallbackWatches.count(pid) != 0) {
+        log_error() << "Process " << pid << " is already watched";
+        return false;
+    }
+
+    int pidfd = m_epollFd == -1 ? -1 : pidfdOpen(pid);
+    if (pidfd == -1 && m_epollFd != -1 && errno != ENOSYS) {
+        log_error() << "Could not open pidfd for process " << pid << ": " << strerror(errno);
+        return false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    if (pidfd == -1) {
+        auto connection = m_context->signal_child_watch().connect([this, callback, started] (GPid pid, int status) {
+            m_fallbackWatches.erase(pid);
+            ProcessUsage usage;
+            usage.runtimeMs = elapsedMs(started);
+            callback(pid, status, usage);
+        }, pid);
+        m_fallbackWatches[pid] = connection;
+        return true;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(pid);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, pidfd, &event) == -1) {
+        log_error() << "Could not add process " << pid << " to epoll set: " << strerror(errno);
+        ::close(pidfd);
+        return false;
+    }
+
+    m_watches[pid] = Watch{pidfd, callback, started};
+    return true;
+}
+
+void ProcessMonitor::unwatch(pid_t pid)
+{
+    auto it = m_watches.find(pid);
+    if (it != m_watches.end()) {
+        // Closing the pidfd removes it from the epoll set
+        reapIfExited(it->second.pidfd);
+        ::close(it->second.pidfd);
+        m_watches.erase(it);
+        return;
+    }
+
+    auto fallback = m_fallbackWatches.find(pid);
+    if (fallback != m_fallbackWatches.end()) {
+        fallback->second.disconnect();
+        m_fallbackWatches.erase(fallback);
+    }
+}
+
+size_t ProcessMonitor::watchedCount() const
+{
+    return m_watches.size() + m_fallbackWatches.size();
+}
+
+bool ProcessMonitor::onEpollReadable(Glib::IOCondition /*condition*/)
+{
+    static constexpr int MAX_EVENTS = 64;
+    struct epoll_event events[MAX_EVENTS];
+
+    int count;
+    do {
+        count = epoll_wait(m_epollFd, events, MAX_EVENTS, 0);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error() << "Could not wait for process events: " << strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            processExited(static_cast<pid_t>(events[i].data.u64));
+        }
+    } while (count == MAX_EVENTS || (count == -1 && errno == EINTR));
+
+    return true;
+}
+
+void ProcessMonitor::processExited(pid_t pid)
+{
+    auto it = m_watches.find(pid);
+    if (it == m_watches.end()) {
+        // Unwatched by an earlier callback in the same batch of events
+        return;
+    }
+
+    int status = 0;
+    struct rusage rusage = {};
+    pid_t ret = wait4(pid, &status, WNOHANG, &rusage);
+    if (ret == 0) {
+        // Not exited yet, keep watching
+        return;
+    }
+
+    if (ret == -1) {
+        log_warning() << "Could not reap process " << pid << ": " << strerror(errno);
+        status = -1;
+    }
+
+    ProcessUsage usage;
+    usage.userTimeUs = toMicroseconds(rusage.ru_utime);
+    usage.systemTimeUs = toMicroseconds(rusage.ru_stime);
+    usage.maxRssKb = rusage.ru_maxrss;
+    usage.majorFaults = rusage.ru_majflt;
+    usage.voluntaryContextSwitches = rusage.ru_nvcsw;
+    usage.involuntaryContextSwitches = rusage.ru_nivcsw;
+    usage.runtimeMs = elapsedMs(it->second.started);
+
+    // Remove the watch before running the callback, so the callback may watch other processes
+    ExitCallback callback = it->second.callback;
+    ::close(it->second.pidfd);
+    m_watches.erase(it);
+
+    callback(pid, status, usage);
+}
+
+} // namespace softwarecontainer
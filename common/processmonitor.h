@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <glibmm.h>
+
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+namespace softwarecontainer {
+
+/**
+ * @brief Resources used by a process during its lifetime, including the children it has waited for
+ */
+struct ProcessUsage
+{
+    uint64_t userTimeUs = 0;
+    uint64_t systemTimeUs = 0;
+    // Peak resident set size
+    uint64_t maxRssKb = 0;
+    uint64_t majorFaults = 0;
+    uint64_t voluntaryContextSwitches = 0;
+    uint64_t involuntaryContextSwitches = 0;
+    // Time from when the monitor started watching the process until it was reaped
+    uint64_t runtimeMs = 0;
+};
+
+/**
+ * @brief The ProcessMonitor class dispatches callbacks when watched processes exit.
+ *
+ * Every watched process is represented by a pidfd, and all pidfds are kept in a single epoll
+ * set. Only the epoll fd is attached to the glib main loop, so the cost of watching a process
+ * does not grow with the number of processes being watched, unlike one glib child watch per
+ * process. Exited processes are reaped by the monitor before their callback is run, and the
+ * resource usage of the process is collected when reaping it.
+ *
+ * On kernels without pidfd support, the monitor falls back to glib child watches. glib reaps the
+ * processes itself in that case, so only the runtime of the process is reported.
+ *
+ * @warning This is not thread safe, it is meant to be used from the thread running the main loop
+ */
+class ProcessMonitor
+{
+    LOG_DECLARE_CLASS_CONTEXT("PRMO", "Process monitor");
+
+public:
+    /**
+     * @brief Called with the pid, the status of the process as returned by waitpid(), and the
+     * resources used by the process. The status is -1 if the process could not be reaped by the
+     * monitor.
+     */
+    typedef std::function<void (pid_t, int, const ProcessUsage &)> ExitCallback;
+
+    ProcessMonitor(Glib::RefPtr<Glib::MainContext> context);
+    ~ProcessMonitor();
+
+    ProcessMonitor(const ProcessMonitor &) = delete;
+    ProcessMonitor &operator=(const ProcessMonitor &) = delete;
+
+    /**
+     * @brief Starts watching a child process of this process
+     *
+     * @return false if the process can not be watched, e.g. if it has already been reaped
+     */
+    bool watch(pid_t pid, ExitCallback callback);
+
+    /**
+     * @brief Stops watching a process, its callback will not be called
+     *
+     * A process that has already exited is reaped. If it is still running, reaping it is left
+     * to the caller.
+     */
+    void unwatch(pid_t pid);
+
+    /**
+     * @brief The number of processes currently being watched
+     */
+    size_t watchedCount() const;
+
+private:
+    bool onEpollReadable(Glib::IOCondition condition);
+    void processExited(pid_t pid);
+
+    struct Watch {
+        int pidfd;
+        ExitCallback callback;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    Glib::RefPtr<Glib::MainContext> m_context;
+    int m_epollFd = INVALID_FD;
+    sigc::connection m_epollConnection;
+    std::unordered_map<pid_t, Watch> m_watches;
+
+    // Child watches used when pidfd is not supported by the kernel
+    std::unordered_map<pid_t, sigc::connection> m_fallbackWatches;
+};
+
+} // namespace softwarecontainer
@@ -18,57 +18,623 @@
  */
 
 #include "recursivecopy.h"
+#include "filedescriptor.h"
+#include "workerpool.h"
 
-#include <ftw.h>
-#include <fstream>
-#include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <vector>
 
-#include <glibmm.h>
+#include <climits>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+#include <unistd.h>
 
 namespace softwarecontainer {
 
-std::string dstRoot;
-std::string srcRoot;
+namespace {
 
-extern "C" int copyFile(const char*, const struct stat, int);
+const std::string OVERLAY_XATTR_PREFIX = "trusted.overlay.";
+const std::string OVERLAY_OPAQUE_XATTR = "trusted.overlay.opaque";
 
-/**
- * @brief copy_file Copy files from src_path to dst_root global path
- *
- * This function is wrapped and hidden in this separate code unit because of it's side effects
- * and used by the RecursiveCopy::copy() function.
- * @param src_path The path of the file to copy
- * @param sb not used in this function
- * @param typeflag Points to what type of node is traversed by ftw().
- * @sideeffect Uses the global variables dst_root and src_root to know the root directories
- * being copied to and from. These must not be changed while ftw is running or the function will
- * misbehave.
- * @return always 0 for now.
+const std::string TEMPORARY_FILE_PREFIX = ".sc-sync.";
+
+constexpr size_t COPY_CHUNK_SIZE = 1024 * 1024;
+
+/*
+ * Overlayfs marks a deleted lower entry with a character device with device number 0/0
+ */
+bool isWhiteout(const struct stat &st)
+{
+    return S_ISCHR(st.st_mode) && st.st_rdev == makedev(0, 0);
+}
+
+/*
+ * Names of the entries in a directory, except '.' and '..'
  */
-int copyFile(const char* srcPath, const struct stat* sb, int typeflag)
+bool listDirectory(int dirFd, std::vector<std::string> &names)
 {
-    std::string dstPath;
-    std::string src(srcPath);
+    int fd = ::dup(dirFd);
+    if (fd == INVALID_FD) {
+        return false;
+    }
 
-    if (src.find(srcRoot) != std::string::npos) {
-        dstPath = buildPath(dstRoot, src.erase(0, srcRoot.length()));
-    } else {
-        dstPath = buildPath(dstRoot, src);
+    DIR *dir = ::fdopendir(fd);
+    if (nullptr == dir) {
+        ::close(fd);
+        return false;
     }
 
-    switch(typeflag) {
-    case FTW_D:
-        mkdir(dstPath.c_str(), sb->st_mode);
-        break;
-    case FTW_F:
-        std::ifstream src(srcPath, std::ios::binary);
-        std::ofstream dst(dstPath, std::ios::binary);
-        dst << src.rdbuf();
+    ::rewinddir(dir);
+    struct dirent *entry;
+    while ((entry = ::readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        if (name != "." && name != "..") {
+            names.push_back(name);
+        }
     }
-    return 0;
+
+    ::closedir(dir);
+    return true;
 }
 
+/*
+ * State of one RecursiveCopy::copy() call. The directory walk runs on the calling thread
+ * while regular files are copied on the worker pool shared by all copies. Directory metadata
+ * is applied after all files of this copy are copied, deepest directory first, so that
+ * restrictive permissions or timestamps are not disturbed by the files created inside them.
+ */
+class CopyJob
+{
+    LOG_DECLARE_CLASS_CONTEXT("RECO", "Recursive Copy");
+
+public:
+    CopyJob(const std::string &src, const std::string &dst, WorkerPool &pool) :
+        m_src(src),
+        m_dst(dst),
+        m_success(true),
+        m_pool(pool)
+    {
+    }
+
+    ~CopyJob()
+    {
+        // No task may outlive the members it uses
+        waitForTasks();
+    }
+
+    bool run()
+    {
+        FileDescriptor srcFd(::open(m_src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!srcFd.isValid()) {
+            log_error() << "Could not open " << m_src << ": " << strerror(errno);
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(srcFd.get(), &st) == 0 && ::mkdir(m_dst.c_str(), st.st_mode & 07777) != 0
+            && errno != EEXIST) {
+            log_error() << "Could not create " << m_dst << ": " << strerror(errno);
+            return false;
+        }
+
+        FileDescriptor dstFd(::open(m_dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!dstFd.isValid()) {
+            log_error() << "Could not open " << m_dst << ": " << strerror(errno);
+            return false;
+        }
+
+        copyDirectoryContents(srcFd.get(), dstFd.get(), m_src, m_dst);
+        waitForTasks();
+
+        for (auto it = m_directories.rbegin(); it != m_directories.rend(); ++it) {
+            applyDirectoryMetadata(*it);
+        }
+
+        return m_success;
+    }
+
+private:
+    /*
+     * The pool is shared with other copies, so the tasks of this copy are counted to know when
+     * they are done, rather than waiting for the whole pool to become idle
+     */
+    void submit(WorkerPool::Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_tasksLock);
+            m_pendingTasks++;
+        }
+
+        m_pool.submit([this, task] () {
+            struct Done {
+                CopyJob *job;
+                ~Done() { job->taskDone(); }
+            } done{this};
+            task();
+        });
+    }
+
+    void taskDone()
+    {
+        std::lock_guard<std::mutex> lock(m_tasksLock);
+        if (--m_pendingTasks == 0) {
+            m_tasksDone.notify_all();
+        }
+    }
+
+    void waitForTasks()
+    {
+        std::unique_lock<std::mutex> lock(m_tasksLock);
+        m_tasksDone.wait(lock, [this] () {
+            return m_pendingTasks == 0;
+        });
+    }
+
+    struct PendingDirectory
+    {
+        std::string srcPath;
+        std::string dstPath;
+        struct stat st;
+    };
+
+    void fail()
+    {
+        m_success = false;
+    }
+
+    void copyDirectoryContents(int srcDirFd,
+                               int dstDirFd,
+                               const std::string &srcPath,
+                               const std::string &dstPath)
+    {
+        std::vector<std::string> names;
+        if (!listDirectory(srcDirFd, names)) {
+            log_error() << "Could not read directory " << srcPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        for (const std::string &name : names) {
+            copyEntry(srcDirFd, dstDirFd, name, buildPath(srcPath, name), buildPath(dstPath, name));
+        }
+    }
+
+    void copyEntry(int srcDirFd,
+                   int dstDirFd,
+                   const std::string &name,
+                   const std::string &srcPath,
+                   const std::string &dstPath)
+    {
+        struct stat st;
+        if (::fstatat(srcDirFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            log_error() << "Could not stat " << srcPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        if (isWhiteout(st)) {
+            log_debug() << "Whiteout found, removing " << dstPath;
+            if (!removeAt(dstDirFd, name, dstPath)) {
+                fail();
+            }
+            return;
+        }
+
+        struct stat dstSt;
+        bool dstExists = ::fstatat(dstDirFd, name.c_str(), &dstSt, AT_SYMLINK_NOFOLLOW) == 0;
+
+        if (S_ISDIR(st.st_mode)) {
+            if (dstExists && !S_ISDIR(dstSt.st_mode) && !removeAt(dstDirFd, name, dstPath)) {
+                fail();
+                return;
+            }
+            copyDirectory(srcDirFd, dstDirFd, name, srcPath, dstPath, st);
+            return;
+        }
+
+        // Everything else replaces whatever is at the destination, except that regular files
+        // are renamed over any existing non-directory.
+        if (dstExists && (!S_ISREG(st.st_mode) || S_ISDIR(dstSt.st_mode))
+            && !removeAt(dstDirFd, name, dstPath)) {
+            fail();
+            return;
+        }
+
+        if (S_ISREG(st.st_mode)) {
+            submit([this, name, srcPath, dstPath, st] () {
+                if (!copyRegularFile(name, srcPath, dstPath, st)) {
+                    fail();
+                }
+            });
+        } else if (S_ISLNK(st.st_mode)) {
+            if (!copySymlink(srcDirFd, dstDirFd, name, dstPath, st)) {
+                fail();
+            }
+        } else {
+            if (!copySpecialFile(dstDirFd, name, dstPath, st)) {
+                fail();
+            }
+        }
+    }
+
+    void copyDirectory(int srcDirFd,
+                       int dstDirFd,
+                       const std::string &name,
+                       const std::string &srcPath,
+                       const std::string &dstPath,
+                       const struct stat &st)
+    {
+        FileDescriptor srcFd(::openat(srcDirFd, name.c_str(),
+                                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!srcFd.isValid()) {
+            log_error() << "Could not open " << srcPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        // Keep the directory private until its real permissions are applied at the end
+        if (::mkdirat(dstDirFd, name.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+            log_error() << "Could not create directory " << dstPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        FileDescriptor dstFd(::openat(dstDirFd, name.c_str(),
+                                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!dstFd.isValid()) {
+            log_error() << "Could not open " << dstPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        if (isOpaque(srcFd.get())) {
+            log_debug() << "Opaque directory found, clearing " << dstPath;
+            if (!clearDirectory(dstFd.get(), dstPath)) {
+                fail();
+            }
+        }
+
+        m_directories.push_back(PendingDirectory{srcPath, dstPath, st});
+        copyDirectoryContents(srcFd.get(), dstFd.get(), srcPath, dstPath);
+    }
+
+    /*
+     * The data is written to a temporary file next to the destination which is then renamed
+     * over it, so that the destination never holds a partially copied file, e.g. if the copy is
+     * interrupted by a crash.
+     */
+    bool copyRegularFile(const std::string &name,
+                         const std::string &srcPath,
+                         const std::string &dstPath,
+                         const struct stat &st)
+    {
+        FileDescriptor srcFd(::open(srcPath.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+        if (!srcFd.isValid()) {
+            log_error() << "Could not open " << srcPath << ": " << strerror(errno);
+            return false;
+        }
+
+        std::string tmpPath = temporaryPath(dstPath, name);
+        FileDescriptor dstFd(::open(tmpPath.c_str(),
+                                    O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                                    S_IRUSR | S_IWUSR));
+        if (!dstFd.isValid()) {
+            log_error() << "Could not open " << tmpPath << ": " << strerror(errno);
+            return false;
+        }
+
+        bool success = copyData(srcFd.get(), dstFd.get(), dstPath);
+        if (success) {
+            copyXattrs(srcFd.get(), dstFd.get(), dstPath);
+            success = applyMetadata(dstFd.get(), st, dstPath);
+        }
+
+        if (success && tmpPath != dstPath && ::rename(tmpPath.c_str(), dstPath.c_str()) != 0) {
+            log_error() << "Could not rename " << tmpPath << " to " << dstPath << ": "
+                        << strerror(errno);
+            success = false;
+        }
+
+        if (!success && tmpPath != dstPath) {
+            ::unlink(tmpPath.c_str());
+        }
+
+        return success;
+    }
+
+    /*
+     * Path of the temporary file used while copying to path. Falls back to writing path in
+     * place when the name would become too long.
+     */
+    std::string temporaryPath(const std::string &path, const std::string &name)
+    {
+        if (TEMPORARY_FILE_PREFIX.size() + name.size() > NAME_MAX) {
+            return path;
+        }
+        return path.substr(0, path.size() - name.size()) + TEMPORARY_FILE_PREFIX + name;
+    }
+
+    bool copyData(int srcFd, int dstFd, const std::string &dstPath)
+    {
+#ifdef FICLONE
+        // Shares the data blocks on filesystems with reflink support, e.g. btrfs and xfs
+        if (::ioctl(dstFd, FICLONE, srcFd) == 0) {
+            return true;
+        }
+#endif
+
+#ifdef __NR_copy_file_range
+        // Lets the kernel copy the data without passing it through user space. Anything
+        // that is left when it is not supported for these files is copied below.
+        while (true) {
+            ssize_t copied = ::syscall(__NR_copy_file_range, srcFd, nullptr, dstFd, nullptr,
+                                       COPY_CHUNK_SIZE, 0);
+            if (copied > 0) {
+                continue;
+            }
+            if (copied == 0) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP) {
+                log_error() << "Could not copy data to " << dstPath << ": " << strerror(errno);
+                return false;
+            }
+            break;
+        }
+#endif
+
+        std::vector<char> buffer(COPY_CHUNK_SIZE);
+        while (true) {
+            ssize_t bytesRead = ::read(srcFd, buffer.data(), buffer.size());
+            if (bytesRead == 0) {
+                return true;
+            }
+            if (bytesRead < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log_error() << "Could not read data for " << dstPath << ": " << strerror(errno);
+                return false;
+            }
+
+            ssize_t offset = 0;
+            while (offset < bytesRead) {
+                ssize_t written = ::write(dstFd, buffer.data() + offset, bytesRead - offset);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    log_error() << "Could not write to " << dstPath << ": " << strerror(errno);
+                    return false;
+                }
+                offset += written;
+            }
+        }
+    }
+
+    bool copySymlink(int srcDirFd,
+                     int dstDirFd,
+                     const std::string &name,
+                     const std::string &dstPath,
+                     const struct stat &st)
+    {
+        std::vector<char> target(st.st_size + 1);
+        ssize_t length = ::readlinkat(srcDirFd, name.c_str(), target.data(), target.size());
+        if (length < 0 || static_cast<size_t>(length) >= target.size()) {
+            log_error() << "Could not read link " << dstPath << ": " << strerror(errno);
+            return false;
+        }
+        target[length] = '\0';
+
+        if (::symlinkat(target.data(), dstDirFd, name.c_str()) != 0) {
+            log_error() << "Could not create link " << dstPath << ": " << strerror(errno);
+            return false;
+        }
+
+        return applyMetadataAt(dstDirFd, name, st, dstPath);
+    }
+
+    bool copySpecialFile(int dstDirFd,
+                         const std::string &name,
+                         const std::string &dstPath,
+                         const struct stat &st)
+    {
+        if (::mknodat(dstDirFd, name.c_str(), st.st_mode, st.st_rdev) != 0) {
+            log_error() << "Could not create " << dstPath << ": " << strerror(errno);
+            return false;
+        }
+
+        if (!applyMetadataAt(dstDirFd, name, st, dstPath)) {
+            return false;
+        }
+
+        // Ownership changes may have cleared setuid/setgid bits
+        if (::fchmodat(dstDirFd, name.c_str(), st.st_mode & 07777, 0) != 0) {
+            log_error() << "Could not set mode on " << dstPath << ": " << strerror(errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    void applyDirectoryMetadata(const PendingDirectory &dir)
+    {
+        FileDescriptor srcFd(::open(dir.srcPath.c_str(),
+                                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        FileDescriptor dstFd(::open(dir.dstPath.c_str(),
+                                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!srcFd.isValid() || !dstFd.isValid()) {
+            log_error() << "Could not open " << dir.dstPath << ": " << strerror(errno);
+            fail();
+            return;
+        }
+
+        copyXattrs(srcFd.get(), dstFd.get(), dir.dstPath);
+        if (!applyMetadata(dstFd.get(), dir.st, dir.dstPath)) {
+            fail();
+        }
+    }
+
+    /*
+     * Sets ownership, mode and timestamps from st on an open file. Failing to change the
+     * owner is only logged, since that is expected when not running as root.
+     */
+    bool applyMetadata(int fd, const struct stat &st, const std::string &path)
+    {
+        if (::fchown(fd, st.st_uid, st.st_gid) != 0) {
+            log_debug() << "Could not set owner on " << path << ": " << strerror(errno);
+        }
+
+        if (::fchmod(fd, st.st_mode & 07777) != 0) {
+            log_error() << "Could not set mode on " << path << ": " << strerror(errno);
+            return false;
+        }
+
+        const struct timespec times[2] = { st.st_atim, st.st_mtim };
+        if (::futimens(fd, times) != 0) {
+            log_error() << "Could not set times on " << path << ": " << strerror(errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+     * Same as applyMetadata, but for entries that can not be opened, i.e. symlinks and
+     * special files. The mode of a symlink can not be changed so it is not touched here.
+     */
+    bool applyMetadataAt(int dirFd,
+                         const std::string &name,
+                         const struct stat &st,
+                         const std::string &path)
+    {
+        if (::fchownat(dirFd, name.c_str(), st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW) != 0) {
+            log_debug() << "Could not set owner on " << path << ": " << strerror(errno);
+        }
+
+        const struct timespec times[2] = { st.st_atim, st.st_mtim };
+        if (::utimensat(dirFd, name.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0) {
+            log_error() << "Could not set times on " << path << ": " << strerror(errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+     * Copies all extended attributes except the ones private to overlayfs. Failures are
+     * only logged since the destination filesystem may lack support for some namespaces.
+     */
+    void copyXattrs(int srcFd, int dstFd, const std::string &dstPath)
+    {
+        ssize_t size = ::flistxattr(srcFd, nullptr, 0);
+        if (size <= 0) {
+            return;
+        }
+
+        std::vector<char> names(size);
+        size = ::flistxattr(srcFd, names.data(), names.size());
+        if (size <= 0) {
+            return;
+        }
+
+        for (ssize_t offset = 0; offset < size; offset += strlen(&names[offset]) + 1) {
+            std::string name(&names[offset]);
+            if (name.compare(0, OVERLAY_XATTR_PREFIX.size(), OVERLAY_XATTR_PREFIX) == 0) {
+                continue;
+            }
+
+            ssize_t valueSize = ::fgetxattr(srcFd, name.c_str(), nullptr, 0);
+            if (valueSize < 0) {
+                continue;
+            }
+
+            std::vector<char> value(valueSize);
+            valueSize = ::fgetxattr(srcFd, name.c_str(), value.data(), value.size());
+            if (valueSize < 0
+                || ::fsetxattr(dstFd, name.c_str(), value.data(), valueSize, 0) != 0) {
+                log_warning() << "Could not copy attribute " << name << " to " << dstPath
+                              << ": " << strerror(errno);
+            }
+        }
+    }
+
+    bool isOpaque(int dirFd)
+    {
+        char value = 0;
+        ssize_t size = ::fgetxattr(dirFd, OVERLAY_OPAQUE_XATTR.c_str(), &value, sizeof(value));
+        return size == 1 && value == 'y';
+    }
+
+    /*
+     * Removes a directory entry, recursively if it is a directory. An entry that does not
+     * exist is not an error.
+     */
+    bool removeAt(int dirFd, const std::string &name, const std::string &path)
+    {
+        struct stat st;
+        if (::fstatat(dirFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return errno == ENOENT;
+        }
+
+        int flags = 0;
+        if (S_ISDIR(st.st_mode)) {
+            FileDescriptor fd(::openat(dirFd, name.c_str(),
+                                       O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+            if (!fd.isValid() || !clearDirectory(fd.get(), path)) {
+                return false;
+            }
+            flags = AT_REMOVEDIR;
+        }
+
+        if (::unlinkat(dirFd, name.c_str(), flags) != 0 && errno != ENOENT) {
+            log_error() << "Could not remove " << path << ": " << strerror(errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool clearDirectory(int dirFd, const std::string &path)
+    {
+        std::vector<std::string> names;
+        if (!listDirectory(dirFd, names)) {
+            log_error() << "Could not read directory " << path << ": " << strerror(errno);
+            return false;
+        }
+
+        bool success = true;
+        for (const std::string &name : names) {
+            success &= removeAt(dirFd, name, buildPath(path, name));
+        }
+        return success;
+    }
+
+    std::string m_src;
+    std::string m_dst;
+    std::atomic<bool> m_success;
+    std::vector<PendingDirectory> m_directories;
+
+    WorkerPool &m_pool;
+    std::mutex m_tasksLock;
+    std::condition_variable m_tasksDone;
+    size_t m_pendingTasks = 0;
+};
+
+} // namespace
+
 RecursiveCopy &RecursiveCopy::getInstance()
 {
     static RecursiveCopy instance;
@@ -77,20 +643,20 @@ RecursiveCopy &RecursiveCopy::getInstance()
 
 bool RecursiveCopy::copy(std::string src, std::string dst)
 {
-    bool retval = true;
-    m_copyLock.lock();
-    dstRoot.assign(dst);
-    srcRoot.assign(src);
-    if (ftw(src.c_str(), copyFile, 20) != 0) {
+    CopyJob job(src, dst, *m_pool);
+    if (!job.run()) {
         log_error() << "Failed to recursively copy " << src << " to " << dst;
-        retval = false;
+        return false;
     }
-    m_copyLock.unlock();
 
-    return retval;
+    return true;
+}
+
+RecursiveCopy::RecursiveCopy() :
+    m_pool(new WorkerPool(WorkerPool::defaultThreadCount()))
+{
 }
 
-RecursiveCopy::RecursiveCopy() {}
 RecursiveCopy::~RecursiveCopy() {}
 
 } // namespace softwarecontainer
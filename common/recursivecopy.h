@@ -20,11 +20,29 @@
 #pragma once
 #include "softwarecontainer-common.h"
 
+#include <memory>
+
 namespace softwarecontainer {
 
+class WorkerPool;
+
 /**
  * @brief The RecursiveCopy class is a singleton class used to copy files recursively from a
  * source to a destination.
+ *
+ * The copy is meant for syncing an overlayfs upper directory down to its destination, so
+ * besides file data it also carries over permissions, ownership, timestamps, extended
+ * attributes, symlinks and special files. Overlayfs whiteouts (character devices with
+ * device number 0/0) remove the corresponding entry in the destination, and opaque
+ * directories replace the contents of the corresponding destination directory. The
+ * overlayfs private "trusted.overlay.*" attributes are never copied.
+ *
+ * File data is copied with a reflink where the filesystem supports it, otherwise with
+ * copy_file_range(2), and regular files are copied in parallel on a bounded WorkerPool. Each
+ * file is written to a temporary file that is then renamed over the destination, so an
+ * interrupted copy never leaves a partially written file behind.
+ * Any number of copies can run concurrently. They share one WorkerPool, so the number of
+ * copying threads stays the same however many copies run at once.
  */
 class RecursiveCopy {
     LOG_DECLARE_CLASS_CONTEXT("RECO", "Recursive Copy");
@@ -45,11 +63,14 @@ public:
     /**
      * @brief copy Copy files from src to dst
      *
-     * The function is protected by a mutex because it uses some non thread-safe C functions.
+     * The copy continues past entries that fail to copy, so that as much as possible is
+     * copied, but the failure is reported in the return value. The metadata of dst itself is
+     * left untouched.
+     *
      * @param src The source path to copy from
-     * @param dst The destination path to copy to
+     * @param dst The destination path to copy to, created if it does not exist
      * @return true on success
-     * @return false on failure
+     * @return false if any part of the copy failed
      */
     bool copy(std::string src, std::string dst);
 
@@ -57,10 +78,7 @@ private:
     RecursiveCopy();
     ~RecursiveCopy();
 
-    /**
-     * @brief m_copyLock lock used to protect global variables in the copy() method.
-     */
-    std::mutex m_copyLock;
+    std::unique_ptr<WorkerPool> m_pool;
 };
 
 } // namespace softwarecontainer
@@ -18,35 +18,315 @@
  */
 
 #include "recursivedelete.h"
+#include "filedescriptor.h"
+#include "workerpool.h"
 
-#include <ftw.h>
-#include <fstream>
-#include <iostream>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
-#include <glibmm.h>
+#include <climits>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mntent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace softwarecontainer {
 
-extern "C" int deleteFile(const char*, const struct stat, int, struct FTW *ftwbuf);
+namespace {
 
-/**
- * @brief deleteFile Delete files from the directory
- *
- * @param deletePath The path of the file to delete
- * @param sb not used in this function
- * @param typeflag Points to what type of node is traversed by ftw().
- * @return always 0 for now.
+/*
+ * Every queued directory task keeps its parent directory open, so the queue is kept short
+ * to bound the number of open file descriptors.
  */
-int deleteFile(const char* deletePath, const struct stat* sb, int typeflag, struct FTW *ftwbuf)
+constexpr size_t MAX_QUEUED_DIRECTORIES = 256;
+
+/*
+ * A directory being emptied. It keeps its parent alive, so that it can be removed through the
+ * file descriptor of the parent once everything below it has been removed.
+ */
+struct Directory
 {
-    (void)sb;
-    (void)typeflag;
-    (void)ftwbuf;
+    Directory(const std::shared_ptr<Directory> &parent,
+              const std::string &name,
+              const std::string &path,
+              int fd) :
+        parent(parent),
+        name(name),
+        path(path),
+        fd(fd),
+        pending(1)
+    {
+    }
 
-    remove(deletePath);
-    return 0;
-}
+    std::shared_ptr<Directory> parent;
+    std::string name;
+    std::string path;
+    FileDescriptor fd;
+    // The listing of the directory itself, and each subdirectory that is not done yet
+    std::atomic<unsigned int> pending;
+};
+
+typedef std::shared_ptr<Directory> SharedDirectory;
+
+/*
+ * State of one RecursiveDelete::del() call. Non-directories are unlinked as soon as they are
+ * found, and every subdirectory is emptied in its own task on the worker pool. A directory is
+ * removed by the task that finishes the last thing below it, so directories are removed
+ * deepest first without keeping all of them open until the end.
+ */
+class DeleteJob
+{
+    LOG_DECLARE_CLASS_CONTEXT("REDE", "Recursive Delete");
+
+public:
+    DeleteJob(const std::string &path) :
+        m_path(path),
+        m_success(true),
+        m_pool(WorkerPool::defaultThreadCount(), MAX_QUEUED_DIRECTORIES)
+    {
+    }
+
+    bool run()
+    {
+        struct stat st;
+        if (::lstat(m_path.c_str(), &st) != 0) {
+            fail(errno, "Could not stat " + m_path);
+            return false;
+        }
+
+        if (!S_ISDIR(st.st_mode)) {
+            if (::unlink(m_path.c_str()) != 0) {
+                fail(errno, "Could not remove " + m_path);
+            }
+            return finish();
+        }
+
+        char resolved[PATH_MAX];
+        if (nullptr != ::realpath(m_path.c_str(), resolved)) {
+            m_path = resolved;
+        }
+        while (m_path.size() > 1 && m_path.back() == '/') {
+            m_path.pop_back();
+        }
+        m_device = st.st_dev;
+        readMountPoints();
+
+        size_t separator = m_path.rfind('/');
+        std::string parentPath = separator == std::string::npos ? "."
+                                 : separator == 0 ? "/" : m_path.substr(0, separator);
+        std::string name = m_path.substr(separator == std::string::npos ? 0 : separator + 1);
+        FileDescriptor parentFd(::open(parentPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!parentFd.isValid()) {
+            fail(errno, "Could not open " + parentPath);
+            return finish();
+        }
+
+        SharedDirectory root = std::make_shared<Directory>(
+            nullptr, name, m_path,
+            ::openat(parentFd.get(), name.c_str(),
+                     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!root->fd.isValid()) {
+            fail(errno, "Could not open " + m_path);
+            return finish();
+        }
+
+        clearDirectory(root);
+        m_pool.waitForIdle();
+        root.reset();
+
+        if (::unlinkat(parentFd.get(), name.c_str(), AT_REMOVEDIR) != 0) {
+            fail(errno, "Could not remove " + m_path);
+        }
+
+        return finish();
+    }
+
+private:
+    void fail(int error, const std::string &message)
+    {
+        log_error() << message << ": " << strerror(error);
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_success) {
+            m_firstError = error;
+        }
+        m_success = false;
+    }
+
+    /*
+     * Leaves errno set to the first error, for callers that report it
+     */
+    bool finish()
+    {
+        if (!m_success) {
+            errno = m_firstError;
+        }
+        return m_success;
+    }
+
+    /*
+     * Mount points below the deleted directory. Bind mounts of the same filesystem have the
+     * same device number as their parent, so they can only be found through the mount table.
+     */
+    void readMountPoints()
+    {
+        FILE *mountsFile = ::setmntent("/proc/self/mounts", "r");
+        if (nullptr == mountsFile) {
+            log_warning() << "Could not read mount table: " << strerror(errno);
+            return;
+        }
+
+        std::string prefix = m_path + "/";
+        struct mntent *entry;
+        while ((entry = ::getmntent(mountsFile)) != nullptr) {
+            std::string mountPoint(entry->mnt_dir);
+            if (mountPoint.compare(0, prefix.size(), prefix) == 0) {
+                m_mountPoints.insert(mountPoint);
+            }
+        }
+
+        ::endmntent(mountsFile);
+    }
+
+    void clearDirectory(const SharedDirectory &directory)
+    {
+        std::vector<std::string> directories;
+        std::vector<std::string> others;
+        if (listDirectory(directory->fd.get(), directory->path, directories, others)) {
+            for (const std::string &name : others) {
+                if (::unlinkat(directory->fd.get(), name.c_str(), 0) != 0 && errno != ENOENT) {
+                    fail(errno, "Could not remove " + buildPath(directory->path, name));
+                }
+            }
+
+            for (const std::string &name : directories) {
+                directory->pending++;
+                m_pool.submit([this, directory, name] () {
+                    clearSubdirectory(directory, name);
+                });
+            }
+        }
+
+        done(directory);
+    }
+
+    void clearSubdirectory(const SharedDirectory &parent, const std::string &name)
+    {
+        std::string path = buildPath(parent->path, name);
+        if (m_mountPoints.count(path) > 0) {
+            fail(EBUSY, "Refusing to delete mount point " + path);
+            done(parent);
+            return;
+        }
+
+        SharedDirectory directory = std::make_shared<Directory>(
+            parent, name, path,
+            ::openat(parent->fd.get(), name.c_str(),
+                     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!directory->fd.isValid()) {
+            if (errno != ENOENT) {
+                fail(errno, "Could not open " + path);
+            }
+            done(parent);
+            return;
+        }
+
+        struct stat st;
+        if (::fstat(directory->fd.get(), &st) != 0) {
+            fail(errno, "Could not stat " + path);
+            done(parent);
+            return;
+        }
+
+        if (st.st_dev != m_device) {
+            fail(EXDEV, "Refusing to delete " + path + " on another device");
+            done(parent);
+            return;
+        }
+
+        clearDirectory(directory);
+    }
+
+    /*
+     * Called when the listing of a directory or one of its subdirectories is done. The last
+     * call removes the directory from its parent, which is then done with it in turn. The
+     * directory given to run() has no parent here, it is removed by run().
+     */
+    void done(const SharedDirectory &directory)
+    {
+        if (--directory->pending > 0 || !directory->parent) {
+            return;
+        }
+
+        const SharedDirectory &parent = directory->parent;
+        if (::unlinkat(parent->fd.get(), directory->name.c_str(), AT_REMOVEDIR) != 0
+            && errno != ENOENT) {
+            fail(errno, "Could not remove " + directory->path);
+        }
+        done(parent);
+    }
+
+    /*
+     * Splits the entries of a directory into subdirectories and everything else. The
+     * directory is read completely before anything in it is removed.
+     */
+    bool listDirectory(int dirFd,
+                       const std::string &path,
+                       std::vector<std::string> &directories,
+                       std::vector<std::string> &others)
+    {
+        int fd = ::dup(dirFd);
+        DIR *dir = (fd == INVALID_FD) ? nullptr : ::fdopendir(fd);
+        if (nullptr == dir) {
+            fail(errno, "Could not read directory " + path);
+            if (fd != INVALID_FD) {
+                ::close(fd);
+            }
+            return false;
+        }
+
+        struct dirent *entry;
+        while ((entry = ::readdir(dir)) != nullptr) {
+            std::string name(entry->d_name);
+            if (name == "." || name == "..") {
+                continue;
+            }
+
+            bool isDirectory = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat st;
+                isDirectory = ::fstatat(dirFd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+                              && S_ISDIR(st.st_mode);
+            }
+
+            if (isDirectory) {
+                directories.push_back(name);
+            } else {
+                others.push_back(name);
+            }
+        }
+
+        ::closedir(dir);
+        return true;
+    }
+
+    std::string m_path;
+    dev_t m_device = 0;
+    std::unordered_set<std::string> m_mountPoints;
+
+    std::mutex m_lock;
+    std::atomic<bool> m_success;
+    int m_firstError = 0;
+    // Last, so that no task can outlive the members it uses
+    WorkerPool m_pool;
+};
+
+} // namespace
 
 RecursiveDelete &RecursiveDelete::getInstance()
 {
@@ -56,13 +336,15 @@ RecursiveDelete &RecursiveDelete::getInstance()
 
 bool RecursiveDelete::del(std::string dir)
 {
-    bool retval = true;
-    if (nftw(dir.c_str(), deleteFile, 20, FTW_DEPTH) != 0) {
+    DeleteJob job(dir);
+    if (!job.run()) {
+        int error = errno;
         log_error() << "Failed to recursively delete " << dir;
-        retval = false;
+        errno = error;
+        return false;
     }
 
-    return retval;
+    return true;
 }
 
 RecursiveDelete::RecursiveDelete() {}
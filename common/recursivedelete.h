@@ -25,6 +25,13 @@ namespace softwarecontainer {
 /**
  * @brief The RecursiveDelete class is a singleton class used to delete files recursively in a
  * directory.
+ *
+ * The tree is walked with directory file descriptors (openat(2)/unlinkat(2)), so entries are
+ * never looked up by their full path, and symlinks are removed rather than followed.
+ * Subdirectories are emptied in parallel on a bounded WorkerPool. The delete never crosses
+ * into another mount: mount points and directories on another device below the deleted
+ * directory are left untouched and reported as errors.
+ * The class keeps no state between calls, so any number of deletes can run concurrently.
  */
 class RecursiveDelete {
     LOG_DECLARE_CLASS_CONTEXT("RECO", "Recursive Delete");
@@ -43,11 +50,15 @@ public:
 
 
     /**
-     * @brief delete Delete files from directory
+     * @brief delete Delete a directory and everything in it
+     *
+     * The delete continues past entries that can not be removed, so that as much as possible
+     * is removed, but the failure is reported in the return value and errno is set to the
+     * first error encountered.
      *
-     * @param dir The source path to deletefrom
+     * @param dir The path to delete
      * @return true on success
-     * @return false on failure
+     * @return false if dir or anything in it could not be removed
      */
     bool del(std::string dir);
 
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "resourcesampler.h"
+#include "filedescriptor.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+
+namespace softwarecontainer {
+
+namespace {
+
+// memory.stat is the largest file read, about 1.5 kB on current kernels
+static constexpr size_t READ_BUFFER_SIZE = 8192;
+
+uint64_t clockNs(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Reads a whole control file from the start. Returns the number of bytes read, the data is
+ * always null terminated.
+ */
+size_t readFile(const FileDescriptor &file, char *buffer)
+{
+    if (!file.isValid()) {
+        return 0;
+    }
+
+    ssize_t bytes = pread(file.get(), buffer, READ_BUFFER_SIZE - 1, 0);
+    if (bytes < 0) {
+        bytes = 0;
+    }
+    buffer[bytes] = '\0';
+    return bytes;
+}
+
+struct Field
+{
+    const char *key;
+    uint64_t *value;
+};
+
+/*
+ * Parses "key value" lines of flat keyed files like cpu.stat and memory.stat, and
+ * "device key=value ..." lines of nested keyed files like io.stat. The value of a key that
+ * appears on several lines, i.e. for several devices, is the sum of them.
+ */
+template<size_t N>
+void parseKeyed(const char *data, const Field (&fields)[N])
+{
+    for (auto &field : fields) {
+        *field.value = 0;
+    }
+
+    const char *position = data;
+    while (*position != '\0') {
+        // Find the next token
+        while (*position == ' ' || *position == '\n') {
+            position++;
+        }
+        const char *keyStart = position;
+        while (*position != '\0' && *position != ' ' && *position != '=' && *position != '\n') {
+            position++;
+        }
+        size_t keyLength = position - keyStart;
+        if (keyLength == 0) {
+            if (*position != '\0') {
+                position++;
+            }
+            continue;
+        }
+
+        // The value follows a '=' in nested keyed files, and a ' ' in flat keyed files. In a
+        // nested keyed file, the device at the start of the line is followed by a ' ' too,
+        // but does not match any field.
+        if (*position != '=' && *position != ' ') {
+            continue;
+        }
+        position++;
+
+        for (auto &field : fields) {
+            if (strlen(field.key) == keyLength && strncmp(field.key, keyStart, keyLength) == 0) {
+                char *end;
+                *field.value += strtoull(position, &end, 10);
+                position = end;
+                break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+struct ResourceSampler::Cgroup
+{
+    Cgroup(const std::string &path, size_t historySize) :
+        memoryCurrent(openat(AT_FDCWD, (path + "/memory.current").c_str(), O_RDONLY | O_CLOEXEC)),
+        memoryStat(openat(AT_FDCWD, (path + "/memory.stat").c_str(), O_RDONLY | O_CLOEXEC)),
+        cpuStat(openat(AT_FDCWD, (path + "/cpu.stat").c_str(), O_RDONLY | O_CLOEXEC)),
+        ioStat(openat(AT_FDCWD, (path + "/io.stat").c_str(), O_RDONLY | O_CLOEXEC)),
+        samples(historySize)
+    {
+    }
+
+    FileDescriptor memoryCurrent;
+    FileDescriptor memoryStat;
+    FileDescriptor cpuStat;
+    FileDescriptor ioStat;
+
+    // Ring of the most recent samples, next is where the next sample is written
+    std::vector<ResourceSample> samples;
+    size_t next = 0;
+    size_t count = 0;
+
+    const ResourceSample &fromNewest(size_t age) const
+    {
+        return samples[(next + samples.size() - 1 - age) % samples.size()];
+    }
+};
+
+ResourceSampler::ResourceSampler(size_t historySize) :
+    m_historySize(std::max(historySize, static_cast<size_t>(1)))
+{
+}
+
+ResourceSampler::~ResourceSampler()
+{
+    stop();
+}
+
+bool ResourceSampler::add(int id, const std::string &cgroupPath)
+{
+    std::unique_ptr<Cgroup> cgroup(new Cgroup(cgroupPath, m_historySize));
+    if (!cgroup->memoryCurrent.isValid() && !cgroup->memoryStat.isValid()
+        && !cgroup->cpuStat.isValid() && !cgroup->ioStat.isValid()) {
+        log_warning() << "Could not open any control files of " << cgroupPath
+                      << ", it will not be sampled";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_cgroups[id] = std::move(cgroup);
+    return true;
+}
+
+void ResourceSampler::remove(int id)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_cgroups.erase(id);
+}
+
+bool ResourceSampler::start(unsigned int intervalMs)
+{
+    if (intervalMs == 0 || m_thread.joinable()) {
+        return false;
+    }
+
+    m_stopping = false;
+    m_cpuTimeNs = 0;
+    m_runTimeNs = 0;
+    m_thread = std::thread(&ResourceSampler::run, this, intervalMs);
+    return true;
+}
+
+void ResourceSampler::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_stopRequested.notify_all();
+    m_thread.join();
+}
+
+bool ResourceSampler::isRunning() const
+{
+    return m_thread.joinable();
+}
+
+void ResourceSampler::run(unsigned int intervalMs)
+{
+    uint64_t startTime = clockNs(CLOCK_MONOTONIC);
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while (!m_stopping) {
+        lock.unlock();
+        uint64_t cpuTimeBefore = clockNs(CLOCK_THREAD_CPUTIME_ID);
+        sample();
+        uint64_t cpuTime = clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuTimeBefore;
+        lock.lock();
+
+        m_cpuTimeNs += cpuTime;
+        m_runTimeNs = clockNs(CLOCK_MONOTONIC) - startTime;
+
+        double currentLoad = m_runTimeNs ? static_cast<double>(m_cpuTimeNs) / m_runTimeNs : 0;
+        if (!m_loadWarned && m_runTimeNs > 10 * static_cast<uint64_t>(intervalMs) * 1000000
+            && currentLoad > MAX_LOAD) {
+            log_warning() << "Resource sampling of " << m_cgroups.size() << " cgroups uses "
+                          << currentLoad * 100 << "% CPU, consider a longer sample interval";
+            m_loadWarned = true;
+        }
+
+        m_stopRequested.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                                 [this] { return m_stopping; });
+    }
+}
+
+void ResourceSampler::sample()
+{
+    uint64_t timestampMs = clockNs(CLOCK_MONOTONIC) / 1000000;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto &cgroup : m_cgroups) {
+        sampleCgroup(*cgroup.second, timestampMs);
+    }
+}
+
+void ResourceSampler::sampleCgroup(Cgroup &cgroup, uint64_t timestampMs)
+{
+    char buffer[READ_BUFFER_SIZE];
+    ResourceSample &sample = cgroup.samples[cgroup.next];
+    sample = ResourceSample();
+    sample.timestampMs = timestampMs;
+
+    if (readFile(cgroup.memoryCurrent, buffer) > 0) {
+        sample.memoryCurrent = strtoull(buffer, nullptr, 10);
+    }
+
+    if (readFile(cgroup.memoryStat, buffer) > 0) {
+        const Field fields[] = {
+            { "anon", &sample.memoryAnon },
+            { "file", &sample.memoryFile },
+        };
+        parseKeyed(buffer, fields);
+    }
+
+    if (readFile(cgroup.cpuStat, buffer) > 0) {
+        const Field fields[] = {
+            { "usage_usec", &sample.cpuUsageUs },
+            { "user_usec", &sample.cpuUserUs },
+            { "system_usec", &sample.cpuSystemUs },
+        };
+        parseKeyed(buffer, fields);
+    }
+
+    if (readFile(cgroup.ioStat, buffer) > 0) {
+        const Field fields[] = {
+            { "rbytes", &sample.ioReadBytes },
+            { "wbytes", &sample.ioWriteBytes },
+            { "rios", &sample.ioReadOps },
+            { "wios", &sample.ioWriteOps },
+        };
+        parseKeyed(buffer, fields);
+    }
+
+    cgroup.next = (cgroup.next + 1) % cgroup.samples.size();
+    cgroup.count = std::min(cgroup.count + 1, cgroup.samples.size());
+}
+
+bool ResourceSampler::latest(int id, ResourceSample &sample) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_cgroups.find(id);
+    if (it == m_cgroups.end() || it->second->count == 0) {
+        return false;
+    }
+
+    sample = it->second->fromNewest(0);
+    return true;
+}
+
+bool ResourceSampler::latestDelta(int id, ResourceSample &delta) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_cgroups.find(id);
+    if (it == m_cgroups.end() || it->second->count < 2) {
+        return false;
+    }
+
+    delta = ResourceSampler::delta(it->second->fromNewest(1), it->second->fromNewest(0));
+    return true;
+}
+
+std::vector<ResourceSample> ResourceSampler::history(int id) const
+{
+    std::vector<ResourceSample> samples;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_cgroups.find(id);
+    if (it == m_cgroups.end()) {
+        return samples;
+    }
+
+    const Cgroup &cgroup = *it->second;
+    samples.reserve(cgroup.count);
+    for (size_t age = cgroup.count; age > 0; age--) {
+        samples.push_back(cgroup.fromNewest(age - 1));
+    }
+    return samples;
+}
+
+std::vector<int> ResourceSampler::ids() const
+{
+    std::vector<int> ids;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto &cgroup : m_cgroups) {
+        ids.push_back(cgroup.first);
+    }
+    return ids;
+}
+
+ResourceSample ResourceSampler::delta(const ResourceSample &older, const ResourceSample &newer)
+{
+    // Counters are reset if a cgroup is recreated, which must not show up as a huge increase
+    auto difference = [](uint64_t before, uint64_t after) {
+        return after >= before ? after - before : 0;
+    };
+
+    ResourceSample delta = newer;
+    delta.timestampMs = difference(older.timestampMs, newer.timestampMs);
+    delta.cpuUsageUs = difference(older.cpuUsageUs, newer.cpuUsageUs);
+    delta.cpuUserUs = difference(older.cpuUserUs, newer.cpuUserUs);
+    delta.cpuSystemUs = difference(older.cpuSystemUs, newer.cpuSystemUs);
+    delta.ioReadBytes = difference(older.ioReadBytes, newer.ioReadBytes);
+    delta.ioWriteBytes = difference(older.ioWriteBytes, newer.ioWriteBytes);
+    delta.ioReadOps = difference(older.ioReadOps, newer.ioReadOps);
+    delta.ioWriteOps = difference(older.ioWriteOps, newer.ioWriteOps);
+    return delta;
+}
+
+double ResourceSampler::load() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_runTimeNs ? static_cast<double>(m_cpuTimeNs) / m_runTimeNs : 0;
+}
+
+} // namespace softwarecontainer
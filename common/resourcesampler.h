@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief Resource usage of a cgroup at one point in time
+ *
+ * Memory values are the current usage in bytes. CPU and IO values are counters that only
+ * grow, so the usage over a period is the difference between two samples, see
+ * ResourceSampler::delta().
+ */
+struct ResourceSample
+{
+    uint64_t timestampMs = 0;       // CLOCK_MONOTONIC
+
+    uint64_t memoryCurrent = 0;     // memory.current
+    uint64_t memoryAnon = 0;        // "anon" in memory.stat
+    uint64_t memoryFile = 0;        // "file" in memory.stat
+
+    uint64_t cpuUsageUs = 0;        // "usage_usec" in cpu.stat
+    uint64_t cpuUserUs = 0;         // "user_usec" in cpu.stat
+    uint64_t cpuSystemUs = 0;       // "system_usec" in cpu.stat
+
+    uint64_t ioReadBytes = 0;       // "rbytes" in io.stat, summed over all devices
+    uint64_t ioWriteBytes = 0;      // "wbytes" in io.stat
+    uint64_t ioReadOps = 0;         // "rios" in io.stat
+    uint64_t ioWriteOps = 0;        // "wios" in io.stat
+};
+
+/**
+ * @brief The ResourceSampler class periodically samples the resource usage of a set of
+ * cgroup v2 directories on a thread of its own.
+ *
+ * The control files of each cgroup are opened once when the cgroup is added, and are then
+ * read with pread at every sample, so a sample of a cgroup costs four system calls and no
+ * allocations. The most recent samples of each cgroup are kept in a fixed size ring.
+ *
+ * The CPU time spent by the sampler thread is measured, so that its own overhead can be
+ * checked, see load().
+ */
+class ResourceSampler
+{
+    LOG_DECLARE_CLASS_CONTEXT("RSSA", "Resource sampler");
+
+public:
+    /**
+     * @brief The fraction of one CPU the sampler should stay below, a warning is logged
+     * if it uses more
+     */
+    static constexpr double MAX_LOAD = 0.005;
+
+    /**
+     * @param historySize Number of samples kept per cgroup, at least one
+     */
+    ResourceSampler(size_t historySize);
+
+    /**
+     * @brief Stops the sampler thread and closes all control files
+     */
+    ~ResourceSampler();
+
+    ResourceSampler(const ResourceSampler &) = delete;
+    ResourceSampler &operator=(const ResourceSampler &) = delete;
+
+    /**
+     * @brief Starts sampling the cgroup directory at cgroupPath, replacing any cgroup
+     * previously added with the same id
+     *
+     * Control files that are missing, e.g. io.stat when the io controller is not enabled,
+     * are left out of the samples.
+     *
+     * @return false if none of the control files could be opened
+     */
+    bool add(int id, const std::string &cgroupPath);
+
+    /**
+     * @brief Stops sampling a cgroup and drops its samples
+     */
+    void remove(int id);
+
+    /**
+     * @brief Starts the sampler thread, which samples all cgroups every intervalMs
+     *
+     * @return false if the sampler is already running or intervalMs is 0
+     */
+    bool start(unsigned int intervalMs);
+
+    /**
+     * @brief Stops the sampler thread, the samples taken so far are kept
+     */
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * @brief Takes one sample of all cgroups, this is what the sampler thread runs every
+     * interval
+     */
+    void sample();
+
+    /**
+     * @brief The most recent sample of a cgroup
+     *
+     * @return false if the cgroup is unknown or has not been sampled yet
+     */
+    bool latest(int id, ResourceSample &sample) const;
+
+    /**
+     * @brief The change since the sample before the most recent one
+     *
+     * @return false if the cgroup is unknown or has fewer than two samples
+     */
+    bool latestDelta(int id, ResourceSample &delta) const;
+
+    /**
+     * @brief All samples kept for a cgroup, oldest first
+     */
+    std::vector<ResourceSample> history(int id) const;
+
+    /**
+     * @brief The ids of all cgroups being sampled
+     */
+    std::vector<int> ids() const;
+
+    /**
+     * @brief The difference between two samples of the same cgroup
+     *
+     * Counters are the amount added between the samples, memory values are the ones in
+     * newer, and the timestamp is the time between the samples.
+     */
+    static ResourceSample delta(const ResourceSample &older, const ResourceSample &newer);
+
+    /**
+     * @brief The CPU time used by the sampler thread as a fraction of the time it has been
+     * running, e.g. 0.001 is 0.1% of one CPU
+     */
+    double load() const;
+
+private:
+    struct Cgroup;
+
+    void run(unsigned int intervalMs);
+    static void sampleCgroup(Cgroup &cgroup, uint64_t timestampMs);
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_stopRequested;
+    bool m_stopping = false;
+    std::thread m_thread;
+
+    size_t m_historySize;
+    std::map<int, std::unique_ptr<Cgroup>> m_cgroups;
+
+    uint64_t m_cpuTimeNs = 0;
+    uint64_t m_runTimeNs = 0;
+    bool m_loadWarned = false;
+};
+
+} // namespace softwarecontainer
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace softwarecontainer {
+
+RingBuffer::RingBuffer(size_t capacity) :
+    m_buffer(capacity)
+{
+}
+
+void RingBuffer::write(const char *data, size_t size)
+{
+    m_totalWritten += size;
+
+    const size_t capacity = m_buffer.size();
+    if (capacity == 0) {
+        return;
+    }
+
+    // Only the last capacity bytes can end up in the buffer
+    if (size >= capacity) {
+        memcpy(m_buffer.data(), data + size - capacity, capacity);
+        m_start = 0;
+        m_size = capacity;
+        return;
+    }
+
+    size_t end = (m_start + m_size) % capacity;
+    size_t first = std::min(size, capacity - end);
+    memcpy(m_buffer.data() + end, data, first);
+    memcpy(m_buffer.data(), data + first, size - first);
+
+    if (m_size + size > capacity) {
+        size_t dropped = m_size + size - capacity;
+        m_start = (m_start + dropped) % capacity;
+        m_size = capacity;
+    } else {
+        m_size += size;
+    }
+}
+
+std::string RingBuffer::tail(size_t maxBytes) const
+{
+    const size_t count = std::min(maxBytes, m_size);
+    if (count == 0) {
+        return std::string();
+    }
+
+    const size_t capacity = m_buffer.size();
+    size_t begin = (m_start + m_size - count) % capacity;
+    size_t first = std::min(count, capacity - begin);
+
+    std::string result;
+    result.reserve(count);
+    result.append(m_buffer.data() + begin, first);
+    result.append(m_buffer.data(), count - first);
+    return result;
+}
+
+size_t RingBuffer::size() const
+{
+    return m_size;
+}
+
+size_t RingBuffer::capacity() const
+{
+    return m_buffer.size();
+}
+
+uint64_t RingBuffer::totalWritten() const
+{
+    return m_totalWritten;
+}
+
+} // namespace softwarecontainer
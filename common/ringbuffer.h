@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The RingBuffer class keeps the most recent bytes written to it, up to a fixed capacity.
+ *
+ * When the buffer is full, the oldest bytes are overwritten. Memory for the full capacity is
+ * allocated up front, so writing never allocates.
+ */
+class RingBuffer
+{
+public:
+    RingBuffer(size_t capacity);
+
+    /**
+     * @brief Appends data, dropping the oldest bytes if the buffer overflows
+     */
+    void write(const char *data, size_t size);
+
+    /**
+     * @brief Returns the most recent bytes in the buffer, oldest first
+     *
+     * @param maxBytes Max number of bytes to return
+     */
+    std::string tail(size_t maxBytes) const;
+
+    /**
+     * @brief The number of bytes currently in the buffer
+     */
+    size_t size() const;
+
+    size_t capacity() const;
+
+    /**
+     * @brief The total number of bytes ever written, including the ones that have been dropped
+     */
+    uint64_t totalWritten() const;
+
+private:
+    std::vector<char> m_buffer;
+
+    // Index of the oldest byte, and the number of bytes in the buffer
+    size_t m_start = 0;
+    size_t m_size = 0;
+
+    uint64_t m_totalWritten = 0;
+};
+
+} // namespace softwarecontainer
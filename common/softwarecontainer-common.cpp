@@ -20,6 +20,8 @@
 #include "softwarecontainer-common.h"
 #include "softwarecontainererror.h"
 
+#include <algorithm>
+#include <set>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -31,6 +33,8 @@
 #include <string.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <limits.h>
+#include <mntent.h>
 
 namespace softwarecontainer {
     LOG_DECLARE_DEFAULT_CONTEXT(defaultLogContext, "MAIN", "Main context");
@@ -108,6 +112,29 @@ bool existsInFileSystem(const std::string &path)
     return getStat(path, st);
 }
 
+bool isMountPoint(const std::string &path)
+{
+    char resolved[PATH_MAX];
+    if (nullptr == realpath(path.c_str(), resolved)) {
+        return false;
+    }
+
+    FILE *mountsFile = setmntent("/proc/self/mounts", "r");
+    if (nullptr == mountsFile) {
+        log_error() << "Could not read mount table: " << strerror(errno);
+        return false;
+    }
+
+    bool found = false;
+    struct mntent *entry;
+    while (!found && (entry = getmntent(mountsFile)) != nullptr) {
+        found = (0 == strcmp(entry->mnt_dir, resolved));
+    }
+
+    endmntent(mountsFile);
+    return found;
+}
+
 std::string parentPath(const std::string &path_)
 {
     char *path = strdup(path_.c_str());
@@ -195,4 +222,77 @@ bool parseInt(const char *arg, int *result)
     return true;
 }
 
+bool parseCpuList(const std::string &list, std::vector<unsigned int> &cpus)
+{
+    std::string trimmed = list;
+    if (!trimmed.empty() && trimmed.back() == '\n') {
+        trimmed.pop_back();
+    }
+    if (trimmed.empty()) {
+        return false;
+    }
+
+    std::set<unsigned int> parsed;
+    std::istringstream ranges(trimmed);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        const char *position = range.c_str();
+        char *end;
+
+        if (!isdigit(*position)) {
+            return false;
+        }
+        unsigned long first = strtoul(position, &end, 10);
+        unsigned long last = first;
+        if (*end == '-') {
+            position = end + 1;
+            if (!isdigit(*position)) {
+                return false;
+            }
+            last = strtoul(position, &end, 10);
+        }
+
+        // Kernels support at most a few thousand CPUs
+        if (*end != '\0' || first > last || last >= 65536) {
+            return false;
+        }
+
+        for (unsigned long cpu = first; cpu <= last; cpu++) {
+            parsed.insert(cpu);
+        }
+    }
+
+    // A trailing comma is not valid
+    if (trimmed.back() == ',') {
+        return false;
+    }
+
+    cpus.assign(parsed.begin(), parsed.end());
+    return true;
+}
+
+std::string formatCpuList(std::vector<unsigned int> cpus)
+{
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    std::string list;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t last = i;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+            last++;
+        }
+
+        if (!list.empty()) {
+            list += ",";
+        }
+        list += std::to_string(cpus[i]);
+        if (last > i) {
+            list += "-" + std::to_string(cpus[last]);
+        }
+        i = last + 1;
+    }
+    return list;
+}
+
 } // namespace softwarecontainer
@@ -22,6 +22,8 @@
 #include "softwarecontainer-log.h"
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include <glibmm.h>
 #include <sys/wait.h>
@@ -93,6 +95,14 @@ bool isSocket(const std::string &path);
  */
 bool existsInFileSystem(const std::string &path);
 
+/**
+ * @brief isMountPoint Check if something is mounted on path in the mount namespace of
+ *  the calling process
+ * @param path Path to check
+ * @return true/false
+ */
+bool isMountPoint(const std::string &path);
+
 std::string parentPath(const std::string &path);
 std::string baseName(const std::string &path);
 
@@ -101,6 +111,21 @@ bool writeToFile(const std::string &path, const std::string &content);
 bool readFromFile(const std::string &path, std::string &content);
 bool parseInt(const char *args, int *result);
 
+/**
+ * @brief parseCpuList Parse a list of CPUs in the format used by cpuset.cpus and
+ *  /sys/devices/system/cpu/online, e.g. "0-3,6"
+ * @param list The list to parse, a trailing newline is allowed
+ * @param cpus Set to the CPUs in the list, in ascending order without duplicates
+ * @return false if the list is empty or not valid
+ */
+bool parseCpuList(const std::string &list, std::vector<unsigned int> &cpus);
+
+/**
+ * @brief formatCpuList Format CPUs as a list in the format used by cpuset.cpus, with
+ *  consecutive CPUs written as ranges
+ */
+std::string formatCpuList(std::vector<unsigned int> cpus);
+
 /*
  * This builds a full path from parts, including the appropriate separator.
  *
@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "unifiedcgroup.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <chrono>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+namespace softwarecontainer {
+
+namespace {
+
+// Controllers which only exist in cgroup v1
+const char *const V1_ONLY_PREFIXES[] = { "blkio.", "cpuacct.", "devices.", "freezer.",
+                                         "net_cls.", "net_prio." };
+
+const std::string MEMSW_LIMIT = "memory.memsw.limit_in_bytes";
+
+const std::string IO_MAX = "io.max";
+const std::string IO_WEIGHT = "io.weight";
+
+// The device a line of a per-device control file is for, or "default" for io.weight
+std::string deviceOfLine(const std::string &line)
+{
+    std::string device = line.substr(0, line.find(' '));
+    return device.find(':') != std::string::npos || device == "default" ? device : "";
+}
+
+// The line that removes all limits of a device from a per-device control file
+std::string resetLine(const std::string &file, const std::string &device)
+{
+    if (file == IO_MAX) {
+        return device + " rbps=max wbps=max riops=max wiops=max";
+    }
+    return device + " default";
+}
+
+bool parseUnsigned(const std::string &value, unsigned long long &result)
+{
+    if (value.empty() || !std::isdigit(value[0])) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    result = std::strtoull(value.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+// A memory limit, where -1 means no limit in cgroup v1
+bool translateMemoryLimit(const std::string &value, std::string &translatedValue)
+{
+    unsigned long long bytes;
+    if (value == "-1" || value == "max") {
+        translatedValue = "max";
+    } else if (parseUnsigned(value, bytes)) {
+        translatedValue = value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Maps a value from the range [min1, max1] to [min2, max2], like the other container runtimes
+bool translateWeight(const std::string &value,
+                     unsigned long long min1, unsigned long long max1,
+                     unsigned long long min2, unsigned long long max2,
+                     std::string &translatedValue)
+{
+    unsigned long long weight;
+    if (!parseUnsigned(value, weight)) {
+        return false;
+    }
+    weight = std::min(std::max(weight, min1), max1);
+    translatedValue = std::to_string(min2 + ((weight - min1) * (max2 - min2)) / (max1 - min1));
+    return true;
+}
+
+// Adds the processes of the cgroup at path, and of the cgroups below it, to pids
+void collectProcesses(const std::string &path, std::vector<pid_t> &pids)
+{
+    std::string content;
+    if (readFromFile(buildPath(path, "cgroup.procs"), content)) {
+        std::istringstream lines(content);
+        pid_t pid;
+        while (lines >> pid) {
+            pids.push_back(pid);
+        }
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (nullptr == dir) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        if (entry->d_type == DT_DIR && name != "." && name != "..") {
+            collectProcesses(buildPath(path, name), pids);
+        }
+    }
+    closedir(dir);
+}
+
+} // namespace
+
+UnifiedCgroup::UnifiedCgroup()
+{
+}
+
+UnifiedCgroup::~UnifiedCgroup()
+{
+    close();
+}
+
+bool UnifiedCgroup::isAvailable(const std::string &root)
+{
+    struct statfs fs;
+    if (statfs(root.c_str(), &fs) == -1) {
+        return false;
+    }
+    return fs.f_type == CGROUP2_SUPER_MAGIC;
+}
+
+std::string UnifiedCgroup::pathOfProcess(pid_t pid, const std::string &root)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/cgroup");
+    std::string line;
+    while (std::getline(file, line)) {
+        // The unified hierarchy has id 0 and no controllers listed: "0::/path"
+        if (line.compare(0, 3, "0::") != 0) {
+            continue;
+        }
+
+        std::string path = root + line.substr(3);
+        if (!path.empty() && path.back() == '/') {
+            path.pop_back();
+        }
+        return isDirectory(path) ? path : "";
+    }
+    return "";
+}
+
+bool UnifiedCgroup::blockDevice(const std::string &path, std::string &device,
+                                const std::string &sysDevBlock)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        log_error() << "Could not find the device of " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    device = std::to_string(major(dev)) + ":" + std::to_string(minor(dev));
+
+    // Filesystems without a block device, like tmpfs and overlayfs, have anonymous devices
+    std::string sysPath = buildPath(sysDevBlock, device);
+    if (!isDirectory(sysPath)) {
+        log_error() << path << " is not on a block device";
+        return false;
+    }
+
+    if (isFile(buildPath(sysPath, "partition"))) {
+        std::string disk;
+        if (!readFromFile(buildPath(sysPath, "../dev"), disk) || disk.empty()) {
+            log_error() << "Could not find the disk of partition " << device;
+            return false;
+        }
+        if (disk.back() == '\n') {
+            disk.pop_back();
+        }
+        device = disk;
+    }
+    return true;
+}
+
+bool UnifiedCgroup::translate(const std::string &key, const std::string &value,
+                              std::string &translatedKey, std::string &translatedValue)
+{
+    if (key == MEMSW_LIMIT) {
+        return false;
+    }
+
+    translatedKey = translateKey(key);
+    if (translatedKey.empty()) {
+        return false;
+    }
+
+    if (key == "memory.limit_in_bytes" || key == "memory.soft_limit_in_bytes") {
+        return translateMemoryLimit(value, translatedValue);
+    } else if (key == "cpu.shares") {
+        return translateWeight(value, 2, 262144, 1, 10000, translatedValue);
+    } else if (key == "blkio.weight") {
+        return translateWeight(value, 10, 1000, 1, 10000, translatedValue);
+    }
+
+    translatedValue = value;
+    return true;
+}
+
+bool UnifiedCgroup::isPerDeviceSetting(const std::string &setting)
+{
+    return setting == IO_MAX || setting == IO_WEIGHT;
+}
+
+std::string UnifiedCgroup::translateKey(const std::string &key)
+{
+    static const std::map<std::string, std::string> V1_SETTINGS = {
+        { "memory.limit_in_bytes", "memory.max" },
+        { "memory.soft_limit_in_bytes", "memory.low" },
+        { MEMSW_LIMIT, "memory.swap.max" },
+        { "cpu.shares", "cpu.weight" },
+        { "blkio.weight", "io.weight" }
+    };
+
+    auto it = V1_SETTINGS.find(key);
+    if (it != V1_SETTINGS.end()) {
+        return it->second;
+    }
+
+    for (const char *prefix : V1_ONLY_PREFIXES) {
+        if (key.compare(0, strlen(prefix), prefix) == 0) {
+            return "";
+        }
+    }
+    return key;
+}
+
+bool UnifiedCgroup::open(const std::string &path)
+{
+    close();
+
+    m_directory = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_directory == -1) {
+        log_error() << "Could not open cgroup " << path << ": " << strerror(errno);
+        m_directory = INVALID_FD;
+        return false;
+    }
+
+    m_path = path;
+    log_debug() << "Opened cgroup " << m_path;
+    return true;
+}
+
+void UnifiedCgroup::close()
+{
+    for (auto &file : m_files) {
+        ::close(file.second);
+    }
+    m_files.clear();
+
+    if (m_directory != INVALID_FD) {
+        ::close(m_directory);
+        m_directory = INVALID_FD;
+    }
+    m_path.clear();
+}
+
+bool UnifiedCgroup::isOpen() const
+{
+    return m_directory != INVALID_FD;
+}
+
+const std::string &UnifiedCgroup::path() const
+{
+    return m_path;
+}
+
+bool UnifiedCgroup::set(const std::string &key, const std::string &value)
+{
+    if (key == MEMSW_LIMIT) {
+        std::string memoryMax;
+        std::string swapMax;
+        unsigned long long total;
+        unsigned long long memory;
+        if (!translateMemoryLimit(value, swapMax) || !read("memory.max", memoryMax)) {
+            log_error() << "Could not translate " << key << ": " << value;
+            return false;
+        }
+
+        if (swapMax == "max") {
+            return write("memory.swap.max", swapMax);
+        }
+
+        parseUnsigned(value, total);
+        if (!parseUnsigned(memoryMax, memory)) {
+            // Without a memory limit, the closest is to limit memory alone to the total
+            log_warning() << key << " set without a memory limit, limiting memory to " << value;
+            return write("memory.max", value);
+        }
+        return write("memory.swap.max", std::to_string(total > memory ? total - memory : 0));
+    }
+
+    std::string translatedKey;
+    std::string translatedValue;
+    if (!translate(key, value, translatedKey, translatedValue)) {
+        log_error() << key << ": " << value << " has no cgroup v2 equivalent";
+        return false;
+    }
+
+    if (translatedKey != key) {
+        log_debug() << "Translated " << key << ": " << value
+                    << " to " << translatedKey << ": " << translatedValue;
+    }
+    return write(translatedKey, translatedValue);
+}
+
+bool UnifiedCgroup::set(const std::map<std::string, std::string> &settings)
+{
+    std::vector<std::pair<std::string, std::string>> previousValues;
+    auto rollback = [this, &previousValues] () {
+        for (auto it = previousValues.rbegin(); it != previousValues.rend(); ++it) {
+            if (!write(it->first, it->second)) {
+                log_error() << "Could not restore " << it->first << " to " << it->second;
+            }
+        }
+    };
+
+    for (auto &setting : settings) {
+        std::vector<std::string> files;
+        if (!controlFilesOf(setting.first, files)) {
+            log_error() << setting.first << " has no cgroup v2 equivalent";
+            rollback();
+            return false;
+        }
+
+        for (auto &file : files) {
+            bool saved = std::any_of(previousValues.begin(), previousValues.end(),
+                [&file] (const std::pair<std::string, std::string> &previous) {
+                    return previous.first == file;
+                });
+            if (saved) {
+                continue;
+            }
+
+            std::string value;
+            if (!read(file, value)) {
+                log_error() << "Could not read " << m_path << "/" << file << ": " << strerror(errno);
+                rollback();
+                return false;
+            }
+
+            // Devices that had no line before only get their limits removed by a rollback
+            if (isPerDeviceSetting(file)) {
+                std::istringstream lines(setting.second);
+                std::string line;
+                while (std::getline(lines, line)) {
+                    std::string device = deviceOfLine(line);
+                    if (!device.empty() && device != "default"
+                        && ("\n" + value).find("\n" + device + " ") == std::string::npos) {
+                        value += (value.empty() ? "" : "\n") + resetLine(file, device);
+                    }
+                }
+            }
+            previousValues.push_back(std::make_pair(file, value));
+        }
+
+        if (!set(setting.first, setting.second)) {
+            rollback();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<pid_t> UnifiedCgroup::processes() const
+{
+    std::vector<pid_t> pids;
+    if (isOpen()) {
+        collectProcesses(m_path, pids);
+    }
+    return pids;
+}
+
+size_t UnifiedCgroup::signalAll(int signal, pid_t exceptPid) const
+{
+    size_t signalled = 0;
+    for (pid_t pid : processes()) {
+        if (pid == exceptPid) {
+            continue;
+        }
+        if (::kill(pid, signal) == 0) {
+            signalled++;
+        } else if (errno != ESRCH) {
+            log_warning() << "Could not signal process " << pid << ": " << strerror(errno);
+        }
+    }
+    return signalled;
+}
+
+bool UnifiedCgroup::waitUntilEmpty(unsigned int timeoutMs, pid_t exceptPid) const
+{
+    auto isEmpty = [this, exceptPid] () {
+        for (pid_t pid : processes()) {
+            if (pid != exceptPid) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (!isOpen()) {
+        return false;
+    }
+
+    int fd = openat(m_directory, "cgroup.events", O_RDONLY | O_CLOEXEC);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    bool empty = isEmpty();
+    while (!empty) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            break;
+        }
+
+        // The kernel wakes pollers with POLLPRI when "populated" changes
+        int pollTimeout = static_cast<int>(remaining);
+        if (exceptPid != INVALID_PID || fd == -1) {
+            pollTimeout = std::min<int>(pollTimeout, POLL_INTERVAL_MS);
+        }
+        if (fd != -1) {
+            struct pollfd pfd = { fd, POLLPRI, 0 };
+            int ready = ::poll(&pfd, 1, pollTimeout);
+            if (ready == -1 && errno != EINTR) {
+                log_warning() << "Could not poll " << m_path << "/cgroup.events: "
+                              << strerror(errno);
+                ::close(fd);
+                fd = -1;
+            } else if (ready > 0) {
+                // Reading the file again is what rearms the notification
+                char buffer[64];
+                if (::pread(fd, buffer, sizeof(buffer), 0) == -1) {
+                    log_debug() << "Could not read " << m_path << "/cgroup.events";
+                }
+            }
+        } else {
+            ::poll(nullptr, 0, pollTimeout);
+        }
+        empty = isEmpty();
+    }
+
+    if (fd != -1) {
+        ::close(fd);
+    }
+    return empty;
+}
+
+bool UnifiedCgroup::killAll()
+{
+    int fd = isOpen() ? openat(m_directory, "cgroup.kill", O_WRONLY | O_CLOEXEC) : -1;
+    if (fd != -1) {
+        bool written = ::write(fd, "1", 1) == 1;
+        int error = errno;
+        ::close(fd);
+        if (written) {
+            return true;
+        }
+        log_warning() << "Could not write " << m_path << "/cgroup.kill: " << strerror(error);
+    }
+
+    log_debug() << "Killing the processes of " << m_path << " one by one";
+    return signalAll(SIGKILL) > 0 || processes().empty();
+}
+
+bool UnifiedCgroup::freeze(bool frozen, unsigned int timeoutMs)
+{
+    std::string value = frozen ? "1" : "0";
+    if (!write("cgroup.freeze", value)) {
+        return false;
+    }
+
+    if (!waitForEvent("frozen", value, timeoutMs)) {
+        log_error() << m_path << " was not " << (frozen ? "frozen" : "thawed")
+                    << " within " << timeoutMs << " ms";
+
+        // Otherwise the cgroup is left half way, in a state the caller does not know about
+        if (!write("cgroup.freeze", frozen ? "0" : "1")) {
+            log_error() << "Could not restore cgroup.freeze of " << m_path;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool UnifiedCgroup::waitForEvent(const std::string &key, const std::string &value,
+                                 unsigned int timeoutMs) const
+{
+    int fd = isOpen() ? openat(m_directory, "cgroup.events", O_RDONLY | O_CLOEXEC) : -1;
+    if (fd == -1) {
+        log_error() << "Could not open " << m_path << "/cgroup.events";
+        return false;
+    }
+
+    std::string line = key + " " + value;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    bool reached = false;
+    while (true) {
+        // Reading the file is also what rearms the notification
+        char buffer[256];
+        ssize_t count = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+        if (count < 0) {
+            log_error() << "Could not read " << m_path << "/cgroup.events: " << strerror(errno);
+            break;
+        }
+        std::string events(buffer, count);
+        if (("\n" + events).find("\n" + line + "\n") != std::string::npos) {
+            reached = true;
+            break;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            break;
+        }
+        struct pollfd pfd = { fd, POLLPRI, 0 };
+        if (::poll(&pfd, 1, static_cast<int>(remaining)) == -1 && errno != EINTR) {
+            log_error() << "Could not poll " << m_path << "/cgroup.events: " << strerror(errno);
+            break;
+        }
+    }
+
+    ::close(fd);
+    return reached;
+}
+
+bool UnifiedCgroup::controlFilesOf(const std::string &key, std::vector<std::string> &files)
+{
+    if (key == MEMSW_LIMIT) {
+        files = { "memory.max", "memory.swap.max" };
+        return true;
+    }
+
+    std::string file = translateKey(key);
+    if (file.empty()) {
+        return false;
+    }
+    files = { file };
+    return true;
+}
+
+bool UnifiedCgroup::write(const std::string &file, const std::string &value)
+{
+    if (isPerDeviceSetting(file) && (value.empty() || value.find('\n') != std::string::npos)) {
+        std::istringstream lines(value);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (!line.empty() && !write(file, line)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int fd = controlFile(file);
+    if (fd == INVALID_FD) {
+        return false;
+    }
+
+    ssize_t written = pwrite(fd, value.c_str(), value.size(), 0);
+    if (written != static_cast<ssize_t>(value.size())) {
+        int error = (written == -1) ? errno : EIO;
+        log_error() << "Could not write " << value << " to " << m_path << "/" << file
+                    << ": " << strerror(error);
+        errno = error;
+        return false;
+    }
+    return true;
+}
+
+bool UnifiedCgroup::read(const std::string &file, std::string &value) const
+{
+    if (!isOpen()) {
+        errno = EBADF;
+        return false;
+    }
+
+    int fd = openat(m_directory, file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    value.clear();
+    char buffer[4096];
+    ssize_t count;
+    while ((count = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        value.append(buffer, count);
+    }
+    int error = errno;
+    ::close(fd);
+
+    if (count == -1) {
+        errno = error;
+        return false;
+    }
+    if (!value.empty() && value.back() == '\n') {
+        value.pop_back();
+    }
+    return true;
+}
+
+int UnifiedCgroup::controlFile(const std::string &file)
+{
+    auto it = m_files.find(file);
+    if (it != m_files.end()) {
+        return it->second;
+    }
+
+    if (!isOpen()) {
+        errno = EBADF;
+        return INVALID_FD;
+    }
+
+    int fd = openat(m_directory, file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        int error = errno;
+        log_error() << "Could not open " << m_path << "/" << file << ": " << strerror(error);
+        errno = error;
+        return INVALID_FD;
+    }
+
+    m_files[file] = fd;
+    return fd;
+}
+
+} // namespace softwarecontainer
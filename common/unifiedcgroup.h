@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The UnifiedCgroup class writes settings directly to a cgroup in the cgroup v2
+ * (unified) hierarchy.
+ *
+ * The cgroup is looked up once, and the control files are opened the first time they are
+ * written and then kept open, so applying a setting is a single pwrite. Settings can be given
+ * either with their cgroup v2 names or with the cgroup v1 names used in container
+ * configurations, which are translated to the closest cgroup v2 equivalent.
+ */
+class UnifiedCgroup
+{
+    LOG_DECLARE_CLASS_CONTEXT("UCGR", "Unified cgroup");
+
+public:
+    static constexpr const char *CGROUP_ROOT = "/sys/fs/cgroup";
+
+    UnifiedCgroup();
+    ~UnifiedCgroup();
+
+    UnifiedCgroup(const UnifiedCgroup &) = delete;
+    UnifiedCgroup &operator=(const UnifiedCgroup &) = delete;
+
+    /**
+     * @brief Checks if a cgroup v2 hierarchy is mounted on root
+     */
+    static bool isAvailable(const std::string &root = CGROUP_ROOT);
+
+    /**
+     * @brief Finds the cgroup v2 directory of a process
+     *
+     * @return The path of the cgroup below root, or an empty string if the process is not
+     *         found or is not in the unified hierarchy
+     */
+    static std::string pathOfProcess(pid_t pid, const std::string &root = CGROUP_ROOT);
+
+    /**
+     * @brief Finds the block device that io.max and io.weight limits for a path are set on
+     *
+     * For a block device node this is the device itself, otherwise it is the device holding
+     * the filesystem the path is on, which for a bind mount is the device of the host path.
+     * Limits can only be set on whole disks, so a partition is resolved to its disk.
+     *
+     * @param path The path to resolve
+     * @param device Set to the device as "MAJ:MIN"
+     * @return false if the path does not exist or is not backed by a block device, e.g. on a
+     *         tmpfs
+     */
+    static bool blockDevice(const std::string &path, std::string &device,
+                            const std::string &sysDevBlock = "/sys/dev/block");
+
+    /**
+     * @brief Translates a cgroup v1 setting to cgroup v2
+     *
+     * memory.limit_in_bytes, cpu.shares and blkio.weight are translated to memory.max,
+     * cpu.weight and io.weight. Settings that are already cgroup v2 settings are kept as they
+     * are. memory.memsw.limit_in_bytes depends on the memory limit and is handled by set().
+     *
+     * @return false if the setting has no cgroup v2 equivalent or the value is invalid
+     */
+    static bool translate(const std::string &key, const std::string &value,
+                          std::string &translatedKey, std::string &translatedValue);
+
+    /**
+     * @brief The cgroup v2 control file a setting is written to
+     *
+     * @return The name of the control file, or an empty string if the setting has no cgroup
+     *         v2 equivalent
+     */
+    static std::string translateKey(const std::string &key);
+
+    /**
+     * @brief Whether a setting holds one line per block device
+     *
+     * A write to io.max or io.weight only changes the line of the device it is for, so
+     * several values for different devices have to be merged instead of replacing each other.
+     */
+    static bool isPerDeviceSetting(const std::string &setting);
+
+    /**
+     * @brief Opens the cgroup directory at path, closing any previously opened cgroup
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Closes all open control files and the cgroup directory
+     */
+    void close();
+
+    bool isOpen() const;
+
+    const std::string &path() const;
+
+    /**
+     * @brief Applies a setting, translating it from cgroup v1 if needed
+     *
+     * memory.memsw.limit_in_bytes limits memory and swap together, while cgroup v2 limits
+     * swap separately. It is set as memory.swap.max, using the current value of memory.max,
+     * so it must be set after memory.limit_in_bytes.
+     *
+     * @return true if the setting was written
+     */
+    bool set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Applies several settings as one update
+     *
+     * The current value of every control file that is written is read first. If any setting
+     * can not be applied, the control files already written are restored to their previous
+     * values, in reverse order.
+     *
+     * @return true if all settings were written
+     */
+    bool set(const std::map<std::string, std::string> &settings);
+
+    /**
+     * @brief Writes a value to a control file of the cgroup as it is
+     *
+     * io.max and io.weight take one device per write, so a value for them with several lines
+     * is written one line at a time.
+     */
+    bool write(const std::string &file, const std::string &value);
+
+    /**
+     * @brief Reads the contents of a control file of the cgroup, without trailing newline
+     */
+    bool read(const std::string &file, std::string &value) const;
+
+    /**
+     * @brief The processes in the cgroup and in all cgroups below it
+     */
+    std::vector<pid_t> processes() const;
+
+    /**
+     * @brief Sends a signal to every process in the cgroup and in all cgroups below it
+     *
+     * @param signal The signal to send
+     * @param exceptPid A process not to signal, e.g. the init of the container
+     * @return The number of processes signalled
+     */
+    size_t signalAll(int signal, pid_t exceptPid = INVALID_PID) const;
+
+    /**
+     * @brief Waits until there are no processes in the cgroup, other than exceptPid
+     *
+     * Without exceptPid this waits for "populated 0" in cgroup.events, which the kernel
+     * notifies pollers of. With exceptPid, that never happens while exceptPid lives, so the
+     * processes are then also checked every POLL_INTERVAL_MS.
+     *
+     * @param timeoutMs Max time to wait
+     * @param exceptPid A process that may be left, e.g. the init of the container
+     * @return true if the cgroup is empty, false if the timeout expired
+     */
+    bool waitUntilEmpty(unsigned int timeoutMs, pid_t exceptPid = INVALID_PID) const;
+
+    /**
+     * @brief Kills all processes in the cgroup and in all cgroups below it
+     *
+     * This writes cgroup.kill, which kills all processes at once, also those that are being
+     * forked meanwhile. On kernels older than 5.14 without cgroup.kill, every process is sent
+     * SIGKILL instead.
+     *
+     * @return false if no process could be killed
+     */
+    bool killAll();
+
+    /**
+     * @brief Freezes or thaws all processes in the cgroup and in all cgroups below it
+     *
+     * This writes cgroup.freeze and then waits until cgroup.events reports the cgroup as
+     * frozen or thawed, which the kernel notifies pollers of. If that does not happen in time,
+     * cgroup.freeze is set back to what it was, so the cgroup stays in its old state.
+     *
+     * @param frozen true to freeze, false to thaw
+     * @param timeoutMs Max time to wait for the cgroup to reach the state
+     * @return false if cgroup.freeze could not be written or the state was not reached in time
+     */
+    bool freeze(bool frozen, unsigned int timeoutMs);
+
+private:
+    static constexpr unsigned int POLL_INTERVAL_MS = 20;
+
+    int controlFile(const std::string &file);
+
+    // Waits until cgroup.events has the line "key value"
+    bool waitForEvent(const std::string &key, const std::string &value,
+                      unsigned int timeoutMs) const;
+
+    /**
+     * @brief The control files that set() writes for a setting
+     */
+    static bool controlFilesOf(const std::string &key, std::vector<std::string> &files);
+
+    std::string m_path;
+    int m_directory = INVALID_FD;
+    std::unordered_map<std::string, int> m_files;
+};
+
+} // namespace softwarecontainer
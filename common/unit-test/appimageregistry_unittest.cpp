@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <appimageregistry.h>
+#include <createdir.h>
+
+#include <gtest/gtest.h>
+#include <fstream>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class AppImageRegistryTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-AppImageRegistryTest-XXXXXX");
+        mountDir = buildPath(workdir, "images");
+    }
+
+    /*
+     * Writes a file of the given size with the magic at the given offset
+     */
+    std::string createImage(const std::string &name, size_t offset, const std::string &magic)
+    {
+        std::string path = buildPath(workdir, name);
+        std::string content(4096, '\0');
+        content.replace(offset, magic.size(), magic);
+        std::ofstream(path) << content;
+        return path;
+    }
+
+    CreateDir cd;
+    std::string workdir;
+    std::string mountDir;
+};
+
+TEST_F(AppImageRegistryTest, detectFileSystemType)
+{
+    ASSERT_EQ("erofs", AppImageRegistry::fileSystemType(
+                  createImage("app.erofs", 1024, "\xe2\xe1\xf5\xe0")));
+    ASSERT_EQ("squashfs", AppImageRegistry::fileSystemType(
+                  createImage("app.squashfs", 0, "hsqs")));
+    ASSERT_EQ("", AppImageRegistry::fileSystemType(createImage("app.img", 0, "????")));
+    ASSERT_EQ("", AppImageRegistry::fileSystemType(buildPath(workdir, "missing")));
+}
+
+TEST_F(AppImageRegistryTest, acquireFailsForInvalidImages)
+{
+    std::string mountPoint;
+    std::string canonicalPath;
+    ASSERT_FALSE(AppImageRegistry::getInstance().acquire(buildPath(workdir, "missing"),
+                                                         mountDir, mountPoint, canonicalPath));
+    ASSERT_FALSE(AppImageRegistry::getInstance().acquire(createImage("app.img", 0, "????"),
+                                                         mountDir, mountPoint, canonicalPath));
+    ASSERT_FALSE(AppImageRegistry::getInstance().acquire(workdir, mountDir, mountPoint,
+                                                         canonicalPath));
+    ASSERT_FALSE(existsInFileSystem(mountDir));
+}
+
+TEST_F(AppImageRegistryTest, releaseUnknownImageFails)
+{
+    ASSERT_FALSE(AppImageRegistry::getInstance().release(createImage("app.img", 0, "hsqs")));
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <cleanupregistry.h>
+#include <createdir.h>
+#include <filecleanuphandler.h>
+
+#include <gtest/gtest.h>
+#include <functional>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * Runs a function on clean and reports the given paths as required
+ */
+class TestCleanUpHandler : public CleanUpHandler
+{
+public:
+    TestCleanUpHandler(std::function<bool ()> onClean,
+                       std::vector<std::string> paths = std::vector<std::string>()) :
+        m_onClean(onClean),
+        m_paths(paths)
+    {
+    }
+
+    bool clean() override
+    {
+        return m_onClean();
+    }
+
+    const std::string queryName() override
+    {
+        return "";
+    }
+
+    std::vector<std::string> requiredPaths() override
+    {
+        return m_paths;
+    }
+
+private:
+    std::function<bool ()> m_onClean;
+    std::vector<std::string> m_paths;
+};
+
+class CleanupRegistryTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-CleanupRegistryTest-XXXXXX");
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+TEST_F(CleanupRegistryTest, cleanRunsHandlersInReverseOrder)
+{
+    CleanupRegistry registry;
+    std::vector<int> order;
+    for (int i = 0; i < 3; i++) {
+        registry.add(new TestCleanUpHandler([&order, i] () {
+            order.push_back(i);
+            return true;
+        }));
+    }
+
+    ASSERT_EQ(3u, registry.size());
+    ASSERT_TRUE(registry.clean());
+    ASSERT_EQ(std::vector<int>({2, 1, 0}), order);
+    ASSERT_TRUE(registry.empty());
+}
+
+TEST_F(CleanupRegistryTest, cleanRunsAllHandlersOnFailure)
+{
+    CleanupRegistry registry;
+    int runCount = 0;
+    registry.add(new TestCleanUpHandler([&runCount] () { runCount++; return true; }));
+    registry.add(new TestCleanUpHandler([&runCount] () { runCount++; return false; }));
+    registry.add(new TestCleanUpHandler([&runCount] () { runCount++; return true; }));
+
+    ASSERT_FALSE(registry.clean());
+    ASSERT_EQ(3, runCount);
+}
+
+TEST_F(CleanupRegistryTest, containsRegisteredPaths)
+{
+    std::string file = buildPath(workdir, "file");
+    createFile(file);
+
+    CleanupRegistry registry;
+    registry.add(new FileCleanUpHandler(file));
+
+    ASSERT_TRUE(registry.contains(file));
+    ASSERT_FALSE(registry.contains(buildPath(workdir, "other")));
+
+    ASSERT_TRUE(registry.clean());
+    ASSERT_FALSE(existsInFileSystem(file));
+    ASSERT_FALSE(registry.contains(file));
+}
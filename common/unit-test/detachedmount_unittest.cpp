@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <detachedmount.h>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class DetachedMountTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-DetachedMountTest-XXXXXX");
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+TEST_F(DetachedMountTest, cloneMissingPathFails)
+{
+    DetachedMount mount;
+    ASSERT_FALSE(mount.clone(buildPath(workdir, "missing")));
+}
+
+TEST_F(DetachedMountTest, attachWithoutCloneFails)
+{
+    DetachedMount mount;
+    ASSERT_FALSE(mount.attach(getpid(), buildPath(workdir, "target"), true));
+    ASSERT_EQ(EINVAL, errno);
+}
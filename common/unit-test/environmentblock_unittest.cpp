@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <environmentblock.h>
+
+#include <gtest/gtest.h>
+
+using namespace softwarecontainer;
+
+class EnvironmentBlockTest: public ::testing::Test
+{
+public:
+    std::vector<std::string> toStrings(char **envp)
+    {
+        std::vector<std::string> strings;
+        for (char **entry = envp; *entry != nullptr; entry++) {
+            strings.push_back(*entry);
+        }
+        return strings;
+    }
+};
+
+/*
+ * An empty block gives an empty, null terminated array
+ */
+TEST_F(EnvironmentBlockTest, emptyBlock)
+{
+    EnvironmentBlock block;
+    char **envp = block.envp();
+
+    ASSERT_NE(envp, nullptr);
+    ASSERT_EQ(envp[0], nullptr);
+    ASSERT_EQ(block.version(), 0u);
+}
+
+/*
+ * The array is only rebuilt when a variable changes, and setting the same value again is not a change
+ */
+TEST_F(EnvironmentBlockTest, rebuiltOnlyOnChange)
+{
+    EnvironmentBlock block;
+    ASSERT_TRUE(block.set("B", "2"));
+    ASSERT_TRUE(block.set("A", "1"));
+    ASSERT_EQ(block.version(), 2u);
+
+    char **envp = block.envp();
+    ASSERT_EQ(toStrings(envp), std::vector<std::string>({"A=1", "B=2"}));
+    ASSERT_EQ(block.envp(), envp);
+
+    ASSERT_FALSE(block.set("A", "1"));
+    ASSERT_EQ(block.version(), 2u);
+    ASSERT_EQ(block.envp(), envp);
+
+    ASSERT_TRUE(block.set("A", "3"));
+    ASSERT_EQ(block.version(), 3u);
+    ASSERT_EQ(toStrings(block.envp()), std::vector<std::string>({"A=3", "B=2"}));
+}
+
+/*
+ * Overrides take precedence over the block, and entries not overridden are shared with the block
+ */
+TEST_F(EnvironmentBlockTest, overridesLayeredOnTop)
+{
+    EnvironmentBlock block;
+    block.set("A", "1");
+    block.set("B", "2");
+    block.set("C", "3");
+    char **base = block.envp();
+
+    std::vector<std::string> storage;
+    std::vector<char *> entries;
+    char **envp = block.envp({{"B", "20"}, {"D", "4"}}, storage, entries);
+
+    ASSERT_EQ(toStrings(envp), std::vector<std::string>({"A=1", "C=3", "B=20", "D=4"}));
+    ASSERT_EQ(envp[0], base[0]);
+    ASSERT_EQ(envp[1], base[2]);
+
+    // The block itself is left untouched
+    ASSERT_EQ(toStrings(block.envp()), std::vector<std::string>({"A=1", "B=2", "C=3"}));
+
+    // Without overrides the prebuilt array is used directly
+    ASSERT_EQ(block.envp({}, storage, entries), base);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <mounttable.h>
+
+#include <gtest/gtest.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class MountTableTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-MountTableTest-XXXXXX");
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+TEST_F(MountTableTest, parseMountInfo)
+{
+    std::string content =
+        "22 1 0:21 / / rw,relatime shared:1 - ext4 /dev/sda1 rw,errors=remount-ro\n"
+        "36 22 98:0 /mnt1 /mnt/with\\040space rw,noatime master:1 shared:2 - tmpfs tmpfs rw\n"
+        "37 22 0:5 / /dev rw - devtmpfs udev rw,size=10k\n";
+
+    std::vector<MountTable::Entry> entries;
+    ASSERT_TRUE(MountTable::parse(content, entries));
+    ASSERT_EQ(3u, entries.size());
+
+    ASSERT_EQ(22, entries[0].mountId);
+    ASSERT_EQ(1, entries[0].parentId);
+    ASSERT_EQ("/", entries[0].mountPoint);
+    ASSERT_EQ("ext4", entries[0].fsType);
+    ASSERT_EQ("/dev/sda1", entries[0].source);
+    ASSERT_EQ("rw,errors=remount-ro", entries[0].superOptions);
+
+    ASSERT_EQ("/mnt1", entries[1].root);
+    ASSERT_EQ("/mnt/with space", entries[1].mountPoint);
+    ASSERT_EQ("rw,noatime", entries[1].mountOptions);
+    ASSERT_EQ("tmpfs", entries[1].fsType);
+
+    ASSERT_EQ("/dev", entries[2].mountPoint);
+    ASSERT_EQ("devtmpfs", entries[2].fsType);
+}
+
+TEST_F(MountTableTest, parseRejectsMalformedLines)
+{
+    std::vector<MountTable::Entry> entries;
+    ASSERT_FALSE(MountTable::parse("22 1 0:21 / / rw,relatime shared:1 ext4 /dev/sda1 rw\n",
+                                   entries));
+    ASSERT_FALSE(MountTable::parse("22 1 0:21 /\n", entries));
+    ASSERT_TRUE(entries.empty());
+}
+
+TEST_F(MountTableTest, refreshReadsOwnMounts)
+{
+    MountTable table;
+    ASSERT_TRUE(table.refresh());
+    ASSERT_FALSE(table.entries().empty());
+    ASSERT_TRUE(table.isMountPoint("/"));
+    ASSERT_FALSE(table.isMountPoint(workdir));
+}
+
+TEST_F(MountTableTest, refreshFailsForMissingFile)
+{
+    MountTable table(buildPath(workdir, "mountinfo"));
+    ASSERT_FALSE(table.refresh());
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <namespaceworker.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+static const NamespaceWorker::CallResult DONE = NamespaceWorker::CallResult::Done;
+static const NamespaceWorker::CallResult NOT_SENT = NamespaceWorker::CallResult::NotSent;
+static const NamespaceWorker::CallResult LOST = NamespaceWorker::CallResult::Lost;
+
+class NamespaceWorkerTest: public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        m_worker.registerOperation("pid", [] (const char *const [], size_t) {
+            return static_cast<int>(getpid());
+        });
+        m_worker.registerOperation("count", [] (const char *const [], size_t count) {
+            return static_cast<int>(count);
+        });
+        m_worker.registerOperation("mkdir", [] (const char *const arguments[], size_t count) {
+            return count == 1 ? mkdir(arguments[0], 0755) : -1;
+        });
+        m_worker.registerOperation("die", [] (const char *const [], size_t) -> int {
+            _exit(0);
+        });
+    }
+
+    NamespaceWorker m_worker;
+};
+
+/*
+ * Registered operations are run in the helper process, with the arguments given to call()
+ */
+TEST_F(NamespaceWorkerTest, runsOperations)
+{
+    // Entering the namespaces of this process means entering none of them
+    ASSERT_TRUE(m_worker.start(getpid()));
+    ASSERT_TRUE(m_worker.isRunning());
+
+    int result = 0;
+    ASSERT_EQ(DONE, m_worker.call("pid", {}, result));
+    ASSERT_NE(result, getpid());
+
+    ASSERT_EQ(DONE, m_worker.call("count", {"a", "", "c"}, result));
+    ASSERT_EQ(result, 3);
+
+    m_worker.stop();
+    ASSERT_FALSE(m_worker.isRunning());
+    ASSERT_EQ(NOT_SENT, m_worker.call("count", {}, result));
+}
+
+/*
+ * Failing operations report errno, and unknown operations fail with EINVAL
+ */
+TEST_F(NamespaceWorkerTest, errors)
+{
+    ASSERT_TRUE(m_worker.start(getpid()));
+
+    int result = 0;
+    ASSERT_EQ(DONE, m_worker.call("mkdir", {"/nonexistent/directory"}, result));
+    ASSERT_EQ(result, -1);
+    ASSERT_EQ(errno, ENOENT);
+
+    ASSERT_EQ(DONE, m_worker.call("unknown", {}, result));
+    ASSERT_EQ(result, -1);
+    ASSERT_EQ(errno, EINVAL);
+}
+
+/*
+ * Calls with more arguments than the helper has room for are refused without stopping it
+ */
+TEST_F(NamespaceWorkerTest, tooManyArguments)
+{
+    ASSERT_TRUE(m_worker.start(getpid()));
+
+    int result = 0;
+    std::vector<std::string> arguments(NamespaceWorker::MAX_ARGUMENTS, "a");
+    ASSERT_EQ(DONE, m_worker.call("count", arguments, result));
+    ASSERT_EQ(result, static_cast<int>(NamespaceWorker::MAX_ARGUMENTS));
+
+    arguments.push_back("a");
+    ASSERT_EQ(NOT_SENT, m_worker.call("count", arguments, result));
+    ASSERT_TRUE(m_worker.isRunning());
+}
+
+/*
+ * The worker is stopped if the helper dies, and a call that was in progress is reported as lost
+ */
+TEST_F(NamespaceWorkerTest, helperDies)
+{
+    ASSERT_TRUE(m_worker.start(getpid()));
+
+    int result = 0;
+    ASSERT_EQ(LOST, m_worker.call("die", {}, result));
+    ASSERT_FALSE(m_worker.isRunning());
+    ASSERT_EQ(NOT_SENT, m_worker.call("count", {}, result));
+}
+
+/*
+ * Starting fails if the target process does not exist
+ */
+TEST_F(NamespaceWorkerTest, missingProcess)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+
+    ASSERT_FALSE(m_worker.start(pid));
+    ASSERT_FALSE(m_worker.isRunning());
+}
+
+/*
+ * Running an operation through the worker is faster than forking a process for it, which is
+ * what attaching to the container does for every operation. Attaching also enters the
+ * namespaces and sets up the process, so forking is a lower bound for the cost of it.
+ */
+TEST_F(NamespaceWorkerTest, fasterThanForking)
+{
+    static const int CALLS = 200;
+    ASSERT_TRUE(m_worker.start(getpid()));
+
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < CALLS; i++) {
+        int result = 0;
+        ASSERT_EQ(DONE, m_worker.call("count", {"a"}, result));
+        ASSERT_EQ(result, 1);
+    }
+    auto workerTime = std::chrono::steady_clock::now() - started;
+
+    started = std::chrono::steady_clock::now();
+    for (int i = 0; i < CALLS; i++) {
+        pid_t pid = fork();
+        ASSERT_NE(pid, -1);
+        if (pid == 0) {
+            const char *const arguments[] = {"a"};
+            _exit(arguments[0][0] == 'a' ? 0 : 1);
+        }
+        int status = 0;
+        ASSERT_EQ(pid, waitpid(pid, &status, 0));
+        ASSERT_EQ(0, WEXITSTATUS(status));
+    }
+    auto forkTime = std::chrono::steady_clock::now() - started;
+
+    auto microseconds = [] (std::chrono::steady_clock::duration time) {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(time).count()
+                                / CALLS);
+    };
+    RecordProperty("workerCallUs", microseconds(workerTime));
+    RecordProperty("forkCallUs", microseconds(forkTime));
+    ASSERT_LT(workerTime, forkTime);
+}
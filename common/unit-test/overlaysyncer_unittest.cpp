@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <overlaysyncer.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <unistd.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class OverlaySyncerTest: public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        journalDir = buildPath(cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX"),
+                               "journal");
+        upper = cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX");
+        lower = cd.createTempDirectoryFromTemplate("/tmp/sc-overlaysyncerTest-XXXXXX");
+    }
+
+    void TearDown() override
+    {
+        OverlaySyncer::getInstance().stop();
+        rmdir(journalDir.c_str());
+    }
+
+    bool start()
+    {
+        return OverlaySyncer::getInstance().start(journalDir,
+            [this] (const std::string &tag, bool success) {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_results.push_back(std::make_pair(tag, success));
+                m_done.notify_all();
+            });
+    }
+
+    // Waits for count syncs to be reported
+    bool waitForResults(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        return m_done.wait_for(lock, std::chrono::seconds(10), [this, count] () {
+            return m_results.size() >= count;
+        });
+    }
+
+    /*
+     * Sets up a staging directory the way a stopped syncer leaves it behind
+     */
+    std::string createStagingDir(const std::string &tag, bool withJournal)
+    {
+        std::string stagingDir = buildPath(journalDir, tag + "-resume");
+        mkdir(journalDir.c_str(), S_IRWXU);
+        createDir(stagingDir);
+        createDir(buildPath(stagingDir, "upper"));
+        createDir(buildPath(stagingDir, "lower"));
+        if (withJournal) {
+            createFile(buildPath(stagingDir, "journal"),
+                       "tag=" + tag + "\nupper=" + upper + "\nlower=" + lower + "\n");
+        }
+        return stagingDir;
+    }
+
+    CreateDir cd;
+    std::string journalDir;
+    std::string upper;
+    std::string lower;
+
+    std::mutex m_lock;
+    std::condition_variable m_done;
+    std::vector<std::pair<std::string, bool>> m_results;
+};
+
+/*
+ * Jobs are refused until the syncer is started, so callers can sync synchronously instead
+ */
+TEST_F(OverlaySyncerTest, enqueueFailsWhenNotStarted)
+{
+    ASSERT_FALSE(OverlaySyncer::getInstance().isRunning());
+    ASSERT_FALSE(OverlaySyncer::getInstance().enqueue("SC-0", upper, lower));
+}
+
+/*
+ * Only the synced directories can be handed over to be removed after the sync
+ */
+TEST_F(OverlaySyncerTest, enqueueRefusesRemovingOtherDirectories)
+{
+    ASSERT_TRUE(start());
+    ASSERT_FALSE(OverlaySyncer::getInstance().enqueue("SC-5", upper, lower, { journalDir }));
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+}
+
+/*
+ * A journaled job whose upper directory is gone, e.g. since a reboot cleared the tmpfs it was
+ * on, is reported as failed
+ */
+TEST_F(OverlaySyncerTest, resumeWithoutUpperFails)
+{
+    createStagingDir("SC-3", true);
+    ASSERT_EQ(0, rmdir(upper.c_str()));
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(waitForResults(1));
+
+    ASSERT_EQ(m_results[0].first, "SC-3");
+    ASSERT_FALSE(m_results[0].second);
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+}
+
+/*
+ * A staging directory without journal was never fully set up and is just removed
+ */
+TEST_F(OverlaySyncerTest, incompleteStagingDirIsRemoved)
+{
+    createStagingDir("SC-4", false);
+
+    ASSERT_TRUE(start());
+    ASSERT_TRUE(isDirectoryEmpty(journalDir));
+    ASSERT_TRUE(m_results.empty());
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <pressuremonitor.h>
+
+#include <gtest/gtest.h>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+class PressureMonitorTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-PressureMonitorTest-XXXXXX");
+    }
+
+    PressureMonitor::PressureCallback ignorePressure = [] (int, const std::string &, double) {};
+    PressureMonitor::MemoryEventCallback ignoreEvents = [] (int, const std::string &, uint64_t) {};
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+/*
+ * memory.events is parsed into its counters
+ */
+TEST_F(PressureMonitorTest, parseMemoryEvents)
+{
+    auto events = PressureMonitor::parseMemoryEvents("low 0\nhigh 12\nmax 3\noom 1\noom_kill 1\n");
+    ASSERT_EQ(5u, events.size());
+    ASSERT_EQ(12u, events["high"]);
+    ASSERT_EQ(3u, events["max"]);
+    ASSERT_EQ(1u, events["oom_kill"]);
+
+    ASSERT_TRUE(PressureMonitor::parseMemoryEvents("").empty());
+}
+
+/*
+ * The avg10 value of the "some" line is used, not the one of the "full" line
+ */
+TEST_F(PressureMonitorTest, parseSomeAvg10)
+{
+    double avg10 = 0;
+    ASSERT_TRUE(PressureMonitor::parseSomeAvg10(
+        "some avg10=12.50 avg60=3.00 avg300=1.00 total=123456\n"
+        "full avg10=2.25 avg60=1.00 avg300=0.50 total=23456\n", avg10));
+    ASSERT_DOUBLE_EQ(12.5, avg10);
+
+    ASSERT_FALSE(PressureMonitor::parseSomeAvg10("full avg10=2.25\n", avg10));
+    ASSERT_FALSE(PressureMonitor::parseSomeAvg10("some avg10=x\n", avg10));
+}
+
+/*
+ * Only kernel files can be watched, plain files are rejected by epoll and trigger registration
+ */
+TEST_F(PressureMonitorTest, watchWithoutPressureFiles)
+{
+    PressureMonitor monitor(Glib::MainContext::get_default(), 100000, 1000000,
+                            ignorePressure, ignoreEvents);
+
+    ASSERT_FALSE(monitor.watchCgroup(1, workdir));
+    ASSERT_FALSE(monitor.watchHost(workdir));
+
+    createFile(buildPath(workdir, "memory.events"), "high 0\n");
+    createFile(buildPath(workdir, "memory.pressure"), "");
+    ASSERT_FALSE(monitor.watchCgroup(1, workdir));
+    ASSERT_EQ(0u, monitor.watchedCount());
+}
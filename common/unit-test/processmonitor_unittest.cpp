@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <processmonitor.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+class ProcessMonitorTest: public ::testing::Test
+{
+public:
+    pid_t startChild(int exitCode, unsigned int sleepSeconds = 0)
+    {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (sleepSeconds > 0) {
+                sleep(sleepSeconds);
+            }
+            _exit(exitCode);
+        }
+        return pid;
+    }
+};
+
+/*
+ * Exit callbacks are dispatched from the main loop for all watched processes
+ */
+TEST_F(ProcessMonitorTest, watchDispatchesExits)
+{
+    Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::get_default();
+    ProcessMonitor monitor(context);
+
+    std::map<pid_t, int> expected;
+    std::map<pid_t, int> exited;
+    for (int i = 0; i < 50; i++) {
+        pid_t pid = startChild(i);
+        ASSERT_GT(pid, 0);
+        expected[pid] = i;
+        ASSERT_TRUE(monitor.watch(pid, [&exited] (pid_t pid, int status, const ProcessUsage &) {
+            exited[pid] = WEXITSTATUS(status);
+        }));
+    }
+    ASSERT_EQ(monitor.watchedCount(), 50u);
+
+    while (exited.size() < expected.size()) {
+        context->iteration(true);
+    }
+
+    ASSERT_EQ(exited, expected);
+    ASSERT_EQ(monitor.watchedCount(), 0u);
+}
+
+/*
+ * Unwatched processes do not get their callback called
+ */
+TEST_F(ProcessMonitorTest, unwatch)
+{
+    Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::get_default();
+    ProcessMonitor monitor(context);
+
+    bool called = false;
+    pid_t pid = startChild(0, 10);
+    ASSERT_TRUE(monitor.watch(pid, [&called] (pid_t, int, const ProcessUsage &) { called = true; }));
+    ASSERT_FALSE(monitor.watch(pid, [] (pid_t, int, const ProcessUsage &) {}));
+
+    monitor.unwatch(pid);
+    ASSERT_EQ(monitor.watchedCount(), 0u);
+
+    kill(pid, SIGKILL);
+    ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+    while (context->iteration(false)) {}
+    ASSERT_FALSE(called);
+}
+
+/*
+ * Unwatching a process that has exited reaps it, so it is not left as a zombie
+ */
+TEST_F(ProcessMonitorTest, unwatchReapsExited)
+{
+    Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::get_default();
+    ProcessMonitor monitor(context);
+
+    pid_t pid = startChild(0);
+    ASSERT_TRUE(monitor.watch(pid, [] (pid_t, int, const ProcessUsage &) {}));
+
+    // Wait for the exit without reaping the process
+    siginfo_t info = {};
+    ASSERT_EQ(waitid(P_PID, pid, &info, WEXITED | WNOWAIT), 0);
+
+    monitor.unwatch(pid);
+    ASSERT_EQ(waitpid(pid, nullptr, WNOHANG), -1);
+    ASSERT_EQ(errno, ECHILD);
+}
+
+/*
+ * The resources used by a process are reported when it exits
+ */
+TEST_F(ProcessMonitorTest, usage)
+{
+    Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::get_default();
+    ProcessMonitor monitor(context);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Burn some CPU time and sleep for a while
+        volatile uint64_t counter = 0;
+        for (uint64_t i = 0; i < 100000000; i++) {
+            counter += i;
+        }
+        usleep(100 * 1000);
+        _exit(0);
+    }
+    ASSERT_GT(pid, 0);
+
+    bool exited = false;
+    ProcessUsage usage;
+    ASSERT_TRUE(monitor.watch(pid, [&] (pid_t, int, const ProcessUsage &processUsage) {
+        usage = processUsage;
+        exited = true;
+    }));
+
+    while (!exited) {
+        context->iteration(true);
+    }
+
+    ASSERT_GT(usage.userTimeUs + usage.systemTimeUs, 0u);
+    ASSERT_GT(usage.maxRssKb, 0u);
+    ASSERT_GE(usage.runtimeMs, 100u);
+}
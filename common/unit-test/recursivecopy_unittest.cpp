@@ -24,6 +24,12 @@
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "unittest_common_helpers.h"
 
@@ -117,3 +123,123 @@ TEST_F(RecursiveCopyTest, copyDirFilesToFilesOverWrite)
     ASSERT_TRUE(checkContent(srcFile, content1));
     ASSERT_TRUE(checkContent(dstFile, content1));
 }
+
+TEST_F(RecursiveCopyTest, copySubdirectories)
+{
+    std::string srcSub = buildPath(srcdir, "a");
+    std::string srcSubSub = buildPath(srcSub, "b");
+    createDir(srcSub);
+    createDir(srcSubSub);
+    createFile(buildPath(srcSubSub, "lala.txt"), "nested");
+
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+
+    ASSERT_TRUE(isDirectory(buildPath(dstdir, "a/b")));
+    ASSERT_TRUE(checkContent(buildPath(dstdir, "a/b/lala.txt"), "nested"));
+}
+
+/*
+ * Copies running at the same time share the worker pool, and each copy returns only when all
+ * of its own files are copied
+ */
+TEST_F(RecursiveCopyTest, copyConcurrently)
+{
+    const int files = 200;
+    for (int i = 0; i < files; i++) {
+        createFile(buildPath(srcdir, std::to_string(i)), std::to_string(i));
+    }
+
+    const int copies = 4;
+    std::vector<std::thread> threads;
+    std::vector<int> results(copies, 0);
+    for (int i = 0; i < copies; i++) {
+        threads.emplace_back([this, i, &results] () {
+            std::string dst = buildPath(dstdir, std::to_string(i));
+            if (!RecursiveCopy::getInstance().copy(srcdir, dst)) {
+                return;
+            }
+            for (int file = 0; file < files; file++) {
+                if (!checkContent(buildPath(dst, std::to_string(file)), std::to_string(file))) {
+                    return;
+                }
+            }
+            results[i] = 1;
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(std::vector<int>(copies, 1), results);
+}
+
+TEST_F(RecursiveCopyTest, copyPreservesPermissionsAndTimes)
+{
+    std::string srcFile = buildPath(srcdir, "script.sh");
+    std::string srcSub = buildPath(srcdir, "readonly");
+    createFile(srcFile);
+    createDir(srcSub);
+    createFile(buildPath(srcSub, "lala.txt"));
+
+    ASSERT_EQ(chmod(srcFile.c_str(), 0750), 0);
+    ASSERT_EQ(chmod(srcSub.c_str(), 0555), 0);
+    const struct timespec times[2] = { { 1000, 0 }, { 2000, 0 } };
+    ASSERT_EQ(utimensat(AT_FDCWD, srcFile.c_str(), times, 0), 0);
+
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+
+    struct stat st;
+    ASSERT_EQ(stat(buildPath(dstdir, "script.sh").c_str(), &st), 0);
+    ASSERT_EQ(st.st_mode & 07777, 0750u);
+    ASSERT_EQ(st.st_mtim.tv_sec, 2000);
+
+    ASSERT_EQ(stat(buildPath(dstdir, "readonly").c_str(), &st), 0);
+    ASSERT_EQ(st.st_mode & 07777, 0555u);
+    ASSERT_TRUE(isFile(buildPath(dstdir, "readonly/lala.txt")));
+
+    // Let the fixture directories be cleaned up
+    chmod(srcSub.c_str(), 0755);
+    chmod(buildPath(dstdir, "readonly").c_str(), 0755);
+}
+
+TEST_F(RecursiveCopyTest, copySymlink)
+{
+    std::string srcLink = buildPath(srcdir, "link");
+    std::string dstLink = buildPath(dstdir, "link");
+    ASSERT_EQ(symlink("/does/not/exist", srcLink.c_str()), 0);
+
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+
+    char target[64] = {};
+    ASSERT_GT(readlink(dstLink.c_str(), target, sizeof(target) - 1), 0);
+    ASSERT_EQ(std::string(target), "/does/not/exist");
+}
+
+/*
+ * Benchmark, run with --gtest_also_run_disabled_tests --gtest_output=xml to get the timings
+ */
+TEST_F(RecursiveCopyTest, DISABLED_copyLargeTreeThroughput)
+{
+    const int dirCount = 100;
+    const int filesPerDir = 100;
+    const std::string content(64 * 1024, 'x');
+
+    for (int i = 0; i < dirCount; i++) {
+        std::string dir = buildPath(srcdir, std::to_string(i));
+        createDir(dir);
+        for (int j = 0; j < filesPerDir; j++) {
+            createFile(buildPath(dir, std::to_string(j)), content);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(RecursiveCopy::getInstance().copy(srcdir, dstdir));
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start).count();
+
+    RecordProperty("files", dirCount * filesPerDir);
+    RecordProperty("bytes", static_cast<int>(dirCount * filesPerDir * content.size()));
+    RecordProperty("elapsedMs", static_cast<int>(elapsed));
+
+    ASSERT_TRUE(checkContent(buildPath(dstdir, "99/99"), content));
+}
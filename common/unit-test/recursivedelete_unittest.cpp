@@ -25,6 +25,9 @@
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <fstream>
+#include <chrono>
+
+#include <sys/stat.h>
 
 #include "unittest_common_helpers.h"
 
@@ -84,3 +87,90 @@ TEST_F(RecursiveDeleteTest, deleteWithFilesAndDirs)
     ASSERT_TRUE(isDirectoryEmpty(workdir));
 }
 
+TEST_F(RecursiveDeleteTest, deleteDeepTree)
+{
+    std::string dir = testdir;
+    for (int i = 0; i < 50; i++) {
+        dir = buildPath(dir, "d" + std::to_string(i));
+        createDir(dir);
+        createFile(buildPath(dir, "file"));
+    }
+
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(testdir));
+    ASSERT_TRUE(isDirectoryEmpty(workdir));
+}
+
+TEST_F(RecursiveDeleteTest, deleteDoesNotFollowSymlinks)
+{
+    std::string outside = buildPath(workdir, "outside");
+    createDir(outside);
+    createFile(buildPath(outside, "keep.txt"));
+    ASSERT_EQ(0, symlink(outside.c_str(), buildPath(testdir, "link").c_str()));
+
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(testdir));
+    ASSERT_FALSE(existsInFileSystem(testdir));
+    ASSERT_TRUE(isFile(buildPath(outside, "keep.txt")));
+}
+
+TEST_F(RecursiveDeleteTest, deleteNonDirectory)
+{
+    std::string file = buildPath(testdir, "subfile");
+    createFile(file);
+
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(file));
+    ASSERT_FALSE(existsInFileSystem(file));
+}
+
+TEST_F(RecursiveDeleteTest, deleteMissingFails)
+{
+    ASSERT_FALSE(RecursiveDelete::getInstance().del(buildPath(testdir, "missing")));
+    ASSERT_EQ(ENOENT, errno);
+}
+
+/*
+ * Entries that can not be removed are reported, but everything else is still removed
+ * This test is disabled since permissions are not enforced for root, which the unit tests
+ * are run as. It will be enabled again when that necessity is removed.
+ */
+TEST_F(RecursiveDeleteTest, DISABLED_deleteReportsErrors)
+{
+    std::string locked = buildPath(testdir, "locked");
+    createDir(locked);
+    createFile(buildPath(locked, "subfile"));
+    createFile(buildPath(testdir, "subfile"));
+    chmod(locked.c_str(), S_IRUSR | S_IXUSR);
+
+    ASSERT_FALSE(RecursiveDelete::getInstance().del(testdir));
+    ASSERT_EQ(EACCES, errno);
+    ASSERT_FALSE(existsInFileSystem(buildPath(testdir, "subfile")));
+    ASSERT_TRUE(isFile(buildPath(locked, "subfile")));
+
+    chmod(locked.c_str(), S_IRWXU);
+}
+
+/*
+ * Benchmark, run with --gtest_also_run_disabled_tests --gtest_output=xml to get the timings
+ */
+TEST_F(RecursiveDeleteTest, DISABLED_deleteLargeTreeThroughput)
+{
+    const int dirCount = 100;
+    const int filesPerDir = 1000;
+
+    for (int i = 0; i < dirCount; i++) {
+        std::string dir = buildPath(testdir, std::to_string(i));
+        createDir(dir);
+        for (int j = 0; j < filesPerDir; j++) {
+            createFile(buildPath(dir, std::to_string(j)));
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(RecursiveDelete::getInstance().del(testdir));
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start).count();
+
+    RecordProperty("files", dirCount * filesPerDir);
+    RecordProperty("elapsedMs", static_cast<int>(elapsed));
+
+    ASSERT_TRUE(isDirectoryEmpty(workdir));
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <resourcesampler.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "unittest_common_helpers.h"
+
+using namespace softwarecontainer;
+
+/*
+ * The control files of a cgroup are plain files in a temporary directory in these tests,
+ * with contents in the format the kernel uses.
+ */
+class ResourceSamplerTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-ResourceSamplerTest-XXXXXX");
+    }
+
+    std::string createCgroup(const std::string &name)
+    {
+        std::string path = buildPath(workdir, name);
+        cd.createDirectory(path);
+        writeCgroup(path, 1000, 0, 0);
+        return path;
+    }
+
+    void writeCgroup(const std::string &path, uint64_t memory, uint64_t cpu, uint64_t io)
+    {
+        writeToFile(buildPath(path, "memory.current"), std::to_string(memory) + "\n");
+        writeToFile(buildPath(path, "memory.stat"),
+                    "anon " + std::to_string(memory / 2) + "\n"
+                    "file " + std::to_string(memory / 4) + "\n"
+                    "kernel_stack 16384\n"
+                    "anon_thp 0\n"
+                    "file_mapped 8192\n");
+        writeToFile(buildPath(path, "cpu.stat"),
+                    "usage_usec " + std::to_string(cpu) + "\n"
+                    "user_usec " + std::to_string(cpu / 2) + "\n"
+                    "system_usec " + std::to_string(cpu - cpu / 2) + "\n"
+                    "nr_periods 0\n"
+                    "nr_throttled 0\n"
+                    "throttled_usec 0\n");
+        writeToFile(buildPath(path, "io.stat"),
+                    "8:0 rbytes=" + std::to_string(io) + " wbytes=" + std::to_string(2 * io)
+                    + " rios=3 wios=4 dbytes=0 dios=0\n"
+                    "8:16 rbytes=" + std::to_string(io) + " wbytes=0 rios=1 wios=0 dbytes=0 dios=0\n");
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+/*
+ * A sample is parsed from all the control files, with io.stat summed over all devices
+ */
+TEST_F(ResourceSamplerTest, sample)
+{
+    ResourceSampler sampler(4);
+    std::string path = createCgroup("a");
+    writeCgroup(path, 4096, 3000, 100);
+    ASSERT_TRUE(sampler.add(1, path));
+
+    ResourceSample sample;
+    ASSERT_FALSE(sampler.latest(1, sample));
+
+    sampler.sample();
+    ASSERT_TRUE(sampler.latest(1, sample));
+    ASSERT_EQ(4096u, sample.memoryCurrent);
+    ASSERT_EQ(2048u, sample.memoryAnon);
+    ASSERT_EQ(1024u, sample.memoryFile);
+    ASSERT_EQ(3000u, sample.cpuUsageUs);
+    ASSERT_EQ(1500u, sample.cpuUserUs);
+    ASSERT_EQ(1500u, sample.cpuSystemUs);
+    ASSERT_EQ(200u, sample.ioReadBytes);
+    ASSERT_EQ(200u, sample.ioWriteBytes);
+    ASSERT_EQ(4u, sample.ioReadOps);
+    ASSERT_EQ(4u, sample.ioWriteOps);
+
+    // Nothing can be sampled from a directory without control files
+    ASSERT_FALSE(sampler.add(2, workdir));
+    ASSERT_FALSE(sampler.latest(2, sample));
+}
+
+/*
+ * Only the most recent samples are kept, and the delta is computed from the last two
+ */
+TEST_F(ResourceSamplerTest, historyAndDelta)
+{
+    ResourceSampler sampler(3);
+    std::string path = createCgroup("a");
+    ASSERT_TRUE(sampler.add(1, path));
+
+    ResourceSample delta;
+    sampler.sample();
+    ASSERT_FALSE(sampler.latestDelta(1, delta));
+
+    for (uint64_t i = 1; i <= 4; i++) {
+        writeCgroup(path, 1000 * i, 500 * i, 10 * i);
+        sampler.sample();
+    }
+
+    std::vector<ResourceSample> history = sampler.history(1);
+    ASSERT_EQ(3u, history.size());
+    ASSERT_EQ(2000u, history[0].memoryCurrent);
+    ASSERT_EQ(3000u, history[1].memoryCurrent);
+    ASSERT_EQ(4000u, history[2].memoryCurrent);
+
+    ASSERT_TRUE(sampler.latestDelta(1, delta));
+    ASSERT_EQ(4000u, delta.memoryCurrent);
+    ASSERT_EQ(500u, delta.cpuUsageUs);
+    ASSERT_EQ(20u, delta.ioReadBytes);
+
+    // A counter that goes backwards gives no increase
+    writeCgroup(path, 1000, 0, 0);
+    sampler.sample();
+    ASSERT_TRUE(sampler.latestDelta(1, delta));
+    ASSERT_EQ(0u, delta.cpuUsageUs);
+
+    sampler.remove(1);
+    ASSERT_TRUE(sampler.history(1).empty());
+    ASSERT_TRUE(sampler.ids().empty());
+}
+
+/*
+ * The sampler thread takes samples until it is stopped
+ */
+TEST_F(ResourceSamplerTest, thread)
+{
+    ResourceSampler sampler(100);
+    ASSERT_TRUE(sampler.add(1, createCgroup("a")));
+
+    ASSERT_FALSE(sampler.start(0));
+    ASSERT_TRUE(sampler.start(10));
+    ASSERT_TRUE(sampler.isRunning());
+    ASSERT_FALSE(sampler.start(10));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sampler.stop();
+    ASSERT_FALSE(sampler.isRunning());
+
+    size_t samples = sampler.history(1).size();
+    ASSERT_GE(samples, 2u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_EQ(samples, sampler.history(1).size());
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <ringbuffer.h>
+
+#include <gtest/gtest.h>
+
+using namespace softwarecontainer;
+
+class RingBufferTest: public ::testing::Test
+{
+};
+
+/*
+ * Data fitting in the buffer is kept as is, and tail returns the most recent bytes
+ */
+TEST_F(RingBufferTest, tail)
+{
+    RingBuffer buffer(16);
+    ASSERT_EQ(buffer.tail(16), "");
+
+    buffer.write("hello ", 6);
+    buffer.write("world", 5);
+
+    ASSERT_EQ(buffer.size(), 11u);
+    ASSERT_EQ(buffer.tail(100), "hello world");
+    ASSERT_EQ(buffer.tail(5), "world");
+}
+
+/*
+ * The oldest bytes are dropped when the buffer wraps around
+ */
+TEST_F(RingBufferTest, wrapAround)
+{
+    RingBuffer buffer(8);
+    buffer.write("0123456", 7);
+    buffer.write("789", 3);
+
+    ASSERT_EQ(buffer.size(), 8u);
+    ASSERT_EQ(buffer.tail(8), "23456789");
+    ASSERT_EQ(buffer.tail(4), "6789");
+    ASSERT_EQ(buffer.totalWritten(), 10u);
+
+    // A write larger than the buffer keeps only its last bytes
+    buffer.write("abcdefghijkl", 12);
+    ASSERT_EQ(buffer.tail(8), "efghijkl");
+    ASSERT_EQ(buffer.totalWritten(), 22u);
+}
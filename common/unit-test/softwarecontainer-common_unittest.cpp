@@ -284,6 +284,27 @@ TEST_F(SoftwareContainerCommonTest, ParentPathWorksAsExpected) {
     EXPECT_EQ(parentPath("home/test/some-file.txt"), "home/test");
 }
 
+TEST_F(SoftwareContainerCommonTest, CpuListsAreParsedAndFormatted) {
+    std::vector<unsigned int> cpus;
+    ASSERT_TRUE(parseCpuList("0-3,6\n", cpus));
+    EXPECT_EQ(cpus, std::vector<unsigned int>({ 0, 1, 2, 3, 6 }));
+    ASSERT_TRUE(parseCpuList("5,1,1-2", cpus));
+    EXPECT_EQ(cpus, std::vector<unsigned int>({ 1, 2, 5 }));
+
+    EXPECT_FALSE(parseCpuList("", cpus));
+    EXPECT_FALSE(parseCpuList("3-1", cpus));
+    EXPECT_FALSE(parseCpuList("1,", cpus));
+    EXPECT_FALSE(parseCpuList("1,,2", cpus));
+    EXPECT_FALSE(parseCpuList("-1", cpus));
+    EXPECT_FALSE(parseCpuList("1-", cpus));
+    EXPECT_FALSE(parseCpuList("a", cpus));
+
+    EXPECT_EQ(formatCpuList({ 0, 1, 2, 3, 6 }), "0-3,6");
+    EXPECT_EQ(formatCpuList({ 7, 5, 4, 4 }), "4-5,7");
+    EXPECT_EQ(formatCpuList({ 2 }), "2");
+    EXPECT_EQ(formatCpuList({}), "");
+}
+
 TEST_F(SoftwareContainerCommonTest, BaseNameWorksAsExpected) {
     EXPECT_EQ(baseName("/"), "/");
     EXPECT_EQ(baseName("/usr/"), "usr");
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <softwarecontainer-common.h>
+#include <createdir.h>
+#include <unifiedcgroup.h>
+
+#include <gtest/gtest.h>
+
+#include "unittest_common_helpers.h"
+
+#include <csignal>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace softwarecontainer;
+
+/*
+ * The control files of a cgroup are plain files in a temporary directory in these tests, so
+ * they are created before they are written, like the kernel would have done.
+ */
+class UnifiedCgroupTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        workdir = cd.createTempDirectoryFromTemplate("/tmp/sc-UnifiedCgroupTest-XXXXXX");
+        for (auto file : { "memory.max", "memory.swap.max", "cpu.weight", "io.weight" }) {
+            createFile(buildPath(workdir, file), "");
+        }
+    }
+
+    CreateDir cd;
+    std::string workdir;
+};
+
+/*
+ * cgroup v1 settings are translated to their cgroup v2 equivalents
+ */
+TEST_F(UnifiedCgroupTest, translate)
+{
+    std::string key;
+    std::string value;
+
+    ASSERT_TRUE(UnifiedCgroup::translate("memory.limit_in_bytes", "1048576", key, value));
+    ASSERT_EQ("memory.max", key);
+    ASSERT_EQ("1048576", value);
+
+    ASSERT_TRUE(UnifiedCgroup::translate("memory.limit_in_bytes", "-1", key, value));
+    ASSERT_EQ("max", value);
+
+    ASSERT_TRUE(UnifiedCgroup::translate("cpu.shares", "1024", key, value));
+    ASSERT_EQ("cpu.weight", key);
+    ASSERT_EQ("39", value);
+    ASSERT_TRUE(UnifiedCgroup::translate("cpu.shares", "2", key, value));
+    ASSERT_EQ("1", value);
+    ASSERT_TRUE(UnifiedCgroup::translate("cpu.shares", "262144", key, value));
+    ASSERT_EQ("10000", value);
+
+    ASSERT_TRUE(UnifiedCgroup::translate("blkio.weight", "500", key, value));
+    ASSERT_EQ("io.weight", key);
+    ASSERT_EQ("4950", value);
+
+    // cgroup v2 settings are passed through
+    ASSERT_TRUE(UnifiedCgroup::translate("memory.high", "4096", key, value));
+    ASSERT_EQ("memory.high", key);
+    ASSERT_EQ("4096", value);
+
+    ASSERT_FALSE(UnifiedCgroup::translate("net_cls.classid", "0x10001", key, value));
+    ASSERT_FALSE(UnifiedCgroup::translate("cpu.shares", "many", key, value));
+}
+
+/*
+ * Only io.max and io.weight hold one line per device
+ */
+TEST_F(UnifiedCgroupTest, isPerDeviceSetting)
+{
+    ASSERT_TRUE(UnifiedCgroup::isPerDeviceSetting("io.max"));
+    ASSERT_TRUE(UnifiedCgroup::isPerDeviceSetting("io.weight"));
+    ASSERT_FALSE(UnifiedCgroup::isPerDeviceSetting("blkio.weight"));
+    ASSERT_FALSE(UnifiedCgroup::isPerDeviceSetting("memory.max"));
+}
+
+/*
+ * Settings are written to the control files of the opened cgroup
+ */
+TEST_F(UnifiedCgroupTest, set)
+{
+    UnifiedCgroup cgroup;
+    ASSERT_FALSE(cgroup.set("memory.max", "4096"));
+
+    ASSERT_TRUE(cgroup.open(workdir));
+    ASSERT_TRUE(cgroup.isOpen());
+
+    ASSERT_TRUE(cgroup.set("cpu.shares", "1024"));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cpu.weight"), "39"));
+
+    ASSERT_TRUE(cgroup.set("memory.limit_in_bytes", "1000"));
+    ASSERT_TRUE(cgroup.set("memory.memsw.limit_in_bytes", "1500"));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "memory.max"), "1000"));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "memory.swap.max"), "500"));
+
+    std::string value;
+    ASSERT_TRUE(cgroup.read("memory.max", value));
+    ASSERT_EQ("1000", value);
+
+    // Missing control files, e.g. for disabled controllers, are errors
+    ASSERT_FALSE(cgroup.set("pids.max", "10"));
+    ASSERT_FALSE(cgroup.set("net_cls.classid", "0x10001"));
+
+    cgroup.close();
+    ASSERT_FALSE(cgroup.isOpen());
+    ASSERT_FALSE(cgroup.read("memory.max", value));
+}
+
+/*
+ * Several settings are applied as one update, which is rolled back if any of them fails
+ */
+TEST_F(UnifiedCgroupTest, setSeveral)
+{
+    createFile(buildPath(workdir, "cpu.weight"), "100");
+    createFile(buildPath(workdir, "memory.max"), "max");
+
+    UnifiedCgroup cgroup;
+    ASSERT_TRUE(cgroup.open(workdir));
+
+    // memory.high does not exist, so cpu.weight is restored after it has been written
+    ASSERT_FALSE(cgroup.set({ { "cpu.weight", "200" }, { "memory.high", "1000" } }));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cpu.weight"), "100"));
+
+    ASSERT_FALSE(cgroup.set({ { "cpu.weight", "200" }, { "net_cls.classid", "0x10001" } }));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cpu.weight"), "100"));
+
+    ASSERT_TRUE(cgroup.set({ { "cpu.weight", "300" }, { "memory.max", "4096" } }));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cpu.weight"), "300"));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "memory.max"), "4096"));
+}
+
+/*
+ * io.max takes one device per write, and devices that were not limited before get their
+ * limits removed again when an update is rolled back
+ */
+TEST_F(UnifiedCgroupTest, setPerDevice)
+{
+    UnifiedCgroup cgroup;
+    ASSERT_TRUE(cgroup.open(workdir));
+
+    std::string value;
+    createFile(buildPath(workdir, "io.max"), "");
+    ASSERT_TRUE(cgroup.set("io.max", "8:0 rbps=1048576"));
+    ASSERT_TRUE(cgroup.read("io.max", value));
+    ASSERT_EQ("8:0 rbps=1048576", value);
+
+    // A plain file keeps only what was written last, the kernel would keep both lines
+    createFile(buildPath(workdir, "io.max"), "");
+    ASSERT_TRUE(cgroup.set("io.max", "8:0 wbps=max\n8:16 riops=100"));
+    ASSERT_TRUE(cgroup.read("io.max", value));
+    ASSERT_EQ("8:16 riops=100", value);
+
+    createFile(buildPath(workdir, "io.max"), "");
+    ASSERT_FALSE(cgroup.set({ { "io.max", "8:16 riops=100" }, { "memory.high", "1000" } }));
+    ASSERT_TRUE(cgroup.read("io.max", value));
+    ASSERT_EQ("8:16 rbps=max wbps=max riops=max wiops=max", value);
+}
+
+/*
+ * Paths are resolved to the block device holding them, and partitions to their disk
+ */
+TEST_F(UnifiedCgroupTest, blockDevice)
+{
+    std::string device;
+    ASSERT_FALSE(UnifiedCgroup::blockDevice("/nonexistent", device));
+
+    // The filesystem of the temporary directory, faked as the first partition of disk 8:0
+    struct stat st;
+    ASSERT_EQ(0, stat(workdir.c_str(), &st));
+    std::string fsDevice = std::to_string(major(st.st_dev)) + ":" + std::to_string(minor(st.st_dev));
+
+    std::string sysDevBlock = buildPath(workdir, "block");
+    std::string disk = buildPath(workdir, "sda");
+    ASSERT_TRUE(cd.createDirectory(sysDevBlock));
+    ASSERT_TRUE(cd.createDirectory(buildPath(disk, "sda1")));
+    createFile(buildPath(disk, "dev"), "8:0\n");
+    createFile(buildPath(disk, "sda1/partition"), "1\n");
+    ASSERT_FALSE(UnifiedCgroup::blockDevice(workdir, device, sysDevBlock));
+
+    ASSERT_EQ(0, symlink(buildPath(disk, "sda1").c_str(), buildPath(sysDevBlock, fsDevice).c_str()));
+    ASSERT_TRUE(UnifiedCgroup::blockDevice(workdir, device, sysDevBlock));
+    ASSERT_EQ("8:0", device);
+}
+
+/*
+ * Processes are found in the cgroup and the cgroups below it, and can be signalled and waited
+ * for. The kernel would drop processes from cgroup.procs when they exit, which these files
+ * don't, so only the timeouts can be tested here.
+ */
+TEST_F(UnifiedCgroupTest, processes)
+{
+    pid_t child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    ASSERT_TRUE(cd.createDirectory(buildPath(workdir, "app")));
+    createFile(buildPath(workdir, "cgroup.procs"), std::to_string(getpid()) + "\n");
+    createFile(buildPath(workdir, "app/cgroup.procs"), std::to_string(child) + "\n");
+    createFile(buildPath(workdir, "cgroup.events"), "populated 1\n");
+
+    UnifiedCgroup cgroup;
+    ASSERT_TRUE(cgroup.processes().empty());
+    ASSERT_TRUE(cgroup.open(workdir));
+    ASSERT_EQ(2u, cgroup.processes().size());
+
+    ASSERT_FALSE(cgroup.waitUntilEmpty(50));
+    createFile(buildPath(workdir, "cgroup.procs"), "");
+    ASSERT_FALSE(cgroup.waitUntilEmpty(50));
+    ASSERT_TRUE(cgroup.waitUntilEmpty(50, child));
+
+    ASSERT_EQ(1u, cgroup.signalAll(SIGTERM));
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    ASSERT_TRUE(WIFSIGNALED(status));
+    ASSERT_EQ(SIGTERM, WTERMSIG(status));
+
+    // With cgroup.kill, the kernel kills the processes
+    createFile(buildPath(workdir, "cgroup.kill"), "");
+    ASSERT_TRUE(cgroup.killAll());
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cgroup.kill"), "1"));
+}
+
+/*
+ * Freezing writes cgroup.freeze and waits for cgroup.events to report the new state. If the
+ * state is not reached in time, cgroup.freeze is set back.
+ */
+TEST_F(UnifiedCgroupTest, freeze)
+{
+    UnifiedCgroup cgroup;
+    ASSERT_FALSE(cgroup.freeze(true, 50));
+    ASSERT_TRUE(cgroup.open(workdir));
+
+    createFile(buildPath(workdir, "cgroup.freeze"), "0");
+    createFile(buildPath(workdir, "cgroup.events"), "populated 1\nfrozen 1\n");
+    ASSERT_TRUE(cgroup.freeze(true, 50));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cgroup.freeze"), "1"));
+
+    // The kernel would have thawed the cgroup, these files stay frozen
+    ASSERT_FALSE(cgroup.freeze(false, 50));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cgroup.freeze"), "1"));
+
+    createFile(buildPath(workdir, "cgroup.freeze"), "0");
+    createFile(buildPath(workdir, "cgroup.events"), "populated 1\nfrozen 0\n");
+    ASSERT_FALSE(cgroup.freeze(true, 50));
+    ASSERT_TRUE(checkContent(buildPath(workdir, "cgroup.freeze"), "0"));
+}
+
+/*
+ * The cgroup of this process is found if the unified hierarchy is used
+ */
+TEST_F(UnifiedCgroupTest, pathOfProcess)
+{
+    ASSERT_EQ("", UnifiedCgroup::pathOfProcess(-1));
+
+    if (!UnifiedCgroup::isAvailable()) {
+        return;
+    }
+
+    std::string path = UnifiedCgroup::pathOfProcess(getpid());
+    ASSERT_EQ(0u, path.find(UnifiedCgroup::CGROUP_ROOT));
+    ASSERT_TRUE(isFile(buildPath(path, "cgroup.procs")));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include <workerpool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+
+using namespace softwarecontainer;
+
+class WorkerPoolTest: public ::testing::Test
+{
+};
+
+/*
+ * All submitted tasks are run before waitForIdle returns
+ */
+TEST_F(WorkerPoolTest, runsAllTasks)
+{
+    std::atomic<int> counter(0);
+    WorkerPool pool(4, 8);
+
+    for (int i = 0; i < 1000; i++) {
+        pool.submit([&counter] () { counter++; });
+    }
+    pool.waitForIdle();
+
+    ASSERT_EQ(counter, 1000);
+}
+
+/*
+ * Tasks submitting more tasks to a full queue must not deadlock the pool
+ */
+TEST_F(WorkerPoolTest, nestedSubmitDoesNotDeadlock)
+{
+    std::atomic<int> counter(0);
+    WorkerPool pool(2, 1);
+
+    for (int i = 0; i < 10; i++) {
+        pool.submit([&pool, &counter] () {
+            for (int j = 0; j < 10; j++) {
+                pool.submit([&counter] () { counter++; });
+            }
+        });
+    }
+    pool.waitForIdle();
+
+    ASSERT_EQ(counter, 100);
+}
+
+/*
+ * The destructor waits for queued tasks to finish
+ */
+TEST_F(WorkerPoolTest, destructorFinishesTasks)
+{
+    std::atomic<int> counter(0);
+    {
+        WorkerPool pool(1);
+        for (int i = 0; i < 10; i++) {
+            pool.submit([&counter] () {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                counter++;
+            });
+        }
+    }
+
+    ASSERT_EQ(counter, 10);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "workerpool.h"
+
+#include <algorithm>
+
+namespace softwarecontainer {
+
+static constexpr unsigned int MAX_DEFAULT_THREAD_COUNT = 8;
+
+WorkerPool::WorkerPool(unsigned int threadCount, size_t maxQueuedTasks) :
+    m_maxQueuedTasks(std::max<size_t>(maxQueuedTasks, 1))
+{
+    threadCount = std::max(threadCount, 1u);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    waitForIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned int WorkerPool::defaultThreadCount()
+{
+    unsigned int cpus = std::thread::hardware_concurrency();
+    if (cpus == 0) {
+        cpus = 1;
+    }
+    return std::min(cpus, MAX_DEFAULT_THREAD_COUNT);
+}
+
+bool WorkerPool::isWorkerThread()
+{
+    std::thread::id self = std::this_thread::get_id();
+    for (auto &thread : m_threads) {
+        if (thread.get_id() == self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::submit(Task task)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (m_tasks.size() >= m_maxQueuedTasks) {
+        if (isWorkerThread()) {
+            // Blocking here could deadlock if all workers do the same, run it right away
+            lock.unlock();
+            task();
+            return;
+        }
+
+        m_spaceAvailable.wait(lock, [this] () {
+            return m_tasks.size() < m_maxQueuedTasks;
+        });
+    }
+
+    m_tasks.push(std::move(task));
+    lock.unlock();
+    m_taskAvailable.notify_one();
+}
+
+void WorkerPool::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_idle.wait(lock, [this] () {
+        return m_tasks.empty() && m_runningTasks == 0;
+    });
+}
+
+void WorkerPool::run()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while (true) {
+        m_taskAvailable.wait(lock, [this] () {
+            return m_stopping || !m_tasks.empty();
+        });
+
+        if (m_tasks.empty()) {
+            // Only reached when stopping
+            return;
+        }
+
+        Task task = std::move(m_tasks.front());
+        m_tasks.pop();
+        m_runningTasks++;
+        lock.unlock();
+        m_spaceAvailable.notify_one();
+
+        try {
+            task();
+        } catch (std::exception &err) {
+            log_error() << "Uncaught exception in worker task: " << err.what();
+        }
+
+        lock.lock();
+        m_runningTasks--;
+        if (m_tasks.empty() && m_runningTasks == 0) {
+            m_idle.notify_all();
+        }
+    }
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "softwarecontainer-common.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace softwarecontainer {
+
+/**
+ * @brief The WorkerPool class runs tasks on a fixed number of worker threads.
+ *
+ * The queue of pending tasks is bounded so that a fast producer, e.g. a directory walk,
+ * can not queue up an unbounded amount of work. When the queue is full, submit() blocks
+ * until a worker has picked up a task. If submit() is called from one of the pool's own
+ * worker threads and the queue is full, the task is run directly on the calling thread
+ * instead, so tasks can safely submit more work without deadlocking the pool.
+ */
+class WorkerPool
+{
+    LOG_DECLARE_CLASS_CONTEXT("WOPO", "Worker pool");
+
+public:
+    typedef std::function<void ()> Task;
+
+    /**
+     * @brief Creates a pool and starts its worker threads
+     *
+     * @param threadCount Number of worker threads, at least one thread is always started.
+     * @param maxQueuedTasks Max number of tasks waiting to be picked up by a worker.
+     */
+    WorkerPool(unsigned int threadCount, size_t maxQueuedTasks = 1024);
+
+    /**
+     * @brief Waits for all submitted tasks to finish and then stops the worker threads
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief Queues a task to be run by one of the workers
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Blocks until all submitted tasks have finished running
+     */
+    void waitForIdle();
+
+    /**
+     * @brief The number of worker threads to use when the caller has no preference.
+     *
+     * This is the number of online CPUs, capped to keep the pool small on big machines.
+     */
+    static unsigned int defaultThreadCount();
+
+private:
+    void run();
+    bool isWorkerThread();
+
+    std::mutex m_lock;
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::condition_variable m_idle;
+
+    std::queue<Task> m_tasks;
+    size_t m_maxQueuedTasks;
+    unsigned int m_runningTasks = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace softwarecontainer
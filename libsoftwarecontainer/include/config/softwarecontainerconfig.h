@@ -64,6 +64,10 @@ public:
     void setEnableWriteBuffer(bool enabledFlag);
     void setEnableTemporaryFileSystemWriteBuffers(bool enabled);
     void setTemporaryFileSystemSize(unsigned int size);
+    void setTemporaryFileSystemMaxSize(unsigned int size);
+    void setAsyncWriteBufferSync(bool enabled);
+    void setAppImage(const std::string &imagePath);
+    void setVolatileWriteBuffer(bool enabled);
 
     /*
      * Getters for values that are set on creation only, i.e. these originate from the
@@ -89,6 +93,10 @@ public:
     bool writeBufferEnabled() const;
     bool temporaryFileSystemWriteBufferEnableds() const;
     unsigned int temporaryFileSystemSize() const;
+    unsigned int temporaryFileSystemMaxSize() const;
+    bool asyncWriteBufferSync() const;
+    std::string appImage() const;
+    bool volatileWriteBuffer() const;
 
 private:
 #ifdef ENABLE_NETWORKGATEWAY
@@ -104,9 +112,13 @@ private:
     std::string m_sharedMountsDir;
     unsigned int m_containerShutdownTimeout;
 
-    bool m_writeBufferEnabled;
-    bool m_temporaryFileSystemWriteBufferEnableds;
-    unsigned int m_temporaryFileSystemSize;
+    bool m_writeBufferEnabled = false;
+    bool m_temporaryFileSystemWriteBufferEnableds = false;
+    unsigned int m_temporaryFileSystemSize = 0;
+    unsigned int m_temporaryFileSystemMaxSize = 0;
+    bool m_asyncWriteBufferSync = false;
+    std::string m_appImage;
+    bool m_volatileWriteBuffer = false;
 };
 
 } // namespace softwarecontainer
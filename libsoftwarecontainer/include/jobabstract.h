@@ -43,6 +43,11 @@ public:
     void captureStdout();
     void captureStderr();
 
+    /**
+     * @brief Redirects both stdout and stderr of the job to a single pipe, readable through stdout()
+     */
+    void captureOutput();
+
     int wait();
 
     int stdout();
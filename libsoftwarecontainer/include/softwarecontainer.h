@@ -19,7 +19,6 @@
 
 #pragma once
 
-#include "observableproperty.h"
 #include "gatewayconfig.h"
 #include "signalconnectionshandler.h"
 #include "config/softwarecontainerconfig.h"
@@ -45,15 +44,6 @@ class Gateway;
 class ContainerAbstractInterface;
 
 
-enum class ContainerState
-{
-    READY,
-    SUSPENDED,
-    TERMINATED,
-    INVALID
-};
-
-
 /**
  * @class InvalidOperationError
  *
@@ -176,13 +166,17 @@ public:
      *
      * @param id The containerID to use.
      * @param config An object holding all needed settings for the container
+     * @param checkpointDirectory If not empty, the container is restored from a checkpoint
+     *        written there by checkpoint() instead of started, and its gateways and bind
+     *        mounts are set up again.
      *
      * @throws SoftwareContainerError If unable to set up the needed directories
      *         or network settings for this container, or if anything goes wrong
      *         when creating and initializing the underlying container implementation.
      */
     SoftwareContainer(const ContainerID id,
-                      std::unique_ptr<const SoftwareContainerConfig> config);
+                      std::unique_ptr<const SoftwareContainerConfig> config,
+                      const std::string &checkpointDirectory = "");
 
     ~SoftwareContainer();
 
@@ -295,6 +289,26 @@ public:
                          const std::string &pathInContainer,
                          bool readonly = true);
 
+    /**
+     * @brief Checkpoint the container to a directory and stop it
+     *
+     * The processes of the container are dumped with CRIU, and the gateway configurations
+     * and bind mounts are saved next to them, so the container can be restored into a new
+     * SoftwareContainer instance. The bind mounts are unmounted before the dump, and are
+     * done again when the container is restored. A successful call to this method triggers a transition
+     * to state 'TERMINATED', like shutdown().
+     *
+     * This should only be called on containers in state 'READY' or 'SUSPENDED'
+     *
+     * @param directory Where to write the checkpoint, which must exist
+     *
+     * @throws ContainerError If the container could not be checkpointed, in which case it is
+     *         left running
+     * @throws InvalidOperationError If called when state is not 'READY' or 'SUSPENDED'
+     * @throws InvalidContainerError If the container is in state 'INVALID'
+     */
+    void checkpoint(const std::string &directory);
+
     /**
      * @brief Get the state of this container instance
      *
@@ -302,6 +316,11 @@ public:
      */
     ObservableProperty<ContainerState> &getContainerState();
 
+    /**
+     * @brief The pid of the init process of the container, on the host
+     */
+    pid_t initPid();
+
     /**
      * @brief Indicates if gateways have been configured previously.
      *
@@ -314,14 +333,68 @@ public:
      */
     bool previouslyConfigured();
 
+    /**
+     * @brief Get the usage of the tmpfs the write buffer is kept in
+     *
+     * Can be called in any state.
+     *
+     * @param usage is set to the current usage on success
+     * @return false if no tmpfs write buffer is used or if it could not be read
+     */
+    bool writeBufferUsage(WriteBufferUsage &usage);
+
+    /**
+     * @brief Resize the tmpfs the write buffer is kept in
+     *
+     * The tmpfs is remounted in place, so processes in the container are not affected.
+     * The size can not exceed the temporaryFileSystemMaxSize option, or the initial
+     * size if that is not set.
+     *
+     * @param size the new size in bytes
+     * @return false if no tmpfs write buffer is used or if it could not be resized
+     */
+    bool resizeWriteBuffer(uint64_t size);
+
+    /**
+     * @brief Change cgroup limits of the running container
+     *
+     * Should only be called on containers in state 'READY' or 'SUSPENDED'. The limits are
+     * applied by the cgroups gateway as one update.
+     *
+     * @param limits the cgroup settings to change and their new values
+     * @return false if the limits could not be changed, or if the cgroups gateway is not
+     *         enabled
+     *
+     * @throws InvalidOperationError If called when state is not 'READY' or 'SUSPENDED'
+     * @throws InvalidContainerError If the container is in state 'INVALID'
+     */
+    bool setCgroupLimits(const std::map<std::string, std::string> &limits);
+
+    /**
+     * @brief The cgroup v2 directory of the container
+     *
+     * @return The path of the cgroup, or an empty string if the host has no cgroup v2
+     *         hierarchy or the container is not running
+     */
+    std::string cgroupPath();
+
 private:
     /*
      * Add gateways and create and initialize the underlying container
      * implementation.
      */
-    bool init();
+    bool init(const std::string &checkpointDirectory);
+
+    bool start(const std::string &checkpointDirectory);
+
+    // Saves the gateway configurations and bind mounts, to be set up again by restoreState
+    bool saveState(const std::string &path);
+    bool restoreState(const std::string &path);
 
-    bool start();
+    // Unmounts the bind mounts before a checkpoint, or none of them if any fails
+    bool unmountBindMounts();
+    // Does the bind mounts from index first again, after unmountBindMounts
+    void remountBindMounts(size_t first);
 
     bool configureGateways(const GatewayConfiguration &gwConfig);
     bool activateGateways();
@@ -347,13 +420,26 @@ private:
     std::unique_ptr<const SoftwareContainerConfig> m_config;
 
     std::string m_containerRoot;
-    unsigned int m_tmpfsSize;
+    bool m_tmpfsMounted = false;
+    uint64_t m_tmpfsSize;
+    uint64_t m_tmpfsMaxSize = 0;
 
     Glib::RefPtr<Glib::MainContext> m_mainLoopContext;
     SignalConnectionsHandler m_connections;
 
     // Keeps track of if startGateways has been called on this instance
     bool m_previouslyConfigured;
+
+    struct BindMount
+    {
+        std::string pathOnHost;
+        std::string pathInContainer;
+        bool readOnly;
+    };
+
+    // Everything given to startGateways and bindMount, which is saved by checkpoint
+    GatewayConfiguration m_gatewayConfigs;
+    std::vector<BindMount> m_bindMounts;
 };
 
 } // namespace softwarecontainer
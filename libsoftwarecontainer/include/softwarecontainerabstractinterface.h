@@ -25,9 +25,33 @@
 
 #include "commandjob.h"
 #include "gatewayconfig.h"
+#include "observableproperty.h"
+
+#include <cstdint>
+#include <map>
 
 namespace softwarecontainer {
 
+enum class ContainerState
+{
+    READY,
+    SUSPENDED,
+    TERMINATED,
+    INVALID
+};
+
+/**
+ * @brief Usage of the tmpfs that holds the write buffer of a container, in bytes
+ */
+struct WriteBufferUsage
+{
+    uint64_t usedBytes = 0;
+    uint64_t freeBytes = 0;
+    uint64_t sizeBytes = 0;
+    // The size the tmpfs is allowed to grow to
+    uint64_t maxSizeBytes = 0;
+};
+
 class SoftwareContainerAbstractInterface
 {
 public:
@@ -104,6 +128,16 @@ public:
      */
     virtual void resume() = 0;
 
+    /**
+     * @brief Checkpoint the container to a directory and stop it, so it can be restored
+     * into a new container later
+     *
+     * @throws ContainerError If the container could not be checkpointed
+     * @throws InvalidOperationError If called when state is not 'READY' or 'SUSPENDED'
+     * @throws InvalidContainerError If the container is in state 'INVALID'
+     */
+    virtual void checkpoint(const std::string &directory) = 0;
+
     /**
      * Should only be called on containers in state 'READY'
      *
@@ -114,6 +148,18 @@ public:
                            const std::string &pathInContainer,
                            bool readonly = true) = 0;
 
+    /**
+     * @brief Get the state of this container instance
+     *
+     * @return ContainerState representing the current state
+     */
+    virtual ObservableProperty<ContainerState> &getContainerState() = 0;
+
+    /**
+     * @brief The pid of the init process of the container, on the host
+     */
+    virtual pid_t initPid() = 0;
+
     /**
      * @brief Indicates if gateways have been configured previously.
      *
@@ -125,6 +171,41 @@ public:
      * @return true if startGateways has been called previously, false if not
      */
     virtual bool previouslyConfigured() = 0;
+
+    /**
+     * @brief Get the usage of the tmpfs the write buffer of the container is kept in
+     *
+     * @param usage is set to the current usage on success
+     * @return false if the container has no tmpfs write buffer or if it could not be read
+     */
+    virtual bool writeBufferUsage(WriteBufferUsage &usage) = 0;
+
+    /**
+     * @brief Change the size of the tmpfs the write buffer of the container is kept in,
+     * without affecting anything running in the container
+     *
+     * @param size the new size in bytes, at most the configured max size
+     * @return false if the container has no tmpfs write buffer, if the size is larger
+     *         than allowed, or if the tmpfs could not be resized
+     */
+    virtual bool resizeWriteBuffer(uint64_t size) = 0;
+
+    /**
+     * @brief Change cgroup limits of the running container, see CgroupsGateway::updateLimits
+     *
+     * @param limits the cgroup settings to change and their new values
+     * @return false if any of the limits is invalid or could not be changed, in which case
+     *         none of them are changed
+     */
+    virtual bool setCgroupLimits(const std::map<std::string, std::string> &limits) = 0;
+
+    /**
+     * @brief The cgroup v2 directory of the container
+     *
+     * @return The path of the cgroup, or an empty string if the host has no cgroup v2
+     *         hierarchy or the container is not running
+     */
+    virtual std::string cgroupPath() = 0;
 };
 
 } //namespace
@@ -64,6 +64,26 @@ void SoftwareContainerConfig::setTemporaryFileSystemSize(unsigned int size)
     m_temporaryFileSystemSize = size;
 }
 
+void SoftwareContainerConfig::setTemporaryFileSystemMaxSize(unsigned int size)
+{
+    m_temporaryFileSystemMaxSize = size;
+}
+
+void SoftwareContainerConfig::setAsyncWriteBufferSync(bool enabled)
+{
+    m_asyncWriteBufferSync = enabled;
+}
+
+void SoftwareContainerConfig::setAppImage(const std::string &imagePath)
+{
+    m_appImage = imagePath;
+}
+
+void SoftwareContainerConfig::setVolatileWriteBuffer(bool enabled)
+{
+    m_volatileWriteBuffer = enabled;
+}
+
 std::string SoftwareContainerConfig::containerConfigPath() const
 {
     return m_containerConfigPath;
@@ -94,6 +114,26 @@ unsigned int SoftwareContainerConfig::temporaryFileSystemSize() const
     return m_temporaryFileSystemSize;
 }
 
+unsigned int SoftwareContainerConfig::temporaryFileSystemMaxSize() const
+{
+    return m_temporaryFileSystemMaxSize;
+}
+
+bool SoftwareContainerConfig::asyncWriteBufferSync() const
+{
+    return m_asyncWriteBufferSync;
+}
+
+std::string SoftwareContainerConfig::appImage() const
+{
+    return m_appImage;
+}
+
+bool SoftwareContainerConfig::volatileWriteBuffer() const
+{
+    return m_volatileWriteBuffer;
+}
+
 #ifdef ENABLE_NETWORKGATEWAY
 
 bool SoftwareContainerConfig::shouldCreateBridge() const
@@ -20,11 +20,21 @@
 
 #include <vector>
 #include <fstream>
+#include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/mount.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/route.h>
+#include <netinet/in.h>
 
 // rlimit stuff
 #include <sys/time.h>
@@ -40,13 +50,17 @@
 #include <string.h>
 
 #include <stdio.h>
-#include <mntent.h>
 
 #include "container.h"
+#include "detachedmount.h"
+#include "appimagecleanuphandler.h"
+#include "appimageregistry.h"
 #include "filecleanuphandler.h"
 
 #include <libgen.h>
 
+#include <chrono>
+
 #include "softwarecontainererror.h"
 
 namespace softwarecontainer {
@@ -72,18 +86,352 @@ void Container::init_lxc()
     }
 }
 
+// Operations run in the namespaces of the container, see Container::runOperation
+static const std::string OPERATION_CREATE_DIRECTORIES = "createDirectories";
+static const std::string OPERATION_TOUCH = "touch";
+static const std::string OPERATION_MOVE_MOUNT = "moveMount";
+static const std::string OPERATION_REMOUNT_READ_ONLY = "remountReadOnly";
+static const std::string OPERATION_CHMOD = "chmod";
+static const std::string OPERATION_UNMOUNT = "unmount";
+static const std::string OPERATION_SET_LINK_STATE = "setLinkState";
+static const std::string OPERATION_SET_ADDRESS = "setAddress";
+static const std::string OPERATION_ADD_DEFAULT_ROUTE = "addDefaultRoute";
+static const std::string OPERATION_RUN = "run";
+
+// The operations are run by a helper forked from the agent, see NamespaceWorker, so they only
+// call async-signal-safe functions
+
+static bool hasArguments(size_t count, size_t expected)
+{
+    if (count != expected) {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+// Creates a directory and any missing parents
+static int createDirectories(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 1)) {
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    size_t length = strlen(arguments[0]);
+    if (length == 0 || length >= sizeof(path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(path, arguments[0], length + 1);
+
+    // Create each path prefix ending before a separator, and finally the whole path
+    for (char *end = path + 1; ; end++) {
+        if (*end != '/' && *end != '\0') {
+            continue;
+        }
+
+        char separator = *end;
+        *end = '\0';
+        if (mkdir(path, S_IRWXU | S_IRWXG | S_IRWXO) == -1) {
+            struct stat st;
+            if (errno != EEXIST) {
+                return -1;
+            }
+            if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode)) {
+                errno = ENOTDIR;
+                return -1;
+            }
+        }
+        *end = separator;
+
+        if (separator == '\0') {
+            return 0;
+        }
+    }
+}
+
+static int touchFile(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 1)) {
+        return -1;
+    }
+
+    int fd = open(arguments[0], O_WRONLY | O_CREAT | O_NOCTTY | O_NONBLOCK | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        return -1;
+    }
+    return close(fd);
+}
+
+static int moveMount(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 2)) {
+        return -1;
+    }
+    return mount(arguments[0], arguments[1], nullptr, MS_MOVE, nullptr);
+}
+
+static int remountReadOnly(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 1)) {
+        return -1;
+    }
+    unsigned long flags = MS_REMOUNT | MS_RDONLY | MS_BIND;
+    return mount(arguments[0], arguments[0], "", flags, nullptr);
+}
+
+static int unmountPath(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 1)) {
+        return -1;
+    }
+    return umount2(arguments[0], MNT_DETACH);
+}
+
+// Parses a decimal number that is at most max
+static bool parseNumber(const char *text, unsigned long max, unsigned long &value)
+{
+    if (text[0] == '\0') {
+        errno = EINVAL;
+        return false;
+    }
+
+    value = 0;
+    for (const char *digit = text; *digit != '\0'; digit++) {
+        if (*digit < '0' || *digit > '9') {
+            errno = EINVAL;
+            return false;
+        }
+        value = value * 10 + (*digit - '0');
+        if (value > max) {
+            errno = EINVAL;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The mode is given in decimal
+static int changeMode(const char *const arguments[], size_t count)
+{
+    unsigned long mode = 0;
+    if (!hasArguments(count, 2) || !parseNumber(arguments[1], 07777, mode)) {
+        return -1;
+    }
+    return chmod(arguments[0], static_cast<mode_t>(mode));
+}
+
+// Addresses are given as the decimal value of an in_addr, i.e. in network byte order
+static bool parseAddress(const char *text, struct sockaddr &address)
+{
+    unsigned long value = 0;
+    if (!parseNumber(text, UINT32_MAX, value)) {
+        return false;
+    }
+
+    struct sockaddr_in inet;
+    memset(&inet, 0, sizeof(inet));
+    inet.sin_family = AF_INET;
+    inet.sin_addr.s_addr = static_cast<in_addr_t>(value);
+    memcpy(&address, &inet, sizeof(inet));
+    return true;
+}
+
+// Closes a socket used for an ioctl and returns the result of the ioctl, keeping its errno
+static int closeSocket(int fd, int result)
+{
+    int error = errno;
+    close(fd);
+    errno = error;
+    return result;
+}
+
+// Sets up a request for the named interface and opens a socket to send it on
+static int interfaceSocket(const char *name, struct ifreq &request)
+{
+    size_t length = strlen(name);
+    if (length == 0 || length >= IFNAMSIZ) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&request, 0, sizeof(request));
+    memcpy(request.ifr_name, name, length + 1);
+    return socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+}
+
+// The state is given as "up" or "down"
+static int setLinkState(const char *const arguments[], size_t count)
+{
+    if (!hasArguments(count, 2)) {
+        return -1;
+    }
+
+    bool up = strcmp(arguments[1], "up") == 0;
+    if (!up && strcmp(arguments[1], "down") != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct ifreq request;
+    int fd = interfaceSocket(arguments[0], request);
+    if (fd == -1) {
+        return -1;
+    }
+
+    int result = ioctl(fd, SIOCGIFFLAGS, &request);
+    if (result == 0) {
+        int flags = up ? (request.ifr_flags | IFF_UP) : (request.ifr_flags & ~IFF_UP);
+        request.ifr_flags = static_cast<short>(flags);
+        result = ioctl(fd, SIOCSIFFLAGS, &request);
+    }
+    return closeSocket(fd, result);
+}
+
+// Sets the address and netmask of an interface
+static int setAddress(const char *const arguments[], size_t count)
+{
+    struct sockaddr address;
+    struct sockaddr netmask;
+    if (!hasArguments(count, 3)
+        || !parseAddress(arguments[1], address)
+        || !parseAddress(arguments[2], netmask)) {
+        return -1;
+    }
+
+    struct ifreq request;
+    int fd = interfaceSocket(arguments[0], request);
+    if (fd == -1) {
+        return -1;
+    }
+
+    request.ifr_addr = address;
+    int result = ioctl(fd, SIOCSIFADDR, &request);
+    if (result == 0) {
+        request.ifr_netmask = netmask;
+        result = ioctl(fd, SIOCSIFNETMASK, &request);
+    }
+    return closeSocket(fd, result);
+}
+
+// Adds a default route through the given gateway, an existing one is left as it is
+static int addDefaultRoute(const char *const arguments[], size_t count)
+{
+    struct rtentry route;
+    memset(&route, 0, sizeof(route));
+    if (!hasArguments(count, 1)
+        || !parseAddress(arguments[0], route.rt_gateway)
+        || !parseAddress("0", route.rt_dst)
+        || !parseAddress("0", route.rt_genmask)) {
+        return -1;
+    }
+    route.rt_flags = RTF_UP | RTF_GATEWAY;
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    int result = ioctl(fd, SIOCADDRT, &route);
+    if (result == -1 && errno == EEXIST) {
+        result = 0;
+    }
+    return closeSocket(fd, result);
+}
+
+// Runs a program and waits for it to exit, it fails unless the program exits with 0. Programs
+// given without a path are looked up in the usual directories of the container.
+static int runProgram(const char *const arguments[], size_t count)
+{
+    if (count == 0 || count > NamespaceWorker::MAX_ARGUMENTS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const char *argv[NamespaceWorker::MAX_ARGUMENTS + 1];
+    for (size_t i = 0; i < count; i++) {
+        argv[i] = arguments[i];
+    }
+    argv[count] = nullptr;
+
+    static const char *const environment[] = { "PATH=/usr/sbin:/usr/bin:/sbin:/bin", nullptr };
+    static const char *const directories[] = { "/usr/sbin", "/usr/bin", "/sbin", "/bin" };
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    }
+
+    if (pid == 0) {
+        char *const *args = const_cast<char *const *>(argv);
+        char *const *env = const_cast<char *const *>(environment);
+        if (strchr(argv[0], '/') != nullptr) {
+            execve(argv[0], args, env);
+        } else {
+            char path[PATH_MAX];
+            size_t nameLength = strlen(argv[0]);
+            for (const char *directory : directories) {
+                size_t length = strlen(directory);
+                if (length + 1 + nameLength >= sizeof(path)) {
+                    continue;
+                }
+                memcpy(path, directory, length);
+                path[length] = '/';
+                memcpy(path + length + 1, argv[0], nameLength + 1);
+                execve(path, args, env);
+            }
+        }
+        _exit(127);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        // 127 is what the child exits with when the program could not be run at all
+        errno = (WIFEXITED(status) && WEXITSTATUS(status) == 127) ? ENOENT : EIO;
+        return -1;
+    }
+    return 0;
+}
+
 Container::Container(const std::string id,
                      const std::string &configFile,
                      const std::string &containerRoot,
                      bool writeBufferEnabled,
-                     int shutdownTimeout) :
+                     int shutdownTimeout,
+                     bool asyncWriteBufferSync,
+                     const std::string &appImage,
+                     bool volatileWriteBuffer) :
     m_configFile(configFile),
     m_id(id),
     m_containerRoot(containerRoot),
     m_writeBufferEnabled(writeBufferEnabled),
-    m_shutdownTimeout(shutdownTimeout)
+    m_shutdownTimeout(shutdownTimeout),
+    m_asyncWriteBufferSync(asyncWriteBufferSync),
+    m_appImage(appImage)
 {
+    m_namespaceOperations[OPERATION_CREATE_DIRECTORIES] = &createDirectories;
+    m_namespaceOperations[OPERATION_TOUCH] = &touchFile;
+    m_namespaceOperations[OPERATION_MOVE_MOUNT] = &moveMount;
+    m_namespaceOperations[OPERATION_REMOUNT_READ_ONLY] = &remountReadOnly;
+    m_namespaceOperations[OPERATION_CHMOD] = &changeMode;
+    m_namespaceOperations[OPERATION_UNMOUNT] = &unmountPath;
+    m_namespaceOperations[OPERATION_SET_LINK_STATE] = &setLinkState;
+    m_namespaceOperations[OPERATION_SET_ADDRESS] = &setAddress;
+    m_namespaceOperations[OPERATION_ADD_DEFAULT_ROUTE] = &addDefaultRoute;
+    m_namespaceOperations[OPERATION_RUN] = &runProgram;
+    for (auto &operation : m_namespaceOperations) {
+        m_namespaceWorker.registerOperation(operation.first, operation.second);
+    }
+
     init_lxc();
+    setVolatileOverlays(writeBufferEnabled && volatileWriteBuffer);
     log_debug() << "Container constructed with " << id;
 }
 
@@ -194,7 +542,31 @@ bool Container::create()
         const std::string rootFSPathUpper = m_containerRoot + "/rootfs-upper";
         const std::string rootFSPathWork  = m_containerRoot + "/rootfs-work";
 
-        overlayMount(rootFSPathLower, rootFSPathUpper, rootFSPathWork, m_rootFSPath);
+        // The image is shared by all containers using it, and is released after the overlay
+        // on top of it is unmounted
+        std::vector<std::string> readOnlyLayers;
+        if (!m_appImage.empty()) {
+            std::string imageMountPoint;
+            std::string imagePath;
+            if (!AppImageRegistry::getInstance().acquire(m_appImage,
+                                                         buildPath(parentPath(m_containerRoot),
+                                                                   ".app-images"),
+                                                         imageMountPoint,
+                                                         imagePath)) {
+                log_error() << "Could not mount app image " << m_appImage;
+                return rollbackCreate();
+            }
+            m_cleanupHandlers.add(new AppImageCleanUpHandler(imagePath));
+            readOnlyLayers.push_back(imageMountPoint);
+        }
+
+        // The container name doubles as tag for background syncs
+        if (!overlayMount(rootFSPathLower, rootFSPathUpper, rootFSPathWork, m_rootFSPath,
+                          m_asyncWriteBufferSync ? m_id : "", readOnlyLayers)) {
+            log_error() << "Could not mount the write buffer on " << m_rootFSPath;
+            m_rootFSPath.assign("");
+            return rollbackCreate();
+        }
         log_debug() << "Write buffer enabled, lowerdir=" << rootFSPathLower
                     << ", upperdir=" << rootFSPathUpper
                     << ", workdir=" << rootFSPathWork
@@ -224,6 +596,11 @@ bool Container::rollbackCreate() {
         lxc_container_put(m_container);
         m_container = nullptr;
     }
+
+    // Releases what was set up for the container, e.g. the app image below its write buffer
+    if (!m_cleanupHandlers.clean()) {
+        log_warning() << "One or more cleanup handlers returned error status, please check the log";
+    }
     return false;
 }
 
@@ -288,6 +665,11 @@ bool Container::start(pid_t *pid)
     }
 
     log_debug() << "Container started: " << toString();
+    return attachToRunning(pid);
+}
+
+bool Container::attachToRunning(pid_t *pid)
+{
     *pid = m_container->init_pid(m_container);
     m_state = ContainerState::STARTED;
 
@@ -296,6 +678,20 @@ bool Container::start(pid_t *pid)
         return false;
     }
 
+    // Internal operations are run by a worker kept in the namespaces of the container, instead
+    // of attaching to the container for every one of them
+    if (!m_namespaceWorker.start(*pid)) {
+        log_warning() << "Could not start namespace worker, internal operations will attach to the container";
+    }
+
+    // On a cgroup v2 host, cgroup settings are written directly to the cgroup of the container
+    if (UnifiedCgroup::isAvailable()) {
+        std::string cgroupPath = UnifiedCgroup::pathOfProcess(*pid);
+        if (cgroupPath.empty() || !m_cgroup.open(cgroupPath)) {
+            log_warning() << "Could not open the cgroup of the container, cgroup items will be set by LXC";
+        }
+    }
+
     log_info() << "To connect to this container : lxc-attach -n " << id();
     return true;
 }
@@ -318,9 +714,59 @@ int Container::unlimitCoreDump()
 
 bool Container::setCgroupItem(std::string subsys, std::string value)
 {
+    if (m_cgroup.isOpen()) {
+        return m_cgroup.set(subsys, value);
+    }
     return m_container->set_cgroup_item(m_container, subsys.c_str(), value.c_str());
 }
 
+bool Container::setCgroupItems(const std::map<std::string, std::string> &settings)
+{
+    if (m_cgroup.isOpen()) {
+        return m_cgroup.set(settings);
+    }
+
+    std::vector<std::pair<std::string, std::string>> previousValues;
+    auto rollback = [this, &previousValues] () {
+        for (auto it = previousValues.rbegin(); it != previousValues.rend(); ++it) {
+            if (!m_container->set_cgroup_item(m_container, it->first.c_str(), it->second.c_str())) {
+                log_error() << "Could not restore cgroup item " << it->first << " to " << it->second;
+            }
+        }
+    };
+
+    for (auto &setting : settings) {
+        const char *key = setting.first.c_str();
+        int length = m_container->get_cgroup_item(m_container, key, nullptr, 0);
+        if (length < 0) {
+            log_error() << "Could not read cgroup item " << setting.first;
+            rollback();
+            return false;
+        }
+
+        std::vector<char> value(length + 1, '\0');
+        m_container->get_cgroup_item(m_container, key, value.data(), value.size());
+        std::string previousValue(value.data());
+        while (!previousValue.empty() && previousValue.back() == '\n') {
+            previousValue.pop_back();
+        }
+
+        if (!m_container->set_cgroup_item(m_container, key, setting.second.c_str())) {
+            log_error() << "Could not set cgroup item " << setting.first << ": " << setting.second;
+            rollback();
+            return false;
+        }
+        previousValues.push_back(std::make_pair(setting.first, previousValue));
+    }
+
+    return true;
+}
+
+std::string Container::cgroupPath() const
+{
+    return m_cgroup.isOpen() ? m_cgroup.path() : "";
+}
+
 int Container::executeInContainerEntryFunction(void *param)
 {
     int canCoreDump = unlimitCoreDump();
@@ -371,43 +817,13 @@ bool Container::execute(ExecFunction function,
     options.uid = ROOT_UID;
     options.gid = ROOT_UID;
 
-    // List of vars to use when executing the function
-    EnvironmentVariables actualVariables = variables;
-
-    // Add the variables set by gateways, variables passed with the 'variables' argument
-    // will take precedence over previously set variables.
-    for (auto &var : m_gatewayEnvironmentVariables) {
-        if (variables.count(var.first) != 0) {
-            if (m_gatewayEnvironmentVariables.at(var.first) != variables.at(var.first)) {
-                // Inform user that GW config will be overridden, it might be unintentionally done
-                log_info() << "Variable \"" << var.first
-                           << "\" set by gateway will be overwritten with the value: \""
-                           << variables.at(var.first) << "\"";
-            }
-            actualVariables[var.first] = variables.at(var.first);
-        } else {
-            // The variable was not set again, just keep the original value set by GW
-            actualVariables[var.first] = var.second;
-        }
-    }
-
     log_debug() << "Starting function in container " << toString();
 
-    // prepare array of env variable strings to be set when launching the process in the container
-    std::vector<std::string> strings;
-    for (auto &var : actualVariables) {
-        strings.push_back(var.first + "=" + var.second);
-    }
-
-    const size_t stringCount = strings.size() + 1;
-    const char **envVariablesArray = new const char* [stringCount];
-    for (size_t i = 0; i < strings.size(); i++) {
-        envVariablesArray[i] = strings[i].c_str();
-        log_debug() << "Passing env variable: " << strings[i];
-    }
-    // Null terminate
-    envVariablesArray[strings.size()] = nullptr;
-    options.extra_env_vars = (char **)envVariablesArray;
+    // Variables passed with the 'variables' argument take precedence over the ones set by
+    // gateways. The gateway variables are only referenced, not copied.
+    std::vector<std::string> overrideStrings;
+    std::vector<char *> envp;
+    options.extra_env_vars = m_gatewayEnvironment.envp(variables, overrideStrings, envp);
 
     // Do the actual attach call to the container
     int attach_res = m_container->attach(m_container,
@@ -416,7 +832,6 @@ bool Container::execute(ExecFunction function,
                                          &options,
                                          pid);
 
-    delete[] envVariablesArray;
     if (attach_res == 0) {
         log_info() << " Attached PID: " << *pid;
         return true;
@@ -479,6 +894,8 @@ bool Container::stop()
     bool ret = true;
     if (m_state >= ContainerState::STARTED) {
         log_debug() << "Stopping the container";
+        m_namespaceWorker.stop();
+        m_cgroup.close();
         if (m_container->stop(m_container)) {
             log_debug() << "Container stopped, waiting for stop state";
             waitForState(LXCContainerState::STOPPED);
@@ -509,12 +926,22 @@ bool Container::shutdown(unsigned int timeout)
     log_debug() << "Shutting down container " << toString() << " pid: "
                 << m_container->init_pid(m_container);
 
-    if (m_container->init_pid(m_container) != INVALID_PID) {
-        kill(m_container->init_pid(m_container), SIGTERM);
+    // The worker keeps the namespaces of the container alive, so it has to go first
+    m_namespaceWorker.stop();
+
+    bool success = false;
+    if (m_cgroup.isOpen()) {
+        success = killCgroup(timeout);
+    } else {
+        if (m_container->init_pid(m_container) != INVALID_PID) {
+            kill(m_container->init_pid(m_container), SIGTERM);
+        }
+
+        // Shutdown with timeout
+        success = m_container->shutdown(m_container, timeout);
     }
+    m_cgroup.close();
 
-    // Shutdown with timeout
-    bool success = m_container->shutdown(m_container, timeout);
     if (!success) {
         log_warning() << "Failed to cleanly shutdown container, forcing stop" << toString();
         if(!stop()) {
@@ -523,10 +950,81 @@ bool Container::shutdown(unsigned int timeout)
         }
     }
 
+    resetMountTable();
+    m_state = ContainerState::CREATED;
+    return true;
+}
+
+bool Container::killCgroup(unsigned int timeout)
+{
+    pid_t initPid = m_container->init_pid(m_container);
+
+    // The init of the container only sleeps, and does not pass SIGTERM on to the
+    // applications, so they are signalled directly and only the init is left waiting for
+    size_t signalled = m_cgroup.signalAll(SIGTERM, initPid);
+    log_debug() << "Sent SIGTERM to " << signalled << " processes in " << toString();
+
+    if (!m_cgroup.waitUntilEmpty(timeout * 1000, initPid)) {
+        log_warning() << "Processes in " << toString() << " did not exit within "
+                      << timeout << " s, killing them";
+    }
+
+    if (!m_cgroup.killAll() || !m_cgroup.waitUntilEmpty(KILL_TIMEOUT_MS)) {
+        log_error() << "Could not kill all processes in " << toString();
+        return false;
+    }
+
+    return waitForState(LXCContainerState::STOPPED, KILL_TIMEOUT_MS / 1000);
+}
+
+bool Container::checkpoint(const std::string &directory)
+{
+    if (m_state < ContainerState::STARTED) {
+        log_error() << "Trying to checkpoint container that has not been started";
+        return false;
+    }
+
+    // The worker is connected to the agent, it can not be part of the checkpoint
+    m_namespaceWorker.stop();
+
+    log_debug() << "Checkpointing container " << toString() << " to " << directory;
+    if (!m_container->checkpoint(m_container, const_cast<char *>(directory.c_str()), true, false)) {
+        log_error() << "Could not checkpoint container " << toString() << " to " << directory;
+        if (!m_namespaceWorker.start(m_container->init_pid(m_container))) {
+            log_warning() << "Could not restart namespace worker, internal operations will attach to the container";
+        }
+        return false;
+    }
+
+    // The processes of the container are stopped by the checkpoint
+    m_cgroup.close();
+    resetMountTable();
     m_state = ContainerState::CREATED;
     return true;
 }
 
+bool Container::restore(const std::string &directory, pid_t *pid)
+{
+    if (m_state != ContainerState::CREATED) {
+        log_error() << "Trying to restore container that is not created, or already started";
+        return false;
+    }
+
+    if (pid == nullptr) {
+        log_error() << "Supplied pid argument is nullptr";
+        return false;
+    }
+
+    log_debug() << "Restoring container " << toString() << " from " << directory;
+    if (!m_container->restore(m_container, const_cast<char *>(directory.c_str()), false)) {
+        log_error() << "Could not restore container " << toString() << " from " << directory;
+        return false;
+    }
+
+    log_debug() << "Container restored: " << toString();
+    return attachToRunning(pid);
+}
+
 bool Container::destroy()
 {
     return destroy(m_shutdownTimeout);
@@ -577,25 +1075,32 @@ bool Container::bindMountInContainer(const std::string &pathInHost,
         return false;
     }
 
-    // Check that there is nothing already mounted on the target path
-    pid_t pid = INVALID_PID;
-    bool checkIfAlreadyMountpoint = executeSync([pathInContainer] () {
-        FILE *mountsfile = setmntent("/proc/mounts", "r");
-        struct mntent *mounts;
-        while ((mounts = getmntent(mountsfile)) != nullptr) {
-            std::string mountDir(mounts->mnt_dir);
-            if (0 == mountDir.compare(pathInContainer)) {
-                return -1;
-            }
-        }
-        return 0;
-    }, &pid);
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't bind-mount folder";
+        return false;
+    }
 
-    if (!checkIfAlreadyMountpoint) {
+    // Check that there is nothing already mounted on the target path
+    if (isMountPointInContainer(pathInContainer)) {
         log_error() << pathInContainer << " is already mounted to.";
         return false;
     }
 
+    if (DetachedMount::isSupported() && !(m_writeBufferEnabled && isDirectory(pathInHost))) {
+        if (bindMountDetached(pathInHost, pathInContainer, readOnly)) {
+            std::lock_guard<std::mutex> lock(m_mountTableLock);
+            m_mountPointsInContainer.insert(pathInContainer);
+            return true;
+        }
+
+        if (errno != ENOSYS) {
+            log_error() << "Could not mount " << pathInHost << " at " << pathInContainer
+                        << " in the container";
+            return false;
+        }
+        log_info() << "Falling back to mounting through " << gatewaysDir();
+    }
+
     // Create a file to mount to in gateways
     std::string filePart = baseName(pathInContainer);
     std::string tempPath = buildPath(gatewaysDir(), filePart);
@@ -638,10 +1143,156 @@ bool Container::bindMountInContainer(const std::string &pathInHost,
     // bindMountInContainer succeed. Add cleanup for mounted tempPath
     m_createDirList.push_back(std::move(createDirInstance));
     if (!pathIsDirectory) {
-        m_cleanupHandlers.emplace_back(new FileCleanUpHandler(tempPath));
+        m_cleanupHandlers.add(new FileCleanUpHandler(tempPath));
     }
 
-    m_cleanupHandlers.emplace_back(new MountCleanUpHandler(tempPath));
+    m_cleanupHandlers.add(new MountCleanUpHandler(tempPath));
+
+    std::lock_guard<std::mutex> lock(m_mountTableLock);
+    m_mountPointsInContainer.insert(pathInContainer);
+    return true;
+}
+
+bool Container::bindMountsInContainer(const std::vector<BindMountRequest> &mounts)
+{
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't bind-mount folders";
+        return false;
+    }
+
+    std::vector<std::unique_ptr<DetachedMount>> clones;
+    std::vector<DetachedMount::Attachment> batch;
+    std::unordered_set<std::string> batchTargets;
+
+    auto attachBatch = [&] () {
+        if (batch.empty()) {
+            return true;
+        }
+
+        // If this fails part way, the mount table of the container tells what got attached
+        bool attached = DetachedMount::attachAll(m_container->init_pid(m_container), batch);
+        if (attached) {
+            log_debug() << "Attached " << batch.size() << " mounts in the container";
+            std::lock_guard<std::mutex> lock(m_mountTableLock);
+            m_mountPointsInContainer.insert(batchTargets.begin(), batchTargets.end());
+        } else {
+            log_error() << "Could not attach " << batch.size() << " mounts in the container";
+        }
+
+        batch.clear();
+        batchTargets.clear();
+        clones.clear();
+        return attached;
+    };
+
+    for (const BindMountRequest &mount : mounts) {
+        bool detachable = DetachedMount::isSupported()
+                          && !(m_writeBufferEnabled && isDirectory(mount.pathInHost));
+
+        if (detachable) {
+            if (!existsInFileSystem(mount.pathInHost)) {
+                log_error() << "Path on host does not exist: " << mount.pathInHost;
+                return false;
+            }
+
+            if (mount.pathInContainer.empty() || mount.pathInContainer.front() != '/') {
+                log_error() << "Provided path '" << mount.pathInContainer
+                            << "' is not absolute!";
+                return false;
+            }
+
+            if (batchTargets.count(mount.pathInContainer) > 0
+                || isMountPointInContainer(mount.pathInContainer)) {
+                log_error() << mount.pathInContainer << " is already mounted to.";
+                return false;
+            }
+
+            std::unique_ptr<DetachedMount> clone(new DetachedMount());
+            if (clone->clone(mount.pathInHost)
+                && (!mount.readOnly || clone->setReadOnly())) {
+                batch.push_back({ clone.get(), mount.pathInContainer,
+                                  isDirectory(mount.pathInHost) });
+                batchTargets.insert(mount.pathInContainer);
+                clones.push_back(std::move(clone));
+                continue;
+            }
+
+            if (errno != ENOSYS) {
+                log_error() << "Could not clone " << mount.pathInHost;
+                return false;
+            }
+            log_info() << "Falling back to mounting through " << gatewaysDir();
+        }
+
+        // Keep the order, anything batched so far goes first
+        if (!attachBatch()) {
+            return false;
+        }
+
+        if (!bindMountInContainer(mount.pathInHost, mount.pathInContainer, mount.readOnly)) {
+            return false;
+        }
+    }
+
+    return attachBatch();
+}
+
+bool Container::isMountPointInContainer(const std::string &pathInContainer)
+{
+    std::lock_guard<std::mutex> lock(m_mountTableLock);
+    if (m_mountPointsInContainer.count(pathInContainer) > 0) {
+        return true;
+    }
+
+    pid_t pid = m_container->init_pid(m_container);
+    if (!m_mountTable || pid != m_mountTablePid) {
+        std::string mountInfoPath = logging::StringBuilder() << "/proc/" << pid << "/mountinfo";
+        m_mountTable.reset(new MountTable(mountInfoPath));
+        m_mountTablePid = pid;
+    }
+
+    if (!m_mountTable->refresh()) {
+        log_error() << "Could not read the mount table of " << toString();
+        return true;
+    }
+
+    return m_mountTable->isMountPoint(pathInContainer);
+}
+
+void Container::resetMountTable()
+{
+    std::lock_guard<std::mutex> lock(m_mountTableLock);
+    m_mountPointsInContainer.clear();
+    m_mountTable.reset();
+    m_mountTablePid = INVALID_PID;
+}
+
+bool Container::bindMountDetached(const std::string &pathInHost,
+                                  const std::string &pathInContainer,
+                                  bool readonly)
+{
+    if (pathInContainer.front() != '/') {
+        log_error() << "Provided path '" << pathInContainer << "' is not absolute!";
+        errno = EINVAL;
+        return false;
+    }
+
+    DetachedMount mount;
+    if (!mount.clone(pathInHost)) {
+        return false;
+    }
+
+    if (readonly && !mount.setReadOnly()) {
+        return false;
+    }
+
+    if (!mount.attach(m_container->init_pid(m_container), pathInContainer,
+                      isDirectory(pathInHost))) {
+        return false;
+    }
+
+    log_debug() << "Attached " << pathInHost << " at " << pathInContainer
+                << " in the container" << (readonly ? ", read-only" : "");
     return true;
 }
 
@@ -674,28 +1325,6 @@ bool Container::bindMountCore(const std::string &pathInHost,
     std::string filePart = baseName(pathInContainer);
     std::string tempDirInContainer = buildPath(gatewaysDirInContainer(), filePart);
 
-    pid_t pid = INVALID_PID;
-
-    // Utility lambda function to create parent paths of a given path
-    auto createParentDirectories = [this] (std::string path) {
-        std::stack<std::string> paths;
-        std::string currentPath = path;
-        while(!isDirectory(currentPath)) {
-            paths.push(currentPath);
-            currentPath = parentPath(currentPath);
-        }
-
-        while(!paths.empty()) {
-            std::string path = paths.top();
-            if (mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) == -1) {
-                return 1;
-            }
-
-            paths.pop();
-        }
-        return 0;
-    };
-
     // Move the mount in the container if the tempdir is not the desired dir
     if (tempDirInContainer.compare(pathInContainer) != 0) {
         //
@@ -703,9 +1332,7 @@ bool Container::bindMountCore(const std::string &pathInHost,
         // We do this on the host to avoid working too much inside the container
         //
         std::string parentPathInContainer = parentPath(pathInContainer);
-        ExecFunction createParent = std::bind(createParentDirectories, parentPathInContainer);
-
-        if (!executeSync(createParent, &pid)) {
+        if (!runOperation(OPERATION_CREATE_DIRECTORIES, {parentPathInContainer})) {
             log_error() << "Could not create parent directory " << parentPathInContainer
                         << " in container";
             return false;
@@ -715,20 +1342,14 @@ bool Container::bindMountCore(const std::string &pathInHost,
         // Then, create the actual directory / file to mount to.
         //
         if (isDirectory(tempDirInContainerOnHost)) {
-            ExecFunction createDir = std::bind(createParentDirectories, pathInContainer);
-
-            if (!executeSync(createDir, &pid)) {
+            if (!runOperation(OPERATION_CREATE_DIRECTORIES, {pathInContainer})) {
                 log_error() << "Could not create target directory " << pathInContainer
                             << " in the container";
                 return false;
             }
         } else {
             log_debug() << "Touching file in container: " << pathInContainer;
-            bool touchResult = executeSync([pathInContainer] () {
-                return touch(pathInContainer) ? 0 : 1;
-            }, &pid);
-
-            if (!touchResult) {
+            if (!runOperation(OPERATION_TOUCH, {pathInContainer})) {
                 log_error() << "Could not touch target file " << pathInContainer
                             << " in the container";
                 return false;
@@ -739,21 +1360,9 @@ bool Container::bindMountCore(const std::string &pathInHost,
         // And move the mount from /gateways to the desired location
         //
 
-        bool mountMoveResult = executeSync([tempDirInContainer, pathInContainer] () {
-            unsigned long flags = MS_MOVE;
-            int ret = mount(tempDirInContainer.c_str(), pathInContainer.c_str(), nullptr, flags, nullptr);
-            if (ret != 0) {
-                printf("Error while moving the mount %s to %s: %s\n",
-                       tempDirInContainer.c_str(),
-                       pathInContainer.c_str(),
-                       strerror(errno));
-            }
-            return ret;
-        }, &pid);
-
-        if (!mountMoveResult) {
+        if (!runOperation(OPERATION_MOVE_MOUNT, {tempDirInContainer, pathInContainer})) {
             log_error() << "Could not move the mount inside the container: "
-                        << tempDirInContainer << " to " << pathInContainer;
+                        << tempDirInContainer << " to " << pathInContainer << ": " << strerror(errno);
             return false;
         }
     }
@@ -769,21 +1378,140 @@ bool Container::bindMountCore(const std::string &pathInHost,
 
 bool Container::remountReadOnlyInContainer(const std::string &path)
 {
-    pid_t pid = INVALID_PID;
+    if (!runOperation(OPERATION_REMOUNT_READ_ONLY, {path})) {
+        log_error() << "Could not remount " << path << " read-only in container";
+        return false;
+    }
 
-    bool ret = executeSync([path] () {
-        unsigned long flags = MS_REMOUNT | MS_RDONLY | MS_BIND;
-        return mount(path.c_str(), path.c_str(), "", flags, nullptr);
-    }, &pid);
+    return true;
+}
 
-    if (!ret) {
-        log_error() << "Could not remount " << path << " read-only in container";
+bool Container::setModeInContainer(const std::string &path, mode_t mode)
+{
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't change mode of " << path;
+        return false;
+    }
+
+    return runOperation(OPERATION_CHMOD, {path, std::to_string(mode)});
+}
+
+bool Container::unmountInContainer(const std::string &pathInContainer)
+{
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't unmount " << pathInContainer;
+        return false;
+    }
+
+    if (!runOperation(OPERATION_UNMOUNT, {pathInContainer})) {
+        log_error() << "Could not unmount " << pathInContainer << " in the container";
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(m_mountTableLock);
+    m_mountPointsInContainer.erase(pathInContainer);
     return true;
 }
 
+bool Container::setLinkStateInContainer(const std::string &interface, bool up)
+{
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't configure " << interface;
+        return false;
+    }
+
+    return runOperation(OPERATION_SET_LINK_STATE, {interface, up ? "up" : "down"});
+}
+
+bool Container::setAddressInContainer(const std::string &interface,
+                                      const struct in_addr &address,
+                                      unsigned int prefixLength)
+{
+    if (prefixLength > 32) {
+        log_error() << "Invalid prefix length " << prefixLength << " for " << interface;
+        return false;
+    }
+
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't configure " << interface;
+        return false;
+    }
+
+    struct in_addr netmask;
+    netmask.s_addr = htonl(prefixLength == 0 ? 0 : UINT32_MAX << (32 - prefixLength));
+    return runOperation(OPERATION_SET_ADDRESS, {interface,
+                                                std::to_string(address.s_addr),
+                                                std::to_string(netmask.s_addr)});
+}
+
+bool Container::addDefaultRouteInContainer(const std::string &gateway)
+{
+    struct in_addr address;
+    if (inet_pton(AF_INET, gateway.c_str(), &address) != 1) {
+        log_error() << "Invalid gateway address " << gateway;
+        return false;
+    }
+
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't set default route";
+        return false;
+    }
+
+    return runOperation(OPERATION_ADD_DEFAULT_ROUTE, {std::to_string(address.s_addr)});
+}
+
+bool Container::runInContainer(const std::vector<std::string> &commandLine)
+{
+    if (commandLine.empty() || commandLine.size() > NamespaceWorker::MAX_ARGUMENTS) {
+        log_error() << "Can't run a command line of " << commandLine.size() << " arguments";
+        return false;
+    }
+
+    if (!ensureContainerRunning()) {
+        log_error() << "Container is not running or in bad state, can't run " << commandLine[0];
+        return false;
+    }
+
+    return runOperation(OPERATION_RUN, commandLine);
+}
+
+bool Container::runOperation(const std::string &name, const std::vector<std::string> &arguments)
+{
+    auto started = std::chrono::steady_clock::now();
+    auto elapsedUs = [started] () {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    };
+
+    int result = -1;
+    switch (m_namespaceWorker.call(name, arguments, result)) {
+    case NamespaceWorker::CallResult::Done:
+        log_debug() << "Operation " << name << " done by namespace worker in " << elapsedUs() << " us";
+        return result == 0;
+    case NamespaceWorker::CallResult::Lost:
+        // The operation may have been done in part, and operations like moving a mount can't
+        // simply be run again
+        log_error() << "Namespace worker died during operation " << name;
+        return false;
+    case NamespaceWorker::CallResult::NotSent:
+        break;
+    }
+
+    // No worker, attach to the container and run the operation there instead
+    NamespaceWorker::Operation operation = m_namespaceOperations.at(name);
+    pid_t pid = INVALID_PID;
+    bool success = executeSync([operation, arguments] () {
+        std::vector<const char *> argv;
+        for (const std::string &argument : arguments) {
+            argv.push_back(argument.c_str());
+        }
+        return operation(argv.data(), argv.size());
+    }, &pid);
+    log_debug() << "Operation " << name << " done with attach in " << elapsedUs() << " us";
+
+    return success;
+}
+
 bool Container::mountDevice(const std::string &pathInHost)
 {
     if(!ensureContainerRunning()) {
@@ -802,16 +1530,29 @@ bool Container::setEnvironmentVariable(const std::string &var, const std::string
     }
 
     log_debug() << "Setting env variable in container " << var << "=" << val;
-    m_gatewayEnvironmentVariables[var] = val;
+    m_gatewayEnvironment.set(var, val);
+
+    return true;
+}
+
+bool Container::writeEnvironmentFile()
+{
+    if (m_gatewayEnvironment.version() == m_environmentFileVersion) {
+        return true;
+    }
 
     // We generate a file containing all variables for convenience when connecting to the container in command-line
     logging::StringBuilder s;
-    for (auto &var : m_gatewayEnvironmentVariables) {
+    for (auto &var : m_gatewayEnvironment.variables()) {
         s << "export " << var.first << "='" << var.second << "'\n";
     }
     std::string path = buildPath(gatewaysDir(), "env");
-    FileToolkitWithUndo::writeToFile(path, s);
+    if (!FileToolkitWithUndo::writeToFile(path, s)) {
+        log_warning() << "Could not write environment file " << path;
+        return false;
+    }
 
+    m_environmentFileVersion = m_gatewayEnvironment.version();
     return true;
 }
 
@@ -828,7 +1569,8 @@ bool Container::suspend()
     }
 
     log_debug() << "Suspending container";
-    bool retval = m_container->freeze(m_container);
+    bool retval = m_cgroup.isOpen() ? m_cgroup.freeze(true, FREEZE_TIMEOUT_MS)
+                                    : m_container->freeze(m_container);
 
     if (!retval) {
         std::string errorMessage("Could not suspend the container.");
@@ -848,7 +1590,8 @@ bool Container::resume()
     }
 
     log_debug() << "Resuming container";
-    bool retval = m_container->unfreeze(m_container);
+    bool retval = m_cgroup.isOpen() ? m_cgroup.freeze(false, FREEZE_TIMEOUT_MS)
+                                    : m_container->unfreeze(m_container);
 
     if (!retval) {
         std::string errorMessage("Could not resume the container.");
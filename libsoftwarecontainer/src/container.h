@@ -19,12 +19,20 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <lxc/lxccontainer.h>
 
+#include "environmentblock.h"
 #include "filetoolkitwithundo.h"
+#include "mounttable.h"
+#include "namespaceworker.h"
+#include "unifiedcgroup.h"
 
 #include "softwarecontainer-common.h"
 #include "containerabstractinterface.h"
@@ -77,12 +85,17 @@ public:
      *  path to e.g. the configurations and application root
      * @param writeBufferEnabled Enable RAM write buffers on top of rootfs
      * @param shutdownTimeout Timeout for shutdown of container.
+     * @param asyncWriteBufferSync Sync the rootfs write buffer in the background when the
+     *  container is destroyed, instead of before the destruction completes
      */
     Container(const std::string id,
               const std::string &configFile,
               const std::string &containerRoot,
               bool writeBufferEnabled = false,
-              int shutdownTimeout = 1);
+              int shutdownTimeout = 1,
+              bool asyncWriteBufferSync = false,
+              const std::string &appImage = "",
+              bool volatileWriteBuffer = false);
 
     ~Container();
 
@@ -99,8 +112,55 @@ public:
      */
     bool start(pid_t *pid);
 
+    /**
+     * @brief Dumps the processes of the running container to a directory with CRIU, and
+     * stops them
+     *
+     * The container can be frozen. On success the container is left created but not
+     * started, like after shutdown.
+     *
+     * @param directory Where the CRIU images are written
+     * @return false if the container is not started or could not be dumped, in which case
+     *         it is left running
+     */
+    bool checkpoint(const std::string &directory);
+
+    /**
+     * @brief Restores the processes of a container from a directory written by checkpoint,
+     * instead of starting it
+     *
+     * @param directory Where the CRIU images were written
+     * @param pid Set to the pid of the restored init process of the container
+     * @return false if the container is not created or already started, or if the images
+     *         could not be restored
+     */
+    bool restore(const std::string &directory, pid_t *pid);
+
+    /**
+     * @brief Sets a cgroup setting of the running container
+     *
+     * If the host uses cgroup v2, the setting is written directly to the cgroup of the
+     * container, translated from cgroup v1 if needed, see UnifiedCgroup. Otherwise it is set
+     * through LXC.
+     */
     bool setCgroupItem(std::string subsys, std::string value);
 
+    /**
+     * @brief Sets several cgroup settings of the running container as one update
+     *
+     * The previous values are read before anything is written, and restored if any of the
+     * settings fails.
+     */
+    bool setCgroupItems(const std::map<std::string, std::string> &settings);
+
+    /**
+     * @brief The cgroup v2 directory of the running container
+     *
+     * @return An empty string if the host has no cgroup v2 hierarchy or the container is
+     *         not running
+     */
+    std::string cgroupPath() const;
+
     /**
      * @brief Start a process from the given command line, with an environment consisting of the
      * variables previously set by the gateways,
@@ -139,7 +199,10 @@ public:
     /**
      * @brief Tries to bind mount a path from host to container
      *
-     * Any missing parent paths will be created.
+     * Any missing parent paths will be created. The mount is attached directly in the mount
+     * namespace of the container where the kernel supports it, see DetachedMount. Otherwise,
+     * and for directories mounted with a write buffer, the mount is staged in the gateways
+     * directory and moved into place from within the container.
      *
      * @param pathInHost The path on the host that shall be bind mounted into the container
      * @param pathInContainer Where to mount the path in the container.
@@ -151,9 +214,36 @@ public:
                               const std::string &pathInContainer,
                               bool readOnly = true);
 
+    /**
+     * @brief Bind mounts several paths from host to container, in the given order
+     *
+     * Consecutive mounts that can be attached directly in the mount namespace of the
+     * container are cloned on the host and then attached together from a single process in
+     * the namespace, see DetachedMount::attachAll. Other mounts are done one at a time like
+     * with bindMountInContainer.
+     *
+     * @param mounts The mounts to do
+     *
+     * @return true if all mounts were done, false otherwise
+     */
+    bool bindMountsInContainer(const std::vector<BindMountRequest> &mounts);
 
     bool mountDevice(const std::string &pathInHost);
 
+    bool setModeInContainer(const std::string &path, mode_t mode);
+
+    bool unmountInContainer(const std::string &pathInContainer);
+
+    bool setLinkStateInContainer(const std::string &interface, bool up);
+
+    bool setAddressInContainer(const std::string &interface,
+                               const struct in_addr &address,
+                               unsigned int prefixLength);
+
+    bool addDefaultRouteInContainer(const std::string &gateway);
+
+    bool runInContainer(const std::vector<std::string> &commandLine);
+
     /**
      * @brief Calls shutdown, and then destroys the container
      */
@@ -162,6 +252,9 @@ public:
 
     /**
      * @brief Calls shutdown on the lxc container
+     *
+     * On a cgroup v2 host, the processes of the container are stopped through its cgroup
+     * instead, see killCgroup.
      */
     bool shutdown();
     bool shutdown(unsigned int timeout);
@@ -169,6 +262,9 @@ public:
     /*
      * @brief calls freeze() on the LXC container
      *
+     * On a cgroup v2 host the cgroup of the container is frozen directly instead, which
+     * does not poll the freezer state like LXC does.
+     *
      * This only works if the container is currently running and is not already
      * suspended.
      *
@@ -178,7 +274,7 @@ public:
     bool suspend();
 
     /*
-     * @brief calls unfreeze() on the LXC container
+     * @brief calls unfreeze() on the LXC container, or thaws its cgroup on a cgroup v2 host
      *
      * This only works if the container was already suspended. This sets the container
      * into running state again.
@@ -196,6 +292,16 @@ public:
     bool waitForState(LXCContainerState state, int timeout = 20);
     bool ensureContainerRunning();
 
+    /**
+     * @brief Stops all processes in the cgroup of the container
+     *
+     * Every process but the init is sent SIGTERM, and given timeout seconds to exit. Then
+     * the init and any processes left are killed with cgroup.kill.
+     *
+     * @return true if the cgroup is empty and the container is stopped
+     */
+    bool killCgroup(unsigned int timeout);
+
     /**
      * @brief Setup the container for startup
      *
@@ -212,6 +318,7 @@ public:
     std::string gatewaysDir() const;
 
     bool setEnvironmentVariable(const std::string &var, const std::string &val);
+    bool writeEnvironmentFile();
 
 private:
     /**
@@ -221,12 +328,29 @@ private:
      */
     static int unlimitCoreDump();
 
+    /**
+     * @brief Sets up what is kept for a container whose processes were just started or
+     * restored, like the namespace worker and the cgroup
+     *
+     * @param pid Set to the pid of the init process of the container
+     */
+    bool attachToRunning(pid_t *pid);
+
     /**
      * @brief Function used to wrap the functions we want to run inside the container
      * @param param the function to run.
      */
     static int executeInContainerEntryFunction(void *param);
 
+    /**
+     * @brief Bind mounts using the mount API, without staging the mount in the gateways dir
+     *
+     * @return false with errno set to ENOSYS if the kernel lacks support for it
+     */
+    bool bindMountDetached(const std::string &pathInHost,
+                           const std::string &pathInContainer,
+                           bool readonly);
+
     /**
      * Handles bind-mounting
      */
@@ -237,6 +361,33 @@ private:
 
     bool remountReadOnlyInContainer(const std::string &path);
 
+    /**
+     * @brief Runs one of the registered namespace operations inside the running container
+     *
+     * The operation is handed to the namespace worker of the container if it is running,
+     * otherwise a process is attached to the container to run it.
+     *
+     * @return true if the operation returned 0, false otherwise. errno is set on failure
+     *         when the operation was run by the worker.
+     */
+    bool runOperation(const std::string &name, const std::vector<std::string> &arguments);
+
+    /**
+     * @brief Checks if something is mounted on a path inside the running container
+     *
+     * Mount points created by bindMountInContainer are looked up directly, anything else is
+     * looked up in a snapshot of the mount table of the container's init process, which is
+     * read from the host and only re-read when the mount table has changed.
+     *
+     * @return true if the path is a mount point, or if the mount table could not be read
+     */
+    bool isMountPointInContainer(const std::string &pathInContainer);
+
+    /**
+     * @brief Forgets all mount points tracked for the running container
+     */
+    void resetMountTable();
+
     /**
      * @brief Helper function that rollsback the changes done in Container::create().
      */
@@ -263,11 +414,39 @@ private:
 
     bool m_writeBufferEnabled;
 
-    // All environment variables set by gateways
-    EnvironmentVariables m_gatewayEnvironmentVariables;
+    // All environment variables set by gateways, prebuilt for passing to launched processes
+    EnvironmentBlock m_gatewayEnvironment;
+
+    // Version of m_gatewayEnvironment last written to the environment file
+    uint64_t m_environmentFileVersion = 0;
 
     int m_shutdownTimeout = 1;
 
+    // Max time for killed processes to be gone, in milliseconds
+    static constexpr unsigned int KILL_TIMEOUT_MS = 1000;
+
+    // Max time for the cgroup of the container to be frozen or thawed, in milliseconds
+    static constexpr unsigned int FREEZE_TIMEOUT_MS = 5000;
+
+    bool m_asyncWriteBufferSync;
+
+    // Read-only image used as the bottom layer of the rootfs overlay, if any
+    std::string m_appImage;
+
+    // Mount points in the container created by bindMountInContainer, and a snapshot of the
+    // container's mount table, both guarded by m_mountTableLock
+    std::mutex m_mountTableLock;
+    std::unordered_set<std::string> m_mountPointsInContainer;
+    std::unique_ptr<MountTable> m_mountTable;
+    pid_t m_mountTablePid = INVALID_PID;
+
+    // Helper kept in the namespaces of the running container, and the operations it serves
+    NamespaceWorker m_namespaceWorker;
+    std::map<std::string, NamespaceWorker::Operation> m_namespaceOperations;
+
+    // The cgroup v2 cgroup of the running container, if the host uses cgroup v2
+    UnifiedCgroup m_cgroup;
+
     enum class ContainerState : unsigned int {
         DEFAULT = 0,
         PREPARED = 1,
@@ -23,8 +23,23 @@
 #include "softwarecontainer-common.h"
 #include "executable.h"
 
+#include <netinet/in.h>
+#include <map>
+#include <string>
+#include <vector>
+
 namespace softwarecontainer {
 
+/**
+ * @brief A path on the host to bind mount into a container
+ */
+struct BindMountRequest
+{
+    std::string pathInHost;
+    std::string pathInContainer;
+    bool readOnly;
+};
+
 class ContainerAbstractInterface : public Executable
 {
 
@@ -49,6 +64,16 @@ public:
 
     virtual bool mountDevice(const std::string &pathInHost) = 0;
 
+    /**
+     * @brief Changes the mode of a file inside the running container
+     *
+     * @param path The path of the file in the container
+     * @param mode The new mode of the file
+     *
+     * @return true on success, false otherwise
+     */
+    virtual bool setModeInContainer(const std::string &path, mode_t mode) = 0;
+
     /**
      * @brief Tries to bind mount a path from host to container
      *
@@ -64,8 +89,171 @@ public:
                                             const std::string &pathInContainer,
                                             bool readOnly = true) = 0;
 
+    /**
+     * @brief Bind mounts several paths from host to container, in the given order
+     *
+     * Mounts are done in order, so a mount in the container can be placed inside a directory
+     * mounted earlier in the list. Implementations may batch the mounts to save work.
+     *
+     * @param mounts The mounts to do
+     *
+     * @return true if all mounts were done, false if any of them failed, in which case the
+     *         mounts before it are left in place
+     */
+    virtual bool bindMountsInContainer(const std::vector<BindMountRequest> &mounts)
+    {
+        for (const BindMountRequest &mount : mounts) {
+            if (!bindMountInContainer(mount.pathInHost, mount.pathInContainer, mount.readOnly)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unmounts a path mounted with bindMountInContainer from the running container
+     *
+     * @return false if the path could not be unmounted, which is always the case for this
+     *         default implementation
+     */
+    virtual bool unmountInContainer(const std::string &pathInContainer)
+    {
+        (void) pathInContainer;
+        return false;
+    }
+
+    /**
+     * @brief Brings a network interface in the running container up or down
+     *
+     * @return false if the state could not be changed, which is always the case for this
+     *         default implementation
+     */
+    virtual bool setLinkStateInContainer(const std::string &interface, bool up)
+    {
+        (void) interface;
+        (void) up;
+        return false;
+    }
+
+    /**
+     * @brief Sets the IPv4 address and netmask of a network interface in the running container
+     *
+     * @param interface The name of the interface in the container
+     * @param address The address to set
+     * @param prefixLength The number of bits in the netmask
+     *
+     * @return false if the address could not be set, which is always the case for this
+     *         default implementation
+     */
+    virtual bool setAddressInContainer(const std::string &interface,
+                                       const struct in_addr &address,
+                                       unsigned int prefixLength)
+    {
+        (void) interface;
+        (void) address;
+        (void) prefixLength;
+        return false;
+    }
+
+    /**
+     * @brief Adds a default route through the given IPv4 gateway in the running container
+     *
+     * @return false if the route could not be added, which is always the case for this
+     *         default implementation
+     */
+    virtual bool addDefaultRouteInContainer(const std::string &gateway)
+    {
+        (void) gateway;
+        return false;
+    }
+
+    /**
+     * @brief Runs a program in the running container and waits for it to exit
+     *
+     * The program is run with a minimal environment. Programs given without a path are
+     * looked up in /usr/sbin, /usr/bin, /sbin and /bin of the container.
+     *
+     * @param commandLine The program and its arguments
+     *
+     * @return false if the program could not be run or did not exit with 0, which is always
+     *         the case for this default implementation
+     */
+    virtual bool runInContainer(const std::vector<std::string> &commandLine)
+    {
+        (void) commandLine;
+        return false;
+    }
+
     virtual bool setEnvironmentVariable(const std::string &variable, const std::string &value) = 0;
+
+    /**
+     * @brief Writes the variables set with setEnvironmentVariable to the environment file in
+     * the gateways directory, if they changed since it was last written.
+     *
+     * This is meant to be called once after a batch of gateways has been activated, rather
+     * than for every variable set.
+     */
+    virtual bool writeEnvironmentFile()
+    {
+        return true;
+    }
+
     virtual bool setCgroupItem(std::string subsys, std::string value) = 0;
+
+    /**
+     * @brief Sets several cgroup settings as one update
+     *
+     * Implementations should restore any settings already applied if one of them fails. This
+     * default implementation sets them one at a time.
+     *
+     * @return true if all settings were applied
+     */
+    virtual bool setCgroupItems(const std::map<std::string, std::string> &settings)
+    {
+        for (auto &setting : settings) {
+            if (!setCgroupItem(setting.first, setting.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Dumps the processes of the running container to a directory, and stops them
+     *
+     * @return false if the container could not be checkpointed, which is always the case
+     *         for this default implementation
+     */
+    virtual bool checkpoint(const std::string &directory)
+    {
+        (void) directory;
+        return false;
+    }
+
+    /**
+     * @brief Restores the processes of a created container from a directory written by
+     * checkpoint, instead of starting it
+     *
+     * @return false if the container could not be restored, which is always the case for
+     *         this default implementation
+     */
+    virtual bool restore(const std::string &directory, pid_t *pid)
+    {
+        (void) directory;
+        (void) pid;
+        return false;
+    }
+
+    /**
+     * @brief The cgroup v2 directory the container runs in
+     *
+     * @return An empty string if the cgroup is not known, which is the case for this default
+     *         implementation
+     */
+    virtual std::string cgroupPath() const
+    {
+        return "";
+    }
 };
 
 } // namespace softwarecontainer
@@ -21,11 +21,28 @@
 
 #include "softwarecontainer-common.h"
 #include "cgroupsgateway.h"
+#include "unifiedcgroup.h"
+
+#include <set>
 
 namespace softwarecontainer {
 
+// Settings that can be changed with updateLimits
+static const std::set<std::string> LIMITS = {
+    "cpu.weight",
+    "cpu.max",
+    "cpuset.cpus",
+    "memory.high",
+    "memory.max",
+    "io.weight",
+    "io.max",
+    "cpu.shares",
+    "memory.limit_in_bytes",
+    "blkio.weight"
+};
+
 CgroupsGateway::CgroupsGateway(std::shared_ptr<ContainerAbstractInterface> container)
-    : Gateway(ID, container)
+    : Gateway(ID, container, true /*this GW is dynamic*/)
     , m_parser()
 {
 }
@@ -44,22 +61,73 @@ bool CgroupsGateway::readConfigElement(const json_t *element)
 
 bool CgroupsGateway::activateGateway()
 {
-    bool success = false;
     auto cgroupSettings = m_parser.getSettings();
-    for (auto& setting: cgroupSettings) {
-        success = getContainer()->setCgroupItem(setting.first, setting.second);
-        if (!success) {
-            log_error() << "Error activating Cgroups Gateway, could not set cgroup item "
-                        << setting.first << ": " << setting.second;
-            break;
+    for (auto &limit : m_limits) {
+        if (cgroupSettings.count(limit.first) != 0
+            && UnifiedCgroup::isPerDeviceSetting(limit.first)) {
+            cgroupSettings[limit.first] = m_parser.mergeDeviceSetting(cgroupSettings[limit.first],
+                                                                      limit.second);
+        } else {
+            cgroupSettings[limit.first] = limit.second;
         }
     }
 
-    return success;
+    if (cgroupSettings.empty()) {
+        log_error() << "Error activating Cgroups Gateway, no cgroup items to set";
+        return false;
+    }
+
+    if (!getContainer()->setCgroupItems(cgroupSettings)) {
+        log_error() << "Error activating Cgroups Gateway, could not set cgroup items";
+        return false;
+    }
+
+    m_activatedOnce = true;
+    return true;
 }
 
 bool CgroupsGateway::teardownGateway()
 {
+    m_limits.clear();
+    return true;
+}
+
+bool CgroupsGateway::updateLimits(const std::map<std::string, std::string> &limits)
+{
+    if (limits.empty()) {
+        log_error() << "No limits given";
+        return false;
+    }
+
+    std::map<std::string, std::string> validLimits;
+    for (auto &limit : limits) {
+        if (LIMITS.count(limit.first) == 0) {
+            log_error() << limit.first << " can not be changed on a running container";
+            return false;
+        }
+
+        try {
+            validLimits[limit.first] = m_parser.validateSetting(limit.first, limit.second);
+        } catch (CgroupsGatewayError &e) {
+            log_error() << "Invalid limit " << limit.first << ": " << limit.second;
+            return false;
+        }
+    }
+
+    if (!getContainer()->setCgroupItems(validLimits)) {
+        log_error() << "Could not change limits of the container";
+        return false;
+    }
+
+    for (auto &limit : validLimits) {
+        log_info() << "Changed " << limit.first << " to " << limit.second;
+        if (m_limits.count(limit.first) != 0 && UnifiedCgroup::isPerDeviceSetting(limit.first)) {
+            m_limits[limit.first] = m_parser.mergeDeviceSetting(m_limits[limit.first],
+                                                                limit.second);
+        } else {
+            m_limits[limit.first] = limit.second;
+        }
+    }
     return true;
 }
 
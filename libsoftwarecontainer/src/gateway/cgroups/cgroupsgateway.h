@@ -28,6 +28,9 @@ namespace softwarecontainer {
 
 /**
  * @brief The cgroups gateway sets cgroups related settings for the container.
+ *
+ * The gateway is dynamic, and the CPU, memory and IO limits of a running container can also
+ * be changed at any time with updateLimits.
  */
 
 class CgroupsGateway: public Gateway
@@ -44,8 +47,26 @@ public:
     bool activateGateway() override;
     bool teardownGateway() override;
 
+    /**
+     * @brief Changes limits of the running container
+     *
+     * The limits are validated like the values in a gateway configuration, and are then applied
+     * as one update, so either all of them are changed or none. Only cpu.weight, cpu.max,
+     * cpuset.cpus, memory.high, memory.max, io.weight and io.max can be changed, or their
+     * cgroup v1 counterparts. Per device limits of io.weight and io.max are added to the limits
+     * of other devices.
+     * The limits are kept if the gateway is activated again, and dropped when it is torn down.
+     *
+     * @param limits The settings to change, and their new values
+     * @return true if all limits were changed, false otherwise
+     */
+    bool updateLimits(const std::map<std::string, std::string> &limits);
+
 private:
     CGroupsParser m_parser;
+
+    // Limits set with updateLimits, which take precedence over the configuration
+    std::map<std::string, std::string> m_limits;
 };
 
 class CgroupsGatewayError : public SoftwareContainerError
@@ -20,11 +20,34 @@
 #include "cgroupsparser.h"
 #include "cgroupsgateway.h"
 #include "jsonparser.h"
+#include "unifiedcgroup.h"
 
 #include <math.h>
+#include <set>
+#include <sstream>
 
 namespace softwarecontainer {
 
+// Memory limits in bytes, for cgroup v1 and cgroup v2. The cgroup v2 limits can also be "max"
+static const std::set<std::string> MEMORY_LIMITS = {
+    "memory.limit_in_bytes",
+    "memory.memsw.limit_in_bytes",
+    "memory.max",
+    "memory.high",
+    "memory.low",
+    "memory.swap.max"
+};
+
+static const std::string NO_LIMIT = "max";
+
+// Limits of io.max, the bandwidth limits are in bytes and can have a suffix
+static const std::set<std::string> IO_MAX_KEYS = {
+    "rbps",
+    "wbps",
+    "riops",
+    "wiops"
+};
+
 CGroupsParser::CGroupsParser()
     : m_settings()
 {
@@ -96,14 +119,45 @@ void CGroupsParser::parseCGroupsGatewayConfiguration(const json_t *element)
         throw JSonError(errMessage);
     }
 
-    if (("memory.limit_in_bytes" == settingKey) || ("memory.memsw.limit_in_bytes" == settingKey)) {
-        settingValue = suffixCorrection(settingValue);
+    settingValue = validateSetting(settingKey, settingValue);
 
-        // if the new value is smaller/equal than the old value, then we don't save the new value.
-        if (m_settings.count(settingKey) != 0) {
-            if (std::stoll(m_settings[settingKey]) >= std::stoll(settingValue)) {
+    // if the new value is smaller/equal than the old value, then we don't save the new value.
+    if (m_settings.count(settingKey) != 0) {
+        const std::string &oldValue = m_settings[settingKey];
+        if (MEMORY_LIMITS.count(settingKey) != 0) {
+            if (NO_LIMIT == oldValue
+                || (NO_LIMIT != settingValue && std::stoll(oldValue) >= std::stoll(settingValue))) {
+                return;
+            }
+        } else if ("cpu.shares" == settingKey) {
+            if (std::stoi(oldValue) >= std::stoi(settingValue)) {
                 return;
             }
+        } else if (UnifiedCgroup::isPerDeviceSetting(settingKey)) {
+            settingValue = mergeDeviceSetting(oldValue, settingValue);
+        }
+    }
+
+    // If we got this far we save the key/value pair
+    m_settings[settingKey] = settingValue;
+}
+
+std::string CGroupsParser::validateSetting(const std::string &settingKey,
+                                           const std::string &value)
+{
+    std::string settingValue = value;
+
+    if (MEMORY_LIMITS.count(settingKey) != 0) {
+        if (settingValue.empty()) {
+            std::string errorMessage = "The value for " + settingKey + " is empty";
+            log_error() << errorMessage;
+            throw InvalidInputError(errorMessage);
+        }
+
+        // Only the cgroup v2 settings can be "max"
+        bool isV1Setting = settingKey.find("_in_bytes") != std::string::npos;
+        if (isV1Setting || NO_LIMIT != settingValue) {
+            settingValue = suffixCorrection(settingValue);
         }
 
     } else if (("cpu.shares" == settingKey)) {
@@ -125,15 +179,90 @@ void CGroupsParser::parseCGroupsGatewayConfiguration(const json_t *element)
             log_error() << errorMessage;
             throw InvalidInputError(errorMessage);
         }
-        // if the new value is smaller/equal to the old value, then we don't save the new value.
-        if (m_settings.count(settingKey) != 0) {
-            if (std::stoi(m_settings[settingKey]) >= newValue) {
-                return;
-            }
-        }
         settingValue = std::to_string(newValue);
         log_debug() << "Value for cpu.shares: " << settingValue;
 
+    } else if ("cpu.weight" == settingKey) {
+        settingValue = std::to_string(parseInteger(settingKey, settingValue, 1, 10000));
+
+    } else if ("io.weight" == settingKey) {
+        // Either "$WEIGHT", "default $WEIGHT" or "$DEVICE $WEIGHT"
+        size_t space = settingValue.find(' ');
+        if (std::string::npos == space) {
+            settingValue = std::to_string(parseInteger(settingKey, settingValue, 1, 10000));
+        } else {
+            std::string device = settingValue.substr(0, space);
+            std::string weight = settingValue.substr(space + 1);
+            if ("default" != device) {
+                device = resolveDevice(settingKey, device);
+            }
+            settingValue = device + " "
+                           + std::to_string(parseInteger(settingKey, weight, 1, 10000));
+        }
+
+    } else if ("io.max" == settingKey) {
+        // Should be of format "$DEVICE rbps=$BYTES wbps=$BYTES riops=$IOPS wiops=$IOPS", where
+        // any of the limits can be left out and any of them can be "max"
+        std::istringstream tokens(settingValue);
+        std::string device;
+        tokens >> device;
+        settingValue = resolveDevice(settingKey, device);
+
+        std::string token;
+        bool hasLimit = false;
+        while (tokens >> token) {
+            size_t equals = token.find('=');
+            std::string key = token.substr(0, equals);
+            std::string limit = std::string::npos == equals ? "" : token.substr(equals + 1);
+            if (IO_MAX_KEYS.count(key) == 0 || limit.empty()) {
+                std::string errorMessage = "io.max limits should be of form rbps=$BYTES, "
+                                           "wbps=$BYTES, riops=$IOPS or wiops=$IOPS";
+                log_error() << errorMessage;
+                throw InvalidInputError(errorMessage);
+            }
+
+            if (NO_LIMIT != limit) {
+                if ('b' == key[1]) {
+                    limit = suffixCorrection(limit);
+                }
+                if (limit.find_first_not_of("0123456789") != std::string::npos
+                    || limit.find_first_not_of('0') == std::string::npos) {
+                    std::string errorMessage = "The " + key + " limit of io.max must be a "
+                                               "positive integer or max";
+                    log_error() << errorMessage;
+                    throw InvalidInputError(errorMessage);
+                }
+            }
+            settingValue += " " + key + "=" + limit;
+            hasLimit = true;
+        }
+
+        if (!hasLimit) {
+            std::string errorMessage = "io.max needs at least one of rbps, wbps, riops or wiops";
+            log_error() << errorMessage;
+            throw InvalidInputError(errorMessage);
+        }
+
+    } else if ("cpu.max" == settingKey) {
+        // Should be of format "$MAX $PERIOD", where $MAX can be "max" and $PERIOD is optional
+        std::string quota = settingValue.substr(0, settingValue.find(' '));
+        if (NO_LIMIT != quota) {
+            parseInteger(settingKey, quota, 1, std::numeric_limits<int>::max());
+        }
+        if (quota.size() < settingValue.size()) {
+            std::string period = settingValue.substr(quota.size() + 1);
+            parseInteger(settingKey, period, 1000, 1000000);
+        }
+
+    } else if ("cpuset.cpus" == settingKey) {
+        std::vector<unsigned int> cpus;
+        if (!parseCpuList(settingValue, cpus)) {
+            std::string errorMessage = "cpuset.cpus should be a list of CPUs like 0-3,6";
+            log_error() << errorMessage;
+            throw InvalidInputError(errorMessage);
+        }
+        settingValue = formatCpuList(cpus);
+
     } else if ("net_cls.classid" == settingKey) {
         // Should be of format 0xAAAABBBB
         if (settingValue.find("0x") != 0 // Has to begin with 0x
@@ -157,8 +286,90 @@ void CGroupsParser::parseCGroupsGatewayConfiguration(const json_t *element)
         log_warning() << settingKey << " is not supported by CGroups Gateway" ;
     }
 
-    // If we got this far we save the key/value pair
-    m_settings[settingKey] = settingValue;
+    return settingValue;
+}
+
+std::string CGroupsParser::mergeDeviceSetting(const std::string &oldValue,
+                                             const std::string &newValue)
+{
+    // A value without device, like a plain io.weight, is for the default device
+    auto deviceOf = [] (const std::string &line) {
+        size_t space = line.find(' ');
+        return std::string::npos == space ? "default" : line.substr(0, space);
+    };
+
+    std::map<std::string, std::string> lines;
+    std::vector<std::string> devices;
+    for (const std::string &value : { oldValue, newValue }) {
+        std::istringstream stream(value);
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            std::string device = deviceOf(line);
+            if (lines.count(device) == 0) {
+                devices.push_back(device);
+            }
+            lines[device] = line;
+        }
+    }
+
+    std::string merged;
+    for (const std::string &device : devices) {
+        merged += (merged.empty() ? "" : "\n") + lines[device];
+    }
+    return merged;
+}
+
+std::string CGroupsParser::resolveDevice(const std::string &settingKey, const std::string &device)
+{
+    std::string resolved;
+    if (!device.empty() && '/' == device[0]) {
+        if (!UnifiedCgroup::blockDevice(device, resolved)) {
+            std::string errorMessage = "Could not find the block device of " + device
+                                       + " for " + settingKey;
+            log_error() << errorMessage;
+            throw InvalidInputError(errorMessage);
+        }
+        log_debug() << "Resolved " << device << " to block device " << resolved;
+        return resolved;
+    }
+
+    size_t colon = device.find(':');
+    if (std::string::npos == colon
+        || colon == 0
+        || colon + 1 == device.size()
+        || device.find_first_not_of("0123456789:") != std::string::npos
+        || device.find(':', colon + 1) != std::string::npos) {
+        std::string errorMessage = "The device for " + settingKey
+                                   + " should be a path or of form $MAJOR:$MINOR";
+        log_error() << errorMessage;
+        throw InvalidInputError(errorMessage);
+    }
+    return device;
+}
+
+int CGroupsParser::parseInteger(const std::string &settingKey,
+                                const std::string &settingValue,
+                                int min,
+                                int max)
+{
+    size_t parsed = 0;
+    int value = 0;
+    try {
+        value = std::stoi(settingValue, &parsed);
+    } catch (std::exception &err) {
+        parsed = 0;
+    }
+
+    if (parsed == 0 || parsed != settingValue.size() || value < min || value > max) {
+        std::string errorMessage = "The value for " + settingKey + " must be an integer between "
+                                   + std::to_string(min) + " and " + std::to_string(max);
+        log_error() << errorMessage;
+        throw InvalidInputError(errorMessage);
+    }
+    return value;
 }
 
 const std::map<std::string, std::string> &CGroupsParser::getSettings()
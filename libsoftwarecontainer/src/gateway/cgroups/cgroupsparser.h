@@ -44,6 +44,28 @@ public:
      * @return A list of cgroup settings ready to be applied
      */
     const std::map<std::string, std::string> &getSettings();
+
+    /*
+     * @brief Checks the value of a setting and converts it to the form it is applied in
+     *
+     * Memory limits with a suffix are converted to bytes. Settings that are not known are
+     * accepted as they are.
+     *
+     * @param settingKey : the setting, e.g. memory.limit_in_bytes
+     * @param value      : the value of the setting
+     *
+     * @return The value to apply
+     * @throws CgroupsGatewayError if the value is not valid for the setting
+     */
+    std::string validateSetting(const std::string &settingKey, const std::string &value);
+
+    /*
+     * @brief Merges two values of a setting with one line per block device, like io.max
+     *
+     * @return The lines of oldValue with the lines of newValue added, where a line of newValue
+     *         replaces the line of oldValue for the same device
+     */
+    std::string mergeDeviceSetting(const std::string &oldValue, const std::string &newValue);
 private :
     std::map<std::string, std::string> m_settings;
 
@@ -65,6 +87,22 @@ private :
      * @return A string to a value in bytes
      */
     std::string suffixCorrection(const std::string settingValue);
+
+    /*
+     * @brief Resolves a device given to io.max or io.weight to $MAJOR:$MINOR
+     *
+     * @param device : either $MAJOR:$MINOR or a path, which is resolved to the device it is on
+     *
+     * @throws InvalidInputError if the device is not valid or the path is not on a block device
+     */
+    std::string resolveDevice(const std::string &settingKey, const std::string &device);
+
+    /*
+     * @brief Parses the whole of a setting value as an integer in the range [min, max]
+     *
+     * @throws InvalidInputError if the value is not an integer in the range
+     */
+    int parseInteger(const std::string &settingKey, const std::string &settingValue, int min, int max);
 };
 
 } // namespace softwarecontainer
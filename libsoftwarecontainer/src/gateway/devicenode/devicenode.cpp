@@ -20,7 +20,6 @@
 #include <sys/stat.h>
 
 #include "devicenode.h"
-#include "functionjob.h"
 
 namespace softwarecontainer {
 
@@ -72,12 +71,7 @@ bool Device::activate(std::shared_ptr<ContainerAbstractInterface> container)
 
         // If mode is specified, try to set mode for the mounted device.
         if (m_mode != -1) {
-            FunctionJob job(container, [&] () {
-                return chmod(m_name.c_str(), m_mode);
-            });
-            job.start();
-            job.wait();
-            if (job.isError()) {
+            if (!container->setModeInContainer(m_name, m_mode)) {
                 log_error() << "Could not 'chmod " << m_mode
                             << "' the mounted device " << m_name;
                 return false;
@@ -18,6 +18,9 @@
  */
 
 #include "filegateway.h"
+#include "filegatewaymountplan.h"
+
+#include <ivi-profiling.h>
 
 namespace softwarecontainer {
 
@@ -45,23 +48,24 @@ bool FileGateway::readConfigElement(const json_t *element)
 
 bool FileGateway::activateGateway()
 {
-    const std::vector<FileGatewayParser::FileSetting> settings = m_store.getSettings();
-    for (const FileGatewayParser::FileSetting &setting : settings) {
-        if (!bindMount(setting)) {
-            return false;
-        }
+    profilepoint("fileGatewayPlanStart");
+    FileGatewayMountPlan plan(m_store.getSettings());
+    profilepoint("fileGatewayPlanEnd");
+
+    if (!bindMounts(plan.mounts())) {
+        return false;
     }
+    profilepoint("fileGatewayMountEnd");
+
     return true;
 }
 
-bool FileGateway::bindMount(const FileGatewayParser::FileSetting &setting)
+bool FileGateway::bindMounts(const std::vector<BindMountRequest> &mounts)
 {
     std::shared_ptr<ContainerAbstractInterface> con = getContainer();
 
-    if (!con->bindMountInContainer(setting.pathInHost,
-                                   setting.pathInContainer,
-                                   setting.readOnly)) {
-        log_error() << "Could not bind mount " << setting.pathInHost << " into container";
+    if (!con->bindMountsInContainer(mounts)) {
+        log_error() << "Could not bind mount files into container";
         return false;
     }
 
@@ -47,7 +47,7 @@ public:
     bool teardownGateway() override;
 
 private:
-    virtual bool bindMount(const FileGatewayParser::FileSetting &setting);
+    virtual bool bindMounts(const std::vector<BindMountRequest> &mounts);
 
     FileGatewaySettingStore m_store;
 };
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "filegatewaymountplan.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace softwarecontainer {
+
+namespace {
+
+typedef FileGatewayParser::FileSetting FileSetting;
+
+// Removes repeated and trailing slashes, so paths can be compared as strings
+std::string normalizePath(const std::string &path)
+{
+    std::string normalized;
+    for (char c : path) {
+        if (c != '/' || normalized.empty() || normalized.back() != '/') {
+            normalized += c;
+        }
+    }
+
+    if (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+bool isBelow(const std::string &path, const std::string &dir)
+{
+    if (dir == "/") {
+        return path.size() > 1 && path.front() == '/';
+    }
+
+    return path.size() > dir.size()
+        && path.compare(0, dir.size(), dir) == 0
+        && path[dir.size()] == '/';
+}
+
+} // namespace
+
+FileGatewayMountPlan::FileGatewayMountPlan(const std::vector<FileSetting> &settings)
+{
+    std::vector<FileSetting> planned = settings;
+    for (FileSetting &setting : planned) {
+        setting.pathInHost = normalizePath(setting.pathInHost);
+        setting.pathInContainer = normalizePath(setting.pathInContainer);
+    }
+
+    collapseDirectories(planned);
+
+    // A path sorts before all paths below it, so directories are mounted before their contents
+    std::sort(planned.begin(), planned.end(), [] (const FileSetting &a, const FileSetting &b) {
+        return a.pathInContainer < b.pathInContainer;
+    });
+
+    dropRedundant(planned);
+
+    for (const FileSetting &setting : planned) {
+        m_mounts.push_back({ setting.pathInHost, setting.pathInContainer, setting.readOnly });
+    }
+
+    log_debug() << "Planned " << m_mounts.size() << " mounts for "
+                << settings.size() << " file settings";
+}
+
+const std::vector<BindMountRequest> &FileGatewayMountPlan::mounts() const
+{
+    return m_mounts;
+}
+
+void FileGatewayMountPlan::collapseDirectories(std::vector<FileSetting> &settings)
+{
+    // Candidates by host directory, container directory and read-only setting
+    std::map<std::tuple<std::string, std::string, bool>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < settings.size(); i++) {
+        const FileSetting &setting = settings[i];
+        if (!setting.allowDirectoryMount
+            || baseName(setting.pathInHost) != baseName(setting.pathInContainer)) {
+            continue;
+        }
+
+        std::string containerDir = parentPath(setting.pathInContainer);
+        if (containerDir == "/") {
+            continue;
+        }
+
+        // A mount of the directory would not show files that are mount points themselves
+        if (isDirectory(setting.pathInHost) || isMountPoint(setting.pathInHost)) {
+            continue;
+        }
+
+        groups[std::make_tuple(parentPath(setting.pathInHost), containerDir, setting.readOnly)]
+            .push_back(i);
+    }
+
+    std::vector<bool> collapsed(settings.size(), false);
+    std::vector<FileSetting> directories;
+    for (const auto &group : groups) {
+        const std::vector<size_t> &members = group.second;
+        if (members.size() < 2) {
+            continue;
+        }
+
+        // Anything else mounted at or below the directory would end up in the host directory
+        const std::string &containerDir = std::get<1>(group.first);
+        bool conflict = false;
+        for (size_t i = 0; i < settings.size() && !conflict; i++) {
+            const std::string &path = settings[i].pathInContainer;
+            if (path == containerDir) {
+                conflict = true;
+            } else if (isBelow(path, containerDir)) {
+                conflict = std::find(members.begin(), members.end(), i) == members.end();
+            }
+        }
+
+        if (conflict) {
+            log_debug() << "Not mounting " << containerDir << " as a directory, "
+                        << "other paths are mounted in it";
+            continue;
+        }
+
+        FileSetting directory;
+        directory.pathInHost = std::get<0>(group.first);
+        directory.pathInContainer = containerDir;
+        directory.readOnly = std::get<2>(group.first);
+        directories.push_back(directory);
+
+        for (size_t i : members) {
+            collapsed[i] = true;
+        }
+        log_debug() << "Mounting " << members.size() << " files in " << containerDir
+                    << " as a directory";
+    }
+
+    if (directories.empty()) {
+        return;
+    }
+
+    std::vector<FileSetting> remaining;
+    for (size_t i = 0; i < settings.size(); i++) {
+        if (!collapsed[i]) {
+            remaining.push_back(settings[i]);
+        }
+    }
+    remaining.insert(remaining.end(), directories.begin(), directories.end());
+    settings.swap(remaining);
+}
+
+void FileGatewayMountPlan::dropRedundant(std::vector<FileSetting> &settings)
+{
+    // Directories that will be mounted, by path in container
+    std::unordered_map<std::string, const FileSetting *> directories;
+    std::vector<FileSetting> kept;
+
+    for (const FileSetting &setting : settings) {
+        // Only the closest directory mount above the path decides what is visible there
+        const FileSetting *enclosing = nullptr;
+        std::string path = setting.pathInContainer;
+        while (enclosing == nullptr && path != "/" && path != ".") {
+            path = parentPath(path);
+            auto found = directories.find(path);
+            if (found != directories.end()) {
+                enclosing = found->second;
+            }
+        }
+
+        if (enclosing != nullptr
+            && enclosing->readOnly == setting.readOnly
+            && setting.pathInHost == normalizePath(enclosing->pathInHost + "/"
+                   + setting.pathInContainer.substr(enclosing->pathInContainer.size()))
+            && !isMountPoint(setting.pathInHost)) {
+            log_debug() << setting.pathInContainer << " is already visible through "
+                        << enclosing->pathInContainer;
+            continue;
+        }
+
+        kept.push_back(setting);
+        if (isDirectory(setting.pathInHost)) {
+            directories[setting.pathInContainer] = &setting;
+        }
+    }
+
+    settings.swap(kept);
+}
+
+} // namespace softwarecontainer
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#pragma once
+
+#include "filegatewayparser.h"
+#include "containerabstractinterface.h"
+
+namespace softwarecontainer {
+
+/**
+ * @brief Compiles file gateway settings into the bind mounts needed to apply them
+ *
+ * The mounts are ordered by path in the container, so a directory is mounted before anything
+ * that is mounted inside it. To keep the number of mounts down:
+ *
+ *  * A setting is dropped if its host path is already visible at its container path through
+ *    a directory mounted by another setting, with the same read-only setting.
+ *  * Files from the same host directory that are mapped, with their names kept, to the same
+ *    container directory are replaced by a single mount of the directory, if all of them
+ *    have allow-directory-mount set and nothing else is mounted inside that directory. This
+ *    exposes the rest of the directory in the container too, and hides what was there before.
+ */
+class FileGatewayMountPlan
+{
+    LOG_DECLARE_CLASS_CONTEXT("FGMP", "File gateway mount plan");
+
+public:
+    /*
+     * @brief Create a plan from settings with unique container paths, see FileGatewaySettingStore
+     */
+    FileGatewayMountPlan(const std::vector<FileGatewayParser::FileSetting> &settings);
+
+    /*
+     * @brief Get the mounts to do, in order
+     */
+    const std::vector<BindMountRequest> &mounts() const;
+
+private:
+    void collapseDirectories(std::vector<FileGatewayParser::FileSetting> &settings);
+    void dropRedundant(std::vector<FileGatewayParser::FileSetting> &settings);
+
+    std::vector<BindMountRequest> m_mounts;
+};
+
+} // namespace softwarecontainer
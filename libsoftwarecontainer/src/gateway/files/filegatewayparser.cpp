@@ -49,6 +49,11 @@ bool FileGatewayParser::parseConfigElement(const json_t *element, FileSetting &s
         return false;
     }
 
+    if (!JSONParser::readOptional(element, "allow-directory-mount", setting.allowDirectoryMount)) {
+        log_error() << "allow-directory-mount has wrong format";
+        return false;
+    }
+
     return true;
 }
 
@@ -31,7 +31,9 @@ public:
     struct FileSetting {
         std::string pathInHost;
         std::string pathInContainer;
-        bool readOnly;
+        bool readOnly = false;
+        // The file may be made available by mounting its whole directory, see FileGatewayMountPlan
+        bool allowDirectoryMount = false;
 
         bool operator==(const FileSetting &rhs) {
             return pathInContainer == rhs.pathInContainer;
@@ -32,19 +32,23 @@ FileGatewaySettingStore::~FileGatewaySettingStore()
 
 bool FileGatewaySettingStore::addSetting(const FileGatewayParser::FileSetting &setting)
 {
-    auto it = std::find(m_settings.begin(), m_settings.end(), setting);
-    if (it != m_settings.end()) {
-        if (it->pathInHost != setting.pathInHost) {
+    auto found = m_index.find(setting.pathInContainer);
+    if (found != m_index.end()) {
+        FileGatewayParser::FileSetting &existing = m_settings[found->second];
+        if (existing.pathInHost != setting.pathInHost) {
             log_error() << "Specifying two files with destination path "
                         << setting.pathInContainer << " but different host paths, "
                         << "this is an error";
             return false;
         } else {
-            it->readOnly &= setting.readOnly;
+            existing.readOnly &= setting.readOnly;
+            // Exposing the rest of the directory must be allowed by all of them
+            existing.allowDirectoryMount &= setting.allowDirectoryMount;
             return true;
         }
     }
 
+    m_index[setting.pathInContainer] = m_settings.size();
     m_settings.push_back(setting);
     return true;
 }
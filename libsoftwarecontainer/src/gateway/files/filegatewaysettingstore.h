@@ -21,6 +21,8 @@
 
 #include "filegatewayparser.h"
 
+#include <unordered_map>
+
 namespace softwarecontainer {
 
 class FileGatewaySettingStore
@@ -57,6 +59,8 @@ public:
 private:
     // The internal storage of settings
     std::vector<FileGatewayParser::FileSetting> m_settings;
+    // Position of each setting in m_settings, by path in container
+    std::unordered_map<std::string, size_t> m_index;
 };
 
 } // namespace softwarecontainer
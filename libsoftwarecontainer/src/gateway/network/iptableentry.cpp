@@ -20,28 +20,29 @@
 #include "iptableentry.h"
 #include "gateway/gateway.h"
 #include <iostream>
+#include <sstream>
 
 namespace softwarecontainer {
 
-bool IPTableEntry::applyRules()
+bool IPTableEntry::commands(std::vector<std::vector<std::string>> &commands)
 {
     for (auto rule : m_rules) {
         if (rule.protocols.size()) {
 
             for (auto proto : rule.protocols) {
-                if (!insertCommand(interpretRuleWithProtocol(rule, proto))) {
+                if (!addCommand(interpretRuleWithProtocol(rule, proto), commands)) {
                     std::cerr << "Couldn't apply the rule " << rule.target << std::endl;
                     return false;
                 }
             }
 
-        } else if (!insertCommand(interpretRule(rule))) {
+        } else if (!addCommand(interpretRule(rule), commands)) {
             std::cerr << "Couldn't apply the rule " << rule.target << std::endl;
             return false;
         }
     }
 
-    if (!insertCommand(interpretPolicy())) {
+    if (!addCommand(interpretPolicy(), commands)) {
         std::cerr << "Unable to set policy " << convertTarget(m_defaultTarget)
                   << " for " << m_type << std::endl;
         return false;
@@ -158,24 +159,22 @@ std::string IPTableEntry::interpretPolicy()
 }
 
 
-bool IPTableEntry::insertCommand(std::string command)
+bool IPTableEntry::addCommand(const std::string &command,
+                             std::vector<std::vector<std::string>> &commands)
 {
-    std::cout << "Add network rule : " <<  command << std::endl;
-
-    try {
-        Glib::spawn_command_line_sync(command);
-
-    } catch (Glib::SpawnError e) {
-        std::cerr << "Failed to spawn " << command << ": code " << e.code()
-                  << " msg: " << e.what() << std::endl;
+    std::vector<std::string> commandLine;
+    std::istringstream words(command);
+    std::string word;
+    while (words >> word) {
+        commandLine.push_back(word);
+    }
 
-        return false;
-    } catch (Glib::ShellError e) {
-        std::cerr << "Failed to call " << command << ": code " << e.code()
-                  << " msg: " << e.what() << std::endl;
+    if (commandLine.empty()) {
         return false;
     }
 
+    std::cout << "Add network rule : " <<  command << std::endl;
+    commands.push_back(commandLine);
     return true;
 }
 
@@ -68,11 +68,16 @@ public:
     };
 
     /**
-     * @brief Applies all rules to iptables
+     * @brief Gets the iptables command lines that apply all rules
+     *
+     * The command lines are meant to be run in the container, see
+     * ContainerAbstractInterface::runInContainer.
+     *
+     * @param commands The command lines are appended here, one program and its arguments each
      * @return true  Upon success
      * @return false Upon failure
      */
-    bool applyRules();
+    bool commands(std::vector<std::vector<std::string>> &commands);
 
     /**
      * @brief Interprets a rule to iptables applicable string
@@ -114,11 +119,11 @@ private:
     std::string convertTarget (Target& t);
 
     /**
-     * @brief Inserts a rule to iptables
+     * @brief Splits an interpreted rule into a command line and appends it to commands
      * @return true  Upon success
-     * @return false Upon failure
+     * @return false If the rule could not be interpreted
      */
-    bool insertCommand(std::string command);
+    bool addCommand(const std::string &command, std::vector<std::vector<std::string>> &commands);
 };
 
 } // namespace softwarecontainer
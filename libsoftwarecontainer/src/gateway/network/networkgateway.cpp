@@ -22,7 +22,6 @@
 #include "unistd.h"
 #include "networkgateway.h"
 #include "networkgatewayparser.h"
-#include "functionjob.h"
 
 namespace softwarecontainer {
 
@@ -84,16 +83,18 @@ bool NetworkGateway::activateGateway()
 
     log_debug() << "Adding iptables entries";
     for (auto entry : m_entries) {
-        FunctionJob job (getContainer(), [&] () {
-            return entry.applyRules() ? SUCCESS : FAILURE;
-        });
-        job.start();
-
-        job.wait();
-        if (job.isError()) {
+        std::vector<std::vector<std::string>> commands;
+        if (!entry.commands(commands)) {
             log_error() << "Failed to apply rules for entry: " << entry.toString();
             return false;
         }
+
+        for (const std::vector<std::string> &command : commands) {
+            if (!getContainer()->runInContainer(command)) {
+                log_error() << "Failed to apply rules for entry: " << entry.toString();
+                return false;
+            }
+        }
     }
 
     return true;
@@ -106,101 +107,42 @@ bool NetworkGateway::teardownGateway()
 
 bool NetworkGateway::setDefaultGateway()
 {
-    FunctionJob job(getContainer(), [this] {
-        Netlink n;
-        return n.setDefaultGateway(m_gateway.c_str()) ? SUCCESS : FAILURE;
-    });
-
-    job.start();
-    job.wait();
-    return job.isSuccess();
+    return getContainer()->addDefaultRouteInContainer(m_gateway);
 }
 
 bool NetworkGateway::up()
 {
-    static const constexpr int BAD_SETIP = 3;
-
     if (m_interfaceInitialized) {
         log_debug() << "Interface already configured";
         return true;
     }
 
-    log_debug() << "Attempting to bring up eth0";
-    FunctionJob jobBringUpEthernet(getContainer(), [this] {
-        Netlink n;
-
-        Netlink::LinkInfo iface;
-        if (!n.findLink("eth0", iface)) {
-            return NO_LINK;
-        }
-
-        int ifaceIndex = iface.first.ifi_index;
-        if (!n.linkUp(ifaceIndex)) {
-            return BAD_LINKUP;
-        }
-
-        if (!n.setIP(ifaceIndex, m_ip, m_netmask)) {
-            return BAD_SETIP;
-        }
-
-        return SUCCESS;
-    });
-
-    jobBringUpEthernet.start();
+    log_debug() << "Attempting to bring up " << INTERFACE;
+    std::shared_ptr<ContainerAbstractInterface> container = getContainer();
+    if (!container->setLinkStateInContainer(INTERFACE, true)) {
+        log_error() << "Could not bring interface " << INTERFACE << " up in container";
+        return false;
+    }
 
-    int returnCode = jobBringUpEthernet.wait();
-    switch(returnCode) {
-        case NO_LINK:
-            log_error() << "Could not find interface eth0 in container";
-            return false;
-        case BAD_LINKUP:
-            log_error() << "Could not bring interface eth0 up in container";
-            return false;
-        case BAD_SETIP:
-            log_error() << "Could not set IP-address";
-            return false;
-        case SUCCESS:
-            log_debug() << "Interface brought up, proceeding to set default gateway";
-            m_interfaceInitialized = true;
-            return setDefaultGateway();
-        default:
-            log_error() << "Unhandled case in NetworkGateway::up(), this is an error!";
-            return false;
+    if (!container->setAddressInContainer(INTERFACE, m_ip, m_netmask)) {
+        log_error() << "Could not set IP-address";
+        return false;
     }
+
+    log_debug() << "Interface brought up, proceeding to set default gateway";
+    m_interfaceInitialized = true;
+    return setDefaultGateway();
 }
 
 bool NetworkGateway::down()
 {
-    log_debug() << "Attempting to configure eth0 to 'down state'";
-    FunctionJob job(getContainer(), [this] {
-        Netlink n;
-        Netlink::LinkInfo iface;
-        if (!n.findLink("eth0", iface)) {
-            return NO_LINK;
-        }
-
-        if (!n.linkDown(iface.first.ifi_index)) {
-            return BAD_LINKDOWN;
-        }
-
-        return SUCCESS;
-    });
-    job.start();
-    int returnCode = job.wait();
-    switch(returnCode)
-    {
-        case NO_LINK:
-            log_error() << "Could not find interface eth0 in container";
-            return false;
-        case BAD_LINKDOWN:
-            log_error() << "Could not bring interface eth0 down in container";
-            return false;
-        case SUCCESS:
-            return true;
-        default:
-            log_error() << "Unhandled case in NetworkGateway::down(), this is an error!";
-            return false;
+    log_debug() << "Attempting to configure " << INTERFACE << " to 'down state'";
+    if (!getContainer()->setLinkStateInContainer(INTERFACE, false)) {
+        log_error() << "Could not bring interface " << INTERFACE << " down in container";
+        return false;
     }
+
+    return true;
 }
 
 bool NetworkGateway::isBridgeAvailable()
@@ -19,6 +19,8 @@
 
 #include "commandjob.h"
 
+#include <unistd.h>
+
 namespace softwarecontainer {
 
 CommandJob::CommandJob(ExecutablePtr executable,
@@ -39,13 +41,33 @@ bool CommandJob::setWorkingDirectory(const std::string &folder)
 
 bool CommandJob::start()
 {
-    return m_executable->execute(m_command,
-                                 &m_pid,
-                                 m_env,
-                                 m_workingDirectory,
-                                 m_stdin[0],
-                                 m_stdout[1],
-                                 m_stderr[1]);
+    bool result = m_executable->execute(m_command,
+                                        &m_pid,
+                                        m_env,
+                                        m_workingDirectory,
+                                        m_stdin[0],
+                                        m_stdout[1],
+                                        m_stderr[1]);
+
+    // The process has its own copies of the pipe ends it uses, close ours so that reading
+    // the other ends sees end of file once the process is done with them
+    if (m_stdout[0] != UNASSIGNED_STREAM && m_stdout[1] != UNASSIGNED_STREAM) {
+        ::close(m_stdout[1]);
+        if (m_stderr[1] == m_stdout[1]) {
+            m_stderr[1] = UNASSIGNED_STREAM;
+        }
+        m_stdout[1] = UNASSIGNED_STREAM;
+    }
+    if (m_stderr[0] != UNASSIGNED_STREAM && m_stderr[1] != UNASSIGNED_STREAM) {
+        ::close(m_stderr[1]);
+        m_stderr[1] = UNASSIGNED_STREAM;
+    }
+    if (m_stdin[1] != UNASSIGNED_STREAM && m_stdin[0] != UNASSIGNED_STREAM) {
+        ::close(m_stdin[0]);
+        m_stdin[0] = UNASSIGNED_STREAM;
+    }
+
+    return result;
 }
 
 std::string CommandJob::toString() const
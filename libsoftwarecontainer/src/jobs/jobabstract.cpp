@@ -56,6 +56,12 @@ void JobAbstract::captureStderr()
     pipe(m_stderr);
 }
 
+void JobAbstract::captureOutput()
+{
+    pipe(m_stdout);
+    m_stderr[1] = m_stdout[1];
+}
+
 int JobAbstract::wait()
 {
     m_exitStatus = waitForProcessTermination(m_pid);
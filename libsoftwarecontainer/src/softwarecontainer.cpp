@@ -21,6 +21,9 @@
 #include "gateway/gateway.h"
 #include "container.h"
 
+#include <algorithm>
+#include <sys/statfs.h>
+
 #ifdef ENABLE_PULSEGATEWAY
 #include "gateway/pulsegateway.h"
 #endif
@@ -55,8 +58,14 @@
 
 namespace softwarecontainer {
 
+// Where the gateway configurations and bind mounts are saved in a checkpoint directory
+static const std::string CHECKPOINT_STATE_FILE = "state.json";
+// Where the CRIU images are written in a checkpoint directory
+static const std::string CHECKPOINT_IMAGES_DIR = "images";
+
 SoftwareContainer::SoftwareContainer(const ContainerID id,
-                                     std::unique_ptr<const SoftwareContainerConfig> config):
+                                     std::unique_ptr<const SoftwareContainerConfig> config,
+                                     const std::string &checkpointDirectory):
     m_containerID(id),
     m_config(std::move(config)),
     m_previouslyConfigured(false)
@@ -68,7 +77,10 @@ SoftwareContainer::SoftwareContainer(const ContainerID id,
         if (m_config->temporaryFileSystemWriteBufferEnableds()) {
             m_tmpfsSize = m_config->temporaryFileSystemSize();
         }
-        tmpfsMount(m_containerRoot, m_tmpfsSize);
+        // The tmpfs may only grow if a larger max size is configured
+        m_tmpfsMaxSize = std::max(m_tmpfsSize,
+                                  static_cast<uint64_t>(m_config->temporaryFileSystemMaxSize()));
+        m_tmpfsMounted = tmpfsMount(m_containerRoot, m_tmpfsSize);
     }
 
 #ifdef ENABLE_NETWORKGATEWAY
@@ -80,21 +92,105 @@ SoftwareContainer::SoftwareContainer(const ContainerID id,
                       m_config->containerConfigPath(),
                       m_containerRoot,
                       m_config->writeBufferEnabled(),
-                      m_config->containerShutdownTimeout()));
+                      m_config->containerShutdownTimeout(),
+                      m_config->asyncWriteBufferSync(),
+                      m_config->appImage(),
+                      m_config->volatileWriteBuffer()));
 
-    if(!init()) {
+    if(!init(checkpointDirectory)) {
         throw SoftwareContainerError("Could not initialize SoftwareContainer, container ID: "
                                      + std::to_string(id));
     }
 
     m_containerState.setValueNotify(ContainerState::READY);
+
+    if (!checkpointDirectory.empty()
+        && !restoreState(buildPath(checkpointDirectory, CHECKPOINT_STATE_FILE))) {
+        throw SoftwareContainerError("Could not set up gateways of restored container, container ID: "
+                                     + std::to_string(id));
+    }
 }
 
 SoftwareContainer::~SoftwareContainer()
 {
 }
 
-bool SoftwareContainer::start()
+bool SoftwareContainer::writeBufferUsage(WriteBufferUsage &usage)
+{
+    if (!m_tmpfsMounted) {
+        return false;
+    }
+
+    struct statfs stats;
+    if (statfs(m_containerRoot.c_str(), &stats) != 0) {
+        log_error() << "Could not get write buffer usage of " << m_containerRoot
+                    << ": " << strerror(errno);
+        return false;
+    }
+
+    uint64_t blockSize = stats.f_frsize ? stats.f_frsize : stats.f_bsize;
+    usage.sizeBytes = stats.f_blocks * blockSize;
+    usage.freeBytes = stats.f_bavail * blockSize;
+    usage.usedBytes = (stats.f_blocks - stats.f_bfree) * blockSize;
+    usage.maxSizeBytes = m_tmpfsMaxSize;
+    return true;
+}
+
+bool SoftwareContainer::resizeWriteBuffer(uint64_t size)
+{
+    if (!m_tmpfsMounted) {
+        log_error() << "Container " << m_containerID << " has no tmpfs write buffer to resize";
+        return false;
+    }
+
+    if (size > m_tmpfsMaxSize) {
+        log_error() << "Can not resize write buffer of container " << m_containerID
+                    << " to " << size << ", max size is " << m_tmpfsMaxSize;
+        return false;
+    }
+
+    if (!tmpfsResize(m_containerRoot, size)) {
+        return false;
+    }
+
+    log_info() << "Write buffer of container " << m_containerID << " resized from "
+               << m_tmpfsSize << " to " << size;
+    m_tmpfsSize = size;
+    return true;
+}
+
+bool SoftwareContainer::setCgroupLimits(const std::map<std::string, std::string> &limits)
+{
+    assertValidState();
+
+    if (m_containerState != ContainerState::READY
+        && m_containerState != ContainerState::SUSPENDED) {
+        std::string message = "Invalid to change cgroup limits of a container that is not running "
+                              + std::string(m_container->id());
+        log_error() << message;
+        throw InvalidOperationError(message);
+    }
+
+#ifdef ENABLE_CGROUPSGATEWAY
+    for (auto &gateway : m_gateways) {
+        if (gateway->id() == CgroupsGateway::ID) {
+            return static_cast<CgroupsGateway *>(gateway.get())->updateLimits(limits);
+        }
+    }
+#else
+    (void) limits;
+#endif // ENABLE_CGROUPSGATEWAY
+
+    log_error() << "Can not change cgroup limits, the cgroups gateway is not enabled";
+    return false;
+}
+
+std::string SoftwareContainer::cgroupPath()
+{
+    return m_container->cgroupPath();
+}
+
+bool SoftwareContainer::start(const std::string &checkpointDirectory)
 {
     log_debug() << "Initializing container";
     if (!m_container->initialize()) {
@@ -107,6 +203,17 @@ bool SoftwareContainer::start()
         return false;
     }
 
+    if (!checkpointDirectory.empty()) {
+        log_debug() << "Restoring container from " << checkpointDirectory;
+        if (!m_container->restore(buildPath(checkpointDirectory, CHECKPOINT_IMAGES_DIR), &m_pcPid)) {
+            log_error() << "Could not restore container";
+            return false;
+        }
+
+        log_debug() << "Restored container with PID " << m_pcPid;
+        return true;
+    }
+
     log_debug() << "Starting container";
     if (!m_container->start(&m_pcPid)) {
         log_error() << "Could not start container";
@@ -117,9 +224,9 @@ bool SoftwareContainer::start()
     return true;
 }
 
-bool SoftwareContainer::init()
+bool SoftwareContainer::init(const std::string &checkpointDirectory)
 {
-    if (!start()) {
+    if (!start(checkpointDirectory)) {
         log_error() << "Failed to start container";
         return false;
     }
@@ -195,6 +302,10 @@ bool SoftwareContainer::startGateways(const GatewayConfiguration &gwConfig)
     // Keep track of if user has called this method at least once
     m_previouslyConfigured = true;
 
+    if (!m_gatewayConfigs.append(gwConfig)) {
+        log_warning() << "Could not keep the gateway configuration, it will not be checkpointed";
+    }
+
     return true;
 }
 
@@ -271,6 +382,11 @@ bool SoftwareContainer::activateGateways()
         }
     }
 
+    // Gateways only update the environment in memory, write the file once for the whole batch
+    if (!m_container->writeEnvironmentFile()) {
+        log_warning() << "Failed to write the environment file for the container";
+    }
+
     return true;
 }
 
@@ -388,6 +504,11 @@ ObservableProperty<ContainerState> &SoftwareContainer::getContainerState()
     return m_containerState;
 }
 
+pid_t SoftwareContainer::initPid()
+{
+    return m_pcPid;
+}
+
 std::shared_ptr<FunctionJob> SoftwareContainer::createFunctionJob(const std::function<int()> fun)
 {
     assertValidState();
@@ -430,7 +551,163 @@ bool SoftwareContainer::bindMount(const std::string &pathOnHost,
         throw InvalidOperationError(message);
     }
 
-    return m_container->bindMountInContainer(pathOnHost, pathInContainer, readonly);
+    if (!m_container->bindMountInContainer(pathOnHost, pathInContainer, readonly)) {
+        return false;
+    }
+
+    m_bindMounts.push_back(BindMount{pathOnHost, pathInContainer, readonly});
+    return true;
+}
+
+void SoftwareContainer::checkpoint(const std::string &directory)
+{
+    assertValidState();
+
+    std::string id = std::string(m_container->id());
+
+    if (m_containerState != ContainerState::READY
+        && m_containerState != ContainerState::SUSPENDED) {
+        std::string message = "Invalid to checkpoint container which is not ready or suspended " + id;
+        log_error() << message;
+        throw InvalidOperationError(message);
+    }
+
+    if (!saveState(buildPath(directory, CHECKPOINT_STATE_FILE))) {
+        std::string message = "Could not save the gateways of container " + id;
+        log_error() << message;
+        throw ContainerError(message);
+    }
+
+    // CRIU can not dump mounts of paths from outside the container, so the bind mounts are
+    // left out of the checkpoint and done again by restoreState
+    if (!unmountBindMounts()) {
+        std::string message = "Could not unmount the bind mounts of container " + id;
+        log_error() << message;
+        throw ContainerError(message);
+    }
+
+    if (!m_container->checkpoint(buildPath(directory, CHECKPOINT_IMAGES_DIR))) {
+        remountBindMounts(0);
+        std::string message = "Failed to checkpoint container " + id;
+        log_error() << message;
+        throw ContainerError(message);
+    }
+    log_debug() << "Checkpointed container " << id << " to " << directory;
+
+    // The processes are stopped, what is left is torn down like in shutdown
+    if (!shutdownGateways()) {
+        log_error() << "Could not shut down all gateways cleanly, check the log";
+    }
+
+    if (!m_container->destroy()) {
+        std::string message = "Could not destroy the container after checkpoint " + id;
+        log_error() << message;
+        m_containerState.setValueNotify(ContainerState::INVALID);
+        throw ContainerError(message);
+    }
+
+    m_containerState.setValueNotify(ContainerState::TERMINATED);
+}
+
+bool SoftwareContainer::saveState(const std::string &path)
+{
+    json_t *gateways = json_object();
+    for (auto &gatewayId : m_gatewayConfigs.ids()) {
+        json_object_set_new(gateways, gatewayId.c_str(), m_gatewayConfigs.config(gatewayId));
+    }
+
+    json_t *bindMounts = json_array();
+    for (auto &mount : m_bindMounts) {
+        json_array_append_new(bindMounts, json_pack("{s:s, s:s, s:b}",
+                                                    "pathOnHost", mount.pathOnHost.c_str(),
+                                                    "pathInContainer", mount.pathInContainer.c_str(),
+                                                    "readOnly", mount.readOnly));
+    }
+
+    json_t *state = json_object();
+    json_object_set_new(state, "gateways", gateways);
+    json_object_set_new(state, "bindMounts", bindMounts);
+
+    bool success = (json_dump_file(state, path.c_str(), JSON_INDENT(4)) == 0);
+    json_decref(state);
+    if (!success) {
+        log_error() << "Could not write " << path;
+    }
+    return success;
+}
+
+bool SoftwareContainer::restoreState(const std::string &path)
+{
+    json_error_t error;
+    json_t *state = json_load_file(path.c_str(), 0, &error);
+    if (state == nullptr) {
+        log_error() << "Could not read " << path << ": " << error.text;
+        return false;
+    }
+
+    GatewayConfiguration gatewayConfigs;
+    const char *gatewayId;
+    json_t *config;
+    json_object_foreach(json_object_get(state, "gateways"), gatewayId, config) {
+        gatewayConfigs.append(gatewayId, config);
+    }
+
+    std::vector<BindMount> bindMounts;
+    size_t index;
+    json_t *mount;
+    json_array_foreach(json_object_get(state, "bindMounts"), index, mount) {
+        const char *pathOnHost = nullptr;
+        const char *pathInContainer = nullptr;
+        int readOnly = 1;
+        if (json_unpack(mount, "{s:s, s:s, s:b}", "pathOnHost", &pathOnHost,
+                        "pathInContainer", &pathInContainer, "readOnly", &readOnly) != 0) {
+            log_error() << "Invalid bind mount in " << path;
+            json_decref(state);
+            return false;
+        }
+        bindMounts.push_back(BindMount{pathOnHost, pathInContainer, readOnly != 0});
+    }
+    json_decref(state);
+
+    // Gateways set up their sockets and mounts in the container again when activated
+    if (!gatewayConfigs.empty() && !startGateways(gatewayConfigs)) {
+        return false;
+    }
+
+    // The bind mounts are not part of the checkpoint, see checkpoint()
+    for (auto &bindMount : bindMounts) {
+        if (!this->bindMount(bindMount.pathOnHost, bindMount.pathInContainer, bindMount.readOnly)) {
+            log_error() << "Could not bind mount " << bindMount.pathOnHost << " to "
+                        << bindMount.pathInContainer << " again";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SoftwareContainer::unmountBindMounts()
+{
+    // Later mounts can be inside earlier ones, so they are unmounted first
+    for (size_t i = m_bindMounts.size(); i > 0; i--) {
+        if (!m_container->unmountInContainer(m_bindMounts[i - 1].pathInContainer)) {
+            remountBindMounts(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+void SoftwareContainer::remountBindMounts(size_t first)
+{
+    for (size_t i = first; i < m_bindMounts.size(); i++) {
+        const BindMount &mount = m_bindMounts[i];
+        if (!m_container->bindMountInContainer(mount.pathOnHost, mount.pathInContainer,
+                                               mount.readOnly)) {
+            log_error() << "Could not bind mount " << mount.pathOnHost << " to "
+                        << mount.pathInContainer << " again";
+        }
+    }
 }
 
 void SoftwareContainer::assertValidState()
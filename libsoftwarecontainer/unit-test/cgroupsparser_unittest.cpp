@@ -88,6 +88,18 @@ INSTANTIATE_TEST_CASE_P(TestBadConfigs, CGroupsNegativeTest, ::testing::Values(
        \"value\": \"15Q\"\
      }",
 
+    // Only cgroup v2 settings can be unlimited
+    "{\
+       \"setting\": \"memory.limit_in_bytes\",\
+       \"value\": \"max\"\
+     }",
+
+    // Value has a bad suffix
+    "{\
+       \"setting\": \"memory.high\",\
+       \"value\": \"15Q\"\
+     }",
+
     // Value must be at least 2
     "{\
        \"setting\": \"cpu.shares\",\
@@ -112,6 +124,66 @@ INSTANTIATE_TEST_CASE_P(TestBadConfigs, CGroupsNegativeTest, ::testing::Values(
        \"value\": \"abc\"\
      }",
 
+    // Value out of range
+    "{\
+       \"setting\": \"cpu.weight\",\
+       \"value\": \"0\"\
+     }",
+
+    // Value is not only an integer
+    "{\
+       \"setting\": \"io.weight\",\
+       \"value\": \"100abc\"\
+     }",
+
+    // Period is too short
+    "{\
+       \"setting\": \"cpu.max\",\
+       \"value\": \"50000 10\"\
+     }",
+
+    // io.max without any limit
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"8:0\"\
+     }",
+
+    // io.max limit can not be zero
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"8:0 rbps=0\"\
+     }",
+
+    // io.max device must be a path or $MAJOR:$MINOR
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"sda wiops=100\"\
+     }",
+
+    // io.max device path does not exist
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"/nonexistent rbps=1m\"\
+     }",
+
+    // Unknown io.max limit
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"8:0 rlat=100\"\
+     }",
+
+    // io.weight of a device out of range
+    "{\
+       \"setting\": \"io.weight\",\
+       \"value\": \"8:0 0\"\
+     }",
+
+    // CPU range is reversed
+    "{\
+       \"setting\": \"cpuset.cpus\",\
+       \"value\": \"3-1\"\
+     }",
+
     // Value is wrong type
     "{\
         \"setting\": \"net_cls.classid\",\
@@ -172,6 +244,53 @@ INSTANTIATE_TEST_CASE_P(TestGoodConfigs, CGroupsPositiveTest, ::testing::Values(
        \"value\": \"15g\"\
      }",
 
+    // cgroup v2 settings with suffix
+    "{\
+       \"setting\": \"memory.max\",\
+       \"value\": \"15m\"\
+     }",
+
+    "{\
+       \"setting\": \"memory.high\",\
+       \"value\": \"max\"\
+     }",
+
+    // cgroup v2 CPU and IO settings
+    "{\
+       \"setting\": \"cpu.weight\",\
+       \"value\": \"10000\"\
+     }",
+
+    "{\
+       \"setting\": \"cpu.max\",\
+       \"value\": \"max 100000\"\
+     }",
+
+    "{\
+       \"setting\": \"cpu.max\",\
+       \"value\": \"50000\"\
+     }",
+
+    "{\
+       \"setting\": \"io.weight\",\
+       \"value\": \"1\"\
+     }",
+
+    "{\
+       \"setting\": \"cpuset.cpus\",\
+       \"value\": \"0-3,6\"\
+     }",
+
+    "{\
+       \"setting\": \"io.max\",\
+       \"value\": \"8:0 rbps=10m wbps=max wiops=100\"\
+     }",
+
+    "{\
+       \"setting\": \"io.weight\",\
+       \"value\": \"8:16 200\"\
+     }",
+
     // Proper value for cpu.shares
     "{\
        \"setting\": \"cpu.shares\",\
@@ -302,6 +421,24 @@ INSTANTIATE_TEST_CASE_P(CGroupsWhitelistParameters, CGroupsParserWhitelistTests,
             "{\"setting\": \"memory.memsw.limit_in_bytes\", \"value\": \"12g\"}",
             "12884901888"
         },
+        testWhitelist{
+            "memory.max",
+            "{\"setting\": \"memory.max\", \"value\": \"1M\"}",
+            "{\"setting\": \"memory.max\", \"value\": \"100K\"}",
+            "1048576"
+        },
+        testWhitelist{
+            "memory.high",
+            "{\"setting\": \"memory.high\", \"value\": \"1M\"}",
+            "{\"setting\": \"memory.high\", \"value\": \"max\"}",
+            "max"
+        },
+        testWhitelist{
+            "memory.high",
+            "{\"setting\": \"memory.high\", \"value\": \"max\"}",
+            "{\"setting\": \"memory.high\", \"value\": \"1G\"}",
+            "max"
+        },
         testWhitelist{
             "cpu.shares",
             "{\"setting\": \"cpu.shares\", \"value\": \"520\"}",
@@ -314,6 +451,24 @@ INSTANTIATE_TEST_CASE_P(CGroupsWhitelistParameters, CGroupsParserWhitelistTests,
             "{\"setting\": \"cpu.shares\", \"value\": \"1500\"}",
             "3000"
         },
+        testWhitelist{
+            "io.max",
+            "{\"setting\": \"io.max\", \"value\": \"8:0 rbps=1k\"}",
+            "{\"setting\": \"io.max\", \"value\": \"8:16  wiops=10\"}",
+            "8:0 rbps=1024\n8:16 wiops=10"
+        },
+        testWhitelist{
+            "io.max",
+            "{\"setting\": \"io.max\", \"value\": \"8:0 rbps=1k\"}",
+            "{\"setting\": \"io.max\", \"value\": \"8:0 rbps=max\"}",
+            "8:0 rbps=max"
+        },
+        testWhitelist{
+            "io.weight",
+            "{\"setting\": \"io.weight\", \"value\": \"100\"}",
+            "{\"setting\": \"io.weight\", \"value\": \"8:0 500\"}",
+            "100\n8:0 500"
+        },
         testWhitelist{
             "unsupported.parameter",
             "{\"setting\": \"unsupported.parameter\", \"value\": \"500\"}",
@@ -112,6 +112,8 @@ public :
 
     bool mountDevice(const std::string &) {return true;}
 
+    bool setModeInContainer(const std::string &, mode_t) {return true;}
+
     bool bindMountInContainer(const std::string &, const std::string &, bool ) {return true;}
 
     bool setEnvironmentVariable(const std::string &, const std::string &) {return true;}
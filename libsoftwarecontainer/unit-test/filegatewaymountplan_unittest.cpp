@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 Pelagicore AB
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+ * BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ * For further information see LICENSE
+ */
+
+#include "gateway/files/filegatewaymountplan.h"
+
+#include "createdir.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <fstream>
+
+using namespace softwarecontainer;
+
+class FileGatewayMountPlanTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        hostDir = cd.createTempDirectoryFromTemplate("/tmp/sc-FileGatewayMountPlanTest-XXXXXX");
+        subDir = buildPath(hostDir, "sub");
+        ASSERT_TRUE(cd.createDirectory(subDir));
+        for (const char *name : { "a.txt", "b.txt", "sub/c.txt" }) {
+            std::ofstream(buildPath(hostDir, name)) << name;
+        }
+    }
+
+    FileGatewayParser::FileSetting setting(const std::string &pathInHost,
+                                           const std::string &pathInContainer,
+                                           bool readOnly = false,
+                                           bool allowDirectoryMount = false)
+    {
+        FileGatewayParser::FileSetting setting;
+        setting.pathInHost = pathInHost;
+        setting.pathInContainer = pathInContainer;
+        setting.readOnly = readOnly;
+        setting.allowDirectoryMount = allowDirectoryMount;
+        return setting;
+    }
+
+    std::vector<std::string> targets(const FileGatewayMountPlan &plan)
+    {
+        std::vector<std::string> result;
+        for (const BindMountRequest &mount : plan.mounts()) {
+            result.push_back(mount.pathInContainer);
+        }
+        return result;
+    }
+
+    CreateDir cd;
+    std::string hostDir;
+    std::string subDir;
+};
+
+/*
+ * Directories are mounted before the paths mounted inside them
+ */
+TEST_F(FileGatewayMountPlanTest, ParentsBeforeChildren) {
+    FileGatewayMountPlan plan({
+        setting(buildPath(hostDir, "a.txt"), "/data/dir/a.txt"),
+        setting(subDir, "/data/dir"),
+        setting(buildPath(hostDir, "b.txt"), "/data/b.txt"),
+    });
+
+    ASSERT_EQ(std::vector<std::string>({ "/data/b.txt", "/data/dir", "/data/dir/a.txt" }),
+              targets(plan));
+}
+
+/*
+ * Paths already visible through a mounted directory are not mounted again, unless the
+ * read-only setting differs
+ */
+TEST_F(FileGatewayMountPlanTest, DropsPathsVisibleThroughDirectory) {
+    FileGatewayMountPlan plan({
+        setting(buildPath(subDir, "c.txt"), "/data/sub/c.txt"),
+        setting(hostDir, "/data/"),
+        setting(buildPath(hostDir, "a.txt"), "/data/a.txt", true),
+        setting(buildPath(hostDir, "b.txt"), "/data/other.txt"),
+    });
+
+    ASSERT_EQ(std::vector<std::string>({ "/data", "/data/a.txt", "/data/other.txt" }),
+              targets(plan));
+}
+
+/*
+ * Files from the same directory are mounted as the directory when all of them allow it
+ */
+TEST_F(FileGatewayMountPlanTest, CollapsesFilesInDirectory) {
+    FileGatewayMountPlan plan({
+        setting(buildPath(hostDir, "a.txt"), "/data/a.txt", true, true),
+        setting(buildPath(hostDir, "b.txt"), "/data/b.txt", true, true),
+    });
+
+    ASSERT_EQ(1u, plan.mounts().size());
+    ASSERT_EQ(hostDir, plan.mounts().at(0).pathInHost);
+    ASSERT_EQ("/data", plan.mounts().at(0).pathInContainer);
+    ASSERT_TRUE(plan.mounts().at(0).readOnly);
+}
+
+/*
+ * Files are not collapsed if not all allow it, if they are renamed, if the read-only
+ * settings differ, or if something else is mounted in the directory
+ */
+TEST_F(FileGatewayMountPlanTest, DoesNotCollapseWhenNotAllowed) {
+    std::string a = buildPath(hostDir, "a.txt");
+    std::string b = buildPath(hostDir, "b.txt");
+
+    ASSERT_EQ(2u, FileGatewayMountPlan({
+        setting(a, "/data/a.txt", false, true),
+        setting(b, "/data/b.txt", false, false),
+    }).mounts().size());
+
+    ASSERT_EQ(2u, FileGatewayMountPlan({
+        setting(a, "/data/a.txt", false, true),
+        setting(b, "/data/renamed.txt", false, true),
+    }).mounts().size());
+
+    ASSERT_EQ(2u, FileGatewayMountPlan({
+        setting(a, "/data/a.txt", false, true),
+        setting(b, "/data/b.txt", true, true),
+    }).mounts().size());
+
+    ASSERT_EQ(3u, FileGatewayMountPlan({
+        setting(a, "/data/a.txt", false, true),
+        setting(b, "/data/b.txt", false, true),
+        setting(buildPath(subDir, "c.txt"), "/data/other/c.txt"),
+    }).mounts().size());
+}
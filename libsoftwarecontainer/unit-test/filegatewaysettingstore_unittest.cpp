@@ -78,6 +78,27 @@ TEST_F(FileGatewaySettingStoreTest, ReadOnlyPrecedence) {
     ASSERT_EQ(store.getSettings().at(0).readOnly, false);
 }
 
+/*
+ * Merged settings only allow mounting the whole directory if all of them do
+ */
+TEST_F(FileGatewaySettingStoreTest, AllowDirectoryMountPrecedence) {
+
+    FileGatewayParser::FileSetting settingAllowed;
+    settingAllowed.pathInHost = FILE_PATH;
+    settingAllowed.pathInContainer = CONTAINER_PATH;
+    settingAllowed.allowDirectoryMount = true;
+
+    FileGatewayParser::FileSetting settingNotAllowed = settingAllowed;
+    settingNotAllowed.allowDirectoryMount = false;
+
+    ASSERT_TRUE(store.addSetting(settingAllowed));
+    ASSERT_TRUE(store.getSettings().at(0).allowDirectoryMount);
+
+    ASSERT_TRUE(store.addSetting(settingNotAllowed));
+    ASSERT_EQ(1u, store.getSettings().size());
+    ASSERT_FALSE(store.getSettings().at(0).allowDirectoryMount);
+}
+
 /*
  * Testing same host path but different container paths is fine, we will
  * mount the same file to two places, no problems.
@@ -133,3 +133,36 @@ TEST_F(IPTableEntryTest, IPTableEntryOutputSinglePort) {
               " -j ACCEPT", ipTable.interpretRule(r));
 }
 
+
+/*
+ * @brief Tests that the rules and the policy are split into command lines, one per protocol
+ * */
+TEST_F(IPTableEntryTest, Commands) {
+    ipTable.m_type = "OUTPUT";
+    IPTableEntry::Rule r;
+    r.host = "127.0.0.1/16";
+    r.ports = {true, false, "80"};
+    r.target = IPTableEntry::Target::ACCEPT;
+    r.protocols = {"tcp", "udp"};
+    ipTable.m_rules.push_back(r);
+
+    std::vector<std::vector<std::string>> commands;
+    ASSERT_TRUE(ipTable.commands(commands));
+    ASSERT_EQ(3u, commands.size());
+    ASSERT_EQ(std::vector<std::string>({"iptables", "-A", "OUTPUT", "-d", "127.0.0.1/16",
+                                        "-p", "tcp", "--dport", "80", "-j", "ACCEPT"}),
+              commands[0]);
+    ASSERT_EQ("udp", commands[1][6]);
+    ASSERT_EQ(std::vector<std::string>({"iptables", "-P", "OUTPUT", "DROP"}), commands[2]);
+}
+
+/*
+ * @brief Tests that no commands are given for an entry with an invalid default target
+ * */
+TEST_F(IPTableEntryTest, CommandsInvalidPolicy) {
+    ipTable.m_defaultTarget = IPTableEntry::Target::REJECT;
+
+    std::vector<std::vector<std::string>> commands;
+    ASSERT_FALSE(ipTable.commands(commands));
+    ASSERT_TRUE(commands.empty());
+}
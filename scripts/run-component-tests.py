@@ -111,6 +111,7 @@ def runTestSuite(binary, name):
 # These are the component tests
 runTestSuite("./agent/component-test/softwarecontaineragent-component-test", "AgentComponentTest")
 runTestSuite("./libsoftwarecontainer/component-test/softwarecontainer-component-test", "LibComponentTest")
+runTestSuite("./common/component-test/softwarecontainercommon-component-test", "CommonComponentTest")
 
 cleanup()
 os.kill(int(os.environ["DBUS_SESSION_BUS_PID"]), 15)
@@ -133,6 +133,27 @@ def service_manifests():
     return [manifest]
 
 
+CGROUP_V2 = os.path.exists("/sys/fs/cgroup/cgroup.controllers")
+
+
+def cgroup_file(sc, container_id, controller, setting):
+    """ Path of a setting in the cgroup of a container. On cgroup v1 hosts the setting is in
+        the hierarchy of the controller, on cgroup v2 hosts in the cgroup of the init process.
+    """
+    if not CGROUP_V2:
+        return "/sys/fs/cgroup/{}/lxc/SC-{}/{}".format(controller, container_id, setting)
+
+    init_pid = [status[2] for status in sc.list_container_status() if status[0] == container_id][0]
+    with open("/proc/{}/cgroup".format(init_pid), "r") as fh:
+        path = [line.strip()[len("0::"):] for line in fh if line.startswith("0::")][0]
+    return "/sys/fs/cgroup" + path + "/" + setting
+
+
+def read_cgroup_file(path):
+    with open(path, "r") as fh:
+        return fh.read().strip()
+
+
 """##### Test suites #####"""
 
 
@@ -272,3 +293,44 @@ class TestCGroupGateway(object):
             assert value == most_permissive_value
         finally:
             sc.terminate()
+
+    def test_set_cgroup_limits(self):
+        """ Test that limits of a running container can be changed, and that invalid limits
+            are rejected without changing anything.
+        """
+
+        try:
+            sc = Container()
+            cid = sc.start(DATA)
+            sc.set_capabilities(["test.cap.cpu.shares.threshold"])
+
+            if CGROUP_V2:
+                cpu_setting, cpu_value = "cpu.weight", "50"
+                memory_setting = "memory.max"
+            else:
+                cpu_setting, cpu_value = "cpu.shares", "512"
+                memory_setting = "memory.limit_in_bytes"
+            cpu_file = cgroup_file(sc, cid, "cpu", cpu_setting)
+            memory_file = cgroup_file(sc, cid, "memory", memory_setting)
+            memory_value = str(64 * 1024 * 1024)
+
+            sc.set_cgroup_limits({cpu_setting: cpu_value, memory_setting: "64M"})
+            assert read_cgroup_file(cpu_file) == cpu_value
+            assert read_cgroup_file(memory_file) == memory_value
+
+            with pytest.raises(DBusException) as err:
+                sc.set_cgroup_limits({"cpu.weight": "0"})
+            assert err.value.get_dbus_name() == Container.DBUS_EXCEPTION_FAILED
+
+            with pytest.raises(DBusException) as err:
+                sc.set_cgroup_limits({"net_cls.classid": TEST_NETCLS_VALUE})
+            assert err.value.get_dbus_name() == Container.DBUS_EXCEPTION_FAILED
+
+            # The valid limit is applied before the invalid one fails, and is then rolled back
+            with pytest.raises(DBusException) as err:
+                sc.set_cgroup_limits({cpu_setting: "100", memory_setting: "invalid"})
+            assert err.value.get_dbus_name() == Container.DBUS_EXCEPTION_FAILED
+            assert read_cgroup_file(cpu_file) == cpu_value
+            assert read_cgroup_file(memory_file) == memory_value
+        finally:
+            sc.terminate()
@@ -0,0 +1,126 @@
+
+# Copyright (C) 2016-2017 Pelagicore AB
+#
+# Permission to use, copy, modify, and/or distribute this software for
+# any purpose with or without fee is hereby granted, provided that the
+# above copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+# BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+# OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+# ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+# SOFTWARE.
+#
+# For further information see LICENSE
+
+import pytest
+
+import os
+import shutil
+import time
+
+from testframework import Container
+
+
+CURRENT_DIR = os.path.dirname(os.path.realpath(__file__))
+TESTOUTPUT_DIR = CURRENT_DIR + "/testoutput"
+CHECKPOINT_DIR = TESTOUTPUT_DIR + "/checkpoint"
+COUNTER_FILE = CURRENT_DIR + "/counter"
+
+# This function is used by the test framework to know where test specific files should be stored
+def output_dir():
+    return TESTOUTPUT_DIR
+
+# This function is used by the 'agent' fixture to know where the log should be stored
+def logfile_path():
+    return TESTOUTPUT_DIR + "/test.log"
+
+
+DATA = {
+    Container.CONFIG: '[{"writeBufferEnabled": false}]',
+    Container.BIND_MOUNT_DIR: "/gateways/app",
+    Container.HOST_PATH: CURRENT_DIR,
+    Container.READONLY: False
+}
+
+# Counts up in a file in the bind mounted directory. The output is not captured, since
+# the pipe to the agent can not be part of a checkpoint.
+COUNTER = "sh -c 'exec >/dev/null 2>&1; i=0; while true; do i=$((i+1)); " \
+          "echo $i > /gateways/app/counter; sleep 0.05; done'"
+
+
+def read_counter():
+    try:
+        with open(COUNTER_FILE) as f:
+            return int(f.read().strip())
+    except (IOError, ValueError):
+        return 0
+
+
+def wait_for_counter(above, timeout=10):
+    """ Wait until the counter is larger than a value, and return how long it took
+    """
+    start = time.monotonic()
+    while read_counter() <= above:
+        if time.monotonic() - start > timeout:
+            pytest.fail("Counter did not grow above {} in {} s".format(above, timeout))
+        time.sleep(0.01)
+    return time.monotonic() - start
+
+
+@pytest.mark.usefixtures("create_testoutput_dir", "agent", "assert_no_proxy")
+class TestCheckpoint(object):
+    """ This suite tests that containers can be checkpointed to disk and restored, and
+        measures how long a restore takes compared to a cold start.
+
+        The tests use the Agent D-Bus interface to drive the tests.
+    """
+
+    def setup_method(self, method):
+        shutil.rmtree(CHECKPOINT_DIR, ignore_errors=True)
+        if os.path.exists(COUNTER_FILE):
+            os.remove(COUNTER_FILE)
+
+    def test_restore_continues_execution(self):
+        """ Test that a process in a restored container continues where it was
+            checkpointed, and compare the time to restore it with a cold start.
+        """
+        sc = Container()
+        try:
+            start = time.monotonic()
+            container_id = sc.start(DATA)
+            sc.launch_command(COUNTER)
+            wait_for_counter(0)
+            cold_start = time.monotonic() - start
+
+            sc.suspend()
+            checkpointed = read_counter()
+            sc.checkpoint(CHECKPOINT_DIR)
+            assert container_id not in sc.list_containers()
+
+            # The container gets its ID back, and the counter keeps writing through the
+            # bind mount, which is done again
+            start = time.monotonic()
+            assert sc.restore(CHECKPOINT_DIR) == container_id
+            wait_for_counter(checkpointed)
+            restore = time.monotonic() - start
+
+            # The counter continues, it does not start over
+            assert read_counter() > checkpointed
+
+            print("Cold start: {:.3f} s, restore: {:.3f} s".format(cold_start, restore))
+            with open(TESTOUTPUT_DIR + "/checkpoint_timing.txt", "w") as f:
+                f.write("cold_start {:.3f}\nrestore {:.3f}\n".format(cold_start, restore))
+
+        finally:
+            sc.terminate()
+
+    def test_restore_without_checkpoint_fails(self):
+        """ Test that restoring from a directory without a checkpoint fails
+        """
+        sc = Container()
+        with pytest.raises(Exception):
+            sc.restore(CHECKPOINT_DIR)
@@ -136,3 +136,28 @@ class TestContainerQueries(object):
                 pass
             sc2.terminate()
             sc3.terminate()
+
+    def test_list_container_status(self):
+        """ Test that the status of containers is listed, and follows suspend and resume
+        """
+        sc = Container()
+        try:
+            container_id = sc.start(DATA)
+
+            statuses = sc.list_container_status()
+            assert len(statuses) == 1
+            (status_id, state, init_pid, pids, gateways, created, usage) = statuses[0]
+            assert status_id == container_id
+            assert state == "ready"
+            assert init_pid > 0
+            assert created > 0
+            assert len(usage) == 0
+
+            sc.suspend()
+            assert sc.list_container_status()[0][1] == "suspended"
+            sc.resume()
+            assert sc.list_container_status()[0][1] == "ready"
+        finally:
+            sc.terminate()
+
+        assert len(sc.list_container_status()) == 0
@@ -283,6 +283,12 @@ class Container():
         containers = self.__agent.List()
         return containers
 
+    def list_container_status(self, include_usage=False):
+        """ List the status of all containers, as a list of
+            (id, state, init pid, pids, gateway ids, creation time, usage) tuples
+        """
+        return self.__agent.ListContainerStatus(include_usage)
+
     def set_capabilities(self, capabilities):
         """ Set capabilities by passsing a list of strings with capability IDs
         """
@@ -290,6 +296,11 @@ class Container():
         return True if result == dbus.Boolean(True) else False
 
 
+    def set_cgroup_limits(self, limits):
+        """ Change cgroup limits of the container by passing a dict of settings and values
+        """
+        self.__agent.SetCgroupLimits(self.__container_id, limits)
+
     def launch_command(self, binary, stdout="/tmp/stdout", env={}):
         """ Calls LaunchCommand on the Agent D-Bus interface.
 
@@ -354,6 +365,19 @@ class Container():
         if self.__container_id is not None:
             result = self.__agent.Resume(self.__container_id)
 
+    def checkpoint(self, directory):
+        """ Checkpoint the container to a directory, which removes it
+        """
+        if self.__container_id is not None:
+            self.__agent.Checkpoint(self.__container_id, directory)
+            self.__container_id = None
+
+    def restore(self, directory):
+        """ Restore a container checkpointed to a directory, which this helper then manages
+        """
+        self.__container_id = self.__agent.Restore(directory)
+        return self.__container_id
+
     def terminate(self):
         """ Perform teardown of container created by call to 'start'
         """